@@ -0,0 +1,239 @@
+#pragma once
+#include <cassert>
+#include <cstdint>
+#include <algorithm>
+#include <exception>
+#include <functional>
+#include <future>
+#include <memory>
+#include <vector>
+#include "thread_pool.h"
+namespace common
+{
+	/// <summary>
+	/// Records a frame in many command lists and submits them in one ExecuteCommandLists. The
+	/// calling thread records in Current(), RecordParallel splits a run of draw batches in ranges
+	/// that the thread pool records at the same time, each in a list of its own, and then the
+	/// calling thread goes on in a new list. Submit executes all of them in the order they were
+	/// recorded, so it's the same as recording everything in one list.
+	/// Each list has its own allocator, because an allocator can't be used by two threads at once.
+	/// They come from a pool per frame in flight that grows with the lists a frame needs, and they
+	/// are reset when the frame index comes back, so BeginFrame must be called after the gpu is
+	/// done with the frame that had the same index.
+	/// Backend makes, resets, closes and executes the lists, so it can run with stand-ins. See
+	/// D3D12Recording and CommandRecorder in command_recorder.h.
+	/// Use it from one thread, the pool's threads only run the record functions.
+	/// </summary>
+	template<typename Backend>
+	class BasicCommandRecorder
+	{
+	public:
+		using Allocator = typename Backend::Allocator;
+		using List = typename Backend::List;
+		/// <summary>
+		/// What a list of RecordParallel starts with: the lists don't inherit the state, so it
+		/// sets the render targets, the viewport, the root signature and so on.
+		/// </summary>
+		using Setup = std::function<void(const List&)>;
+		/// <summary>
+		/// Records one batch, the index goes from 0 to the batch count. It runs on the pool's
+		/// threads, so it should only record in the list and read what doesn't change meanwhile.
+		/// </summary>
+		using Record = std::function<void(const List&, size_t)>;
+		/// <summary>
+		/// Without a pool RecordParallel records everything in the calling thread.
+		/// minBatchesPerList keeps the lists from being so small that making them costs more
+		/// than recording them.
+		/// </summary>
+		BasicCommandRecorder(Backend backend, uint32_t framesInFlight,
+			std::shared_ptr<ThreadPool> pool = nullptr, size_t minBatchesPerList = 64)
+			:mBackend(std::move(backend)), mFrames(framesInFlight), mPool(pool),
+			mMinBatchesPerList(minBatchesPerList)
+		{
+			assert(framesInFlight > 0);
+			assert(minBatchesPerList > 0);
+		}
+		BasicCommandRecorder(const BasicCommandRecorder&) = delete;
+		BasicCommandRecorder& operator=(const BasicCommandRecorder&) = delete;
+		/// <summary>
+		/// Starts recording the frame with this index in a list of its pool.
+		/// </summary>
+		void BeginFrame(uint32_t frameIndex)
+		{
+			assert(frameIndex < mFrames.size());
+			assert(!mRecording);
+			mFrameIndex = frameIndex;
+			mUsed = 0;
+			mSubmission.clear();
+			mCurrent = Open();
+			mRecording = true;
+		}
+		/// <summary>
+		/// Where the calling thread records, it changes after RecordParallel.
+		/// </summary>
+		const List& Current()const { return mCurrent; }
+		/// <summary>
+		/// Records batchCount batches after what Current() has. The batches are split in
+		/// contiguous ranges, one per list, and the lists go in the submission in the order of the
+		/// ranges. The new Current() gets setup too, so the calling thread goes on with the same
+		/// state. Returns when all the ranges are recorded. The exception of a range is thrown here,
+		/// after the calling thread got a new Current(), and then none of the ranges is submitted.
+		/// </summary>
+		void RecordParallel(size_t batchCount, const Setup& setup, const Record& record)
+		{
+			assert(mRecording);
+			const size_t lists = ListsFor(batchCount);
+			if (lists <= 1)
+			{
+				//not worth a list of its own, the state is alredy there or the caller sets it
+				setup(mCurrent);
+				for (size_t i = 0; i < batchCount; i++)
+					record(mCurrent, i);
+				return;
+			}
+			mBackend.Close(mCurrent);
+			mSubmission.push_back(mCurrent);
+			//the slots are taken here, the pool only grows in this thread
+			const size_t first = mUsed;
+			for (size_t i = 0; i < lists; i++)
+				AcquireSlot();
+			std::vector<Slot>& slots = mFrames[mFrameIndex];
+			auto recordRange = [&slots, &setup, &record, first, lists, batchCount, this](size_t range)
+			{
+				Slot& slot = slots[first + range];
+				mBackend.Reset(slot.allocator, slot.list);
+				try
+				{
+					setup(slot.list);
+					for (size_t i = batchCount * range / lists; i < batchCount * (range + 1) / lists; i++)
+						record(slot.list, i);
+				}
+				catch (...)
+				{
+					//closed anyway, an open list can't be reset the next time
+					mBackend.Close(slot.list);
+					throw;
+				}
+				mBackend.Close(slot.list);
+			};
+			std::vector<std::future<void>> recorded;
+			recorded.reserve(lists - 1);
+			for (size_t range = 1; range < lists; range++)
+				recorded.push_back(mPool->Submit([&recordRange, range]() { recordRange(range); }));
+			//the calling thread records the first range instead of waiting
+			std::exception_ptr error;
+			try
+			{
+				recordRange(0);
+			}
+			catch (...)
+			{
+				error = std::current_exception();
+			}
+			//all of them have to be done before the lambdas go away, even if one threw
+			for (std::future<void>& f : recorded)
+			{
+				try
+				{
+					f.get();
+				}
+				catch (...)
+				{
+					if (!error)
+						error = std::current_exception();
+				}
+			}
+			//half recorded ranges aren't executed
+			if (!error)
+			{
+				for (size_t range = 0; range < lists; range++)
+					mSubmission.push_back(slots[first + range].list);
+			}
+			mCurrent = Open();
+			setup(mCurrent);
+			if (error)
+				std::rethrow_exception(error);
+		}
+		/// <summary>
+		/// Closes Current() and executes the frame's lists in one call.
+		/// </summary>
+		void Submit()
+		{
+			assert(mRecording);
+			mBackend.Close(mCurrent);
+			mSubmission.push_back(mCurrent);
+			mBackend.Execute(mSubmission);
+			mLastListCount = mSubmission.size();
+			mSubmission.clear();
+			mCurrent = List{};
+			mRecording = false;
+		}
+		/// <summary>
+		/// How many lists RecordParallel uses for batchCount batches.
+		/// </summary>
+		size_t ListsFor(size_t batchCount)const
+		{
+			if (mPool == nullptr || batchCount == 0)
+				return 1;
+			const size_t byBatches = (batchCount + mMinBatchesPerList - 1) / mMinBatchesPerList;
+			//the calling thread records a range too
+			return (std::min)(byBatches, mPool->ThreadCount() + 1);
+		}
+		/// <summary>
+		/// The lists that the last Submit executed.
+		/// </summary>
+		size_t LastListCount()const { return mLastListCount; }
+		/// <summary>
+		/// The lists of all the pools, each one with its allocator.
+		/// </summary>
+		size_t ListCount()const
+		{
+			size_t count = 0;
+			for (const std::vector<Slot>& slots : mFrames)
+				count += slots.size();
+			return count;
+		}
+	private:
+		struct Slot
+		{
+			Allocator allocator;
+			List list;
+		};
+		/// <summary>
+		/// The next unused slot of the frame's pool, a new one if they're all used.
+		/// </summary>
+		Slot& AcquireSlot()
+		{
+			std::vector<Slot>& slots = mFrames[mFrameIndex];
+			if (mUsed == slots.size())
+			{
+				Allocator allocator = mBackend.CreateAllocator();
+				List list = mBackend.CreateList(allocator);
+				slots.push_back({ allocator, list });
+			}
+			return slots[mUsed++];
+		}
+		/// <summary>
+		/// A list of the frame's pool, reset and ready to record.
+		/// </summary>
+		List Open()
+		{
+			Slot& slot = AcquireSlot();
+			mBackend.Reset(slot.allocator, slot.list);
+			return slot.list;
+		}
+		Backend mBackend;
+		//a pool of lists per frame in flight
+		std::vector<std::vector<Slot>> mFrames;
+		std::shared_ptr<ThreadPool> mPool;
+		size_t mMinBatchesPerList;
+		uint32_t mFrameIndex = 0;
+		//the slots of the frame's pool that the frame took
+		size_t mUsed = 0;
+		//the closed lists, in the order they will execute
+		std::vector<List> mSubmission;
+		List mCurrent{};
+		bool mRecording = false;
+		size_t mLastListCount = 0;
+	};
+}
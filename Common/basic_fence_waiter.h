@@ -0,0 +1,236 @@
+#pragma once
+#include <cstdint>
+#include <cassert>
+#include <functional>
+#include <iterator>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <algorithm>
+namespace common
+{
+	/// <summary>
+	/// Waits for fences without making an event each time: the events are kept in a pool and reused.
+	/// It can wait for many fences at once, for all of them or for the first one, and it can run
+	/// callbacks on a thread of its own when a fence gets to a value, so that the render thread
+	/// doesn't block to release or stream things.
+	/// Fence needs GetCompletedValue() and SetEventOnCompletion(value, event), Events makes, sets
+	/// and waits the events, so it can run with stand-ins. Only std here, the d3d12 version is
+	/// FenceWaiter in fence_waiter.h.
+	/// The fences must live until the waits and the callbacks on them are done. Thread safe.
+	/// </summary>
+	template<typename Fence, typename Events>
+	class BasicFenceWaiter
+	{
+	public:
+		using Event = typename Events::Event;
+		using Callback = std::function<void()>;
+		/// <summary>
+		/// A fence and the value to wait for.
+		/// </summary>
+		struct Point
+		{
+			Fence* fence;
+			uint64_t value;
+		};
+		BasicFenceWaiter() = default;
+		/// <summary>
+		/// Stops the thread, the callbacks that didn't run are dropped.
+		/// </summary>
+		~BasicFenceWaiter()
+		{
+			{
+				std::lock_guard<std::mutex> lock(mMutex);
+				mStopping = true;
+			}
+			if (mThread.joinable())
+			{
+				Events::Set(mWake);
+				mThread.join();
+			}
+			mPending.clear();
+			if (mWake != Event{})
+				Events::Destroy(mWake);
+			for (Event e : mFreeEvents)
+				Events::Destroy(e);
+		}
+		BasicFenceWaiter(const BasicFenceWaiter&) = delete;
+		BasicFenceWaiter& operator=(const BasicFenceWaiter&) = delete;
+		static bool IsComplete(const Point& point)
+		{
+			return point.fence->GetCompletedValue() >= point.value;
+		}
+		void Wait(Fence* fence, uint64_t value)
+		{
+			WaitAll({ { fence, value } });
+		}
+		/// <summary>
+		/// Returns when all the fences got to their values. Each fence signals an event of its own.
+		/// </summary>
+		void WaitAll(const std::vector<Point>& points)
+		{
+			std::vector<Event> events;
+			//an event of the pool can be signaled by an old wait, so it checks the fences again
+			for (bool done = false; !done; )
+			{
+				done = true;
+				for (const Point& point : points)
+				{
+					if (IsComplete(point))
+						continue;
+					Event e = AcquireEvent();
+					point.fence->SetEventOnCompletion(point.value, e);
+					events.push_back(e);
+					done = false;
+				}
+				for (Event e : events)
+				{
+					Events::Wait(e);
+					ReleaseEvent(e);
+				}
+				events.clear();
+			}
+		}
+		/// <summary>
+		/// Returns when one of the fences got to its value, and its index in points.
+		/// </summary>
+		size_t WaitAny(const std::vector<Point>& points)
+		{
+			assert(!points.empty());
+			std::vector<Event> events;
+			while (true)
+			{
+				for (size_t i = 0; i < points.size(); i++)
+					if (IsComplete(points[i]))
+						return i;
+				for (const Point& point : points)
+				{
+					Event e = AcquireEvent();
+					point.fence->SetEventOnCompletion(point.value, e);
+					events.push_back(e);
+				}
+				Events::WaitAny(events.data(), events.size());
+				//the others stay registered in their fences, a later wait on them checks again
+				for (Event e : events)
+					ReleaseEvent(e);
+				events.clear();
+			}
+		}
+		/// <summary>
+		/// Runs callback on the waiter's thread when fence gets to value, even if it alredy did.
+		/// The ones that get ready together run in the order they were added. On win32 the thread
+		/// can wait for up to 63 different fences.
+		/// </summary>
+		void OnCompletion(Fence* fence, uint64_t value, Callback callback)
+		{
+			{
+				std::lock_guard<std::mutex> lock(mMutex);
+				if (mWake == Event{})
+				{
+					mWake = Events::Create();
+					mThread = std::thread([this]() { Run(); });
+				}
+				mPending.push_back({ { fence, value }, std::move(callback) });
+			}
+			Events::Set(mWake);
+		}
+		size_t PendingCallbacks()const
+		{
+			std::lock_guard<std::mutex> lock(mMutex);
+			return mPending.size();
+		}
+		/// <summary>
+		/// How many events the pool has made, it only grows with the waits that happen at once.
+		/// </summary>
+		size_t EventCount()const
+		{
+			std::lock_guard<std::mutex> lock(mMutex);
+			return mEventCount;
+		}
+	private:
+		struct Pending
+		{
+			Point point;
+			Callback callback;
+		};
+		Event AcquireEvent()
+		{
+			{
+				std::lock_guard<std::mutex> lock(mMutex);
+				if (!mFreeEvents.empty())
+				{
+					Event e = mFreeEvents.back();
+					mFreeEvents.pop_back();
+					return e;
+				}
+				mEventCount++;
+			}
+			return Events::Create();
+		}
+		void ReleaseEvent(Event e)
+		{
+			std::lock_guard<std::mutex> lock(mMutex);
+			mFreeEvents.push_back(e);
+		}
+		/// <summary>
+		/// The thread: runs the callbacks that are ready, then waits for the lowest value of each
+		/// fence or for OnCompletion to wake it up.
+		/// </summary>
+		void Run()
+		{
+			std::vector<Pending> ready;
+			std::vector<Point> lowest;
+			std::vector<Event> events;
+			while (true)
+			{
+				{
+					std::lock_guard<std::mutex> lock(mMutex);
+					if (mStopping)
+						return;
+					//stable, the ready ones keep the order they were added in
+					auto firstWaiting = std::stable_partition(mPending.begin(), mPending.end(),
+						[](const Pending& p) { return IsComplete(p.point); });
+					std::move(mPending.begin(), firstWaiting, std::back_inserter(ready));
+					mPending.erase(mPending.begin(), firstWaiting);
+					lowest.clear();
+					for (const Pending& p : mPending)
+					{
+						auto it = std::find_if(lowest.begin(), lowest.end(),
+							[&p](const Point& l) { return l.fence == p.point.fence; });
+						if (it == lowest.end())
+							lowest.push_back(p.point);
+						else
+							it->value = (std::min)(it->value, p.point.value);
+					}
+				}
+				if (!ready.empty())
+				{
+					for (Pending& p : ready)
+						p.callback();
+					//the captures are released here too, not on the render thread
+					ready.clear();
+					continue;
+				}
+				events.push_back(mWake);
+				for (const Point& point : lowest)
+				{
+					Event e = AcquireEvent();
+					point.fence->SetEventOnCompletion(point.value, e);
+					events.push_back(e);
+				}
+				Events::WaitAny(events.data(), events.size());
+				for (size_t i = 1; i < events.size(); i++)
+					ReleaseEvent(events[i]);
+				events.clear();
+			}
+		}
+		mutable std::mutex mMutex;
+		std::vector<Event> mFreeEvents;
+		size_t mEventCount = 0;
+		std::vector<Pending> mPending;
+		//OnCompletion and the destructor set it to wake the thread up, the thread starts with it
+		Event mWake{};
+		std::thread mThread;
+		bool mStopping = false;
+	};
+}
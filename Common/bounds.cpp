@@ -0,0 +1,125 @@
+#include "pch.h"
+#include "bounds.h"
+#include <cmath>
+using namespace DirectX;
+
+void common::ComputeAabb(const XMFLOAT3* positions, size_t count, XMFLOAT3& aabbMin, XMFLOAT3& aabbMax)
+{
+    if (count == 0)
+    {
+        aabbMin = aabbMax = XMFLOAT3(0, 0, 0);
+        return;
+    }
+    XMVECTOR vMin = XMLoadFloat3(&positions[0]);
+    XMVECTOR vMax = vMin;
+    for (size_t i = 1; i < count; i++)
+    {
+        XMVECTOR p = XMLoadFloat3(&positions[i]);
+        vMin = XMVectorMin(vMin, p);
+        vMax = XMVectorMax(vMax, p);
+    }
+    XMStoreFloat3(&aabbMin, vMin);
+    XMStoreFloat3(&aabbMax, vMax);
+}
+
+namespace
+{
+    //rounding in the growing step can leave a point a hair outside, culling must be conservative
+    constexpr float RADIUS_EPSILON = 1e-5f;
+
+    void RitterSphere(const XMFLOAT3* positions, size_t count, XMVECTOR& center, float& radius)
+    {
+        //the points with the smallest and biggest x, y and z
+        size_t minIndex[3] = { 0, 0, 0 };
+        size_t maxIndex[3] = { 0, 0, 0 };
+        for (size_t i = 1; i < count; i++)
+        {
+            const float p[3] = { positions[i].x, positions[i].y, positions[i].z };
+            for (size_t axis = 0; axis < 3; axis++)
+            {
+                const float* pMin = &positions[minIndex[axis]].x;
+                const float* pMax = &positions[maxIndex[axis]].x;
+                if (p[axis] < pMin[axis])
+                    minIndex[axis] = i;
+                if (p[axis] > pMax[axis])
+                    maxIndex[axis] = i;
+            }
+        }
+        //the pair that is farthest apart is the first guess for the diameter
+        size_t bestAxis = 0;
+        float bestDistanceSq = -1;
+        for (size_t axis = 0; axis < 3; axis++)
+        {
+            const float d = XMVectorGetX(XMVector3LengthSq(
+                XMLoadFloat3(&positions[maxIndex[axis]]) - XMLoadFloat3(&positions[minIndex[axis]])));
+            if (d > bestDistanceSq)
+            {
+                bestDistanceSq = d;
+                bestAxis = axis;
+            }
+        }
+        center = (XMLoadFloat3(&positions[minIndex[bestAxis]]) + XMLoadFloat3(&positions[maxIndex[bestAxis]])) * 0.5f;
+        radius = sqrtf(bestDistanceSq) * 0.5f;
+        //grow the sphere towards each point that is outside, just enough to take it in
+        for (size_t i = 0; i < count; i++)
+        {
+            XMVECTOR toPoint = XMLoadFloat3(&positions[i]) - center;
+            const float d = XMVectorGetX(XMVector3Length(toPoint));
+            if (d <= radius)
+                continue;
+            const float newRadius = (radius + d) * 0.5f;
+            center += toPoint * ((newRadius - radius) / d);
+            radius = newRadius;
+        }
+    }
+
+    /// <summary>
+    /// The smallest of Ritter's sphere and the sphere around the center of the box.
+    /// </summary>
+    void BestSphere(const XMFLOAT3* positions, size_t count, const XMFLOAT3& aabbMin, const XMFLOAT3& aabbMax,
+        XMFLOAT3& center, float& radius)
+    {
+        XMVECTOR c;
+        float r;
+        RitterSphere(positions, count, c, r);
+        //for boxy meshes the sphere around the center of the aabb can be better
+        XMVECTOR boxCenter = (XMLoadFloat3(&aabbMin) + XMLoadFloat3(&aabbMax)) * 0.5f;
+        float boxRadiusSq = 0;
+        for (size_t i = 0; i < count; i++)
+        {
+            const float d = XMVectorGetX(XMVector3LengthSq(XMLoadFloat3(&positions[i]) - boxCenter));
+            boxRadiusSq = d > boxRadiusSq ? d : boxRadiusSq;
+        }
+        const float boxRadius = sqrtf(boxRadiusSq);
+        if (boxRadius < r)
+        {
+            c = boxCenter;
+            r = boxRadius;
+        }
+        XMStoreFloat3(&center, c);
+        radius = r * (1.0f + RADIUS_EPSILON);
+    }
+}
+
+void common::ComputeBoundingSphere(const XMFLOAT3* positions, size_t count, XMFLOAT3& center, float& radius)
+{
+    if (count == 0)
+    {
+        center = XMFLOAT3(0, 0, 0);
+        radius = 0;
+        return;
+    }
+    XMFLOAT3 aabbMin, aabbMax;
+    ComputeAabb(positions, count, aabbMin, aabbMax);
+    BestSphere(positions, count, aabbMin, aabbMax, center, radius);
+}
+
+common::MeshBounds common::ComputeMeshBounds(const XMFLOAT3* positions, size_t count)
+{
+    MeshBounds bounds = {};
+    if (count == 0)
+        return bounds;
+    ComputeAabb(positions, count, bounds.aabbMin, bounds.aabbMax);
+    BestSphere(positions, count, bounds.aabbMin, bounds.aabbMax, bounds.sphereCenter, bounds.sphereRadius);
+    return bounds;
+}
@@ -0,0 +1,41 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include <DirectXMath.h>
+namespace common
+{
+	/// <summary>
+	/// Bounding volumes of a mesh, in mesh space: an axis aligned box and a sphere. The padding is
+	/// there because it's part of the cooked mesh format.
+	/// </summary>
+	struct MeshBounds
+	{
+		DirectX::XMFLOAT3 aabbMin;
+		float pad0;
+		DirectX::XMFLOAT3 aabbMax;
+		float pad1;
+		DirectX::XMFLOAT3 sphereCenter;
+		float sphereRadius;
+	};
+	static_assert(sizeof(MeshBounds) == 48, "MeshBounds is part of the cooked mesh format");
+	/// <summary>
+	/// Min and max of the positions, 4 wide with DirectXMath.
+	/// </summary>
+	void ComputeAabb(const DirectX::XMFLOAT3* positions, size_t count,
+		DirectX::XMFLOAT3& aabbMin, DirectX::XMFLOAT3& aabbMax);
+	/// <summary>
+	/// Ritter's sphere: starts from the most distant pair of the extreme points in x, y and z and
+	/// grows to take in the points that are left out. It's within a few percent of the minimal
+	/// sphere; if the sphere around the center of the aabb is smaller, that one is returned.
+	/// </summary>
+	void ComputeBoundingSphere(const DirectX::XMFLOAT3* positions, size_t count,
+		DirectX::XMFLOAT3& center, float& radius);
+	/// <summary>
+	/// Both volumes. An empty mesh has a zero sized box and sphere at the origin.
+	/// </summary>
+	MeshBounds ComputeMeshBounds(const DirectX::XMFLOAT3* positions, size_t count);
+	inline MeshBounds ComputeMeshBounds(const std::vector<DirectX::XMFLOAT3>& positions)
+	{
+		return ComputeMeshBounds(positions.data(), positions.size());
+	}
+}
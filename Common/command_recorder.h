@@ -0,0 +1,57 @@
+#pragma once
+#include "pch.h"
+#include "basic_command_recorder.h"
+namespace common
+{
+	/// <summary>
+	/// Direct command lists of a device, executed in a queue.
+	/// </summary>
+	struct D3D12Recording
+	{
+		using Allocator = Microsoft::WRL::ComPtr<ID3D12CommandAllocator>;
+		using List = Microsoft::WRL::ComPtr<ID3D12GraphicsCommandList>;
+		Microsoft::WRL::ComPtr<ID3D12Device> device;
+		Microsoft::WRL::ComPtr<ID3D12CommandQueue> queue;
+		Allocator CreateAllocator()
+		{
+			Allocator allocator;
+			HRESULT hr = device->CreateCommandAllocator(D3D12_COMMAND_LIST_TYPE_DIRECT, IID_PPV_ARGS(&allocator));
+			if (FAILED(hr))
+				throw std::runtime_error("could not create the command allocator");
+			return allocator;
+		}
+		/// <summary>
+		/// Closed, Reset opens it.
+		/// </summary>
+		List CreateList(const Allocator& allocator)
+		{
+			List list;
+			HRESULT hr = device->CreateCommandList(0, D3D12_COMMAND_LIST_TYPE_DIRECT, allocator.Get(),
+				nullptr, IID_PPV_ARGS(&list));
+			if (FAILED(hr))
+				throw std::runtime_error("could not create the command list");
+			list->Close();
+			return list;
+		}
+		void Reset(const Allocator& allocator, const List& list)
+		{
+			HRESULT hr = allocator->Reset();
+			assert(hr == S_OK);
+			hr = list->Reset(allocator.Get(), nullptr);
+			assert(hr == S_OK);
+		}
+		void Close(const List& list)
+		{
+			HRESULT hr = list->Close();
+			assert(hr == S_OK);
+		}
+		void Execute(const std::vector<List>& lists)
+		{
+			std::vector<ID3D12CommandList*> raw(lists.size());
+			for (size_t i = 0; i < lists.size(); i++)
+				raw[i] = lists[i].Get();
+			queue->ExecuteCommandLists(static_cast<UINT>(raw.size()), raw.data());
+		}
+	};
+	using CommandRecorder = BasicCommandRecorder<D3D12Recording>;
+}
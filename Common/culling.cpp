@@ -0,0 +1,82 @@
+#include "pch.h"
+#include "culling.h"
+#include <algorithm>
+using namespace DirectX;
+
+common::Frustum common::FrustumFromMatrix(FXMMATRIX viewProjection)
+{
+    //clip = v * M, so the planes come from the columns of M, that are the rows of the transpose
+    XMMATRIX t = XMMatrixTranspose(viewProjection);
+    XMVECTOR planes[6] = {
+        t.r[3] + t.r[0], //left
+        t.r[3] - t.r[0], //right
+        t.r[3] + t.r[1], //bottom
+        t.r[3] - t.r[1], //top
+        t.r[2],          //near, z goes from 0 to 1
+        t.r[3] - t.r[2]  //far
+    };
+    Frustum frustum;
+    for (size_t i = 0; i < 6; i++)
+        XMStoreFloat4(&frustum.planes[i], XMPlaneNormalize(planes[i]));
+    return frustum;
+}
+
+bool common::IsSphereInFrustum(const Frustum& frustum, const XMFLOAT3& center, float radius)
+{
+    XMVECTOR c = XMLoadFloat3(&center);
+    for (const XMFLOAT4& plane : frustum.planes)
+    {
+        if (XMVectorGetX(XMPlaneDotCoord(XMLoadFloat4(&plane), c)) < -radius)
+            return false;
+    }
+    return true;
+}
+
+bool common::IsClusterBackfacing(const MeshletBounds& bounds, const XMFLOAT3& cameraPosition)
+{
+    if (bounds.coneCutoff >= 1.0f)
+        return false;
+    XMVECTOR toCenter = XMLoadFloat3(&bounds.center) - XMLoadFloat3(&cameraPosition);
+    const float distance = XMVectorGetX(XMVector3Length(toCenter));
+    return XMVectorGetX(XMVector3Dot(toCenter, XMLoadFloat3(&bounds.coneAxis))) >=
+        bounds.coneCutoff * distance + bounds.radius;
+}
+
+common::MeshletBounds common::TransformBounds(const MeshletBounds& bounds, FXMMATRIX world)
+{
+    MeshletBounds result = bounds;
+    XMStoreFloat3(&result.center, XMVector3TransformCoord(XMLoadFloat3(&bounds.center), world));
+    const float scale = (std::max)({
+        XMVectorGetX(XMVector3Length(world.r[0])),
+        XMVectorGetX(XMVector3Length(world.r[1])),
+        XMVectorGetX(XMVector3Length(world.r[2])) });
+    result.radius = bounds.radius * scale;
+    //only right for uniform scale, the others would need the inverse transpose and a wider cone
+    XMStoreFloat3(&result.coneAxis, XMVector3Normalize(XMVector3TransformNormal(XMLoadFloat3(&bounds.coneAxis), world)));
+    return result;
+}
+
+bool common::IsClusterVisible(const MeshletBounds& worldBounds, const Frustum& frustum, const XMFLOAT3& cameraPosition)
+{
+    return IsSphereInFrustum(frustum, worldBounds.center, worldBounds.radius) &&
+        !IsClusterBackfacing(worldBounds, cameraPosition);
+}
+
+void common::CullMeshlets(const std::vector<Meshlet>& meshlets, const std::vector<MeshletBounds>& bounds,
+    FXMMATRIX world, const Frustum& frustum, const XMFLOAT3& cameraPosition,
+    std::vector<IndexRange>& result)
+{
+    assert(meshlets.size() == bounds.size());
+    result.clear();
+    for (size_t i = 0; i < meshlets.size(); i++)
+    {
+        if (!IsClusterVisible(TransformBounds(bounds[i], world), frustum, cameraPosition))
+            continue;
+        const uint32_t firstIndex = meshlets[i].triangleOffset * 3;
+        const uint32_t indexCount = meshlets[i].triangleCount * 3;
+        if (!result.empty() && result.back().firstIndex + result.back().indexCount == firstIndex)
+            result.back().indexCount += indexCount;
+        else
+            result.push_back({ firstIndex, indexCount });
+    }
+}
@@ -0,0 +1,46 @@
+#pragma once
+#include <cstdint>
+#include <array>
+#include <vector>
+#include <DirectXMath.h>
+#include "meshlet.h"
+namespace common
+{
+	/// <summary>
+	/// The 6 planes of the view volume, pointing inwards, normalized. xyz = normal, w = distance.
+	/// </summary>
+	struct Frustum
+	{
+		std::array<DirectX::XMFLOAT4, 6> planes;
+	};
+	/// <summary>
+	/// A piece of an index buffer, what DrawIndexedInstanced wants.
+	/// </summary>
+	struct IndexRange
+	{
+		uint32_t firstIndex;
+		uint32_t indexCount;
+	};
+	/// <summary>
+	/// Extracts the planes from a (row vector, D3D style z in [0,1]) view projection matrix.
+	/// If the matrix has the model matrix too the planes are in model space.
+	/// </summary>
+	Frustum FrustumFromMatrix(DirectX::FXMMATRIX viewProjection);
+	bool IsSphereInFrustum(const Frustum& frustum, const DirectX::XMFLOAT3& center, float radius);
+	/// <summary>
+	/// True if every triangle of the cluster faces away from the camera.
+	/// </summary>
+	bool IsClusterBackfacing(const MeshletBounds& bounds, const DirectX::XMFLOAT3& cameraPosition);
+	/// <summary>
+	/// Moves the bounds to world space. The radius is scaled by the biggest scale of the matrix.
+	/// </summary>
+	MeshletBounds TransformBounds(const MeshletBounds& bounds, DirectX::FXMMATRIX world);
+	bool IsClusterVisible(const MeshletBounds& worldBounds, const Frustum& frustum, const DirectX::XMFLOAT3& cameraPosition);
+	/// <summary>
+	/// Culls the meshlets of a mesh drawn with the world matrix and writes the index ranges of the
+	/// visible ones into result. Neighbouring visible meshlets are merged in a single range.
+	/// </summary>
+	void CullMeshlets(const std::vector<Meshlet>& meshlets, const std::vector<MeshletBounds>& bounds,
+		DirectX::FXMMATRIX world, const Frustum& frustum, const DirectX::XMFLOAT3& cameraPosition,
+		std::vector<IndexRange>& result);
+}
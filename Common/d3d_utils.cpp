@@ -1,6 +1,9 @@
 #include "pch.h"
 #include "d3d_utils.h"
 #include "concatenate.h"
+#include "upload_batch.h"
+#include "placed_resource_allocator.h"
+#include "fence_waiter.h"
 using Microsoft::WRL::ComPtr;
 
 
@@ -68,6 +71,20 @@ Microsoft::WRL::ComPtr<ID3D12CommandQueue> common::CreateDirectCommandQueue(
     queue->SetName(name.c_str());
     return queue;
 }
+
+Microsoft::WRL::ComPtr<ID3D12CommandQueue> common::CreateCopyCommandQueue(
+    Microsoft::WRL::ComPtr<ID3D12Device> device, const std::wstring& name)
+{
+    assert(device != nullptr);
+    ComPtr<ID3D12CommandQueue> queue;
+    D3D12_COMMAND_QUEUE_DESC cqDesc = {};
+    cqDesc.Flags = D3D12_COMMAND_QUEUE_FLAG_NONE;
+    cqDesc.Type = D3D12_COMMAND_LIST_TYPE_COPY; // only copies, it runs at the same time as the direct queue
+    HRESULT hr = device->CreateCommandQueue(&cqDesc, IID_PPV_ARGS(&queue));
+    assert(hr == S_OK);
+    queue->SetName(name.c_str());
+    return queue;
+}
 DXGI_MODE_DESC DescribeSwapChainBackBuffer(int w, int h, DXGI_FORMAT fmt = DXGI_FORMAT_R8G8B8A8_UNORM)
 {
     DXGI_MODE_DESC backBufferDesc = {};
@@ -185,60 +202,23 @@ Microsoft::WRL::ComPtr<ID3D12Debug> common::CreateDebugLayer()
 #endif
 
 Microsoft::WRL::ComPtr<ID3D12Resource> common::CreateBuffer(ID3D12Device* device,
-    ID3D12CommandQueue* commandQueue,
+    UploadBatch& uploadBatch,
     const void* data,
-    UINT64 size,
-    Microsoft::WRL::ComPtr<ID3D12Resource>& uploadBuffer)
+    UINT64 size)
 {
-    Microsoft::WRL::ComPtr<ID3D12Resource> buffer;
-
-    // Create the default heap (GPU memory)
-    CD3DX12_HEAP_PROPERTIES heapProps(D3D12_HEAP_TYPE_DEFAULT);
-    CD3DX12_RESOURCE_DESC bufferDesc = CD3DX12_RESOURCE_DESC::Buffer(size);
-    device->CreateCommittedResource(
-        &heapProps,
-        D3D12_HEAP_FLAG_NONE,
-        &bufferDesc,
-        D3D12_RESOURCE_STATE_COMMON,
-        nullptr,
-        IID_PPV_ARGS(&buffer)
-    );
-
-    // Create an upload heap (CPU memory)
-    heapProps = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD);
-    device->CreateCommittedResource(
-        &heapProps,
-        D3D12_HEAP_FLAG_NONE,
-        &bufferDesc,
-        D3D12_RESOURCE_STATE_GENERIC_READ,
-        nullptr,
-        IID_PPV_ARGS(&uploadBuffer)
-    );
-
-    // Map and copy data to the upload heap
-    void* mappedData;
-    uploadBuffer->Map(0, nullptr, &mappedData);
-    memcpy(mappedData, data, size);
-    uploadBuffer->Unmap(0, nullptr);
-    // Copy data from the upload heap to the GPU heap
-    common::RunCommands(device, commandQueue, [&buffer, &uploadBuffer, size](auto lst) {
-        lst->CopyBufferRegion(buffer.Get(), 0, uploadBuffer.Get(), 0, size);
-
-        // Transition the buffer to the vertex buffer state
-        CD3DX12_RESOURCE_BARRIER barrier = CD3DX12_RESOURCE_BARRIER::Transition(
-            buffer.Get(),
-            D3D12_RESOURCE_STATE_COPY_DEST,
-            D3D12_RESOURCE_STATE_VERTEX_AND_CONSTANT_BUFFER
-        );
-        lst->ResourceBarrier(1, &barrier);
-    });
+    // Placed in one of the default heaps (GPU memory)
+    Microsoft::WRL::ComPtr<ID3D12Resource> buffer = PlacedResourceAllocator::Default(device)->CreateBuffer(
+        D3D12_HEAP_TYPE_DEFAULT, size, D3D12_RESOURCE_STATE_COMMON);
+    // Copy data to the staging memory and from there to the GPU heap, then to the vertex buffer state
+    uploadBatch.Copy(buffer.Get(), 0, data, size, D3D12_RESOURCE_STATE_VERTEX_AND_CONSTANT_BUFFER);
     return buffer;
 }
 
 void common::RunCommands(
     ID3D12Device* device,
     ID3D12CommandQueue* commandQueue,
-    std::function<void(Microsoft::WRL::ComPtr<ID3D12GraphicsCommandList>)> callback)
+    std::function<void(Microsoft::WRL::ComPtr<ID3D12GraphicsCommandList>)> callback,
+    FenceWaiter* waiter)
 {
     assert(device != nullptr);
     assert(commandQueue != nullptr);
@@ -269,10 +249,13 @@ void common::RunCommands(
     commandQueue->ExecuteCommandLists(1, ppCommandLists);
     commandQueue->Signal(_fence.Get(), fenceCompletitionValue);//increases the fence to the value that indicates that the process is done
     //wait until the fence value goes from 0 to 1
-    HANDLE fenceEvent = CreateEventW(nullptr, FALSE, FALSE, nullptr);
-    assert(fenceEvent != nullptr);
-    _fence->SetEventOnCompletion(fenceCompletitionValue, fenceEvent);
-    WaitForSingleObject(fenceEvent, INFINITE);
+    if (waiter != nullptr)
+    {
+        waiter->Wait(_fence.Get(), fenceCompletitionValue);
+        return;
+    }
+    FenceWaiter ownWaiter;
+    ownWaiter.Wait(_fence.Get(), fenceCompletitionValue);
 }
 
 std::vector<Microsoft::WRL::ComPtr<ID3D12CommandAllocator>> common::CreateCommandAllocators(int amount,
@@ -1,7 +1,9 @@
 #pragma once
 #include "pch.h"
+#include "fence_waiter.h"
 namespace common
 {
+	class UploadBatch;
 	class RenderTargetViewData
 	{
 	public:
@@ -41,6 +43,12 @@ namespace common
 	Microsoft::WRL::ComPtr<ID3D12CommandQueue> CreateDirectCommandQueue(
 		Microsoft::WRL::ComPtr<ID3D12Device> device, const std::wstring& name);
 	/// <summary>
+	/// Create a copy command queue, for uploads that run while the direct queue renders.
+	/// Its command lists can only use the common and copy states, see UploadBatch.
+	/// </summary>
+	Microsoft::WRL::ComPtr<ID3D12CommandQueue> CreateCopyCommandQueue(
+		Microsoft::WRL::ComPtr<ID3D12Device> device, const std::wstring& name);
+	/// <summary>
 	/// Creates the swapchain for the given window, with the given size.
 	/// </summary>
 	/// <param name="hwnd"></param>
@@ -96,15 +104,20 @@ namespace common
 	/// <param name="device">a valid device</param>
 	/// <param name="commandQueue">a valid command queue</param>
 	/// <param name="callback">the callback with the commands</param>
+	/// <param name="waiter">the caller's waiter, to reuse its events. Without one the call makes a
+	/// waiter that lives until it returns</param>
 	void RunCommands(
 		ID3D12Device* device,
 		ID3D12CommandQueue* commandQueue,
-		std::function<void(Microsoft::WRL::ComPtr<ID3D12GraphicsCommandList>)> callback);
-	
+		std::function<void(Microsoft::WRL::ComPtr<ID3D12GraphicsCommandList>)> callback,
+		FenceWaiter* waiter = nullptr);
+	/// <summary>
+	/// Creates a buffer in the default heap with a copy of data. The copy is recorded in uploadBatch,
+	/// the buffer has the data after the batch is submitted, in D3D12_RESOURCE_STATE_VERTEX_AND_CONSTANT_BUFFER.
+	/// </summary>
 	Microsoft::WRL::ComPtr<ID3D12Resource> CreateBuffer(ID3D12Device* device,
-		ID3D12CommandQueue* commandQueue,
+		UploadBatch& uploadBatch,
 		const void* data,
-		UINT64 size,
-		Microsoft::WRL::ComPtr<ID3D12Resource>& uploadBuffer);
+		UINT64 size);
 
 }
@@ -0,0 +1,44 @@
+#include "pch.h"
+#include "dirty_ranges.h"
+#include <algorithm>
+
+common::DirtyRanges::DirtyRanges(uint32_t mergeGap)
+    :mMergeGap(mergeGap)
+{
+}
+
+void common::DirtyRanges::Mark(uint32_t first, uint32_t count)
+{
+    if (count == 0)
+        return;
+    //the usual case, the next element of the last range
+    if (!mRanges.empty() && mRanges.back().first + mRanges.back().count == first)
+    {
+        mRanges.back().count += count;
+        return;
+    }
+    mRanges.push_back({ first, count });
+}
+
+std::vector<common::DirtyRanges::Range> common::DirtyRanges::Take()
+{
+    std::vector<Range> ranges;
+    ranges.swap(mRanges);
+    std::sort(ranges.begin(), ranges.end(), [](const Range& a, const Range& b) { return a.first < b.first; });
+    size_t merged = 0;
+    for (size_t i = 1; i < ranges.size(); i++)
+    {
+        Range& last = ranges[merged];
+        const uint64_t lastEnd = uint64_t(last.first) + last.count;
+        if (ranges[i].first <= lastEnd + mMergeGap)
+        {
+            const uint64_t end = (std::max)(lastEnd, uint64_t(ranges[i].first) + ranges[i].count);
+            last.count = static_cast<uint32_t>(end - last.first);
+        }
+        else
+            ranges[++merged] = ranges[i];
+    }
+    if (!ranges.empty())
+        ranges.resize(merged + 1);
+    return ranges;
+}
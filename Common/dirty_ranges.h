@@ -0,0 +1,36 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+namespace common
+{
+	/// <summary>
+	/// The elements of a buffer that changed since the last upload, as sorted ranges, so that only
+	/// those are copied. Elements marked in order grow the last range, so marking is cheap when the
+	/// changes come in index order.
+	/// </summary>
+	class DirtyRanges
+	{
+	public:
+		struct Range
+		{
+			uint32_t first;
+			uint32_t count;
+		};
+		/// <summary>
+		/// Ranges with up to mergeGap clean elements between them are joined: one bigger copy is
+		/// cheaper than many tiny ones.
+		/// </summary>
+		explicit DirtyRanges(uint32_t mergeGap = 0);
+		void Mark(uint32_t index) { Mark(index, 1); }
+		void Mark(uint32_t first, uint32_t count);
+		/// <summary>
+		/// The ranges sorted by first, without overlaps, and forgets them.
+		/// </summary>
+		std::vector<Range> Take();
+		bool IsEmpty()const { return mRanges.empty(); }
+		void Clear() { mRanges.clear(); }
+	private:
+		uint32_t mMergeGap;
+		std::vector<Range> mRanges;
+	};
+}
@@ -0,0 +1,34 @@
+#pragma once
+#include "pch.h"
+#include "basic_fence_waiter.h"
+namespace common
+{
+	/// <summary>
+	/// Auto reset win32 events, for ID3D12Fence::SetEventOnCompletion.
+	/// </summary>
+	struct Win32Events
+	{
+		using Event = HANDLE;
+		static Event Create()
+		{
+			HANDLE e = CreateEventW(nullptr, FALSE, FALSE, nullptr);
+			if (e == nullptr)
+				throw std::runtime_error("could not create the fence event");
+			return e;
+		}
+		static void Destroy(Event e) { CloseHandle(e); }
+		static void Set(Event e) { SetEvent(e); }
+		static void Wait(Event e) { WaitForSingleObject(e, INFINITE); }
+		/// <summary>
+		/// Index of the event that was signaled, at most MAXIMUM_WAIT_OBJECTS events.
+		/// </summary>
+		static size_t WaitAny(const Event* events, size_t count)
+		{
+			assert(count > 0 && count <= MAXIMUM_WAIT_OBJECTS);
+			const DWORD r = WaitForMultipleObjects(static_cast<DWORD>(count), events, FALSE, INFINITE);
+			assert(r < WAIT_OBJECT_0 + count);
+			return r - WAIT_OBJECT_0;
+		}
+	};
+	using FenceWaiter = BasicFenceWaiter<ID3D12Fence, Win32Events>;
+}
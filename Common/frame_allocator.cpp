@@ -0,0 +1,42 @@
+#include "pch.h"
+#include "frame_allocator.h"
+#include "placed_resource_allocator.h"
+using Microsoft::WRL::ComPtr;
+
+common::FrameAllocator::FrameAllocator(ComPtr<ID3D12Device> device, uint32_t frameCount, uint64_t bytesPerFrame,
+    const std::wstring& name)
+    :mFrameCount(frameCount),
+    //each part begins aligned like the allocations
+    mBytesPerFrame((bytesPerFrame + D3D12_CONSTANT_BUFFER_DATA_PLACEMENT_ALIGNMENT - 1) &
+        ~uint64_t(D3D12_CONSTANT_BUFFER_DATA_PLACEMENT_ALIGNMENT - 1))
+{
+    assert(frameCount > 0 && bytesPerFrame > 0);
+    mBuffer = PlacedResourceAllocator::Default(device)->CreateBuffer(D3D12_HEAP_TYPE_UPLOAD,
+        mBytesPerFrame * mFrameCount, D3D12_RESOURCE_STATE_GENERIC_READ);
+    mBuffer->SetName(name.c_str());
+    //upload heaps can stay mapped, we never read from it
+    CD3DX12_RANGE readRange(0, 0);
+    HRESULT hr = mBuffer->Map(0, &readRange, reinterpret_cast<void**>(&mMapped));
+    assert(SUCCEEDED(hr));
+    mGpuAddress = mBuffer->GetGPUVirtualAddress();
+}
+
+void common::FrameAllocator::BeginFrame(uint32_t frameIndex)
+{
+    assert(frameIndex < mFrameCount);
+    mFrameIndex = frameIndex;
+    mCursor = 0;
+}
+
+common::FrameAllocator::Allocation common::FrameAllocator::Allocate(uint64_t size, uint64_t alignment)
+{
+    assert(size > 0);
+    assert(alignment > 0 && (alignment & (alignment - 1)) == 0);
+    const uint64_t offset = (mCursor + alignment - 1) & ~(alignment - 1);
+    if (offset + size > mBytesPerFrame)
+        throw std::runtime_error("the frame allocator is full, give it more bytes per frame");
+    mCursor = offset + size;
+    mPeakSize = (std::max)(mPeakSize, mCursor);
+    const uint64_t address = mFrameIndex * mBytesPerFrame + offset;
+    return { mMapped + address, mGpuAddress + address };
+}
@@ -0,0 +1,66 @@
+#pragma once
+#include "pch.h"
+namespace common
+{
+	/// <summary>
+	/// Memory for the constants that change every frame (cameras, passes, draws). One upload buffer,
+	/// mapped for its whole life and split in one part per frame in flight: each frame bumps a
+	/// pointer in its part, so writing the next frame never touches what the gpu may still read.
+	/// Call BeginFrame when the frame that last used the part is done on the gpu, that's the
+	/// caller's job because it owns the fences.
+	/// Not thread safe, use it from the thread that records the frame.
+	/// </summary>
+	class FrameAllocator
+	{
+	public:
+		struct Allocation
+		{
+			void* cpuAddress;
+			D3D12_GPU_VIRTUAL_ADDRESS gpuAddress;
+		};
+		FrameAllocator(Microsoft::WRL::ComPtr<ID3D12Device> device, uint32_t frameCount,
+			uint64_t bytesPerFrame = 1 << 20, const std::wstring& name = L"FrameAllocator");
+		FrameAllocator(const FrameAllocator&) = delete;
+		FrameAllocator& operator=(const FrameAllocator&) = delete;
+		/// <summary>
+		/// Starts using the part of frameIndex from the beginning.
+		/// </summary>
+		void BeginFrame(uint32_t frameIndex);
+		/// <summary>
+		/// Aligned to 256 bytes by default, what a constant buffer view needs. Throws if the frame
+		/// runs out of memory.
+		/// </summary>
+		Allocation Allocate(uint64_t size, uint64_t alignment = D3D12_CONSTANT_BUFFER_DATA_PLACEMENT_ALIGNMENT);
+		/// <summary>
+		/// Copies data and returns its address, to bind as a root constant buffer view.
+		/// </summary>
+		template<typename T>
+		D3D12_GPU_VIRTUAL_ADDRESS Store(const T& data)
+		{
+			static_assert(std::is_trivially_copyable<T>::value, "the data is copied as bytes");
+			Allocation allocation = Allocate(sizeof(T));
+			memcpy(allocation.cpuAddress, &data, sizeof(T));
+			return allocation.gpuAddress;
+		}
+		uint32_t FrameCount()const { return mFrameCount; }
+		uint32_t FrameIndex()const { return mFrameIndex; }
+		uint64_t BytesPerFrame()const { return mBytesPerFrame; }
+		/// <summary>
+		/// How much the current frame took, with the alignment.
+		/// </summary>
+		uint64_t UsedSize()const { return mCursor; }
+		/// <summary>
+		/// The most any frame took, to size bytesPerFrame.
+		/// </summary>
+		uint64_t PeakSize()const { return mPeakSize; }
+	private:
+		Microsoft::WRL::ComPtr<ID3D12Resource> mBuffer;
+		uint8_t* mMapped = nullptr;
+		D3D12_GPU_VIRTUAL_ADDRESS mGpuAddress = 0;
+		const uint32_t mFrameCount;
+		const uint64_t mBytesPerFrame;
+		uint32_t mFrameIndex = 0;
+		uint64_t mCursor = 0;
+		uint64_t mPeakSize = 0;
+	};
+}
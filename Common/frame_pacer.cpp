@@ -0,0 +1,155 @@
+#include "pch.h"
+#include "frame_pacer.h"
+#include <thread>
+#include <chrono>
+
+namespace
+{
+#if defined(_WIN32)
+#ifndef CREATE_WAITABLE_TIMER_HIGH_RESOLUTION
+#define CREATE_WAITABLE_TIMER_HIGH_RESOLUTION 0x00000002
+#endif
+    class Win32Clock final : public common::FramePacer::Clock
+    {
+    public:
+        Win32Clock()
+        {
+            __int64 countsPerSec;
+            QueryPerformanceFrequency((LARGE_INTEGER*)&countsPerSec);
+            mSecondsPerCount = 1.0 / (double)countsPerSec;
+            //the high resolution timer is from windows 10 1803, the plain one is ~1ms at best
+            mTimer = CreateWaitableTimerExW(nullptr, nullptr, CREATE_WAITABLE_TIMER_HIGH_RESOLUTION, TIMER_ALL_ACCESS);
+            if (mTimer == nullptr)
+                mTimer = CreateWaitableTimerExW(nullptr, nullptr, 0, TIMER_ALL_ACCESS);
+        }
+        ~Win32Clock()
+        {
+            if (mTimer != nullptr)
+                CloseHandle(mTimer);
+        }
+        double Now() override
+        {
+            __int64 count;
+            QueryPerformanceCounter((LARGE_INTEGER*)&count);
+            return count * mSecondsPerCount;
+        }
+        void Sleep(double seconds) override
+        {
+            if (seconds <= 0.0)
+                return;
+            if (mTimer == nullptr)
+            {
+                std::this_thread::sleep_for(std::chrono::duration<double>(seconds));
+                return;
+            }
+            //relative time, in 100ns
+            LARGE_INTEGER dueTime;
+            dueTime.QuadPart = -static_cast<LONGLONG>(seconds * 1e7);
+            SetWaitableTimer(mTimer, &dueTime, 0, nullptr, nullptr, FALSE);
+            WaitForSingleObject(mTimer, INFINITE);
+        }
+    private:
+        double mSecondsPerCount;
+        HANDLE mTimer;
+    };
+#else
+    class SteadyClock final : public common::FramePacer::Clock
+    {
+    public:
+        double Now() override
+        {
+            return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+        }
+        void Sleep(double seconds) override
+        {
+            if (seconds > 0.0)
+                std::this_thread::sleep_for(std::chrono::duration<double>(seconds));
+        }
+    };
+#endif
+}
+
+void common::FramePacer::Clock::Spin()
+{
+    std::this_thread::yield();
+}
+
+std::shared_ptr<common::FramePacer::Clock> common::FramePacer::SystemClock()
+{
+#if defined(_WIN32)
+    return std::make_shared<Win32Clock>();
+#else
+    return std::make_shared<SteadyClock>();
+#endif
+}
+
+common::FramePacer::FramePacer(const Settings& settings, Queue queue, std::shared_ptr<Clock> clock)
+    :mSettings(settings), mQueue(std::move(queue)), mClock(clock)
+{
+    assert(mClock != nullptr);
+    assert(mQueue.completedValue && mQueue.waitForValue);
+}
+
+void common::FramePacer::WaitUntil(double deadline)
+{
+    const double sleepTime = deadline - mSettings.spinTime - mClock->Now();
+    if (sleepTime > 0.0)
+        mClock->Sleep(sleepTime);
+    while (mClock->Now() < deadline)
+        mClock->Spin();
+}
+
+void common::FramePacer::BeginFrame()
+{
+    double now = mClock->Now();
+    const double begin = now;
+    //the frames the gpu finished
+    const uint64_t completed = mQueue.completedValue();
+    while (!mPresented.empty() && mPresented.front() <= completed)
+        mPresented.pop_front();
+    //room for this frame in the queue: the oldest ones have to be done
+    if (mSettings.maxQueuedFrames > 0 && mPresented.size() >= mSettings.maxQueuedFrames)
+    {
+        const size_t excess = mPresented.size() - mSettings.maxQueuedFrames + 1;
+        mQueue.waitForValue(mPresented[excess - 1]);
+        mPresented.erase(mPresented.begin(), mPresented.begin() + excess);
+        now = mClock->Now();
+    }
+    mStats.queueWait = now - begin;
+    mStats.rateWait = 0.0;
+    if (mSettings.targetFps > 0.0 && mFrameStart >= 0.0)
+    {
+        const double interval = 1.0 / mSettings.targetFps;
+        const double deadline = mFrameStart + interval;
+        if (now < deadline)
+        {
+            WaitUntil(deadline);
+            mStats.rateWait = mClock->Now() - now;
+            //the next deadline comes from this one, so the sleep's imprecision doesn't add up
+            now = deadline;
+        }
+    }
+    //late frames don't build up a debt, the next one is a frame time after this one
+    if (mFrameStart >= 0.0)
+        mStats.frameTime = now - mFrameStart;
+    mFrameStart = now;
+}
+
+void common::FramePacer::Presented(uint64_t fenceValue)
+{
+    assert(mPresented.empty() || mPresented.back() < fenceValue);
+    mPresented.push_back(fenceValue);
+    if (mFirstInput.has_value())
+    {
+        mStats.inputLatency = mClock->Now() - *mFirstInput;
+        mStats.maxInputLatency = (std::max)(mStats.maxInputLatency, mStats.inputLatency);
+        mStats.framesWithInput++;
+        mFirstInput.reset();
+    }
+}
+
+void common::FramePacer::InputReceived()
+{
+    if (!mFirstInput.has_value())
+        mFirstInput = mClock->Now();
+}
@@ -0,0 +1,107 @@
+#pragma once
+#include <cstdint>
+#include <memory>
+#include <functional>
+#include <optional>
+#include <deque>
+namespace common
+{
+	/// <summary>
+	/// Paces the frames so that the cpu doesn't run ahead for nothing: at most maxQueuedFrames
+	/// presented frames that the gpu didn't finish, and at most targetFps frames per second. To be
+	/// precise without burning a core the wait is a sleep until spinTime before the deadline and
+	/// then a spin on the clock. It also measures the latency from the first input after a present
+	/// to the next present, the one of the frame that saw it.
+	/// The clock and the gpu queue are given from outside, so it can run with a simulated clock.
+	/// Not thread safe, use it from the thread that presents.
+	/// </summary>
+	class FramePacer
+	{
+	public:
+		struct Settings
+		{
+			//presented frames the gpu can have queued, 0 doesn't limit them
+			uint32_t maxQueuedFrames = 2;
+			//0 doesn't cap the frame rate
+			double targetFps = 0.0;
+			//the sleeps are only so precise, the last part of the wait spins
+			double spinTime = 0.002;
+		};
+		/// <summary>
+		/// Time in seconds. The pacer calls Spin between the checks of the last part of a wait, a
+		/// simulated clock moves its time there.
+		/// </summary>
+		class Clock
+		{
+		public:
+			virtual ~Clock() = default;
+			virtual double Now() = 0;
+			virtual void Sleep(double seconds) = 0;
+			/// <summary>
+			/// Gives the core away for a moment, by default std::this_thread::yield.
+			/// </summary>
+			virtual void Spin();
+		};
+		/// <summary>
+		/// QueryPerformanceCounter and a high resolution waitable timer when the os has it.
+		/// </summary>
+		static std::shared_ptr<Clock> SystemClock();
+		/// <summary>
+		/// Where the presented frames are: the last fence value the gpu completed and a wait for a
+		/// value. The fence values given to Presented must grow.
+		/// </summary>
+		struct Queue
+		{
+			std::function<uint64_t()> completedValue;
+			std::function<void(uint64_t)> waitForValue;
+		};
+		struct Stats
+		{
+			double frameTime = 0.0;
+			//how long BeginFrame waited for the queue and for the frame rate, in the last frame
+			double queueWait = 0.0;
+			double rateWait = 0.0;
+			//input to present, of the last frame that had input, and the worst one
+			double inputLatency = 0.0;
+			double maxInputLatency = 0.0;
+			uint64_t framesWithInput = 0;
+		};
+		FramePacer(const Settings& settings, Queue queue, std::shared_ptr<Clock> clock = SystemClock());
+		/// <summary>
+		/// Call before the frame's update. Waits for the queue to have room and for the frame's time.
+		/// </summary>
+		void BeginFrame();
+		/// <summary>
+		/// Call after the present, with the fence value the frame signals.
+		/// </summary>
+		void Presented(uint64_t fenceValue);
+		/// <summary>
+		/// Call when input arrives. Only the first one after each present counts for the latency.
+		/// </summary>
+		void InputReceived();
+		/// <summary>
+		/// Takes effect in the next BeginFrame.
+		/// </summary>
+		void SetSettings(const Settings& settings) { mSettings = settings; }
+		const Settings& GetSettings()const { return mSettings; }
+		const Stats& GetStats()const { return mStats; }
+		/// <summary>
+		/// Presented frames that the gpu may not have finished.
+		/// </summary>
+		size_t QueuedFrames()const { return mPresented.size(); }
+	private:
+		/// <summary>
+		/// Sleeps until spinTime before deadline and spins the rest.
+		/// </summary>
+		void WaitUntil(double deadline);
+		Settings mSettings;
+		Queue mQueue;
+		std::shared_ptr<Clock> mClock;
+		//the fence values of the presented frames that weren't seen completed yet, in order
+		std::deque<uint64_t> mPresented;
+		//when the last frame was allowed to begin, the next one is a frame time after it
+		double mFrameStart = -1.0;
+		std::optional<double> mFirstInput;
+		Stats mStats;
+	};
+}
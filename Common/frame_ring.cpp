@@ -0,0 +1,21 @@
+#include "pch.h"
+#include "frame_ring.h"
+
+common::FrameRing::FrameRing(uint32_t framesInFlight)
+    :mSlotFenceValues(framesInFlight, 0)
+{
+    assert(framesInFlight > 0);
+}
+
+uint64_t common::FrameRing::BeginFrame()
+{
+    mIndex = (mIndex + 1) % Count();
+    mFenceValue++;
+    return mSlotFenceValues[mIndex];
+}
+
+uint64_t common::FrameRing::EndFrame()
+{
+    mSlotFenceValues[mIndex] = mFenceValue;
+    return mFenceValue;
+}
@@ -0,0 +1,38 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+namespace common
+{
+	/// <summary>
+	/// The bookkeeping of N frames in flight on one fence: which slot the frame being recorded uses,
+	/// the fence value it signals and the value to wait for before reusing a slot. The fence and the
+	/// queue stay with the caller, so it can be driven by a stand-in queue.
+	/// The value of the frame being recorded is signaled after its lists; a slot is reused N frames
+	/// later, so the cpu only waits when it gets N frames ahead of the gpu.
+	/// </summary>
+	class FrameRing
+	{
+	public:
+		explicit FrameRing(uint32_t framesInFlight);
+		/// <summary>
+		/// Starts the next frame in the next slot. Returns the fence value the gpu must reach before
+		/// the slot's allocators and memory are reused, 0 if the slot was never used.
+		/// </summary>
+		uint64_t BeginFrame();
+		/// <summary>
+		/// The frame's lists were submitted. Returns the fence value to signal after them.
+		/// </summary>
+		uint64_t EndFrame();
+		/// <summary>
+		/// The value the frame being recorded signals, what the gpu must reach to be done with it.
+		/// </summary>
+		uint64_t FenceValue()const { return mFenceValue; }
+		uint32_t Index()const { return mIndex; }
+		uint32_t Count()const { return static_cast<uint32_t>(mSlotFenceValues.size()); }
+	private:
+		//what each slot signaled the last time it was used
+		std::vector<uint64_t> mSlotFenceValues;
+		uint64_t mFenceValue = 0;
+		uint32_t mIndex = 0;
+	};
+}
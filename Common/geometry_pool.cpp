@@ -0,0 +1,196 @@
+#include "pch.h"
+#include "geometry_pool.h"
+#include "vertex.h"
+#include "placed_resource_allocator.h"
+#include <algorithm>
+using Microsoft::WRL::ComPtr;
+
+common::GeometryPool::GeometryPool(ComPtr<ID3D12Device> device, std::shared_ptr<UploadBatch> uploadBatch,
+    VertexFormat vertexFormat, uint32_t vertexCapacity, uint32_t index16Capacity, uint32_t index32Capacity)
+    :mDevice(device), mUploadBatch(uploadBatch), mVertexFormat(vertexFormat),
+    mVertices(vertexCapacity, vertexFormat == VertexFormat::Packed ? sizeof(PackedVertex) : sizeof(Vertex),
+        D3D12_RESOURCE_STATE_VERTEX_AND_CONSTANT_BUFFER, L"GeometryPool vertices"),
+    mIndices16(index16Capacity, sizeof(uint16_t), D3D12_RESOURCE_STATE_INDEX_BUFFER, L"GeometryPool indices16"),
+    mIndices32(index32Capacity, sizeof(uint32_t), D3D12_RESOURCE_STATE_INDEX_BUFFER, L"GeometryPool indices32")
+{
+}
+
+UINT common::GeometryPool::VertexStride()const
+{
+    return mVertices.elementSize;
+}
+
+common::GeometryPool::Heap& common::GeometryPool::Indices(DXGI_FORMAT indexFormat)
+{
+    assert(indexFormat == DXGI_FORMAT_R16_UINT || indexFormat == DXGI_FORMAT_R32_UINT);
+    return indexFormat == DXGI_FORMAT_R16_UINT ? mIndices16 : mIndices32;
+}
+
+const common::GeometryPool::Heap& common::GeometryPool::Indices(DXGI_FORMAT indexFormat)const
+{
+    assert(indexFormat == DXGI_FORMAT_R16_UINT || indexFormat == DXGI_FORMAT_R32_UINT);
+    return indexFormat == DXGI_FORMAT_R16_UINT ? mIndices16 : mIndices32;
+}
+
+common::OffsetAllocator::Handle common::GeometryPool::AllocateVertices(uint32_t count)
+{
+    return Allocate(mVertices, count);
+}
+
+common::OffsetAllocator::Handle common::GeometryPool::AllocateIndices(DXGI_FORMAT indexFormat, uint32_t count)
+{
+    return Allocate(Indices(indexFormat), count);
+}
+
+void common::GeometryPool::FreeVertices(OffsetAllocator::Handle handle)
+{
+    Free(mVertices, handle);
+}
+
+void common::GeometryPool::FreeIndices(DXGI_FORMAT indexFormat, OffsetAllocator::Handle handle)
+{
+    Free(Indices(indexFormat), handle);
+}
+
+void common::GeometryPool::SetFrameFence(ComPtr<ID3D12Fence> fence, std::function<uint64_t()> pendingValue)
+{
+    mFrameFence = fence;
+    mPendingFenceValue = pendingValue;
+}
+
+void common::GeometryPool::Free(Heap& heap, OffsetAllocator::Handle handle)
+{
+    if (mFrameFence == nullptr)
+    {
+        heap.allocator.Free(handle);
+        return;
+    }
+    //the frame being recorded and the ones before it may have drawn it
+    mPendingFrees.push_back({ mPendingFenceValue(), &heap, handle });
+}
+
+void common::GeometryPool::ReleaseCompleted()
+{
+    if (mPendingFrees.empty())
+        return;
+    //polled here and not with a FenceWaiter callback, the allocators belong to this thread
+    const uint64_t completed = mFrameFence->GetCompletedValue();
+    while (!mPendingFrees.empty() && mPendingFrees.front().fenceValue <= completed)
+    {
+        mPendingFrees.front().heap->allocator.Free(mPendingFrees.front().handle);
+        mPendingFrees.pop_front();
+    }
+}
+
+UINT common::GeometryPool::BaseVertex(OffsetAllocator::Handle handle)const
+{
+    return static_cast<UINT>(mVertices.allocator.Offset(handle));
+}
+
+UINT common::GeometryPool::FirstIndex(DXGI_FORMAT indexFormat, OffsetAllocator::Handle handle)const
+{
+    return static_cast<UINT>(Indices(indexFormat).allocator.Offset(handle));
+}
+
+common::OffsetAllocator::Handle common::GeometryPool::Allocate(Heap& heap, uint32_t count)
+{
+    ReleaseCompleted();
+    OffsetAllocator::Handle handle = heap.allocator.Allocate(count);
+    if (handle == OffsetAllocator::INVALID_HANDLE)
+    {
+        //double it, so that growing many times in a row stays linear
+        const uint64_t capacity = heap.allocator.Capacity();
+        heap.allocator.Grow((std::max)(capacity * 2, capacity + count));
+        if (heap.buffer != nullptr)
+            Rebuild(heap, {});
+        handle = heap.allocator.Allocate(count);
+        assert(handle != OffsetAllocator::INVALID_HANDLE);
+    }
+    //the buffer is only created when the first mesh comes
+    if (heap.buffer == nullptr)
+        heap.buffer = CreateBuffer(heap, heap.allocator.Capacity());
+    return handle;
+}
+
+ComPtr<ID3D12Resource> common::GeometryPool::CreateBuffer(const Heap& heap, uint64_t capacity)
+{
+    //bigger than a heap it ends up committed, the allocator decides
+    ComPtr<ID3D12Resource> buffer = PlacedResourceAllocator::Default(mDevice)->CreateBuffer(D3D12_HEAP_TYPE_DEFAULT,
+        capacity * heap.elementSize, D3D12_RESOURCE_STATE_COMMON);
+    buffer->SetName(heap.name);
+    return buffer;
+}
+
+void common::GeometryPool::Rebuild(Heap& heap, const std::vector<OffsetAllocator::Move>& moves)
+{
+    ComPtr<ID3D12Resource> old = heap.buffer;
+    ComPtr<ID3D12Resource> rebuilt = CreateBuffer(heap, heap.allocator.Capacity());
+    const UINT elementSize = heap.elementSize;
+    //the copies to the old buffer alredy recorded in the batch happen before these
+    if (moves.empty())
+    {
+        //growing: everything stays where it was
+        mUploadBatch->CopyBuffer(rebuilt.Get(), 0, old.Get(), 0, old->GetDesc().Width, heap.readState);
+    }
+    else
+    {
+        for (const OffsetAllocator::Move& m : moves)
+            mUploadBatch->CopyBuffer(rebuilt.Get(), m.to * elementSize, old.Get(), m.from * elementSize,
+                m.size * elementSize, heap.readState);
+    }
+    //only read by the copies from now on, the direct queue doesn't get it back
+    mUploadBatch->Forget(old.Get());
+    mUploadBatch->KeepAlive(old);
+    heap.buffer = rebuilt;
+}
+
+void common::GeometryPool::Upload(OffsetAllocator::Handle vertices, DXGI_FORMAT indexFormat,
+    OffsetAllocator::Handle indices, const Writer& write)
+{
+    Heap& indexHeap = Indices(indexFormat);
+    const uint64_t vertexBytes = mVertices.allocator.Size(vertices) * mVertices.elementSize;
+    const uint64_t indexBytes = indexHeap.allocator.Size(indices) * indexHeap.elementSize;
+    const uint64_t vertexDst = mVertices.allocator.Offset(vertices) * mVertices.elementSize;
+    const uint64_t indexDst = indexHeap.allocator.Offset(indices) * indexHeap.elementSize;
+    //both copies in the same batch, the staging memory is written after them
+    mUploadBatch->Reserve((vertexBytes + 15) / 16 * 16 + (indexBytes + 15) / 16 * 16);
+    void* stagedVertices = mUploadBatch->Copy(mVertices.buffer.Get(), vertexDst, vertexBytes, mVertices.readState);
+    void* stagedIndices = mUploadBatch->Copy(indexHeap.buffer.Get(), indexDst, indexBytes, indexHeap.readState);
+    write(stagedVertices, stagedIndices);
+}
+
+void common::GeometryPool::Defragment()
+{
+    //the ranges still in flight are moved like the others
+    ReleaseCompleted();
+    Heap* heaps[3] = { &mVertices, &mIndices16, &mIndices32 };
+    for (Heap* heap : heaps)
+    {
+        if (heap->buffer == nullptr || heap->allocator.IsCompact())
+            continue;
+        Rebuild(*heap, heap->allocator.Defragment());
+    }
+}
+
+D3D12_VERTEX_BUFFER_VIEW common::GeometryPool::VertexBufferView()const
+{
+    D3D12_VERTEX_BUFFER_VIEW view = {};
+    if (mVertices.buffer == nullptr)
+        return view;
+    view.BufferLocation = mVertices.buffer->GetGPUVirtualAddress();
+    view.StrideInBytes = mVertices.elementSize;
+    view.SizeInBytes = static_cast<UINT>(mVertices.allocator.Capacity() * mVertices.elementSize);
+    return view;
+}
+
+D3D12_INDEX_BUFFER_VIEW common::GeometryPool::IndexBufferView(DXGI_FORMAT indexFormat)const
+{
+    const Heap& heap = Indices(indexFormat);
+    D3D12_INDEX_BUFFER_VIEW view = {};
+    if (heap.buffer == nullptr)
+        return view;
+    view.BufferLocation = heap.buffer->GetGPUVirtualAddress();
+    view.SizeInBytes = static_cast<UINT>(heap.allocator.Capacity() * heap.elementSize);
+    view.Format = indexFormat;
+    return view;
+}
@@ -0,0 +1,125 @@
+#pragma once
+#include "pch.h"
+#include "offset_allocator.h"
+#include "upload_batch.h"
+#include <deque>
+namespace common
+{
+	/// <summary>
+	/// One big vertex buffer and one big index buffer per index format, the meshes are ranges
+	/// of them (base vertex, first index). All the meshes of a pool share the bindings, so the
+	/// draws only need different offsets. The buffers grow when they are full.
+	/// </summary>
+	class GeometryPool
+	{
+	public:
+		/// <summary>
+		/// Receives the mapped upload memory: vertexCount vertices of the pool's vertex format
+		/// and indexCount indices of the allocation's index format.
+		/// </summary>
+		using Writer = std::function<void(void* vertices, void* indices)>;
+		/// <summary>
+		/// The capacities are in vertices and indices, size them for the meshes that will be
+		/// loaded: a buffer is only created when its first mesh comes and grows if it's not enough.
+		/// All the copies are recorded in uploadBatch, the pool is ready when it's submitted.
+		/// </summary>
+		GeometryPool(Microsoft::WRL::ComPtr<ID3D12Device> device,
+			std::shared_ptr<UploadBatch> uploadBatch,
+			VertexFormat vertexFormat,
+			uint32_t vertexCapacity,
+			uint32_t index16Capacity,
+			uint32_t index32Capacity);
+		GeometryPool(const GeometryPool&) = delete;
+		GeometryPool& operator=(const GeometryPool&) = delete;
+		VertexFormat GetVertexFormat()const { return mVertexFormat; }
+		UINT VertexStride()const;
+		/// <summary>
+		/// Space for a mesh. Grows the buffers if needed, copying the old ones in the batch.
+		/// </summary>
+		OffsetAllocator::Handle AllocateVertices(uint32_t count);
+		OffsetAllocator::Handle AllocateIndices(DXGI_FORMAT indexFormat, uint32_t count);
+		/// <summary>
+		/// With a frame fence the range is reused once the fence gets to the value the frame being
+		/// recorded will signal, so the frames in flight can still draw it. Without one it's reused
+		/// right away.
+		/// </summary>
+		void FreeVertices(OffsetAllocator::Handle handle);
+		void FreeIndices(DXGI_FORMAT indexFormat, OffsetAllocator::Handle handle);
+		/// <summary>
+		/// The fence that the frames that draw from the pool signal, and the value that the frame
+		/// being recorded will signal.
+		/// </summary>
+		void SetFrameFence(Microsoft::WRL::ComPtr<ID3D12Fence> fence, std::function<uint64_t()> pendingValue);
+		/// <summary>
+		/// Gives back to the allocators the freed ranges that the gpu is done with. Allocate and
+		/// Defragment do it, call it to see them in the allocators before that.
+		/// </summary>
+		void ReleaseCompleted();
+		/// <summary>
+		/// Where the allocation is now, Defragment can change it.
+		/// </summary>
+		UINT BaseVertex(OffsetAllocator::Handle handle)const;
+		UINT FirstIndex(DXGI_FORMAT indexFormat, OffsetAllocator::Handle handle)const;
+		/// <summary>
+		/// Records the copy of the vertices and indices of a mesh to its ranges. write gets the staging
+		/// memory right away, the data is in the buffers when the batch is submitted.
+		/// </summary>
+		void Upload(OffsetAllocator::Handle vertices, DXGI_FORMAT indexFormat, OffsetAllocator::Handle indices,
+			const Writer& write);
+		/// <summary>
+		/// Packs the meshes at the beginning of the buffers. Copies to new buffers in the batch, the old
+		/// ones live until it's done, so the frames alredy submitted still work. The offsets change
+		/// right away: submit the batch before the frames recorded after this one.
+		/// </summary>
+		void Defragment();
+		D3D12_VERTEX_BUFFER_VIEW VertexBufferView()const;
+		D3D12_INDEX_BUFFER_VIEW IndexBufferView(DXGI_FORMAT indexFormat)const;
+		const OffsetAllocator& VertexAllocator()const { return mVertices.allocator; }
+		const OffsetAllocator& IndexAllocator(DXGI_FORMAT indexFormat)const { return Indices(indexFormat).allocator; }
+		const std::shared_ptr<UploadBatch>& Batch()const { return mUploadBatch; }
+	private:
+		/// <summary>
+		/// A gpu buffer and the allocator of its elements.
+		/// </summary>
+		struct Heap
+		{
+			Heap(uint32_t capacity, UINT elementSize, D3D12_RESOURCE_STATES readState, const wchar_t* name)
+				:allocator(capacity), elementSize(elementSize), readState(readState), name(name) {}
+			OffsetAllocator allocator;
+			Microsoft::WRL::ComPtr<ID3D12Resource> buffer;
+			const UINT elementSize;
+			//vertex or index buffer, where the buffer is when not being copied to
+			const D3D12_RESOURCE_STATES readState;
+			const wchar_t* name;
+		};
+		/// <summary>
+		/// A range that was freed while the frames up to fenceValue could still draw it.
+		/// </summary>
+		struct PendingFree
+		{
+			uint64_t fenceValue;
+			Heap* heap;
+			OffsetAllocator::Handle handle;
+		};
+		void Free(Heap& heap, OffsetAllocator::Handle handle);
+		Heap& Indices(DXGI_FORMAT indexFormat);
+		const Heap& Indices(DXGI_FORMAT indexFormat)const;
+		OffsetAllocator::Handle Allocate(Heap& heap, uint32_t count);
+		Microsoft::WRL::ComPtr<ID3D12Resource> CreateBuffer(const Heap& heap, uint64_t capacity);
+		/// <summary>
+		/// Replaces the buffer of the heap by one with the current capacity of its allocator, copying
+		/// the ranges in moves to their new place and everything else where it was.
+		/// </summary>
+		void Rebuild(Heap& heap, const std::vector<OffsetAllocator::Move>& moves);
+		Microsoft::WRL::ComPtr<ID3D12Device> mDevice;
+		std::shared_ptr<UploadBatch> mUploadBatch;
+		const VertexFormat mVertexFormat;
+		Heap mVertices;
+		Heap mIndices16;
+		Heap mIndices32;
+		Microsoft::WRL::ComPtr<ID3D12Fence> mFrameFence;
+		std::function<uint64_t()> mPendingFenceValue;
+		//in the order they were freed, so the fence values only go up
+		std::deque<PendingFree> mPendingFrees;
+	};
+}
@@ -0,0 +1,136 @@
+#include "pch.h"
+#include "hash.h"
+#include <algorithm>
+#include <cstring>
+
+namespace
+{
+    constexpr uint64_t PRIME1 = 0x9E3779B185EBCA87ull;
+    constexpr uint64_t PRIME2 = 0xC2B2AE3D27D4EB4Full;
+    constexpr uint64_t PRIME3 = 0x165667B19E3779F9ull;
+    constexpr uint64_t PRIME4 = 0x85EBCA77C2B2AE63ull;
+    constexpr uint64_t PRIME5 = 0x27D4EB2F165667C5ull;
+
+    uint64_t Rotl(uint64_t x, int r)
+    {
+        return (x << r) | (x >> (64 - r));
+    }
+    //unaligned reads, memcpy is turned into a plain load
+    uint64_t Read64(const uint8_t* p)
+    {
+        uint64_t v;
+        memcpy(&v, p, sizeof(v));
+        return v;
+    }
+    uint32_t Read32(const uint8_t* p)
+    {
+        uint32_t v;
+        memcpy(&v, p, sizeof(v));
+        return v;
+    }
+    uint64_t Round(uint64_t acc, uint64_t input)
+    {
+        acc += input * PRIME2;
+        acc = Rotl(acc, 31);
+        return acc * PRIME1;
+    }
+    uint64_t MergeRound(uint64_t acc, uint64_t value)
+    {
+        acc ^= Round(0, value);
+        return acc * PRIME1 + PRIME4;
+    }
+    /// <summary>
+    /// Consumes all the 32 byte stripes of [p, p + size), returns how many bytes it used.
+    /// </summary>
+    size_t ConsumeStripes(uint64_t acc[4], const uint8_t* p, size_t size)
+    {
+        size_t used = 0;
+        for (; used + 32 <= size; used += 32)
+        {
+            acc[0] = Round(acc[0], Read64(p + used));
+            acc[1] = Round(acc[1], Read64(p + used + 8));
+            acc[2] = Round(acc[2], Read64(p + used + 16));
+            acc[3] = Round(acc[3], Read64(p + used + 24));
+        }
+        return used;
+    }
+    uint64_t Finalize(const uint64_t acc[4], uint64_t seed, uint64_t totalSize, const uint8_t* tail, size_t tailSize)
+    {
+        uint64_t h;
+        if (totalSize >= 32)
+        {
+            h = Rotl(acc[0], 1) + Rotl(acc[1], 7) + Rotl(acc[2], 12) + Rotl(acc[3], 18);
+            for (size_t i = 0; i < 4; i++)
+                h = MergeRound(h, acc[i]);
+        }
+        else
+        {
+            h = seed + PRIME5;
+        }
+        h += totalSize;
+        size_t i = 0;
+        for (; i + 8 <= tailSize; i += 8)
+        {
+            h ^= Round(0, Read64(tail + i));
+            h = Rotl(h, 27) * PRIME1 + PRIME4;
+        }
+        if (i + 4 <= tailSize)
+        {
+            h ^= uint64_t(Read32(tail + i)) * PRIME1;
+            h = Rotl(h, 23) * PRIME2 + PRIME3;
+            i += 4;
+        }
+        for (; i < tailSize; i++)
+        {
+            h ^= tail[i] * PRIME5;
+            h = Rotl(h, 11) * PRIME1;
+        }
+        //avalanche
+        h ^= h >> 33;
+        h *= PRIME2;
+        h ^= h >> 29;
+        h *= PRIME3;
+        h ^= h >> 32;
+        return h;
+    }
+}
+
+uint64_t common::XXH64(const void* data, size_t size, uint64_t seed)
+{
+    uint64_t acc[4] = { seed + PRIME1 + PRIME2, seed + PRIME2, seed, seed - PRIME1 };
+    const uint8_t* p = reinterpret_cast<const uint8_t*>(data);
+    const size_t used = ConsumeStripes(acc, p, size);
+    return Finalize(acc, seed, size, p + used, size - used);
+}
+
+common::XXH64State::XXH64State(uint64_t seed)
+    :mAcc{ seed + PRIME1 + PRIME2, seed + PRIME2, seed, seed - PRIME1 }, mSeed(seed)
+{
+}
+
+void common::XXH64State::Update(const void* data, size_t size)
+{
+    const uint8_t* p = reinterpret_cast<const uint8_t*>(data);
+    mTotalSize += size;
+    //first complete the stripe that was left from the last call
+    if (mBuffered > 0)
+    {
+        const size_t toCopy = (std::min)(size, sizeof(mBuffer) - mBuffered);
+        memcpy(mBuffer + mBuffered, p, toCopy);
+        mBuffered += toCopy;
+        p += toCopy;
+        size -= toCopy;
+        if (mBuffered < sizeof(mBuffer))
+            return;
+        ConsumeStripes(mAcc, mBuffer, sizeof(mBuffer));
+        mBuffered = 0;
+    }
+    const size_t used = ConsumeStripes(mAcc, p, size);
+    memcpy(mBuffer, p + used, size - used);
+    mBuffered = size - used;
+}
+
+uint64_t common::XXH64State::Digest()const
+{
+    return Finalize(mAcc, mSeed, mTotalSize, mBuffer, mBuffered);
+}
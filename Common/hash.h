@@ -0,0 +1,28 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+namespace common
+{
+	/// <summary>
+	/// XXH64, by Yann Collet. Fast non cryptographic hash, good to tell apart big blobs like
+	/// vertex buffers. Same results as the reference implementation.
+	/// </summary>
+	uint64_t XXH64(const void* data, size_t size, uint64_t seed = 0);
+	/// <summary>
+	/// XXH64 for data that comes in pieces. Digest() gives the same as XXH64() over all the
+	/// pieces together.
+	/// </summary>
+	class XXH64State
+	{
+	public:
+		explicit XXH64State(uint64_t seed = 0);
+		void Update(const void* data, size_t size);
+		uint64_t Digest()const;
+	private:
+		uint64_t mAcc[4];
+		uint8_t mBuffer[32];
+		size_t mBuffered = 0;
+		uint64_t mTotalSize = 0;
+		uint64_t mSeed;
+	};
+}
@@ -1,5 +1,6 @@
 #include "pch.h"
 #include "input_layout_service.h"
+#include "vertex.h"
 
 std::vector<D3D12_INPUT_ELEMENT_DESC> common::input_layout_service::OnlyVertexes()
 {
@@ -110,3 +111,28 @@ std::vector<D3D12_INPUT_ELEMENT_DESC> common::input_layout_service::InstancedTra
     };
     return inputLayout;
 }
+
+std::vector<D3D12_INPUT_ELEMENT_DESC> common::input_layout_service::InstanceIdTransform()
+{
+    //the same vertex stream as InstancedTransform, only slot 0
+    std::vector<D3D12_INPUT_ELEMENT_DESC> inputLayout = InstancedTransform();
+    assert(inputLayout.back().InputSlot == 1);
+    inputLayout.pop_back();
+    return inputLayout;
+}
+
+std::vector<D3D12_INPUT_ELEMENT_DESC> common::input_layout_service::PackedInstanceIdTransform()
+{
+    constexpr size_t positionOffset = offsetof(common::PackedVertex, pos);
+    constexpr size_t normalOffset = offsetof(common::PackedVertex, normal);
+    constexpr size_t uvOffset = offsetof(common::PackedVertex, uv);
+    std::vector<D3D12_INPUT_ELEMENT_DESC> inputLayout =
+    {
+        //xyz quantized against the mesh bounds, w is padding
+        { "POSITION", 0, DXGI_FORMAT_R16G16B16A16_UNORM, 0, positionOffset, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0},
+        //octahedral encoded
+        { "NORMAL", 0, DXGI_FORMAT_R16G16_SNORM, 0, normalOffset, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0},
+        { "UV", 0, DXGI_FORMAT_R16G16_FLOAT, 0, uvOffset, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0}
+    };
+    return inputLayout;
+}
@@ -9,6 +9,16 @@ namespace common
 		std::vector<D3D12_INPUT_ELEMENT_DESC> PositionsNormalsAndUVs();
 		std::vector<D3D12_INPUT_ELEMENT_DESC> DefaultVertexDataAndInstanceId();
 		std::vector<D3D12_INPUT_ELEMENT_DESC> InstancedTransform();
+		/// <summary>
+		/// InstancedTransform without the OBJECT_ID stream: the shader takes the matrix index from
+		/// SV_InstanceID plus a base offset in a root constant, so there's no instance buffer.
+		/// </summary>
+		std::vector<D3D12_INPUT_ELEMENT_DESC> InstanceIdTransform();
+		/// <summary>
+		/// Same as InstanceIdTransform but for common::PackedVertex, the shader has to decode
+		/// the position and the normal.
+		/// </summary>
+		std::vector<D3D12_INPUT_ELEMENT_DESC> PackedInstanceIdTransform();
 	}
 }
 
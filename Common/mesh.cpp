@@ -1,129 +1,208 @@
 #include "pch.h"
 #include "mesh.h"
+#include "mesh_cache.h"
 #include "vertex.h"
 #include <locale>
 #include "concatenate.h"
-#include "d3d_utils.h"
+#include "placed_resource_allocator.h"
 using Microsoft::WRL::ComPtr;
 
 
 common::Mesh::Mesh(MeshData& data, 
     Microsoft::WRL::ComPtr<ID3D12Device> device,
-    Microsoft::WRL::ComPtr<ID3D12CommandQueue> commandQueue):
-    mNumberOfIndices(data.indices.size()), 
+    Microsoft::WRL::ComPtr<ID3D12CommandQueue> commandQueue,
+    VertexFormat vertexFormat,
+    std::shared_ptr<GeometryPool> pool,
+    std::shared_ptr<UploadBatch> uploadBatch):
+    mNumberOfIndices(data.lods.empty() ? data.indices.size() : data.lods[0].indexCount), 
+    mVertexFormat(vertexFormat),
+    mPool(pool),
     name(multi2wide(data.name))
 {
-    std::vector<common::Vertex> vertexes(data.vertices.size());
-    for (auto i = 0; i < data.vertices.size(); i++)
+    mBounds = data.bounds;
+    mLods = data.lods;
+    if (mLods.empty())
+        mLods.push_back({ 0, static_cast<uint32_t>(data.indices.size()), 0.0f, 0 });
+    mMeshlets = data.meshlets.meshlets;
+    mMeshletsBounds = data.meshlets.bounds;
+    //narrow the indices to 16 bits if the mesh is small enough
+    DXGI_FORMAT indexFormat = data.IndexFormat();
+    //interleaved and narrowed straight into the upload heap
+    Upload(data.vertices.size(), static_cast<UINT>(data.indices.size() * IndexSize(indexFormat)), indexFormat,
+        [&data, indexFormat](Vertex* vertices, void* indices)
+        {
+            for (size_t i = 0; i < data.vertices.size(); i++)
+            {
+                vertices[i].pos = data.vertices[i];
+                vertices[i].normal = data.normals[i];
+                vertices[i].uv = data.uv[i];
+            }
+            PackIndices(data.indices.data(), data.indices.size(), indexFormat, indices);
+        },
+        name, device, commandQueue, uploadBatch);
+}
+
+common::Mesh::Mesh(const io::MeshView& view,
+    Microsoft::WRL::ComPtr<ID3D12Device> device,
+    Microsoft::WRL::ComPtr<ID3D12CommandQueue> commandQueue,
+    VertexFormat vertexFormat,
+    std::shared_ptr<GeometryPool> pool,
+    std::shared_ptr<UploadBatch> uploadBatch) :
+    mNumberOfIndices(view.lodCount == 0 ? view.indexCount : view.lods[0].indexCount),
+    mVertexFormat(vertexFormat),
+    mPool(pool),
+    name(multi2wide(view.name))
+{
+    mBounds = view.bounds;
+    mLods.assign(view.lods, view.lods + view.lodCount);
+    if (mLods.empty())
+        mLods.push_back({ 0, view.indexCount, 0.0f, 0 });
+    mMeshlets.assign(view.meshlets, view.meshlets + view.meshletCount);
+    mMeshletsBounds.assign(view.meshletBounds, view.meshletBounds + view.meshletCount);
+    //the view is alredy interleaved, it's a memcpy from the mapped file to the upload heap
+    const UINT iBufferSize = view.indexCount * IndexSize(view.indexFormat);
+    Upload(view.vertexCount, iBufferSize, view.indexFormat,
+        [&view, iBufferSize](Vertex* vertices, void* indices)
+        {
+            memcpy(vertices, view.vertices, view.vertexCount * sizeof(Vertex));
+            memcpy(indices, view.indices, iBufferSize);
+        },
+        name, device, commandQueue, uploadBatch);
+}
+
+common::Mesh::Mesh(const std::string& name, uint32_t vertexCount, uint32_t indexCount, DXGI_FORMAT indexFormat,
+    const MeshBounds& bounds,
+    const MeshWriter& write,
+    Microsoft::WRL::ComPtr<ID3D12Device> device,
+    Microsoft::WRL::ComPtr<ID3D12CommandQueue> commandQueue,
+    VertexFormat vertexFormat,
+    std::shared_ptr<GeometryPool> pool,
+    std::shared_ptr<UploadBatch> uploadBatch) :
+    mNumberOfIndices(indexCount),
+    mVertexFormat(vertexFormat),
+    mPool(pool),
+    name(multi2wide(name))
+{
+    mBounds = bounds;
+    mLods.push_back({ 0, indexCount, 0.0f, 0 });
+    Upload(vertexCount, indexCount * IndexSize(indexFormat), indexFormat, write,
+        this->name, device, commandQueue, uploadBatch);
+}
+
+void common::Mesh::Upload(size_t vertexCount, UINT iBufferSize, DXGI_FORMAT indexFormat,
+    const MeshWriter& write,
+    const std::wstring& debugName,
+    Microsoft::WRL::ComPtr<ID3D12Device> device,
+    Microsoft::WRL::ComPtr<ID3D12CommandQueue> commandQueue,
+    std::shared_ptr<UploadBatch> uploadBatch)
+{
+    mIndexFormat = indexFormat;
+    //what goes to the mapped upload memory, wherever it is.
+    //packed meshes are encoded here, the shader gets the bounds to decode the positions
+    auto fill = [this, vertexCount, &write](void* mappedVertices, void* mappedIndices)
     {
-        vertexes[i].pos = data.vertices[i];
-        vertexes[i].normal = data.normals[i];
-        vertexes[i].uv = data.uv[i];
+        if (mVertexFormat == VertexFormat::Packed)
+        {
+            std::vector<common::Vertex> fullVertices(vertexCount);
+            write(fullVertices.data(), mappedIndices);
+            mQuantization = PackVertices(fullVertices.data(), vertexCount, reinterpret_cast<PackedVertex*>(mappedVertices));
+        }
+        else
+        {
+            write(reinterpret_cast<Vertex*>(mappedVertices), mappedIndices);
+        }
+    };
+    if (mPool != nullptr)
+    {
+        //a range of the shared buffers instead of buffers of our own, copied in the pool's batch
+        assert(mPool->GetVertexFormat() == mVertexFormat);
+        assert(uploadBatch == nullptr || uploadBatch == mPool->Batch());
+        mVertexAllocation = mPool->AllocateVertices(static_cast<uint32_t>(vertexCount));
+        mIndexAllocation = mPool->AllocateIndices(indexFormat, iBufferSize / IndexSize(indexFormat));
+        mPool->Upload(mVertexAllocation, indexFormat, mIndexAllocation, fill);
+        return;
     }
-	int vBufferSize = vertexes.size() * sizeof(common::Vertex);
-    CD3DX12_HEAP_PROPERTIES vertexHeapProperties = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT);
-    CD3DX12_RESOURCE_DESC vertexResourceDesc = CD3DX12_RESOURCE_DESC::Buffer(vBufferSize);
-    device->CreateCommittedResource(
-        &vertexHeapProperties, // a default heap
-        D3D12_HEAP_FLAG_NONE, // no flags
-        &vertexResourceDesc, // resource description for a buffer
-        D3D12_RESOURCE_STATE_COMMON,//the initial state of vertex buffer is D3D12_RESOURCE_STATE_COMMON. Before we use them i'll have to transition it to the correct state
-        nullptr, // optimized clear value must be null for this type of resource. used for render targets and depth/stencil buffers
-        IID_PPV_ARGS(&mVertexBuffer));
+    const UINT vertexStride = mVertexFormat == VertexFormat::Packed ? sizeof(common::PackedVertex) : sizeof(common::Vertex);
+    const UINT vBufferSize = static_cast<UINT>(vertexCount * vertexStride);
+    //placed in one of the default heaps instead of a committed resource each
+    std::shared_ptr<PlacedResourceAllocator> placedResources = PlacedResourceAllocator::Default(device);
+    mVertexBuffer = placedResources->CreateBuffer(
+        D3D12_HEAP_TYPE_DEFAULT,
+        vBufferSize,
+        D3D12_RESOURCE_STATE_COMMON);//the initial state of vertex buffer is D3D12_RESOURCE_STATE_COMMON. Before we use them i'll have to transition it to the correct state
     // we can give resource heaps a name so when we debug with the graphics debugger we know what resource we are looking at
-    std::wstring vertex_w_name = Concatenate(multi2wide(data.name),"vertexBuffer");
+    std::wstring vertex_w_name = Concatenate(debugName, "vertexBuffer");
     mVertexBuffer->SetName(vertex_w_name.c_str());
-    // create upload heap
-    // upload heaps are used to upload data to the GPU. CPU can write to it, GPU can read from it
-    // We will upload the vertex buffer using this heap to the default heap
-    ComPtr<ID3D12Resource> vertexBufferUploadHeap;
-    CD3DX12_HEAP_PROPERTIES vertexUploadHeapProperties = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD);
-    device->CreateCommittedResource(
-        &vertexUploadHeapProperties, // upload heap
-        D3D12_HEAP_FLAG_NONE, // no flags
-        &vertexResourceDesc, // resource description for a buffer
-        D3D12_RESOURCE_STATE_COMMON, //D3D12_RESOURCE_STATE_GENERIC_READ, // GPU will read from this buffer and copy its contents to the default heap
-        nullptr,
-        IID_PPV_ARGS(&vertexBufferUploadHeap));
-    vertexBufferUploadHeap->SetName(L"Vertex Buffer Upload Resource Heap");
-    // store vertex buffer in upload heap
-    D3D12_SUBRESOURCE_DATA vertexData = {};
-    vertexData.pData = reinterpret_cast<BYTE*>(vertexes.data()); // pointer to our vertex array
-    vertexData.RowPitch = vBufferSize; // size of all our triangle vertex data
-    vertexData.SlicePitch = vBufferSize; // also the size of our triangle vertex data
     ///////now the index buffer
-    int iBufferSize = data.indices.size() * sizeof(uint16_t);
     //create the index buffer
-    CD3DX12_HEAP_PROPERTIES indexHeapProperties = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT);
-    CD3DX12_RESOURCE_DESC indexResourceDesc = CD3DX12_RESOURCE_DESC::Buffer(iBufferSize);
-    device->CreateCommittedResource(
-        &indexHeapProperties,
-        D3D12_HEAP_FLAG_NONE,
-        &indexResourceDesc,
-        D3D12_RESOURCE_STATE_COMMON,
-        nullptr,
-        IID_PPV_ARGS(&mIndexBuffer)
-    );
-    std::wstring index_w_name = Concatenate(multi2wide(data.name), "indexBuffer");
+    mIndexBuffer = placedResources->CreateBuffer(
+        D3D12_HEAP_TYPE_DEFAULT,
+        iBufferSize,
+        D3D12_RESOURCE_STATE_COMMON);
+    std::wstring index_w_name = Concatenate(debugName, "indexBuffer");
     mIndexBuffer->SetName(index_w_name.c_str());
-    //create the staging buffer for the indexes
-    ComPtr<ID3D12Resource> indexBufferUploadHeap;
-    CD3DX12_HEAP_PROPERTIES indexUploadHeapProperties = CD3DX12_HEAP_PROPERTIES(
-        D3D12_HEAP_TYPE_UPLOAD);
-    device->CreateCommittedResource(
-        &indexUploadHeapProperties, // upload heap
-        D3D12_HEAP_FLAG_NONE, // no flags
-        &indexResourceDesc, // resource description for a buffer
-        D3D12_RESOURCE_STATE_COMMON, //D3D12_RESOURCE_STATE_GENERIC_READ, // GPU will read from this buffer and copy its contents to the default heap
-        nullptr,
-        IID_PPV_ARGS(&indexBufferUploadHeap));
-    indexBufferUploadHeap->SetName(L"Index Buffer Upload Resource Heap");
-    // store index buffer in upload heap
-    D3D12_SUBRESOURCE_DATA indexData = {};
-    indexData.pData = reinterpret_cast<BYTE*>(data.indices.data()); // pointer to our index array
-    indexData.RowPitch = iBufferSize; // size of all our index buffer
-    indexData.SlicePitch = iBufferSize; // also the size of our index buffer
-    //now we run the commands
-    common::RunCommands(
-        device.Get(),
-        commandQueue.Get(),
-        [&vertexBufferUploadHeap, this, &vertexData, &indexBufferUploadHeap, &indexData](ComPtr<ID3D12GraphicsCommandList> lst)
-        {
-            //vertexBuffer will go from common to copy destination
-            CD3DX12_RESOURCE_BARRIER vertexBufferResourceBarrier = CD3DX12_RESOURCE_BARRIER::Transition(
-                mVertexBuffer.Get(), D3D12_RESOURCE_STATE_COMMON, D3D12_RESOURCE_STATE_COPY_DEST);
-            lst->ResourceBarrier(1, &vertexBufferResourceBarrier);
-            //staging buffer will go from common to read origin
-            CD3DX12_RESOURCE_BARRIER stagingBufferResourceBarrier = CD3DX12_RESOURCE_BARRIER::Transition(
-                vertexBufferUploadHeap.Get(), D3D12_RESOURCE_STATE_COMMON, D3D12_RESOURCE_STATE_GENERIC_READ);
-            lst->ResourceBarrier(1, &stagingBufferResourceBarrier);
-            //copy the vertex data from RAM to the vertex buffer, thru vBufferUploadHeap
-            UpdateSubresources(lst.Get(), mVertexBuffer.Get(), vertexBufferUploadHeap.Get(), 0, 0, 1, &vertexData);
-            //now that the data is in _vertexBuffer i transition _vertexBuffer to D3D12_RESOURCE_STATE_VERTEX_AND_CONSTANT_BUFFER, so that
-            //it can be used as vertex buffer
-            CD3DX12_RESOURCE_BARRIER secondVertexBufferResourceBarrier = CD3DX12_RESOURCE_BARRIER::Transition(mVertexBuffer.Get(),
-                D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_VERTEX_AND_CONSTANT_BUFFER);
-            lst->ResourceBarrier(1, &secondVertexBufferResourceBarrier);
-            //index buffer will go from common to copy destination
-            CD3DX12_RESOURCE_BARRIER indexBufferResourceBarrier = CD3DX12_RESOURCE_BARRIER::Transition(
-                mIndexBuffer.Get(), D3D12_RESOURCE_STATE_COMMON, D3D12_RESOURCE_STATE_COPY_DEST);
-            lst->ResourceBarrier(1, &indexBufferResourceBarrier);
-            //index staging buffer will go from common to read origin
-            CD3DX12_RESOURCE_BARRIER indexStagingBufferResourceBarrier = CD3DX12_RESOURCE_BARRIER::Transition(
-                indexBufferUploadHeap.Get(), D3D12_RESOURCE_STATE_COMMON, D3D12_RESOURCE_STATE_GENERIC_READ);
-            lst->ResourceBarrier(1, &indexStagingBufferResourceBarrier);
-            //copy index data to index buffer thru index staging buffer
-            UpdateSubresources(lst.Get(), mIndexBuffer.Get(), indexBufferUploadHeap.Get(), 0, 0, 1, &indexData);
-            //index buffer go to index buffer state
-            CD3DX12_RESOURCE_BARRIER secondIndexBufferResourceBarrier = CD3DX12_RESOURCE_BARRIER::Transition(mIndexBuffer.Get(),
-                D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_INDEX_BUFFER);
-            lst->ResourceBarrier(1, &secondIndexBufferResourceBarrier);
-        });
+    //without a batch we make one just for this mesh and wait for it, like the old RunCommands
+    bool ownBatch = uploadBatch == nullptr;
+    const uint64_t stagingSize = (vBufferSize + 15) / 16 * 16 + (iBufferSize + 15) / 16 * 16;
+    if (ownBatch)
+    {
+        uploadBatch = std::make_shared<UploadBatch>(device, commandQueue,
+            std::make_shared<UploadRing>(device, stagingSize, L"Mesh Upload Ring"));
+    }
+    //the writer fills the staging memory directly, no D3D12_SUBRESOURCE_DATA to copy from.
+    //the vertex buffer goes from common to copy destination and then to D3D12_RESOURCE_STATE_VERTEX_AND_CONSTANT_BUFFER,
+    //the index buffer to D3D12_RESOURCE_STATE_INDEX_BUFFER
+    //the batch may have to go before the copies, not between them: the vertices aren't written yet
+    uploadBatch->Reserve(stagingSize);
+    void* stagedVertices = uploadBatch->Copy(mVertexBuffer.Get(), 0, vBufferSize, D3D12_RESOURCE_STATE_VERTEX_AND_CONSTANT_BUFFER);
+    void* stagedIndices = uploadBatch->Copy(mIndexBuffer.Get(), 0, iBufferSize, D3D12_RESOURCE_STATE_INDEX_BUFFER);
+    fill(stagedVertices, stagedIndices);
+    if (ownBatch)
+        uploadBatch->Flush();
+    else
+        mUploadBatch = uploadBatch;
     mVertexBufferView.BufferLocation = mVertexBuffer->GetGPUVirtualAddress();
-    mVertexBufferView.StrideInBytes = sizeof(common::Vertex);
+    mVertexBufferView.StrideInBytes = vertexStride;
     mVertexBufferView.SizeInBytes = vBufferSize;
 
     mIndexBufferView.BufferLocation = mIndexBuffer->GetGPUVirtualAddress();
     mIndexBufferView.SizeInBytes = iBufferSize;
-    mIndexBufferView.Format = DXGI_FORMAT_R16_UINT;
+    mIndexBufferView.Format = indexFormat;
+}
+
+common::Mesh::~Mesh()
+{
+    //a shared batch may still track the buffers for the direct queue
+    if (std::shared_ptr<UploadBatch> uploadBatch = mUploadBatch.lock())
+    {
+        uploadBatch->Forget(mVertexBuffer.Get());
+        uploadBatch->Forget(mIndexBuffer.Get());
+    }
+    //the ranges go back to the pool, the gpu must be done with them
+    if (mPool == nullptr)
+        return;
+    if (mVertexAllocation != OffsetAllocator::INVALID_HANDLE)
+        mPool->FreeVertices(mVertexAllocation);
+    if (mIndexAllocation != OffsetAllocator::INVALID_HANDLE)
+        mPool->FreeIndices(mIndexFormat, mIndexAllocation);
+}
+
+D3D12_VERTEX_BUFFER_VIEW common::Mesh::VertexBufferView()const
+{
+    return mPool != nullptr ? mPool->VertexBufferView() : mVertexBufferView;
+}
+
+D3D12_INDEX_BUFFER_VIEW common::Mesh::IndexBufferView()const
+{
+    return mPool != nullptr ? mPool->IndexBufferView(mIndexFormat) : mIndexBufferView;
+}
+
+UINT common::Mesh::BaseVertex()const
+{
+    return mPool != nullptr ? mPool->BaseVertex(mVertexAllocation) : 0;
+}
+
+UINT common::Mesh::FirstIndex()const
+{
+    return mPool != nullptr ? mPool->FirstIndex(mIndexFormat, mIndexAllocation) : 0;
 }
@@ -1,25 +1,126 @@
 #pragma once
 #include "pch.h"
 #include "mesh_load.h"
+#include "vertex_packing.h"
+#include "geometry_pool.h"
+namespace common::io
+{
+	struct MeshView;
+}
 namespace common
 {
+	/// <summary>
+	/// Writes a mesh where Mesh wants it, normally the mapped upload heap: the vertices, 
+	/// interleaved, in vertices and the indices, in the index format of the mesh, in indices.
+	/// </summary>
+	using MeshWriter = std::function<void(Vertex* vertices, void* indices)>;
+	/// <summary>
+	/// A mesh in the gpu, in buffers of its own or in a GeometryPool. The copies are recorded in
+	/// uploadBatch, or in the pool's batch, and the mesh can be drawn after that is submitted.
+	/// Without either the mesh makes a batch of its own and waits for it.
+	/// </summary>
 	class Mesh
 	{
 	public:
 		Mesh(MeshData& data, 
 			Microsoft::WRL::ComPtr<ID3D12Device> device,
-			Microsoft::WRL::ComPtr<ID3D12CommandQueue> commandQueue );
-		D3D12_VERTEX_BUFFER_VIEW VertexBufferView()const { return mVertexBufferView; }
-		D3D12_INDEX_BUFFER_VIEW IndexBufferView()const { return mIndexBufferView; }
+			Microsoft::WRL::ComPtr<ID3D12CommandQueue> commandQueue,
+			VertexFormat vertexFormat = VertexFormat::Full,
+			std::shared_ptr<GeometryPool> pool = nullptr,
+			std::shared_ptr<UploadBatch> uploadBatch = nullptr);
+		/// <summary>
+		/// Uploads a mesh that's alredy in the gpu layout, like the ones in a cooked file. The data 
+		/// is copied straight from the view to the upload heap, unless it has to be packed.
+		/// </summary>
+		Mesh(const io::MeshView& view,
+			Microsoft::WRL::ComPtr<ID3D12Device> device,
+			Microsoft::WRL::ComPtr<ID3D12CommandQueue> commandQueue,
+			VertexFormat vertexFormat = VertexFormat::Full,
+			std::shared_ptr<GeometryPool> pool = nullptr,
+			std::shared_ptr<UploadBatch> uploadBatch = nullptr);
+		/// <summary>
+		/// For data that isn't in memory yet, like a MeshImporter: write is called with the
+		/// mapped upload heap, so the vertices and indices are written once and never copied in the cpu.
+		/// With VertexFormat::Packed the vertices go to a temporary first, they need the bounds to be packed.
+		/// </summary>
+		Mesh(const std::string& name, uint32_t vertexCount, uint32_t indexCount, DXGI_FORMAT indexFormat,
+			const MeshBounds& bounds,
+			const MeshWriter& write,
+			Microsoft::WRL::ComPtr<ID3D12Device> device,
+			Microsoft::WRL::ComPtr<ID3D12CommandQueue> commandQueue,
+			VertexFormat vertexFormat = VertexFormat::Full,
+			std::shared_ptr<GeometryPool> pool = nullptr,
+			std::shared_ptr<UploadBatch> uploadBatch = nullptr);
+		~Mesh();
+		Mesh(const Mesh&) = delete;
+		Mesh& operator=(const Mesh&) = delete;
+		/// <summary>
+		/// The buffers of the pool if the mesh is in one, shared with the other meshes of the pool.
+		/// Draw with BaseVertex() and FirstIndex().
+		/// </summary>
+		D3D12_VERTEX_BUFFER_VIEW VertexBufferView()const;
+		D3D12_INDEX_BUFFER_VIEW IndexBufferView()const;
+		/// <summary>
+		/// DXGI_FORMAT_R16_UINT if the mesh has up to 65536 vertices, DXGI_FORMAT_R32_UINT otherwise
+		/// </summary>
+		DXGI_FORMAT IndexFormat()const { return mIndexFormat; }
+		/// <summary>
+		/// Where the mesh starts in VertexBufferView() and IndexBufferView(). 0 if the mesh has its
+		/// own buffers. The lods and meshlets are relative to FirstIndex().
+		/// </summary>
+		UINT BaseVertex()const;
+		UINT FirstIndex()const;
+		const std::shared_ptr<GeometryPool>& Pool()const { return mPool; }
+		/// <summary>
+		/// Number of indices of level 0, the full detail mesh.
+		/// </summary>
 		int NumberOfIndices()const { return mNumberOfIndices; }
+		/// <summary>
+		/// At least one level, the full detail mesh. They are ranges of the same index buffer.
+		/// </summary>
+		const std::vector<LodLevel>& Lods()const { return mLods; }
+		/// <summary>
+		/// Box and sphere around the vertices, in mesh space.
+		/// </summary>
+		const MeshBounds& Bounds()const { return mBounds; }
+		VertexFormat GetVertexFormat()const { return mVertexFormat; }
+		/// <summary>
+		/// What the vertex shader needs to decode the positions of a packed mesh.
+		/// Meaningless for VertexFormat::Full.
+		/// </summary>
+		const QuantizationBounds& Quantization()const { return mQuantization; }
+		/// <summary>
+		/// CPU copy of the meshlets, for culling. Each one is a range of the index buffer.
+		/// Empty if the mesh was created from a MeshData without meshlets.
+		/// </summary>
+		const std::vector<Meshlet>& Meshlets()const { return mMeshlets; }
+		const std::vector<MeshletBounds>& MeshletsBounds()const { return mMeshletsBounds; }
 		const std::wstring name;
 
 	private:
+		void Upload(size_t vertexCount, UINT iBufferSize, DXGI_FORMAT indexFormat,
+			const MeshWriter& write,
+			const std::wstring& debugName,
+			Microsoft::WRL::ComPtr<ID3D12Device> device,
+			Microsoft::WRL::ComPtr<ID3D12CommandQueue> commandQueue,
+			std::shared_ptr<UploadBatch> uploadBatch);
 		Microsoft::WRL::ComPtr<ID3D12Resource> mVertexBuffer = nullptr;
 		D3D12_VERTEX_BUFFER_VIEW mVertexBufferView{};
 		Microsoft::WRL::ComPtr<ID3D12Resource> mIndexBuffer = nullptr;
 		D3D12_INDEX_BUFFER_VIEW mIndexBufferView{};
 		const int mNumberOfIndices;
+		const VertexFormat mVertexFormat;
+		DXGI_FORMAT mIndexFormat = DXGI_FORMAT_UNKNOWN;
+		std::shared_ptr<GeometryPool> mPool;
+		//the batch that uploaded the buffers of our own, if it outlives the upload
+		std::weak_ptr<UploadBatch> mUploadBatch;
+		OffsetAllocator::Handle mVertexAllocation = OffsetAllocator::INVALID_HANDLE;
+		OffsetAllocator::Handle mIndexAllocation = OffsetAllocator::INVALID_HANDLE;
+		QuantizationBounds mQuantization;
+		std::vector<Meshlet> mMeshlets;
+		std::vector<MeshletBounds> mMeshletsBounds;
+		std::vector<LodLevel> mLods;
+		MeshBounds mBounds = {};
 	};
 }
 
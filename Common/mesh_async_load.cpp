@@ -0,0 +1,120 @@
+#include "pch.h"
+#include "mesh_async_load.h"
+#include "mesh.h"
+
+namespace
+{
+    uint64_t AlignUp(uint64_t value, uint64_t alignment)
+    {
+        return (value + alignment - 1) / alignment * alignment;
+    }
+    /// <summary>
+    /// Upload memory for all the meshes of the file, with the full vertex format and the
+    /// alignment of the ring, so that a ring of this size never has to wait.
+    /// </summary>
+    uint64_t StagingSize(const common::io::LoadedMeshFile& file)
+    {
+        uint64_t size = 0;
+        if (file.cooked != nullptr)
+        {
+            for (uint32_t i = 0; i < file.cooked->MeshCount(); i++)
+            {
+                common::io::MeshView view = file.cooked->Mesh(i);
+                size += AlignUp(view.vertexCount * sizeof(common::Vertex), 16) +
+                    AlignUp(view.indexCount * common::IndexSize(view.indexFormat), 16);
+            }
+            return size;
+        }
+        for (const common::MeshData& mesh : file.imported)
+            size += AlignUp(mesh.vertices.size() * sizeof(common::Vertex), 16) +
+                AlignUp(mesh.indices.size() * common::IndexSize(mesh.IndexFormat()), 16);
+        return size;
+    }
+}
+
+common::io::PoolCapacity common::io::PoolCapacityFor(const std::vector<LoadedMeshFile>& files)
+{
+    PoolCapacity capacity;
+    auto add = [&capacity](size_t vertexCount, size_t indexCount, DXGI_FORMAT indexFormat)
+    {
+        capacity.vertices += static_cast<uint32_t>(vertexCount);
+        (indexFormat == DXGI_FORMAT_R16_UINT ? capacity.indices16 : capacity.indices32) += static_cast<uint32_t>(indexCount);
+    };
+    for (const LoadedMeshFile& file : files)
+    {
+        if (file.cooked != nullptr)
+        {
+            for (uint32_t i = 0; i < file.cooked->MeshCount(); i++)
+            {
+                MeshView view = file.cooked->Mesh(i);
+                add(view.vertexCount, view.indexCount, view.indexFormat);
+            }
+            continue;
+        }
+        for (const common::MeshData& mesh : file.imported)
+            add(mesh.vertices.size(), mesh.indices.size(), mesh.IndexFormat());
+    }
+    return capacity;
+}
+
+common::io::LoadedMeshFile common::io::LoadMeshFile(const std::string& filepathInAssetFolder)
+{
+    std::string assetFolder = "assets/";
+    std::stringstream ss;
+    ss << assetFolder << filepathInAssetFolder;
+    LoadedMeshFile file;
+    file.path = ss.str();
+    //warm start: map the cooked file, cold start: assimp + write the cooked file
+    file.cooked = LoadOrCook(file.path, file.imported);
+    return file;
+}
+
+std::vector<std::future<common::io::LoadedMeshFile>> common::io::LoadMeshesAsync(ThreadPool& pool,
+    const std::vector<std::string>& filepathsInAssetFolder)
+{
+    std::vector<std::future<LoadedMeshFile>> result;
+    result.reserve(filepathsInAssetFolder.size());
+    for (const std::string& path : filepathsInAssetFolder)
+        result.push_back(pool.Submit([path]() { return LoadMeshFile(path); }));
+    return result;
+}
+
+std::vector<std::shared_ptr<common::Mesh>> common::io::UploadMeshes(LoadedMeshFile& file,
+    Microsoft::WRL::ComPtr<ID3D12Device> device,
+    Microsoft::WRL::ComPtr<ID3D12CommandQueue> queue,
+    common::VertexFormat vertexFormat,
+    std::shared_ptr<common::GeometryPool> pool,
+    std::shared_ptr<common::UploadBatch> uploadBatch,
+    common::MeshRegistry& registry)
+{
+    std::vector<std::shared_ptr<common::Mesh>> result(file.MeshCount());
+    //one submit for all the meshes of the file, not one for each
+    const bool ownBatch = uploadBatch == nullptr && pool == nullptr;
+    if (ownBatch)
+        uploadBatch = std::make_shared<UploadBatch>(device, queue,
+            std::make_shared<UploadRing>(device, (std::max)(StagingSize(file), uint64_t(16)), L"UploadMeshes Ring"));
+    if (file.cooked != nullptr)
+    {
+        //the hash was computed when the file was cooked
+        for (uint32_t i = 0; i < file.cooked->MeshCount(); i++)
+        {
+            MeshView view = file.cooked->Mesh(i);
+            result[i] = registry.GetOrCreate(view.contentHash, vertexFormat, pool.get(), [&]() {
+                return std::make_shared<common::Mesh>(view, device, queue, vertexFormat, pool, uploadBatch);
+            });
+        }
+        if (ownBatch)
+            uploadBatch->Flush();
+        return result;
+    }
+    //the cooked file could not be written, use what assimp gave us
+    for (size_t i = 0; i < file.imported.size(); i++)
+    {
+        result[i] = registry.GetOrCreate(MeshContentHash(file.imported[i]), vertexFormat, pool.get(), [&]() {
+            return std::make_shared<common::Mesh>(file.imported[i], device, queue, vertexFormat, pool, uploadBatch);
+        });
+    }
+    if (ownBatch)
+        uploadBatch->Flush();
+    return result;
+}
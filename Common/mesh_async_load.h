@@ -0,0 +1,58 @@
+#pragma once
+#include "pch.h"
+#include "mesh_cache.h"
+#include "thread_pool.h"
+#include "mesh_registry.h"
+#include "upload_batch.h"
+namespace common::io
+{
+	/// <summary>
+	/// The cpu side of loading a file: the mapped cooked file or, if it could not be written,
+	/// what assimp imported. Nothing in the gpu yet, that's UploadMeshes.
+	/// </summary>
+	struct LoadedMeshFile
+	{
+		std::string path;
+		std::shared_ptr<CookedMeshFile> cooked;
+		std::vector<common::MeshData> imported;
+		size_t MeshCount()const { return cooked != nullptr ? cooked->MeshCount() : imported.size(); }
+	};
+	/// <summary>
+	/// What UploadMeshes puts in a GeometryPool for some files: vertices and indices of each
+	/// format. It's an upper bound, the meshes that are alredy in the registry take no space.
+	/// </summary>
+	struct PoolCapacity
+	{
+		uint32_t vertices = 0;
+		uint32_t indices16 = 0;
+		uint32_t indices32 = 0;
+	};
+	PoolCapacity PoolCapacityFor(const std::vector<LoadedMeshFile>& files);
+	/// <summary>
+	/// Maps or cooks (see LoadOrCook) a file in the asset folder. Doesn't touch the gpu, so it can
+	/// run in any thread.
+	/// </summary>
+	LoadedMeshFile LoadMeshFile(const std::string& filepathInAssetFolder);
+	/// <summary>
+	/// Runs LoadMeshFile for each file in the pool, so the files are parsed and cooked at the same
+	/// time. The futures are in the same order as the paths and rethrow what LoadMeshFile threw.
+	/// Each path should be there only once, two workers cooking the same file would write the
+	/// same temporary.
+	/// </summary>
+	std::vector<std::future<LoadedMeshFile>> LoadMeshesAsync(ThreadPool& pool,
+		const std::vector<std::string>& filepathsInAssetFolder);
+	/// <summary>
+	/// Creates the gpu meshes of a loaded file, call it from the thread that owns the queue. Meshes
+	/// whose content is alredy in the registry are not uploaded again, the existing one is returned.
+	/// With a pool the meshes are ranges of its buffers. The copies are recorded in uploadBatch, or
+	/// in the pool's, and nothing waits: submit the batch before drawing. Without either, the whole
+	/// file goes in one batch that is submitted and waited for before returning.
+	/// </summary>
+	std::vector<std::shared_ptr<common::Mesh>> UploadMeshes(LoadedMeshFile& file,
+		Microsoft::WRL::ComPtr<ID3D12Device> device,
+		Microsoft::WRL::ComPtr<ID3D12CommandQueue> queue,
+		common::VertexFormat vertexFormat = common::VertexFormat::Full,
+		std::shared_ptr<common::GeometryPool> pool = nullptr,
+		std::shared_ptr<common::UploadBatch> uploadBatch = nullptr,
+		common::MeshRegistry& registry = common::MeshRegistry::Default());
+}
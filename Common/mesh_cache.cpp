@@ -0,0 +1,366 @@
+#include "pch.h"
+#include "mesh_cache.h"
+#include "mesh_optimize.h"
+#include "vertex_packing.h"
+#include "mesh_registry.h"
+#include <filesystem>
+#include <chrono>
+
+namespace
+{
+    constexpr uint64_t VERTEX_BLOB_ALIGNMENT = 16;
+    constexpr uint64_t INDEX_BLOB_ALIGNMENT = 4;
+    constexpr uint64_t MESHLET_BLOB_ALIGNMENT = 16;
+
+    uint64_t AlignUp(uint64_t value, uint64_t alignment)
+    {
+        return (value + alignment - 1) & ~(alignment - 1);
+    }
+    /// <summary>
+    /// If count elements of elementSize at offset are inside a file of fileSize, and offset is a
+    /// multiple of alignment so that they can be read in place. The counts are 32 bit, the product
+    /// doesn't overflow; the offset is compared first so that fileSize - offset doesn't either.
+    /// </summary>
+    bool SectionFits(uint64_t offset, uint64_t count, uint64_t elementSize, uint64_t alignment, uint64_t fileSize)
+    {
+        return offset <= fileSize && count * elementSize <= fileSize - offset && offset % alignment == 0;
+    }
+    /// <summary>
+    /// Size and last write time of the source file, that's what is stored in the header
+    /// to detect stale cooked files.
+    /// </summary>
+    bool SourceStamp(const std::string& sourcePath, uint64_t& size, int64_t& writeTime)
+    {
+        std::error_code ec;
+        size = std::filesystem::file_size(sourcePath, ec);
+        if (ec)
+            return false;
+        auto time = std::filesystem::last_write_time(sourcePath, ec);
+        if (ec)
+            return false;
+        writeTime = static_cast<int64_t>(time.time_since_epoch().count());
+        return true;
+    }
+}
+
+std::shared_ptr<common::io::CookedMeshFile> common::io::CookedMeshFile::Open(
+    const std::string& cookedPath, const std::string& sourcePath)
+{
+    std::shared_ptr<CookedMeshFile> result(new CookedMeshFile());
+    result->mFile = CreateFileA(cookedPath.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+        OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (result->mFile == INVALID_HANDLE_VALUE)
+        return nullptr;
+    LARGE_INTEGER fileSize;
+    if (!GetFileSizeEx(result->mFile, &fileSize) || fileSize.QuadPart < sizeof(CookedMeshHeader))
+        return nullptr;
+    result->mSize = static_cast<uint64_t>(fileSize.QuadPart);
+    result->mMapping = CreateFileMappingA(result->mFile, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (result->mMapping == nullptr)
+        return nullptr;
+    result->mBase = reinterpret_cast<const uint8_t*>(MapViewOfFile(result->mMapping, FILE_MAP_READ, 0, 0, 0));
+    if (result->mBase == nullptr)
+        return nullptr;
+    if (!result->Validate(sourcePath))
+        return nullptr;
+    return result;
+}
+
+common::io::CookedMeshFile::~CookedMeshFile()
+{
+    if (mBase != nullptr)
+        UnmapViewOfFile(mBase);
+    if (mMapping != nullptr)
+        CloseHandle(mMapping);
+    if (mFile != INVALID_HANDLE_VALUE)
+        CloseHandle(mFile);
+}
+
+bool common::io::CookedMeshFile::Validate(const std::string& sourcePath) const
+{
+    const CookedMeshHeader* header = Header();
+    if (header->magic != COOKED_MESH_MAGIC || header->version != COOKED_MESH_VERSION)
+        return false;
+    //if the source is gone we still can use the cooked file
+    uint64_t sourceSize; int64_t sourceWriteTime;
+    if (SourceStamp(sourcePath, sourceSize, sourceWriteTime) &&
+        (sourceSize != header->sourceSize || sourceWriteTime != header->sourceWriteTime))
+        return false;
+    if (!SectionFits(header->tocOffset, header->meshCount, sizeof(CookedMeshTocEntry), alignof(CookedMeshTocEntry), mSize))
+        return false;
+    const CookedMeshTocEntry* toc = reinterpret_cast<const CookedMeshTocEntry*>(mBase + header->tocOffset);
+    for (uint32_t i = 0; i < header->meshCount; i++)
+    {
+        const CookedMeshTocEntry& e = toc[i];
+        if (e.indexSize != sizeof(uint16_t) && e.indexSize != sizeof(uint32_t))
+            return false;
+        //16 bit indices can't reach past the first 0x10000 vertices, see IndexFormatFor
+        if (e.indexSize == sizeof(uint16_t) && e.vertexCount > 0x10000)
+            return false;
+        //Mesh() casts the sections to their types, they have to be aligned for them
+        if (!SectionFits(e.nameOffset, e.nameLength, 1, 1, mSize) ||
+            !SectionFits(e.vertexOffset, e.vertexCount, sizeof(common::Vertex), alignof(common::Vertex), mSize) ||
+            !SectionFits(e.indexOffset, e.indexCount, e.indexSize, e.indexSize, mSize) ||
+            !SectionFits(e.meshletOffset, e.meshletCount, sizeof(common::Meshlet), alignof(common::Meshlet), mSize) ||
+            !SectionFits(e.meshletBoundsOffset, e.meshletCount, sizeof(common::MeshletBounds), alignof(common::MeshletBounds), mSize) ||
+            !SectionFits(e.meshletVertexOffset, e.meshletVertexCount, sizeof(uint32_t), alignof(uint32_t), mSize) ||
+            !SectionFits(e.meshletTriangleOffset, e.meshletTriangleCount, 3, 1, mSize) ||
+            !SectionFits(e.lodOffset, e.lodCount, sizeof(common::LodLevel), alignof(common::LodLevel), mSize))
+            return false;
+        //the sections fit, now what the meshlets point to inside them
+        if (!common::ValidateMeshlets(reinterpret_cast<const common::Meshlet*>(mBase + e.meshletOffset), e.meshletCount,
+            reinterpret_cast<const uint32_t*>(mBase + e.meshletVertexOffset), e.meshletVertexCount,
+            mBase + e.meshletTriangleOffset, e.meshletTriangleCount, e.vertexCount, e.indexCount))
+            return false;
+        const common::LodLevel* lods = reinterpret_cast<const common::LodLevel*>(mBase + e.lodOffset);
+        for (uint32_t l = 0; l < e.lodCount; l++)
+        {
+            if (uint64_t(lods[l].firstIndex) + lods[l].indexCount > e.indexCount)
+                return false;
+        }
+    }
+    return true;
+}
+
+common::io::MeshView common::io::CookedMeshFile::Mesh(uint32_t i) const
+{
+    assert(i < MeshCount());
+    const CookedMeshTocEntry& e = reinterpret_cast<const CookedMeshTocEntry*>(mBase + Header()->tocOffset)[i];
+    MeshView view;
+    view.name = std::string(reinterpret_cast<const char*>(mBase + e.nameOffset), e.nameLength);
+    view.vertices = reinterpret_cast<const common::Vertex*>(mBase + e.vertexOffset);
+    view.vertexCount = e.vertexCount;
+    view.indices = mBase + e.indexOffset;
+    view.indexCount = e.indexCount;
+    view.indexFormat = e.indexSize == sizeof(uint16_t) ? DXGI_FORMAT_R16_UINT : DXGI_FORMAT_R32_UINT;
+    view.meshlets = reinterpret_cast<const common::Meshlet*>(mBase + e.meshletOffset);
+    view.meshletBounds = reinterpret_cast<const common::MeshletBounds*>(mBase + e.meshletBoundsOffset);
+    view.meshletCount = e.meshletCount;
+    view.meshletVertices = reinterpret_cast<const uint32_t*>(mBase + e.meshletVertexOffset);
+    view.meshletVertexCount = e.meshletVertexCount;
+    view.meshletTriangles = mBase + e.meshletTriangleOffset;
+    view.meshletTriangleCount = e.meshletTriangleCount;
+    view.lods = reinterpret_cast<const common::LodLevel*>(mBase + e.lodOffset);
+    view.lodCount = e.lodCount;
+    view.bounds = e.bounds;
+    view.contentHash = e.contentHash;
+    return view;
+}
+
+std::string common::io::CookedPathFor(const std::string& sourcePath)
+{
+    return sourcePath + COOKED_MESH_EXTENSION;
+}
+
+bool common::io::WriteCookedMeshFile(const std::string& cookedPath, const std::string& sourcePath,
+    const std::vector<common::MeshData>& meshes)
+{
+    CookedMeshHeader header = {};
+    header.magic = COOKED_MESH_MAGIC;
+    header.version = COOKED_MESH_VERSION;
+    if (!SourceStamp(sourcePath, header.sourceSize, header.sourceWriteTime))
+        return false;
+    header.meshCount = static_cast<uint32_t>(meshes.size());
+    header.tocOffset = sizeof(CookedMeshHeader);
+    //first pass: where each thing goes
+    std::vector<CookedMeshTocEntry> toc(meshes.size());
+    uint64_t cursor = header.tocOffset + toc.size() * sizeof(CookedMeshTocEntry);
+    for (size_t i = 0; i < meshes.size(); i++)
+    {
+        toc[i].nameOffset = static_cast<uint32_t>(cursor);
+        toc[i].nameLength = static_cast<uint32_t>(meshes[i].name.size());
+        cursor += meshes[i].name.size();
+    }
+    for (size_t i = 0; i < meshes.size(); i++)
+    {
+        const common::MeshData& md = meshes[i];
+        toc[i].vertexCount = static_cast<uint32_t>(md.vertices.size());
+        toc[i].indexCount = static_cast<uint32_t>(md.indices.size());
+        toc[i].indexSize = IndexSize(md.IndexFormat());
+        toc[i].bounds = md.bounds;
+        cursor = AlignUp(cursor, VERTEX_BLOB_ALIGNMENT);
+        toc[i].vertexOffset = cursor;
+        cursor += md.vertices.size() * sizeof(common::Vertex);
+        cursor = AlignUp(cursor, INDEX_BLOB_ALIGNMENT);
+        toc[i].indexOffset = cursor;
+        cursor += md.indices.size() * toc[i].indexSize;
+        const common::MeshletData& ml = md.meshlets;
+        toc[i].meshletCount = static_cast<uint32_t>(ml.meshlets.size());
+        toc[i].meshletVertexCount = static_cast<uint32_t>(ml.vertices.size());
+        toc[i].meshletTriangleCount = static_cast<uint32_t>(ml.triangles.size() / 3);
+        cursor = AlignUp(cursor, MESHLET_BLOB_ALIGNMENT);
+        toc[i].meshletOffset = cursor;
+        cursor += ml.meshlets.size() * sizeof(common::Meshlet);
+        toc[i].meshletBoundsOffset = cursor;
+        cursor += ml.bounds.size() * sizeof(common::MeshletBounds);
+        toc[i].meshletVertexOffset = cursor;
+        cursor += ml.vertices.size() * sizeof(uint32_t);
+        toc[i].meshletTriangleOffset = cursor;
+        cursor += ml.triangles.size();
+        toc[i].lodCount = static_cast<uint32_t>(md.lods.size());
+        cursor = AlignUp(cursor, MESHLET_BLOB_ALIGNMENT);
+        toc[i].lodOffset = cursor;
+        cursor += md.lods.size() * sizeof(common::LodLevel);
+    }
+    //second pass: build the file in memory and write it at once
+    std::vector<uint8_t> bytes(cursor, 0);
+    memcpy(bytes.data(), &header, sizeof(header));
+    for (size_t i = 0; i < meshes.size(); i++)
+    {
+        const common::MeshData& md = meshes[i];
+        memcpy(bytes.data() + toc[i].nameOffset, md.name.data(), md.name.size());
+        common::Vertex* vertices = reinterpret_cast<common::Vertex*>(bytes.data() + toc[i].vertexOffset);
+        for (size_t v = 0; v < md.vertices.size(); v++)
+        {
+            vertices[v].pos = md.vertices[v];
+            vertices[v].normal = md.normals[v];
+            vertices[v].uv = md.uv[v];
+        }
+        PackIndices(md.indices.data(), md.indices.size(), md.IndexFormat(), bytes.data() + toc[i].indexOffset);
+        toc[i].contentHash = MeshContentHash(vertices, md.vertices.size(),
+            bytes.data() + toc[i].indexOffset, md.indices.size() * toc[i].indexSize);
+        const common::MeshletData& ml = md.meshlets;
+        memcpy(bytes.data() + toc[i].meshletOffset, ml.meshlets.data(), ml.meshlets.size() * sizeof(common::Meshlet));
+        memcpy(bytes.data() + toc[i].meshletBoundsOffset, ml.bounds.data(), ml.bounds.size() * sizeof(common::MeshletBounds));
+        memcpy(bytes.data() + toc[i].meshletVertexOffset, ml.vertices.data(), ml.vertices.size() * sizeof(uint32_t));
+        memcpy(bytes.data() + toc[i].meshletTriangleOffset, ml.triangles.data(), ml.triangles.size());
+        memcpy(bytes.data() + toc[i].lodOffset, md.lods.data(), md.lods.size() * sizeof(common::LodLevel));
+    }
+    //the toc goes last, it has the hashes of the blobs
+    memcpy(bytes.data() + header.tocOffset, toc.data(), toc.size() * sizeof(CookedMeshTocEntry));
+    //write to a temporary and rename, so that a crash never leaves a half written cooked file
+    std::string tmpPath = cookedPath + ".tmp";
+    {
+        std::ofstream out(tmpPath, std::ios::binary | std::ios::trunc);
+        if (!out)
+            return false;
+        out.write(reinterpret_cast<const char*>(bytes.data()), bytes.size());
+        if (!out)
+            return false;
+    }
+    std::error_code ec;
+    std::filesystem::rename(tmpPath, cookedPath, ec);
+    return !ec;
+}
+
+std::shared_ptr<common::io::CookedMeshFile> common::io::LoadOrCook(const std::string& sourcePath,
+    std::vector<common::MeshData>& importedMeshes)
+{
+    std::string cookedPath = CookedPathFor(sourcePath);
+    std::shared_ptr<CookedMeshFile> cooked = CookedMeshFile::Open(cookedPath, sourcePath);
+    if (cooked != nullptr)
+        return cooked;
+    //missing or stale, import with assimp, optimize, simplify, build the meshlets and cook it. That's
+    //slow-ish but it's done once, warm starts get all of it for free.
+    importedMeshes = common::LoadMeshes(sourcePath);
+    for (common::MeshData& md : importedMeshes)
+    {
+        common::OptimizeMesh(md);
+        common::GenerateLods(md);
+        const std::vector<uint32_t> lod0(md.indices.begin(), md.indices.begin() + md.lods[0].indexCount);
+        md.meshlets = common::BuildMeshlets(lod0, md.vertices);
+    }
+    if (WriteCookedMeshFile(cookedPath, sourcePath, importedMeshes))
+        cooked = CookedMeshFile::Open(cookedPath, sourcePath);
+    if (cooked != nullptr)
+        importedMeshes.clear();
+    return cooked;
+}
+
+void common::io::BenchmarkMeshLoad(const std::vector<std::string>& sourcePaths)
+{
+    using clock = std::chrono::high_resolution_clock;
+    double totalCold = 0, totalWarm = 0;
+    for (const std::string& path : sourcePaths)
+    {
+        //cold: what we had before, assimp parsing and the copy into the interleaved layout
+        auto t0 = clock::now();
+        std::vector<common::MeshData> meshes = common::LoadMeshes(path);
+        size_t coldVertices = 0;
+        for (const common::MeshData& md : meshes)
+        {
+            std::vector<common::Vertex> interleaved(md.vertices.size());
+            for (size_t v = 0; v < md.vertices.size(); v++)
+            {
+                interleaved[v].pos = md.vertices[v];
+                interleaved[v].normal = md.normals[v];
+                interleaved[v].uv = md.uv[v];
+            }
+            coldVertices += interleaved.size();
+        }
+        auto t1 = clock::now();
+        //the reports are out of the timed part
+        for (const common::MeshData& md : meshes)
+        {
+            //what we lose if the mesh is uploaded as PackedVertex
+            std::vector<common::Vertex> interleaved(md.vertices.size());
+            for (size_t v = 0; v < md.vertices.size(); v++)
+            {
+                interleaved[v].pos = md.vertices[v];
+                interleaved[v].normal = md.normals[v];
+                interleaved[v].uv = md.uv[v];
+            }
+            common::VertexPackingError packingError = common::MeasurePackingError(interleaved.data(), interleaved.size());
+            printf("  %s: packed vertex error: position %f, normal %.3f degrees, uv %f\n", md.name.c_str(),
+                packingError.position, packingError.normalDegrees, packingError.uv);
+            //what the optimization pass does to the cache behaviour, on a copy so the cold path stays as it was
+            common::MeshData optimized = md;
+            common::MeshOptimizationReport report = common::OptimizeMesh(optimized);
+            printf("  %s: acmr %.3f -> %.3f, atvr %.3f -> %.3f\n", md.name.c_str(),
+                report.before.acmr, report.after.acmr, report.before.atvr, report.after.atvr);
+        }
+        //direct: assimp parsing writing straight into one buffer, like MeshImporter does with the upload heap
+        auto d0 = clock::now();
+        size_t directBytes = 0;
+        {
+            common::MeshImporter importer(path);
+            std::vector<uint8_t> destination;
+            for (size_t m = 0; m < importer.MeshCount(); m++)
+            {
+                common::MeshImportInfo info = importer.Info(m);
+                const size_t vertexBytes = info.vertexCount * sizeof(common::Vertex);
+                destination.resize(vertexBytes + info.indexCount * IndexSize(info.IndexFormat()));
+                importer.WriteVertices(m, reinterpret_cast<common::Vertex*>(destination.data()));
+                importer.WriteIndices(m, info.IndexFormat(), destination.data() + vertexBytes);
+                directBytes += destination.size();
+            }
+        }
+        auto d1 = clock::now();
+        printf("  direct import: %.3f ms, %zu bytes written once\n",
+            std::chrono::duration<double, std::milli>(d1 - d0).count(), directBytes);
+        //make sure that the cooked file exists before measuring the warm path
+        std::string cookedPath = CookedPathFor(path);
+        std::vector<common::MeshData> imported;
+        LoadOrCook(path, imported);
+        //warm: map and touch every byte that would be copied to the upload heap
+        auto t2 = clock::now();
+        std::shared_ptr<CookedMeshFile> cooked = CookedMeshFile::Open(cookedPath, path);
+        size_t warmVertices = 0;
+        uint64_t checksum = 0;
+        if (cooked != nullptr)
+        {
+            for (uint32_t i = 0; i < cooked->MeshCount(); i++)
+            {
+                MeshView view = cooked->Mesh(i);
+                const uint8_t* bytes = reinterpret_cast<const uint8_t*>(view.vertices);
+                for (size_t b = 0; b < view.vertexCount * sizeof(common::Vertex); b += 64)
+                    checksum += bytes[b];
+                const uint8_t* indexBytes = reinterpret_cast<const uint8_t*>(view.indices);
+                for (size_t b = 0; b < view.indexCount * IndexSize(view.indexFormat); b += 64)
+                    checksum += indexBytes[b];
+                warmVertices += view.vertexCount;
+            }
+        }
+        auto t3 = clock::now();
+        double cold = std::chrono::duration<double, std::milli>(t1 - t0).count();
+        double warm = std::chrono::duration<double, std::milli>(t3 - t2).count();
+        totalCold += cold;
+        totalWarm += warm;
+        printf("%s: cold %.3f ms (%zu vertices), warm %.3f ms (%zu vertices)%s [%llu]\n",
+            path.c_str(), cold, coldVertices, warm, warmVertices,
+            cooked == nullptr ? " - could not write cooked file" : "",
+            static_cast<unsigned long long>(checksum));
+    }
+    printf("total: cold %.3f ms, warm %.3f ms, %.1fx\n", totalCold, totalWarm,
+        totalWarm > 0 ? totalCold / totalWarm : 0.0);
+}
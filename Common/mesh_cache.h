@@ -0,0 +1,131 @@
+#pragma once
+#include "pch.h"
+#include "mesh_load.h"
+#include "vertex.h"
+namespace common::io
+{
+	/// <summary>
+	/// Cooked mesh files are a binary dump of what the gpu wants: interleaved vertices and
+	/// indices, ready to be copied into the upload heap. Layout:
+	/// [CookedMeshHeader][CookedMeshTocEntry * meshCount][names][vertex/index/meshlet/lod blobs]
+	/// All offsets are from the beginning of the file.
+	/// </summary>
+	constexpr uint32_t COOKED_MESH_MAGIC = 0x4853454D; //"MESH"
+	constexpr uint32_t COOKED_MESH_VERSION = 7;
+	constexpr const char* COOKED_MESH_EXTENSION = ".cooked";
+
+	struct CookedMeshHeader
+	{
+		uint32_t magic;
+		uint32_t version;
+		//size and last write time of the source file, used to know if the cooked file is stale
+		uint64_t sourceSize;
+		int64_t sourceWriteTime;
+		uint32_t meshCount;
+		uint32_t tocOffset;
+	};
+	static_assert(sizeof(CookedMeshHeader) == 32, "CookedMeshHeader is part of the file format");
+
+	struct CookedMeshTocEntry
+	{
+		uint32_t nameOffset;
+		uint32_t nameLength;
+		uint32_t vertexCount;
+		uint32_t indexCount;
+		uint64_t vertexOffset;
+		uint64_t indexOffset;
+		//2 or 4, the blob is in the width that goes to the index buffer
+		uint32_t indexSize;
+		uint32_t meshletCount;
+		uint32_t meshletVertexCount;
+		uint32_t meshletTriangleCount;
+		//Meshlet[meshletCount], MeshletBounds[meshletCount], uint32_t[meshletVertexCount], uint8_t[3 * meshletTriangleCount]
+		uint64_t meshletOffset;
+		uint64_t meshletBoundsOffset;
+		uint64_t meshletVertexOffset;
+		uint64_t meshletTriangleOffset;
+		//LodLevel[lodCount], the ranges are in the index blob
+		uint32_t lodCount;
+		uint32_t reserved;
+		uint64_t lodOffset;
+		MeshBounds bounds;
+		//MeshContentHash of the vertex and index blobs
+		uint64_t contentHash;
+	};
+	static_assert(sizeof(CookedMeshTocEntry) == 152, "CookedMeshTocEntry is part of the file format");
+
+	/// <summary>
+	/// A mesh inside a cooked file. The pointers point to the mapped file, so they are only
+	/// valid while the CookedMeshFile that created the view is alive.
+	/// </summary>
+	struct MeshView
+	{
+		std::string name;
+		const common::Vertex* vertices;
+		uint32_t vertexCount;
+		const void* indices;
+		uint32_t indexCount;
+		DXGI_FORMAT indexFormat;
+		const Meshlet* meshlets;
+		const MeshletBounds* meshletBounds;
+		uint32_t meshletCount;
+		const uint32_t* meshletVertices;
+		uint32_t meshletVertexCount;
+		const uint8_t* meshletTriangles;
+		uint32_t meshletTriangleCount;
+		const LodLevel* lods;
+		uint32_t lodCount;
+		MeshBounds bounds;
+		uint64_t contentHash;
+	};
+
+	/// <summary>
+	/// A memory mapped cooked mesh file.
+	/// </summary>
+	class CookedMeshFile
+	{
+	public:
+		/// <summary>
+		/// Maps the cooked file. Returns nullptr if the file doesn't exist, is corrupt, was cooked
+		/// with another version of the format or is older than sourcePath.
+		/// </summary>
+		static std::shared_ptr<CookedMeshFile> Open(const std::string& cookedPath, const std::string& sourcePath);
+		~CookedMeshFile();
+		CookedMeshFile(const CookedMeshFile&) = delete;
+		CookedMeshFile& operator=(const CookedMeshFile&) = delete;
+		uint32_t MeshCount()const { return Header()->meshCount; }
+		MeshView Mesh(uint32_t i)const;
+	private:
+		CookedMeshFile() = default;
+		const CookedMeshHeader* Header()const { return reinterpret_cast<const CookedMeshHeader*>(mBase); }
+		bool Validate(const std::string& sourcePath)const;
+		HANDLE mFile = INVALID_HANDLE_VALUE;
+		HANDLE mMapping = nullptr;
+		const uint8_t* mBase = nullptr;
+		uint64_t mSize = 0;
+	};
+	/// <summary>
+	/// assets/cube.glb -> assets/cube.glb.cooked
+	/// </summary>
+	std::string CookedPathFor(const std::string& sourcePath);
+	/// <summary>
+	/// Writes the meshes in the cooked format. Returns false if the file can't be written.
+	/// </summary>
+	bool WriteCookedMeshFile(const std::string& cookedPath, const std::string& sourcePath,
+		const std::vector<common::MeshData>& meshes);
+	/// <summary>
+	/// Maps the cooked version of sourcePath. If it's missing or stale the source is imported with
+	/// assimp, optimized with OptimizeMesh, simplified with GenerateLods, split in meshlets and the
+	/// cooked file is (re)written. Returns nullptr only if the cooked file could not
+	/// be written, in that case the imported data is returned in importedMeshes.
+	/// </summary>
+	std::shared_ptr<CookedMeshFile> LoadOrCook(const std::string& sourcePath,
+		std::vector<common::MeshData>& importedMeshes);
+	/// <summary>
+	/// Measures, for each file, the time to import it with assimp (cold load) and the time to map
+	/// its cooked version (warm load) and prints the results to stdout, together with the vertex
+	/// cache stats before and after OptimizeMesh, the error of the packed vertex format and the time
+	/// to import it with MeshImporter, without intermediate vectors.
+	/// </summary>
+	void BenchmarkMeshLoad(const std::vector<std::string>& sourcePaths);
+}
@@ -36,21 +36,79 @@ std::vector<common::MeshData> common::LoadMeshes(const std::string& filename)
             md.normals[i] = aiVec3ToDirectXVector(currMesh->mNormals[i]);
             md.uv[i] = removeZ(aiVec3ToDirectXVector(currMesh->mTextureCoords[0][i]));
         }
-        std::vector<uint16_t> indexData;
+        md.indices.reserve(currMesh->mNumFaces * 3);
         for (unsigned int j = 0; j < currMesh->mNumFaces; j++) {
-            aiFace face = currMesh->mFaces[j];
-            for (unsigned int k = 0; k < face.mNumIndices; k++) {
-                indexData.push_back(face.mIndices[k]);
-            }
+            const aiFace& face = currMesh->mFaces[j];
+            //aiProcess_Triangulate leaves points and lines alone, we only draw triangles
+            if (face.mNumIndices != 3)
+                continue;
+            md.indices.insert(md.indices.end(), face.mIndices, face.mIndices + 3);
         }
         md.name = std::string(currMesh->mName.C_Str());
-        md.indices = indexData;
+        md.bounds = ComputeMeshBounds(md.vertices);
         assert(md.indices.size() > 0);
         assert(md.vertices.size() > 0);
     }
     return result;
 }
 
+common::MeshImporter::MeshImporter(const std::string& filename)
+    :mImporter(std::make_unique<Assimp::Importer>())
+{
+    mScene = LoadScene(*mImporter, filename);
+}
+
+//here, where Assimp::Importer is complete
+common::MeshImporter::~MeshImporter() = default;
+
+size_t common::MeshImporter::MeshCount()const
+{
+    return mScene->mNumMeshes;
+}
+
+common::MeshImportInfo common::MeshImporter::Info(size_t mesh)const
+{
+    const aiMesh* m = mScene->mMeshes[mesh];
+    MeshImportInfo info;
+    info.name = std::string(m->mName.C_Str());
+    info.vertexCount = m->mNumVertices;
+    //same as LoadMeshes, only the triangles
+    info.indexCount = CountTriangleIndices(m->mFaces, m->mNumFaces);
+    //aiVector3D is 3 floats, same as XMFLOAT3. Read from here, the upload heap is write combined
+    static_assert(sizeof(aiVector3D) == sizeof(DirectX::XMFLOAT3), "aiVector3D must be 3 floats");
+    info.bounds = ComputeMeshBounds(reinterpret_cast<const DirectX::XMFLOAT3*>(m->mVertices), m->mNumVertices);
+    return info;
+}
+
+void common::MeshImporter::WriteVertices(size_t mesh, Vertex* dst)const
+{
+    const aiMesh* m = mScene->mMeshes[mesh];
+    //i assume that all vertexes have normals and uv
+    InterleaveVertices(m->mVertices, m->mNormals, m->mTextureCoords[0], m->mNumVertices, dst);
+}
+
+void common::MeshImporter::WriteIndices(size_t mesh, DXGI_FORMAT format, void* dst)const
+{
+    const aiMesh* m = mScene->mMeshes[mesh];
+    assert(format == DXGI_FORMAT_R32_UINT || m->mNumVertices <= 0x10000);
+    WriteTriangleIndices(m->mFaces, m->mNumFaces, format, dst);
+}
+
+void common::PackIndices(const uint32_t* indices, size_t count, DXGI_FORMAT format, void* dst)
+{
+    if (format == DXGI_FORMAT_R32_UINT)
+    {
+        memcpy(dst, indices, count * sizeof(uint32_t));
+        return;
+    }
+    assert(format == DXGI_FORMAT_R16_UINT);
+    uint16_t* dst16 = reinterpret_cast<uint16_t*>(dst);
+    for (size_t i = 0; i < count; i++)
+    {
+        assert(indices[i] <= 0xFFFF);
+        dst16[i] = static_cast<uint16_t>(indices[i]);
+    }
+}
 
 const aiScene* LoadScene(Assimp::Importer& importer, const std::string& path) {
     const aiScene* scene = importer.ReadFile(path.c_str(),
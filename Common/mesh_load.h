@@ -1,14 +1,58 @@
 #pragma once
-#include "pch.h"
+#include <cstdint>
+#include <cassert>
+#include <memory>
+#include <string>
+#include <vector>
+#include <dxgiformat.h>
+#include "meshlet.h"
+#include "mesh_simplify.h"
+#include "bounds.h"
+#include "vertex.h"
+namespace Assimp
+{
+	class Importer;
+}
+struct aiScene;
 namespace common
 {
+	/// <summary>
+	/// The index format that a mesh with vertexCount vertices needs: 16 bits when all indices
+	/// fit in it, 32 bits otherwise.
+	/// </summary>
+	inline DXGI_FORMAT IndexFormatFor(size_t vertexCount)
+	{
+		return vertexCount <= 0x10000 ? DXGI_FORMAT_R16_UINT : DXGI_FORMAT_R32_UINT;
+	}
+	/// <summary>
+	/// Size in bytes of one index of the given format.
+	/// </summary>
+	inline uint32_t IndexSize(DXGI_FORMAT format)
+	{
+		assert(format == DXGI_FORMAT_R16_UINT || format == DXGI_FORMAT_R32_UINT);
+		return format == DXGI_FORMAT_R16_UINT ? sizeof(uint16_t) : sizeof(uint32_t);
+	}
+	/// <summary>
+	/// Writes count indices to dst using the given format. It's up to the caller to ensure that
+	/// the indices fit in the format.
+	/// </summary>
+	void PackIndices(const uint32_t* indices, size_t count, DXGI_FORMAT format, void* dst);
+
 	struct MeshData
 	{
 		std::string name;
-		std::vector<uint16_t> indices;
+		//always 32 bits in the cpu, they are narrowed to IndexFormat() when they go to the gpu
+		std::vector<uint32_t> indices;
 		std::vector<DirectX::XMFLOAT3> vertices;
 		std::vector<DirectX::XMFLOAT3> normals;
 		std::vector<DirectX::XMFLOAT2> uv;
+		//empty until someone calls BuildMeshlets, LoadOrCook does it. Only for level 0.
+		MeshletData meshlets;
+		//empty until someone calls GenerateLods, then each level is a range of indices
+		std::vector<LodLevel> lods;
+		//computed by LoadMeshes, the vertices don't move after that
+		MeshBounds bounds = {};
+		DXGI_FORMAT IndexFormat()const { return IndexFormatFor(vertices.size()); }
 	};
 
 	std::vector<common::MeshData> LoadMeshes(
@@ -18,5 +62,100 @@ namespace common
 	std::vector<common::MeshData> LoadMeshes(
 		const std::wstring& filename
 	);
-}
 
+	/// <summary>
+	/// The copies of MeshImporter, for any source laid out like assimp's: Vector3 has x, y, z
+	/// and Face has mNumIndices and mIndices. Only the triangles are written, like LoadMeshes.
+	/// Nothing is allocated, the destination is the caller's.
+	/// </summary>
+	template<typename Vector3>
+	void InterleaveVertices(const Vector3* positions, const Vector3* normals, const Vector3* uvs, size_t count,
+		Vertex* dst)
+	{
+		for (size_t i = 0; i < count; i++)
+		{
+			dst[i].pos = DirectX::XMFLOAT3(positions[i].x, positions[i].y, positions[i].z);
+			dst[i].normal = DirectX::XMFLOAT3(normals[i].x, normals[i].y, normals[i].z);
+			dst[i].uv = DirectX::XMFLOAT2(uvs[i].x, uvs[i].y);
+		}
+	}
+	template<typename Face>
+	uint32_t CountTriangleIndices(const Face* faces, size_t faceCount)
+	{
+		uint32_t count = 0;
+		for (size_t j = 0; j < faceCount; j++)
+			count += faces[j].mNumIndices == 3 ? 3 : 0;
+		return count;
+	}
+	/// <summary>
+	/// dst must have room for CountTriangleIndices indices of the given format.
+	/// </summary>
+	template<typename Face>
+	void WriteTriangleIndices(const Face* faces, size_t faceCount, DXGI_FORMAT format, void* dst)
+	{
+		//the format is decided once, not for each index
+		if (format == DXGI_FORMAT_R32_UINT)
+		{
+			uint32_t* out = reinterpret_cast<uint32_t*>(dst);
+			for (size_t j = 0; j < faceCount; j++)
+			{
+				if (faces[j].mNumIndices != 3)
+					continue;
+				out[0] = faces[j].mIndices[0];
+				out[1] = faces[j].mIndices[1];
+				out[2] = faces[j].mIndices[2];
+				out += 3;
+			}
+			return;
+		}
+		assert(format == DXGI_FORMAT_R16_UINT);
+		uint16_t* out = reinterpret_cast<uint16_t*>(dst);
+		for (size_t j = 0; j < faceCount; j++)
+		{
+			if (faces[j].mNumIndices != 3)
+				continue;
+			out[0] = static_cast<uint16_t>(faces[j].mIndices[0]);
+			out[1] = static_cast<uint16_t>(faces[j].mIndices[1]);
+			out[2] = static_cast<uint16_t>(faces[j].mIndices[2]);
+			out += 3;
+		}
+	}
+
+	/// <summary>
+	/// Sizes of a mesh in a file, known before reading its vertices.
+	/// </summary>
+	struct MeshImportInfo
+	{
+		std::string name;
+		uint32_t vertexCount;
+		uint32_t indexCount;
+		MeshBounds bounds = {};
+		DXGI_FORMAT IndexFormat()const { return IndexFormatFor(vertexCount); }
+	};
+	/// <summary>
+	/// Reads a file with assimp and writes each mesh straight into memory that the caller gives,
+	/// like a mapped upload heap: the vertices interleaved and the indices alredy in the gpu format.
+	/// Unlike LoadMeshes there are no intermediate vectors, but also no MeshData to optimize.
+	/// </summary>
+	class MeshImporter
+	{
+	public:
+		explicit MeshImporter(const std::string& filename);
+		~MeshImporter();
+		MeshImporter(const MeshImporter&) = delete;
+		MeshImporter& operator=(const MeshImporter&) = delete;
+		size_t MeshCount()const;
+		MeshImportInfo Info(size_t mesh)const;
+		/// <summary>
+		/// dst must have room for Info(mesh).vertexCount vertices.
+		/// </summary>
+		void WriteVertices(size_t mesh, Vertex* dst)const;
+		/// <summary>
+		/// dst must have room for Info(mesh).indexCount indices of the given format.
+		/// </summary>
+		void WriteIndices(size_t mesh, DXGI_FORMAT format, void* dst)const;
+	private:
+		std::unique_ptr<Assimp::Importer> mImporter;
+		const aiScene* mScene = nullptr;
+	};
+}
@@ -0,0 +1,300 @@
+#include "pch.h"
+#include "mesh_optimize.h"
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+using namespace DirectX;
+
+namespace
+{
+    //tuning values from Forsyth's article, the cache here is the one used for scoring, not the simulated one
+    constexpr uint32_t FORSYTH_CACHE_SIZE = 32;
+    constexpr float CACHE_DECAY_POWER = 1.5f;
+    constexpr float LAST_TRIANGLE_SCORE = 0.75f;
+    constexpr float VALENCE_BOOST_SCALE = 2.0f;
+    constexpr float VALENCE_BOOST_POWER = 0.5f;
+    constexpr uint32_t NO_TRIANGLE = UINT32_MAX;
+
+    float VertexScore(int cachePosition, uint32_t remainingTriangles)
+    {
+        //nothing left to draw with this vertex
+        if (remainingTriangles == 0)
+            return -1.0f;
+        float score = 0;
+        if (cachePosition >= 0)
+        {
+            //the vertices of the last triangle get a fixed score so that we don't favour strips too much
+            if (cachePosition < 3)
+                score = LAST_TRIANGLE_SCORE;
+            else
+            {
+                const float scaler = 1.0f / (FORSYTH_CACHE_SIZE - 3);
+                score = powf(1.0f - (cachePosition - 3) * scaler, CACHE_DECAY_POWER);
+            }
+        }
+        //vertices with few triangles left get a boost, so that we finish them and don't leave lonely triangles behind
+        score += VALENCE_BOOST_SCALE * powf(static_cast<float>(remainingTriangles), -VALENCE_BOOST_POWER);
+        return score;
+    }
+
+    float CacheMisses(const std::vector<uint32_t>& indices, size_t vertexCount, uint32_t cacheSize)
+    {
+        //fifo cache: a vertex is in the cache if less than cacheSize misses happened since it was loaded
+        std::vector<uint32_t> loadedAt(vertexCount, 0);
+        uint32_t timestamp = cacheSize + 1;
+        uint32_t misses = 0;
+        for (uint32_t index : indices)
+        {
+            if (timestamp - loadedAt[index] > cacheSize)
+            {
+                loadedAt[index] = timestamp++;
+                misses++;
+            }
+        }
+        return static_cast<float>(misses);
+    }
+}
+
+common::VertexCacheStats common::AnalyzeVertexCache(const std::vector<uint32_t>& indices, size_t vertexCount,
+    uint32_t cacheSize)
+{
+    assert(indices.size() % 3 == 0);
+    VertexCacheStats stats;
+    if (indices.empty())
+        return stats;
+    std::vector<bool> referenced(vertexCount, false);
+    for (uint32_t index : indices)
+        referenced[index] = true;
+    const size_t referencedCount = std::count(referenced.begin(), referenced.end(), true);
+    const float misses = CacheMisses(indices, vertexCount, cacheSize);
+    stats.acmr = misses / (indices.size() / 3);
+    stats.atvr = misses / referencedCount;
+    return stats;
+}
+
+void common::OptimizeVertexCache(std::vector<uint32_t>& indices, size_t vertexCount)
+{
+    assert(indices.size() % 3 == 0);
+    const size_t triangleCount = indices.size() / 3;
+    if (triangleCount == 0)
+        return;
+    //vertex -> triangles that use it, adjacency[offsets[v] .. offsets[v] + remaining[v]] are the ones not emitted yet
+    std::vector<uint32_t> remaining(vertexCount, 0);
+    for (uint32_t index : indices)
+        remaining[index]++;
+    std::vector<uint32_t> offsets(vertexCount + 1, 0);
+    for (size_t v = 0; v < vertexCount; v++)
+        offsets[v + 1] = offsets[v] + remaining[v];
+    std::vector<uint32_t> adjacency(indices.size());
+    std::vector<uint32_t> fill(offsets.begin(), offsets.end() - 1);
+    for (size_t t = 0; t < triangleCount; t++)
+        for (size_t k = 0; k < 3; k++)
+            adjacency[fill[indices[t * 3 + k]]++] = static_cast<uint32_t>(t);
+
+    std::vector<int> cachePosition(vertexCount, -1);
+    std::vector<float> vertexScore(vertexCount);
+    for (size_t v = 0; v < vertexCount; v++)
+        vertexScore[v] = VertexScore(-1, remaining[v]);
+    std::vector<bool> emitted(triangleCount, false);
+
+    std::vector<uint32_t> result;
+    result.reserve(indices.size());
+    //3 extra slots for the vertices of the triangle that is being added before the old ones are pushed out
+    std::vector<uint32_t> cache, newCache;
+    cache.reserve(FORSYTH_CACHE_SIZE + 3);
+    newCache.reserve(FORSYTH_CACHE_SIZE + 3);
+    size_t scanCursor = 0;
+    uint32_t best = NO_TRIANGLE;
+    while (result.size() < indices.size())
+    {
+        if (best == NO_TRIANGLE)
+        {
+            //nothing in the cache has triangles left, restart at the next triangle not emitted
+            while (emitted[scanCursor])
+                scanCursor++;
+            best = static_cast<uint32_t>(scanCursor);
+        }
+        emitted[best] = true;
+        const uint32_t* tri = &indices[best * 3];
+        result.insert(result.end(), tri, tri + 3);
+        for (size_t k = 0; k < 3; k++)
+        {
+            const uint32_t v = tri[k];
+            uint32_t* begin = &adjacency[offsets[v]];
+            uint32_t* end = begin + remaining[v];
+            uint32_t* it = std::find(begin, end, best);
+            assert(it != end);
+            std::swap(*it, *(end - 1));
+            remaining[v]--;
+        }
+        //the triangle goes to the front of the cache, the rest is shifted
+        newCache.clear();
+        newCache.insert(newCache.end(), tri, tri + 3);
+        for (uint32_t v : cache)
+            if (v != tri[0] && v != tri[1] && v != tri[2])
+                newCache.push_back(v);
+        for (size_t i = FORSYTH_CACHE_SIZE; i < newCache.size(); i++)
+        {
+            const uint32_t v = newCache[i];
+            cachePosition[v] = -1;
+            vertexScore[v] = VertexScore(-1, remaining[v]);
+        }
+        for (size_t i = 0; i < newCache.size() && i < FORSYTH_CACHE_SIZE; i++)
+        {
+            const uint32_t v = newCache[i];
+            cachePosition[v] = static_cast<int>(i);
+            vertexScore[v] = VertexScore(static_cast<int>(i), remaining[v]);
+        }
+        //only the triangles of the vertices that were touched changed their scores, the best one must be in the cache
+        best = NO_TRIANGLE;
+        float bestScore = -1.0f;
+        for (size_t i = 0; i < newCache.size() && i < FORSYTH_CACHE_SIZE; i++)
+        {
+            const uint32_t v = newCache[i];
+            for (uint32_t a = offsets[v]; a < offsets[v] + remaining[v]; a++)
+            {
+                const uint32_t t = adjacency[a];
+                const float score = vertexScore[indices[t * 3]] + vertexScore[indices[t * 3 + 1]] + vertexScore[indices[t * 3 + 2]];
+                if (score > bestScore)
+                {
+                    bestScore = score;
+                    best = t;
+                }
+            }
+        }
+        if (newCache.size() > FORSYTH_CACHE_SIZE)
+            newCache.resize(FORSYTH_CACHE_SIZE);
+        std::swap(cache, newCache);
+    }
+    indices = std::move(result);
+}
+
+void common::OptimizeOverdraw(std::vector<uint32_t>& indices, const std::vector<XMFLOAT3>& positions,
+    float threshold)
+{
+    assert(indices.size() % 3 == 0);
+    const size_t triangleCount = indices.size() / 3;
+    if (triangleCount < 2)
+        return;
+    const float acmrBefore = AnalyzeVertexCache(indices, positions.size()).acmr;
+    //hard boundaries: triangles where the cache simulation misses all vertices, the vertex cache
+    //order restarts there so cutting there costs nothing
+    std::vector<size_t> clusterStart;
+    {
+        std::vector<uint32_t> loadedAt(positions.size(), 0);
+        uint32_t timestamp = VERTEX_CACHE_SIZE + 1;
+        for (size_t t = 0; t < triangleCount; t++)
+        {
+            int misses = 0;
+            for (size_t k = 0; k < 3; k++)
+            {
+                const uint32_t v = indices[t * 3 + k];
+                if (timestamp - loadedAt[v] > VERTEX_CACHE_SIZE)
+                {
+                    loadedAt[v] = timestamp++;
+                    misses++;
+                }
+            }
+            if (t == 0 || misses == 3)
+                clusterStart.push_back(t);
+        }
+    }
+    if (clusterStart.size() < 2)
+        return;
+    clusterStart.push_back(triangleCount);
+    struct Cluster
+    {
+        size_t begin;
+        size_t end;
+        float sortKey;
+    };
+    std::vector<Cluster> clusters(clusterStart.size() - 1);
+    std::vector<XMVECTOR> triangleCentroid(triangleCount), triangleNormal(triangleCount);
+    //the center of the mesh, area weighted
+    XMVECTOR meshCentroid = XMVectorZero();
+    float meshArea = 0;
+    for (size_t t = 0; t < triangleCount; t++)
+    {
+        XMVECTOR a = XMLoadFloat3(&positions[indices[t * 3]]);
+        XMVECTOR b = XMLoadFloat3(&positions[indices[t * 3 + 1]]);
+        XMVECTOR c = XMLoadFloat3(&positions[indices[t * 3 + 2]]);
+        //length of the cross product is twice the area, that's fine for weighting
+        triangleNormal[t] = XMVector3Cross(b - a, c - a);
+        triangleCentroid[t] = (a + b + c) / 3.0f;
+        const float area = XMVectorGetX(XMVector3Length(triangleNormal[t]));
+        meshCentroid += triangleCentroid[t] * area;
+        meshArea += area;
+    }
+    if (meshArea > 0)
+        meshCentroid /= meshArea;
+    //clusters that face away from the center are more likely to occlude the others, they go first
+    for (size_t c = 0; c < clusters.size(); c++)
+    {
+        Cluster& cluster = clusters[c];
+        cluster.begin = clusterStart[c];
+        cluster.end = clusterStart[c + 1];
+        XMVECTOR centroid = XMVectorZero();
+        XMVECTOR normal = XMVectorZero();
+        float area = 0;
+        for (size_t t = cluster.begin; t < cluster.end; t++)
+        {
+            const float triangleArea = XMVectorGetX(XMVector3Length(triangleNormal[t]));
+            centroid += triangleCentroid[t] * triangleArea;
+            normal += triangleNormal[t];
+            area += triangleArea;
+        }
+        if (area > 0)
+            centroid /= area;
+        cluster.sortKey = XMVectorGetX(XMVector3Dot(centroid - meshCentroid, XMVector3Normalize(normal)));
+    }
+    std::stable_sort(clusters.begin(), clusters.end(),
+        [](const Cluster& a, const Cluster& b) { return a.sortKey > b.sortKey; });
+    std::vector<uint32_t> result;
+    result.reserve(indices.size());
+    for (const Cluster& cluster : clusters)
+        result.insert(result.end(), indices.begin() + cluster.begin * 3, indices.begin() + cluster.end * 3);
+    //don't give away too much of the vertex cache work
+    if (AnalyzeVertexCache(result, positions.size()).acmr <= acmrBefore * threshold)
+        indices = std::move(result);
+}
+
+void common::OptimizeVertexFetch(MeshData& mesh)
+{
+    constexpr uint32_t UNUSED = UINT32_MAX;
+    std::vector<uint32_t> remap(mesh.vertices.size(), UNUSED);
+    uint32_t next = 0;
+    for (uint32_t& index : mesh.indices)
+    {
+        if (remap[index] == UNUSED)
+            remap[index] = next++;
+        index = remap[index];
+    }
+    std::vector<XMFLOAT3> vertices(next), normals(next);
+    std::vector<XMFLOAT2> uv(next);
+    for (size_t v = 0; v < remap.size(); v++)
+    {
+        if (remap[v] == UNUSED)
+            continue;
+        vertices[remap[v]] = mesh.vertices[v];
+        normals[remap[v]] = mesh.normals[v];
+        uv[remap[v]] = mesh.uv[v];
+    }
+    mesh.vertices = std::move(vertices);
+    mesh.normals = std::move(normals);
+    mesh.uv = std::move(uv);
+}
+
+common::MeshOptimizationReport common::OptimizeMesh(MeshData& mesh, const MeshOptimizationOptions& options)
+{
+    MeshOptimizationReport report;
+    report.before = AnalyzeVertexCache(mesh.indices, mesh.vertices.size());
+    if (options.vertexCache)
+        OptimizeVertexCache(mesh.indices, mesh.vertices.size());
+    if (options.overdraw)
+        OptimizeOverdraw(mesh.indices, mesh.vertices, options.overdrawThreshold);
+    //must be the last one, it renumbers the vertices
+    if (options.vertexFetch)
+        OptimizeVertexFetch(mesh);
+    report.after = AnalyzeVertexCache(mesh.indices, mesh.vertices.size());
+    return report;
+}
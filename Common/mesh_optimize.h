@@ -0,0 +1,63 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include "mesh_load.h"
+namespace common
+{
+	/// <summary>
+	/// Post transform cache stats of an index buffer, from a FIFO cache simulation.
+	/// acmr = cache misses / triangles (0.5 is the best possible for big regular grids, 3 is the worst)
+	/// atvr = cache misses / referenced vertices (1 is the best possible)
+	/// </summary>
+	struct VertexCacheStats
+	{
+		float acmr = 0;
+		float atvr = 0;
+	};
+	/// <summary>
+	/// What OptimizeMesh does. Overdraw ordering trades a bit of the vertex cache
+	/// efficiency for drawing the outer facing parts first, so it's off by default.
+	/// </summary>
+	struct MeshOptimizationOptions
+	{
+		bool vertexCache = true;
+		bool overdraw = false;
+		//the overdraw order is only kept if the acmr does not get worse than threshold * the vertex cache order acmr
+		float overdrawThreshold = 1.05f;
+		bool vertexFetch = true;
+	};
+	struct MeshOptimizationReport
+	{
+		VertexCacheStats before;
+		VertexCacheStats after;
+	};
+	/// <summary>
+	/// Size of the cache used by the simulation, it's conservative, recent hardware
+	/// is better than that.
+	/// </summary>
+	constexpr uint32_t VERTEX_CACHE_SIZE = 16;
+
+	VertexCacheStats AnalyzeVertexCache(const std::vector<uint32_t>& indices, size_t vertexCount,
+		uint32_t cacheSize = VERTEX_CACHE_SIZE);
+	/// <summary>
+	/// Reorders the triangles for post transform cache locality (Tom Forsyth's linear speed
+	/// vertex cache optimisation).
+	/// </summary>
+	void OptimizeVertexCache(std::vector<uint32_t>& indices, size_t vertexCount);
+	/// <summary>
+	/// Splits the triangles, that must alredy be in vertex cache order, in clusters and sorts
+	/// the clusters so that the ones that face away from the center of the mesh are drawn first.
+	/// If that makes the acmr worse than threshold * the current acmr the indices are left as they are.
+	/// </summary>
+	void OptimizeOverdraw(std::vector<uint32_t>& indices, const std::vector<DirectX::XMFLOAT3>& positions,
+		float threshold);
+	/// <summary>
+	/// Reorders the vertices in the order that they are first used by the indices, so that the
+	/// vertex fetch goes forward in memory. Vertices that no index uses are dropped.
+	/// </summary>
+	void OptimizeVertexFetch(MeshData& mesh);
+	/// <summary>
+	/// Runs the passes selected in options, in the order cache -> overdraw -> fetch.
+	/// </summary>
+	MeshOptimizationReport OptimizeMesh(MeshData& mesh, const MeshOptimizationOptions& options = {});
+}
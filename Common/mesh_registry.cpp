@@ -0,0 +1,64 @@
+#include "pch.h"
+#include "mesh_registry.h"
+#include "hash.h"
+#include <algorithm>
+
+uint64_t common::MeshContentHash(const Vertex* vertices, size_t vertexCount, const void* indices, size_t indexBytes)
+{
+    XXH64State state;
+    state.Update(vertices, vertexCount * sizeof(Vertex));
+    state.Update(indices, indexBytes);
+    return state.Digest();
+}
+
+uint64_t common::MeshContentHash(const MeshData& mesh)
+{
+    //interleaved and narrowed a piece at a time, the result is the same as hashing the whole buffers
+    constexpr size_t CHUNK = 256;
+    XXH64State state;
+    Vertex vertices[CHUNK];
+    for (size_t first = 0; first < mesh.vertices.size(); first += CHUNK)
+    {
+        const size_t count = (std::min)(CHUNK, mesh.vertices.size() - first);
+        for (size_t i = 0; i < count; i++)
+        {
+            vertices[i].pos = mesh.vertices[first + i];
+            vertices[i].normal = mesh.normals[first + i];
+            vertices[i].uv = mesh.uv[first + i];
+        }
+        state.Update(vertices, count * sizeof(Vertex));
+    }
+    const DXGI_FORMAT indexFormat = mesh.IndexFormat();
+    uint32_t indices[CHUNK];
+    for (size_t first = 0; first < mesh.indices.size(); first += CHUNK)
+    {
+        const size_t count = (std::min)(CHUNK, mesh.indices.size() - first);
+        PackIndices(mesh.indices.data() + first, count, indexFormat, indices);
+        state.Update(indices, count * IndexSize(indexFormat));
+    }
+    return state.Digest();
+}
+
+common::MeshRegistry& common::MeshRegistry::Default()
+{
+    static MeshRegistry registry;
+    return registry;
+}
+
+std::shared_ptr<common::Mesh> common::MeshRegistry::GetOrCreate(uint64_t contentHash, VertexFormat vertexFormat,
+    const GeometryPool* pool, const std::function<std::shared_ptr<Mesh>()>& create)
+{
+    //the lock is held during the upload, so two threads don't upload the same mesh
+    std::lock_guard<std::mutex> lock(mMutex);
+    std::weak_ptr<Mesh>& entry = mMeshes[{ contentHash, vertexFormat, pool }];
+    std::shared_ptr<Mesh> mesh = entry.lock();
+    if (mesh != nullptr)
+    {
+        mHits++;
+        return mesh;
+    }
+    mMisses++;
+    mesh = create();
+    entry = mesh;
+    return mesh;
+}
@@ -0,0 +1,49 @@
+#pragma once
+#include "pch.h"
+#include "mesh_load.h"
+#include <map>
+#include <tuple>
+#include <mutex>
+namespace common
+{
+	/// <summary>
+	/// XXH64 of what goes to the gpu: the interleaved vertices followed by the indices in their
+	/// gpu format (all the levels of detail). It's what the cooked files store in the toc.
+	/// </summary>
+	uint64_t MeshContentHash(const Vertex* vertices, size_t vertexCount, const void* indices, size_t indexBytes);
+	/// <summary>
+	/// Same as the other overload, without building the interleaved buffer.
+	/// </summary>
+	uint64_t MeshContentHash(const MeshData& mesh);
+	class GeometryPool;
+	/// <summary>
+	/// Meshes that are alive, by the hash of their content, their vertex format and their pool, so that the 
+	/// same geometry is uploaded once no matter how many files or loads have it. Only weak 
+	/// references are kept, when the last user lets go of a mesh its buffers are freed.
+	/// </summary>
+	class MeshRegistry
+	{
+	public:
+		/// <summary>
+		/// The one that io::LoadMesh and io::UploadMeshes use.
+		/// </summary>
+		static MeshRegistry& Default();
+		/// <summary>
+		/// The mesh with that content if it's alive, otherwise the result of create, that is
+		/// kept for the next ones.
+		/// </summary>
+		std::shared_ptr<Mesh> GetOrCreate(uint64_t contentHash, VertexFormat vertexFormat, const GeometryPool* pool,
+			const std::function<std::shared_ptr<Mesh>()>& create);
+		/// <summary>
+		/// How many calls to GetOrCreate returned an existing mesh and how many created one.
+		/// </summary>
+		size_t Hits()const { return mHits; }
+		size_t Misses()const { return mMisses; }
+	private:
+		//a mesh in a pool can't stand in for one that isn't, they are bound differently
+		std::map<std::tuple<uint64_t, VertexFormat, const GeometryPool*>, std::weak_ptr<Mesh>> mMeshes;
+		std::mutex mMutex;
+		size_t mHits = 0;
+		size_t mMisses = 0;
+	};
+}
@@ -0,0 +1,271 @@
+#include "pch.h"
+#include "mesh_simplify.h"
+#include "mesh_load.h"
+#include "mesh_optimize.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <unordered_map>
+using namespace DirectX;
+
+namespace
+{
+    /// <summary>
+    /// Symmetric 4x4 matrix, sum of the squared distances to a set of planes.
+    /// </summary>
+    struct Quadric
+    {
+        double a2 = 0, ab = 0, ac = 0, ad = 0;
+        double b2 = 0, bc = 0, bd = 0;
+        double c2 = 0, cd = 0;
+        double d2 = 0;
+        void AddPlane(double a, double b, double c, double d)
+        {
+            a2 += a * a; ab += a * b; ac += a * c; ad += a * d;
+            b2 += b * b; bc += b * c; bd += b * d;
+            c2 += c * c; cd += c * d;
+            d2 += d * d;
+        }
+        void Add(const Quadric& q)
+        {
+            a2 += q.a2; ab += q.ab; ac += q.ac; ad += q.ad;
+            b2 += q.b2; bc += q.bc; bd += q.bd;
+            c2 += q.c2; cd += q.cd;
+            d2 += q.d2;
+        }
+        double Evaluate(const XMFLOAT3& p)const
+        {
+            const double x = p.x, y = p.y, z = p.z;
+            const double result = a2 * x * x + 2 * ab * x * y + 2 * ac * x * z + 2 * ad * x +
+                b2 * y * y + 2 * bc * y * z + 2 * bd * y +
+                c2 * z * z + 2 * cd * z +
+                d2;
+            //rounding can make it slightly negative
+            return (std::max)(result, 0.0);
+        }
+    };
+    struct Collapse
+    {
+        uint32_t from;
+        uint32_t to;
+        float cost;
+    };
+    uint64_t EdgeKey(uint32_t a, uint32_t b)
+    {
+        return a < b ? (uint64_t(a) << 32) | b : (uint64_t(b) << 32) | a;
+    }
+    XMVECTOR TriangleNormal(const XMFLOAT3& a, const XMFLOAT3& b, const XMFLOAT3& c)
+    {
+        XMVECTOR va = XMLoadFloat3(&a);
+        return XMVector3Cross(XMLoadFloat3(&b) - va, XMLoadFloat3(&c) - va);
+    }
+}
+
+std::vector<uint32_t> common::SimplifyMesh(const std::vector<uint32_t>& indices, const std::vector<XMFLOAT3>& positions,
+    size_t targetIndexCount, float targetError, float* resultError)
+{
+    assert(indices.size() % 3 == 0);
+    std::vector<uint32_t> result = indices;
+    const size_t vertexCount = positions.size();
+    if (resultError != nullptr)
+        *resultError = 0;
+    if (result.size() <= targetIndexCount || vertexCount == 0)
+        return result;
+    //vertices with the same position but different normal/uv are seams, if only one side moves we get a crack
+    struct PositionHash
+    {
+        size_t operator()(const XMFLOAT3& p)const
+        {
+            uint32_t bits[3];
+            memcpy(bits, &p, sizeof(bits));
+            return (bits[0] * 73856093u) ^ (bits[1] * 19349663u) ^ (bits[2] * 83492791u);
+        }
+    };
+    struct PositionEqual
+    {
+        bool operator()(const XMFLOAT3& a, const XMFLOAT3& b)const { return a.x == b.x && a.y == b.y && a.z == b.z; }
+    };
+    std::unordered_map<XMFLOAT3, uint32_t, PositionHash, PositionEqual> firstWithPosition;
+    std::vector<uint32_t> canonical(vertexCount);
+    std::vector<uint32_t> verticesWithPosition(vertexCount, 0);
+    for (uint32_t v = 0; v < vertexCount; v++)
+    {
+        canonical[v] = firstWithPosition.emplace(positions[v], v).first->second;
+        verticesWithPosition[canonical[v]]++;
+    }
+    std::vector<bool> locked(vertexCount, false);
+    for (uint32_t v = 0; v < vertexCount; v++)
+        locked[v] = verticesWithPosition[canonical[v]] > 1;
+    //edges that only one triangle uses are open borders
+    std::unordered_map<uint64_t, uint32_t> edgeUse;
+    for (size_t i = 0; i < result.size(); i += 3)
+        for (size_t k = 0; k < 3; k++)
+            edgeUse[EdgeKey(canonical[result[i + k]], canonical[result[i + (k + 1) % 3]])]++;
+    for (size_t i = 0; i < result.size(); i += 3)
+    {
+        for (size_t k = 0; k < 3; k++)
+        {
+            const uint32_t a = result[i + k], b = result[i + (k + 1) % 3];
+            if (edgeUse[EdgeKey(canonical[a], canonical[b])] == 1)
+                locked[a] = locked[b] = true;
+        }
+    }
+    //the quadric of each vertex has the planes of its triangles
+    std::vector<Quadric> quadrics(vertexCount);
+    XMVECTOR boundsMin = XMLoadFloat3(&positions[0]), boundsMax = boundsMin;
+    for (const XMFLOAT3& p : positions)
+    {
+        boundsMin = XMVectorMin(boundsMin, XMLoadFloat3(&p));
+        boundsMax = XMVectorMax(boundsMax, XMLoadFloat3(&p));
+    }
+    for (size_t i = 0; i < result.size(); i += 3)
+    {
+        XMVECTOR n = TriangleNormal(positions[result[i]], positions[result[i + 1]], positions[result[i + 2]]);
+        if (XMVectorGetX(XMVector3LengthSq(n)) == 0.0f)
+            continue;
+        XMFLOAT3 normal;
+        XMStoreFloat3(&normal, XMVector3Normalize(n));
+        const XMFLOAT3& p = positions[result[i]];
+        const double d = -(double(normal.x) * p.x + double(normal.y) * p.y + double(normal.z) * p.z);
+        for (size_t k = 0; k < 3; k++)
+            quadrics[result[i + k]].AddPlane(normal.x, normal.y, normal.z, d);
+    }
+    const float meshSize = XMVectorGetX(XMVector3Length(boundsMax - boundsMin));
+    const double maxCost = double(targetError) * meshSize * double(targetError) * meshSize;
+    double worstCost = 0;
+
+    std::vector<uint32_t> remaining, offsets, adjacency;
+    std::vector<Collapse> collapses;
+    std::vector<uint32_t> remap(vertexCount);
+    std::vector<bool> touched(vertexCount);
+    //every pass collapses a set of edges that don't share triangles, then the index buffer is rebuilt
+    while (result.size() > targetIndexCount)
+    {
+        const size_t triangleCount = result.size() / 3;
+        remaining.assign(vertexCount, 0);
+        for (uint32_t index : result)
+            remaining[index]++;
+        offsets.assign(vertexCount + 1, 0);
+        for (size_t v = 0; v < vertexCount; v++)
+            offsets[v + 1] = offsets[v] + remaining[v];
+        adjacency.resize(result.size());
+        std::vector<uint32_t> fill(offsets.begin(), offsets.end() - 1);
+        for (size_t t = 0; t < triangleCount; t++)
+            for (size_t k = 0; k < 3; k++)
+                adjacency[fill[result[t * 3 + k]]++] = static_cast<uint32_t>(t);
+        collapses.clear();
+        for (size_t i = 0; i < result.size(); i += 3)
+        {
+            for (size_t k = 0; k < 3; k++)
+            {
+                const uint32_t a = result[i + k], b = result[i + (k + 1) % 3];
+                const uint32_t ends[2][2] = { {a, b}, {b, a} };
+                for (const auto& end : ends)
+                {
+                    if (locked[end[0]])
+                        continue;
+                    Quadric q = quadrics[end[0]];
+                    q.Add(quadrics[end[1]]);
+                    collapses.push_back({ end[0], end[1], static_cast<float>(q.Evaluate(positions[end[1]])) });
+                }
+            }
+        }
+        std::sort(collapses.begin(), collapses.end(), [](const Collapse& a, const Collapse& b) { return a.cost < b.cost; });
+        for (uint32_t v = 0; v < vertexCount; v++)
+            remap[v] = v;
+        touched.assign(vertexCount, false);
+        const size_t trianglesToRemove = (result.size() - targetIndexCount) / 3;
+        size_t removed = 0;
+        for (const Collapse& c : collapses)
+        {
+            if (c.cost > maxCost || removed >= trianglesToRemove)
+                break;
+            if (touched[c.from] || touched[c.to])
+                continue;
+            //moving from to to must not flip any of the triangles that survive
+            bool flips = false;
+            size_t dying = 0;
+            for (uint32_t a = offsets[c.from]; a < offsets[c.from + 1] && !flips; a++)
+            {
+                const uint32_t* tri = &result[adjacency[a] * 3];
+                if (tri[0] == c.to || tri[1] == c.to || tri[2] == c.to)
+                {
+                    dying++;
+                    continue;
+                }
+                XMFLOAT3 p[3] = { positions[tri[0]], positions[tri[1]], positions[tri[2]] };
+                XMVECTOR before = TriangleNormal(p[0], p[1], p[2]);
+                for (size_t k = 0; k < 3; k++)
+                    if (tri[k] == c.from)
+                        p[k] = positions[c.to];
+                XMVECTOR after = TriangleNormal(p[0], p[1], p[2]);
+                flips = XMVectorGetX(XMVector3Dot(before, after)) <= 0.0f;
+            }
+            if (flips)
+                continue;
+            remap[c.from] = c.to;
+            quadrics[c.to].Add(quadrics[c.from]);
+            worstCost = (std::max)(worstCost, double(c.cost));
+            removed += dying;
+            //the neighbourhood changed, the other collapses around here have stale costs
+            for (uint32_t a = offsets[c.from]; a < offsets[c.from + 1]; a++)
+                for (size_t k = 0; k < 3; k++)
+                    touched[result[adjacency[a] * 3 + k]] = true;
+        }
+        if (removed == 0)
+            break;
+        size_t write = 0;
+        for (size_t i = 0; i < result.size(); i += 3)
+        {
+            const uint32_t a = remap[result[i]], b = remap[result[i + 1]], c = remap[result[i + 2]];
+            if (a == b || b == c || a == c)
+                continue;
+            result[write++] = a;
+            result[write++] = b;
+            result[write++] = c;
+        }
+        result.resize(write);
+    }
+    if (resultError != nullptr)
+        *resultError = static_cast<float>(sqrt(worstCost));
+    return result;
+}
+
+void common::GenerateLods(MeshData& mesh, const std::vector<LodTarget>& targets)
+{
+    //if it was alredy done we start again from level 0
+    const uint32_t baseIndexCount = mesh.lods.empty() ? static_cast<uint32_t>(mesh.indices.size()) : mesh.lods[0].indexCount;
+    mesh.indices.resize(baseIndexCount);
+    mesh.lods = { { 0, baseIndexCount, 0.0f, 0 } };
+    const std::vector<uint32_t> base(mesh.indices.begin(), mesh.indices.end());
+    for (const LodTarget& target : targets)
+    {
+        const size_t targetIndexCount = static_cast<size_t>(base.size() / 3 * target.triangleRatio) * 3;
+        float error = 0;
+        //always from level 0, so that the error is against the original
+        std::vector<uint32_t> lod = SimplifyMesh(base, mesh.vertices, targetIndexCount, target.maxError, &error);
+        //a level that is almost the same as the previous one only costs memory
+        if (lod.empty() || lod.size() > mesh.lods.back().indexCount * 0.9f)
+            break;
+        OptimizeVertexCache(lod, mesh.vertices.size());
+        mesh.lods.push_back({ static_cast<uint32_t>(mesh.indices.size()), static_cast<uint32_t>(lod.size()), error, 0 });
+        mesh.indices.insert(mesh.indices.end(), lod.begin(), lod.end());
+    }
+}
+
+uint32_t common::SelectLod(const std::vector<LodLevel>& lods, float worldScale, float distance,
+    float projectionScale, float maxPixelError)
+{
+    //the camera is inside the object, full detail
+    if (distance <= 0.0f)
+        return 0;
+    uint32_t selected = 0;
+    for (uint32_t i = 1; i < lods.size(); i++)
+    {
+        const float pixelError = lods[i].error * worldScale / distance * projectionScale;
+        if (pixelError > maxPixelError)
+            break;
+        selected = i;
+    }
+    return selected;
+}
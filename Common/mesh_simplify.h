@@ -0,0 +1,55 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include <DirectXMath.h>
+namespace common
+{
+	struct MeshData;
+	/// <summary>
+	/// A level of detail of a mesh. All levels share the vertex buffer, each one is a range of
+	/// the index buffer. error is the geometric error against level 0, in mesh units.
+	/// </summary>
+	struct LodLevel
+	{
+		uint32_t firstIndex;
+		uint32_t indexCount;
+		float error;
+		uint32_t reserved;
+	};
+	static_assert(sizeof(LodLevel) == 16, "LodLevel is part of the cooked mesh format");
+	/// <summary>
+	/// What GenerateLods aims for: a fraction of the triangles of level 0, unless that goes over
+	/// maxError (relative to the size of the mesh).
+	/// </summary>
+	struct LodTarget
+	{
+		float triangleRatio;
+		float maxError;
+	};
+	inline std::vector<LodTarget> DefaultLodTargets()
+	{
+		return { {0.5f, 0.01f}, {0.25f, 0.02f}, {0.125f, 0.05f} };
+	}
+	/// <summary>
+	/// Quadric error simplification that only collapses vertices into other existing vertices,
+	/// so the result uses the same vertex buffer. Stops at targetIndexCount or when the error
+	/// would go over targetError * the size of the mesh. Vertices in open borders and uv/normal
+	/// seams don't move, so the result has no cracks.
+	/// </summary>
+	/// <param name="resultError">the error of the result, in mesh units</param>
+	std::vector<uint32_t> SimplifyMesh(const std::vector<uint32_t>& indices, const std::vector<DirectX::XMFLOAT3>& positions,
+		size_t targetIndexCount, float targetError, float* resultError = nullptr);
+	/// <summary>
+	/// Appends the simplified levels to mesh.indices and fills mesh.lods. Levels that don't
+	/// remove enough triangles are not added, so there can be fewer levels than targets.
+	/// </summary>
+	void GenerateLods(MeshData& mesh, const std::vector<LodTarget>& targets = DefaultLodTargets());
+	/// <summary>
+	/// The coarsest level whose error, projected on the screen, is under maxPixelError.
+	/// </summary>
+	/// <param name="worldScale">biggest scale of the model matrix</param>
+	/// <param name="distance">from the camera to the object</param>
+	/// <param name="projectionScale">pixels per world unit at distance 1, see rtt::Camera::ProjectionScale</param>
+	uint32_t SelectLod(const std::vector<LodLevel>& lods, float worldScale, float distance,
+		float projectionScale, float maxPixelError = 1.0f);
+}
@@ -0,0 +1,143 @@
+#include "pch.h"
+#include "meshlet.h"
+#include <algorithm>
+#include <cmath>
+using namespace DirectX;
+
+namespace
+{
+    constexpr uint32_t NOT_IN_MESHLET = UINT32_MAX;
+
+    common::MeshletBounds ComputeBounds(const common::MeshletData& data, const common::Meshlet& meshlet,
+        const std::vector<XMFLOAT3>& positions)
+    {
+        common::MeshletBounds bounds;
+        //sphere around the center of the aabb, good enough for 64 vertices
+        XMVECTOR min = XMLoadFloat3(&positions[data.vertices[meshlet.vertexOffset]]);
+        XMVECTOR max = min;
+        for (uint32_t v = 1; v < meshlet.vertexCount; v++)
+        {
+            XMVECTOR p = XMLoadFloat3(&positions[data.vertices[meshlet.vertexOffset + v]]);
+            min = XMVectorMin(min, p);
+            max = XMVectorMax(max, p);
+        }
+        XMVECTOR center = (min + max) * 0.5f;
+        float radius = 0;
+        for (uint32_t v = 0; v < meshlet.vertexCount; v++)
+        {
+            XMVECTOR p = XMLoadFloat3(&positions[data.vertices[meshlet.vertexOffset + v]]);
+            radius = (std::max)(radius, XMVectorGetX(XMVector3Length(p - center)));
+        }
+        XMStoreFloat3(&bounds.center, center);
+        bounds.radius = radius;
+        //the cone: average normal and how far from it the normals go
+        std::vector<XMVECTOR> normals;
+        normals.reserve(meshlet.triangleCount);
+        XMVECTOR axis = XMVectorZero();
+        for (uint32_t t = 0; t < meshlet.triangleCount; t++)
+        {
+            const uint8_t* tri = &data.triangles[(meshlet.triangleOffset + t) * 3];
+            XMVECTOR a = XMLoadFloat3(&positions[data.vertices[meshlet.vertexOffset + tri[0]]]);
+            XMVECTOR b = XMLoadFloat3(&positions[data.vertices[meshlet.vertexOffset + tri[1]]]);
+            XMVECTOR c = XMLoadFloat3(&positions[data.vertices[meshlet.vertexOffset + tri[2]]]);
+            XMVECTOR n = XMVector3Cross(b - a, c - a);
+            //degenerate triangles don't face anywhere
+            if (XMVectorGetX(XMVector3LengthSq(n)) == 0.0f)
+                continue;
+            n = XMVector3Normalize(n);
+            normals.push_back(n);
+            axis += n;
+        }
+        bounds.coneCutoff = 1.0f;
+        bounds.coneAxis = XMFLOAT3(0, 0, 0);
+        if (normals.empty() || XMVectorGetX(XMVector3LengthSq(axis)) == 0.0f)
+            return bounds;
+        axis = XMVector3Normalize(axis);
+        XMStoreFloat3(&bounds.coneAxis, axis);
+        float minDot = 1.0f;
+        for (XMVECTOR n : normals)
+            minDot = (std::min)(minDot, XMVectorGetX(XMVector3Dot(axis, n)));
+        //more than 90 degrees of spread, some triangle will always face the camera
+        if (minDot <= 0.0f)
+            return bounds;
+        bounds.coneCutoff = sqrtf(1.0f - minDot * minDot);
+        return bounds;
+    }
+}
+
+common::MeshletData common::BuildMeshlets(const std::vector<uint32_t>& indices,
+    const std::vector<XMFLOAT3>& positions, uint32_t maxVertices, uint32_t maxTriangles)
+{
+    assert(indices.size() % 3 == 0);
+    //local indices are stored in a byte
+    assert(maxVertices >= 3 && maxVertices <= 256);
+    assert(maxTriangles >= 1);
+    MeshletData data;
+    //mesh vertex -> local index in the meshlet being built
+    std::vector<uint32_t> localIndex(positions.size(), NOT_IN_MESHLET);
+    Meshlet current = {};
+    auto finish = [&]()
+    {
+        if (current.triangleCount == 0)
+            return;
+        data.meshlets.push_back(current);
+        data.bounds.push_back(ComputeBounds(data, current, positions));
+        for (uint32_t v = 0; v < current.vertexCount; v++)
+            localIndex[data.vertices[current.vertexOffset + v]] = NOT_IN_MESHLET;
+        current.vertexOffset = static_cast<uint32_t>(data.vertices.size());
+        current.vertexCount = 0;
+        current.triangleOffset += current.triangleCount;
+        current.triangleCount = 0;
+    };
+    const size_t triangleCount = indices.size() / 3;
+    data.triangles.reserve(indices.size());
+    for (size_t t = 0; t < triangleCount; t++)
+    {
+        const uint32_t* tri = &indices[t * 3];
+        //a vertex can repeat in degenerate triangles, count it once
+        uint32_t newVertices = (localIndex[tri[0]] == NOT_IN_MESHLET) +
+            (localIndex[tri[1]] == NOT_IN_MESHLET && tri[1] != tri[0]) +
+            (localIndex[tri[2]] == NOT_IN_MESHLET && tri[2] != tri[0] && tri[2] != tri[1]);
+        if (current.vertexCount + newVertices > maxVertices || current.triangleCount + 1 > maxTriangles)
+            finish();
+        for (size_t k = 0; k < 3; k++)
+        {
+            const uint32_t v = tri[k];
+            if (localIndex[v] == NOT_IN_MESHLET)
+            {
+                localIndex[v] = current.vertexCount++;
+                data.vertices.push_back(v);
+            }
+            data.triangles.push_back(static_cast<uint8_t>(localIndex[v]));
+        }
+        current.triangleCount++;
+    }
+    finish();
+    return data;
+}
+
+bool common::ValidateMeshlets(const Meshlet* meshlets, size_t meshletCount,
+    const uint32_t* vertices, size_t vertexCount, const uint8_t* triangles, size_t triangleCount,
+    size_t meshVertexCount, size_t meshIndexCount)
+{
+    for (size_t i = 0; i < meshletCount; i++)
+    {
+        const Meshlet& m = meshlets[i];
+        if (uint64_t(m.vertexOffset) + m.vertexCount > vertexCount ||
+            uint64_t(m.triangleOffset) + m.triangleCount > triangleCount ||
+            (uint64_t(m.triangleOffset) + m.triangleCount) * 3 > meshIndexCount)
+            return false;
+        for (uint32_t v = 0; v < m.vertexCount; v++)
+        {
+            if (vertices[m.vertexOffset + v] >= meshVertexCount)
+                return false;
+        }
+        const uint8_t* local = triangles + size_t(m.triangleOffset) * 3;
+        for (size_t k = 0; k < size_t(m.triangleCount) * 3; k++)
+        {
+            if (local[k] >= m.vertexCount)
+                return false;
+        }
+    }
+    return true;
+}
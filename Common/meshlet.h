@@ -0,0 +1,66 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include <DirectXMath.h>
+namespace common
+{
+	/// <summary>
+	/// Limits that fit the usual mesh shader output (NVidia recommends 64/126, 124 keeps the
+	/// primitive indices 4 byte aligned).
+	/// </summary>
+	constexpr uint32_t MESHLET_MAX_VERTICES = 64;
+	constexpr uint32_t MESHLET_MAX_TRIANGLES = 124;
+	/// <summary>
+	/// A cluster of triangles. The builder doesn't reorder the triangles, so the triangles
+	/// of a meshlet are also a contiguous range of the regular index buffer:
+	/// firstIndex = triangleOffset * 3, indexCount = triangleCount * 3.
+	/// </summary>
+	struct Meshlet
+	{
+		//into MeshletData::vertices
+		uint32_t vertexOffset;
+		uint32_t vertexCount;
+		//into MeshletData::triangles (in triangles, not bytes) and into the index buffer
+		uint32_t triangleOffset;
+		uint32_t triangleCount;
+	};
+	static_assert(sizeof(Meshlet) == 16, "Meshlet is part of the cooked mesh format");
+	/// <summary>
+	/// Bounding sphere and backface cone of a meshlet, in mesh space.
+	/// The cone axis is the average normal. coneCutoff is the sin of the normals spread, the
+	/// cluster is backfacing when dot(center - camera, axis) >= coneCutoff * |center - camera| + radius.
+	/// coneCutoff == 1 means that the normals are too spread to ever cull the cluster.
+	/// </summary>
+	struct MeshletBounds
+	{
+		DirectX::XMFLOAT3 center;
+		float radius;
+		DirectX::XMFLOAT3 coneAxis;
+		float coneCutoff;
+	};
+	static_assert(sizeof(MeshletBounds) == 32, "MeshletBounds is part of the cooked mesh format");
+
+	struct MeshletData
+	{
+		std::vector<Meshlet> meshlets;
+		std::vector<MeshletBounds> bounds;
+		//mesh vertex index of each meshlet vertex
+		std::vector<uint32_t> vertices;
+		//3 local (meshlet) vertex indices per triangle, what a mesh shader outputs as primitive indices
+		std::vector<uint8_t> triangles;
+	};
+	/// <summary>
+	/// Splits the triangles in meshlets, going in index buffer order. Run it after OptimizeMesh, the
+	/// vertex cache order is also good for meshlets.
+	/// </summary>
+	MeshletData BuildMeshlets(const std::vector<uint32_t>& indices, const std::vector<DirectX::XMFLOAT3>& positions,
+		uint32_t maxVertices = MESHLET_MAX_VERTICES, uint32_t maxTriangles = MESHLET_MAX_TRIANGLES);
+	/// <summary>
+	/// For meshlets that come from a file: checks that each meshlet's ranges are inside the
+	/// vertex and triangle arrays and inside the index buffer of the mesh, and that the local
+	/// and mesh vertex indices point to existing vertices.
+	/// </summary>
+	bool ValidateMeshlets(const Meshlet* meshlets, size_t meshletCount,
+		const uint32_t* vertices, size_t vertexCount, const uint8_t* triangles, size_t triangleCount,
+		size_t meshVertexCount, size_t meshIndexCount);
+}
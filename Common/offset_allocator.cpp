@@ -0,0 +1,175 @@
+#include "pch.h"
+#include "offset_allocator.h"
+#include <algorithm>
+
+namespace
+{
+    uint64_t AlignUp(uint64_t value, uint64_t alignment)
+    {
+        return (value + alignment - 1) & ~(alignment - 1);
+    }
+}
+
+common::OffsetAllocator::OffsetAllocator(uint64_t capacity)
+    :mCapacity(capacity)
+{
+    if (capacity > 0)
+        AddFreeRange(0, capacity);
+}
+
+common::OffsetAllocator::Handle common::OffsetAllocator::Allocate(uint64_t size, uint64_t alignment)
+{
+    assert(size > 0);
+    assert(alignment > 0 && (alignment & (alignment - 1)) == 0);
+    //the smallest range that fits, the alignment padding can make a bigger one necessary
+    for (auto it = mFreeBySize.lower_bound(size); it != mFreeBySize.end(); ++it)
+    {
+        const uint64_t rangeOffset = it->second;
+        const uint64_t rangeSize = it->first;
+        const uint64_t offset = AlignUp(rangeOffset, alignment);
+        if (offset + size > rangeOffset + rangeSize)
+            continue;
+        RemoveFreeRange(mFreeByOffset.find(rangeOffset));
+        //what's left before and after goes back to the free list
+        if (offset > rangeOffset)
+            AddFreeRange(rangeOffset, offset - rangeOffset);
+        if (offset + size < rangeOffset + rangeSize)
+            AddFreeRange(offset + size, rangeOffset + rangeSize - offset - size);
+        Handle handle;
+        if (!mFreeHandles.empty())
+        {
+            handle = mFreeHandles.back();
+            mFreeHandles.pop_back();
+        }
+        else
+        {
+            handle = static_cast<Handle>(mAllocations.size());
+            mAllocations.push_back({});
+        }
+        mAllocations[handle] = { offset, size, alignment, true };
+        mUsedSize += size;
+        mAllocationCount++;
+        return handle;
+    }
+    return INVALID_HANDLE;
+}
+
+void common::OffsetAllocator::Free(Handle handle)
+{
+    assert(handle < mAllocations.size() && mAllocations[handle].alive);
+    Allocation& a = mAllocations[handle];
+    a.alive = false;
+    mUsedSize -= a.size;
+    mAllocationCount--;
+    mFreeHandles.push_back(handle);
+    AddFreeRange(a.offset, a.size);
+}
+
+uint64_t common::OffsetAllocator::Offset(Handle handle)const
+{
+    assert(handle < mAllocations.size() && mAllocations[handle].alive);
+    return mAllocations[handle].offset;
+}
+
+uint64_t common::OffsetAllocator::Size(Handle handle)const
+{
+    assert(handle < mAllocations.size() && mAllocations[handle].alive);
+    return mAllocations[handle].size;
+}
+
+void common::OffsetAllocator::Grow(uint64_t newCapacity)
+{
+    assert(newCapacity >= mCapacity);
+    if (newCapacity == mCapacity)
+        return;
+    const uint64_t oldCapacity = mCapacity;
+    mCapacity = newCapacity;
+    AddFreeRange(oldCapacity, newCapacity - oldCapacity);
+}
+
+std::vector<common::OffsetAllocator::Move> common::OffsetAllocator::Defragment()
+{
+    std::vector<Handle> alive;
+    alive.reserve(mAllocationCount);
+    for (Handle h = 0; h < mAllocations.size(); h++)
+        if (mAllocations[h].alive)
+            alive.push_back(h);
+    std::sort(alive.begin(), alive.end(), [this](Handle a, Handle b) {
+        return mAllocations[a].offset < mAllocations[b].offset;
+    });
+    std::vector<Move> moves;
+    moves.reserve(alive.size());
+    mFreeByOffset.clear();
+    mFreeBySize.clear();
+    //in offset order each one goes to the lowest place it can, so they only move down
+    uint64_t cursor = 0;
+    for (Handle h : alive)
+    {
+        Allocation& a = mAllocations[h];
+        const uint64_t offset = AlignUp(cursor, a.alignment);
+        if (offset > cursor)
+            AddFreeRange(cursor, offset - cursor);
+        moves.push_back({ h, a.offset, offset, a.size });
+        a.offset = offset;
+        cursor = offset + a.size;
+    }
+    if (cursor < mCapacity)
+        AddFreeRange(cursor, mCapacity - cursor);
+    return moves;
+}
+
+bool common::OffsetAllocator::IsCompact()const
+{
+    if (mFreeByOffset.empty())
+        return true;
+    if (mFreeByOffset.size() > 1)
+        return false;
+    return mFreeByOffset.begin()->first + mFreeByOffset.begin()->second == mCapacity;
+}
+
+uint64_t common::OffsetAllocator::LargestFreeRange()const
+{
+    return mFreeBySize.empty() ? 0 : mFreeBySize.rbegin()->first;
+}
+
+void common::OffsetAllocator::AddFreeRange(uint64_t offset, uint64_t size)
+{
+    //merge with the free neighbours
+    auto next = mFreeByOffset.lower_bound(offset);
+    if (next != mFreeByOffset.begin())
+    {
+        auto prev = std::prev(next);
+        assert(prev->first + prev->second <= offset);
+        if (prev->first + prev->second == offset)
+        {
+            offset = prev->first;
+            size += prev->second;
+            RemoveFreeRange(prev);
+        }
+    }
+    if (next != mFreeByOffset.end())
+    {
+        assert(offset + size <= next->first);
+        if (offset + size == next->first)
+        {
+            size += next->second;
+            RemoveFreeRange(next);
+        }
+    }
+    mFreeByOffset.emplace(offset, size);
+    mFreeBySize.emplace(size, offset);
+}
+
+void common::OffsetAllocator::RemoveFreeRange(std::map<uint64_t, uint64_t>::iterator byOffset)
+{
+    auto range = mFreeBySize.equal_range(byOffset->second);
+    for (auto it = range.first; it != range.second; ++it)
+    {
+        if (it->second == byOffset->first)
+        {
+            mFreeBySize.erase(it);
+            break;
+        }
+    }
+    mFreeByOffset.erase(byOffset);
+}
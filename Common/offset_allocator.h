@@ -0,0 +1,77 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include <map>
+namespace common
+{
+	/// <summary>
+	/// Hands out ranges of [0, Capacity()), in whatever unit the caller wants (bytes, vertices,
+	/// indices). It only does the bookkeeping, it never touches memory, so it can be used for
+	/// gpu buffers and tested without a gpu. Best fit, free neighbours are merged.
+	/// Allocations are identified by a handle that survives Defragment.
+	/// </summary>
+	class OffsetAllocator
+	{
+	public:
+		using Handle = uint32_t;
+		static constexpr Handle INVALID_HANDLE = UINT32_MAX;
+		/// <summary>
+		/// Where Defragment put an allocation. from == to if it didn't move.
+		/// </summary>
+		struct Move
+		{
+			Handle handle;
+			uint64_t from;
+			uint64_t to;
+			uint64_t size;
+		};
+		explicit OffsetAllocator(uint64_t capacity);
+		/// <summary>
+		/// INVALID_HANDLE if there's no free range big enough. alignment must be a power of 2.
+		/// </summary>
+		Handle Allocate(uint64_t size, uint64_t alignment = 1);
+		void Free(Handle handle);
+		uint64_t Offset(Handle handle)const;
+		uint64_t Size(Handle handle)const;
+		/// <summary>
+		/// Adds [Capacity(), newCapacity) to the free space, the allocations stay where they are.
+		/// </summary>
+		void Grow(uint64_t newCapacity);
+		/// <summary>
+		/// Moves all the allocations to the beginning, keeping their order and alignment, so
+		/// that the free space is one range at the end. Returns where each allocation went, in
+		/// offset order, the caller has to move the data. They only move down, so copying them in
+		/// that order in place works like memmove.
+		/// </summary>
+		std::vector<Move> Defragment();
+		uint64_t Capacity()const { return mCapacity; }
+		uint64_t UsedSize()const { return mUsedSize; }
+		uint64_t FreeSize()const { return mCapacity - mUsedSize; }
+		uint64_t LargestFreeRange()const;
+		size_t FreeRangeCount()const { return mFreeByOffset.size(); }
+		/// <summary>
+		/// True if all the free space is one range at the end, Defragment would do nothing.
+		/// </summary>
+		bool IsCompact()const;
+		size_t AllocationCount()const { return mAllocationCount; }
+	private:
+		struct Allocation
+		{
+			uint64_t offset;
+			uint64_t size;
+			uint64_t alignment;
+			bool alive;
+		};
+		void AddFreeRange(uint64_t offset, uint64_t size);
+		void RemoveFreeRange(std::map<uint64_t, uint64_t>::iterator byOffset);
+		uint64_t mCapacity;
+		uint64_t mUsedSize = 0;
+		size_t mAllocationCount = 0;
+		//offset -> size, to find the neighbours
+		std::map<uint64_t, uint64_t> mFreeByOffset;
+		//size -> offset, for the best fit
+		std::multimap<uint64_t, uint64_t> mFreeBySize;
+		std::vector<Allocation> mAllocations;
+		std::vector<Handle> mFreeHandles;
+	};
+}
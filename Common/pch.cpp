@@ -2,7 +2,9 @@
 
 #include "pch.h"
 #include "mesh.h"
+#include "mesh_async_load.h"
 #include "../Common/d3d_utils.h"
+#include "placed_resource_allocator.h"
 #include "concatenate.h"
 #include "mathutils.h"
 // When you are using pre-compiled headers, this source file is necessary for compilation to succeed.
@@ -29,15 +31,12 @@ Microsoft::WRL::ComPtr<ID3D12Resource> common::images::CreateImage(int textureWi
     clearValue.Color[2] = cv[2];
     clearValue.Color[3] = cv[3];
 
-    Microsoft::WRL::ComPtr<ID3D12Resource> renderTargetTexture;
-    CD3DX12_HEAP_PROPERTIES props = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT);
-    device->CreateCommittedResource(
-        &props,
-        D3D12_HEAP_FLAG_NONE,
-        &textureDesc,
+    //placed in a render target heap, the first use has to be a clear
+    Microsoft::WRL::ComPtr<ID3D12Resource> renderTargetTexture = common::PlacedResourceAllocator::Default(device)->CreateResource(
+        D3D12_HEAP_TYPE_DEFAULT,
+        textureDesc,
         D3D12_RESOURCE_STATE_COMMON,
-        &clearValue,
-        IID_PPV_ARGS(&renderTargetTexture));
+        &clearValue);
     return renderTargetTexture;
 }
 
@@ -48,45 +47,67 @@ Microsoft::WRL::ComPtr<ID3D12Resource> common::images::CreateDepthImage(int text
     depthClearValue.DepthStencil.Depth = 1.0f;
     depthClearValue.DepthStencil.Stencil = 0;
 
-    CD3DX12_HEAP_PROPERTIES depthStencilHeapProperties = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT);
     CD3DX12_RESOURCE_DESC depthStencilResourceDesc = CD3DX12_RESOURCE_DESC::Tex2D(DXGI_FORMAT_D32_FLOAT, //format
         textureWidth, textureHeight, // w/h 
         1, //array size 
         1, //mip levels 
         1, 0, D3D12_RESOURCE_FLAG_ALLOW_DEPTH_STENCIL);
-    Microsoft::WRL::ComPtr<ID3D12Resource> depthStencilBuffer;
-    CD3DX12_HEAP_PROPERTIES props = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT);
-    device->CreateCommittedResource(
-        &depthStencilHeapProperties,
-        D3D12_HEAP_FLAG_NONE,
-        &depthStencilResourceDesc,
+    //placed in a render target heap, the first use has to be a clear
+    Microsoft::WRL::ComPtr<ID3D12Resource> depthStencilBuffer = common::PlacedResourceAllocator::Default(device)->CreateResource(
+        D3D12_HEAP_TYPE_DEFAULT,
+        depthStencilResourceDesc,
         D3D12_RESOURCE_STATE_DEPTH_WRITE,
-        &depthClearValue,
-        IID_PPV_ARGS(&depthStencilBuffer));
+        &depthClearValue);
     return depthStencilBuffer;
 }
 
 std::vector<std::shared_ptr<common::Mesh>> common::io::LoadMesh(
     Microsoft::WRL::ComPtr<ID3D12Device> device, 
     Microsoft::WRL::ComPtr<ID3D12CommandQueue> queue, 
-    std::string filepathInAssetFolder)
+    std::string filepathInAssetFolder,
+    common::VertexFormat vertexFormat)
+{
+    //the same as LoadMeshesAsync + UploadMeshes, but everything in this thread
+    common::io::LoadedMeshFile file = common::io::LoadMeshFile(filepathInAssetFolder);
+    return common::io::UploadMeshes(file, device, queue, vertexFormat);
+}
+
+std::vector<std::shared_ptr<common::Mesh>> common::io::ImportMesh(
+    Microsoft::WRL::ComPtr<ID3D12Device> device,
+    Microsoft::WRL::ComPtr<ID3D12CommandQueue> queue,
+    std::string filepathInAssetFolder,
+    common::VertexFormat vertexFormat)
 {
     std::string assetFolder = "assets/";
     std::stringstream ss;
-    ss <<assetFolder << filepathInAssetFolder;
-    std::string path = ss.str();
-    auto meshData = common::LoadMeshes(path);
-    std::vector<std::shared_ptr<common::Mesh>> result(meshData.size());
-    for (auto i = 0; i < meshData.size(); i++)
+    ss << assetFolder << filepathInAssetFolder;
+    common::MeshImporter importer(ss.str());
+    std::vector<std::shared_ptr<common::Mesh>> result(importer.MeshCount());
+    //all the meshes of the file in one submit, with staging memory for all of them.
+    //Info walks the mesh, it's done once per mesh
+    std::vector<common::MeshImportInfo> infos;
+    infos.reserve(importer.MeshCount());
+    uint64_t stagingSize = 16;
+    for (size_t i = 0; i < importer.MeshCount(); i++)
+    {
+        const common::MeshImportInfo& info = infos.emplace_back(importer.Info(i));
+        stagingSize += (info.vertexCount * sizeof(common::Vertex) + 15) / 16 * 16 +
+            (info.indexCount * common::IndexSize(info.IndexFormat()) + 15) / 16 * 16;
+    }
+    auto uploadBatch = std::make_shared<common::UploadBatch>(device, queue,
+        std::make_shared<common::UploadRing>(device, stagingSize, L"ImportMesh Ring"));
+    for (size_t i = 0; i < importer.MeshCount(); i++)
     {
-        std::shared_ptr<common::Mesh> mesh = std::make_shared<common::Mesh>(
-            meshData[i],
-            device, queue);
-        result[i] = mesh;
+        const common::MeshImportInfo& info = infos[i];
+        result[i] = std::make_shared<common::Mesh>(info.name, info.vertexCount, info.indexCount, info.IndexFormat(),
+            info.bounds,
+            [&importer, i, &info](common::Vertex* vertices, void* indices)
+            {
+                importer.WriteVertices(i, vertices);
+                importer.WriteIndices(i, info.IndexFormat(), indices);
+            },
+            device, queue, vertexFormat, nullptr, uploadBatch);
     }
+    uploadBatch->Flush();
     return result;
-
 }
-
-
-
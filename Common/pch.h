@@ -8,6 +8,9 @@
 #define PCH_H
 
 
+// Only the windows and d3d part is left out elsewhere, so the code that doesn't touch the gpu
+// (allocators, mesh processing, the threading helpers) builds on its own, see Tests.
+#if defined(_WIN32)
 #define WIN32_LEAN_AND_MEAN             // Exclude rarely-used stuff from Windows headers
 #include <windows.h>
 #include <initguid.h> //include <initguid.h> before including d3d12.h, and then the IIDs will be defined instead of just declared. 
@@ -16,15 +19,15 @@
 #include <D3Dcompiler.h>
 #include <DirectXMath.h>
 #include "d3dx12.h"
+#include <wrl/client.h>
+#endif
 #include <cassert>
+#include <cstdint>
 #include <vector>
 #include <array>
 #include <memory>
-#include <DirectXMath.h>
 #include <fstream>
 #include <iterator>
-#include <vector>
-#include <wrl/client.h>
 #include <functional>
 #include <optional>
 #include <string>
@@ -34,7 +37,12 @@
 namespace common
 {
 	class Mesh;
+	/// <summary>
+	/// How the vertices of a mesh are stored in the vertex buffer: common::Vertex or common::PackedVertex
+	/// </summary>
+	enum class VertexFormat { Full, Packed };
 }
+#if defined(_WIN32)
 namespace common::images
 {
 	Microsoft::WRL::ComPtr<ID3D12Resource> CreateImage(int textureWidth, 
@@ -56,17 +64,32 @@ namespace common::images
 namespace common::io
 {
 	/// <summary>
-	/// remember that a file can have many meshes, that's why is a vector
+	/// remember that a file can have many meshes, that's why is a vector.
+	/// The meshes are read from the cooked version of the file (see mesh_cache.h), assimp
+	/// is only used when it's missing or older than the source file.
+	/// Meshes with the same content as one that is alredy loaded are shared, see MeshRegistry.
 	/// </summary>
 	/// <param name="device"></param>
 	/// <param name="queue"></param>
 	/// <param name="filepathInAssetFolder"></param>
+	/// <param name="vertexFormat">Packed compresses the vertices before the upload</param>
 	/// <returns></returns>
 	std::vector<std::shared_ptr<common::Mesh>> LoadMesh(
 		Microsoft::WRL::ComPtr<ID3D12Device> device,
 		Microsoft::WRL::ComPtr<ID3D12CommandQueue> queue,
-		std::string filepathInAssetFolder);
+		std::string filepathInAssetFolder,
+		common::VertexFormat vertexFormat = common::VertexFormat::Full);
+	/// <summary>
+	/// Imports with assimp straight into the upload heap, see MeshImporter. No cooked file and
+	/// no optimizations, for files that are used once or are too big to keep a cpu copy of.
+	/// </summary>
+	std::vector<std::shared_ptr<common::Mesh>> ImportMesh(
+		Microsoft::WRL::ComPtr<ID3D12Device> device,
+		Microsoft::WRL::ComPtr<ID3D12CommandQueue> queue,
+		std::string filepathInAssetFolder,
+		common::VertexFormat vertexFormat = common::VertexFormat::Full);
 }
+#endif
 
 
 #endif //PCH_H
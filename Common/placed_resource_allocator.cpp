@@ -0,0 +1,224 @@
+#include "pch.h"
+#include "placed_resource_allocator.h"
+#include <atomic>
+using Microsoft::WRL::ComPtr;
+
+namespace
+{
+    // {6D1B3C2E-41A5-4F0E-9B67-2C58D41A7E93}
+    const GUID PLACED_RANGE_GUID = { 0x6d1b3c2e, 0x41a5, 0x4f0e, { 0x9b, 0x67, 0x2c, 0x58, 0xd4, 0x1a, 0x7e, 0x93 } };
+    /// <summary>
+    /// Goes in the private data of a placed resource. The resource releases it when it's destroyed,
+    /// and then the range goes back to the heap, so the callers keep using plain ComPtrs.
+    /// A committed resource has one too, with INVALID_HANDLE, to be counted out.
+    /// </summary>
+    class PlacedRange final : public IUnknown
+    {
+    public:
+        PlacedRange(std::shared_ptr<common::PlacedResourceAllocator> owner, size_t heap,
+            common::TlsfAllocator::Handle handle)
+            :mOwner(owner), mHeap(heap), mHandle(handle)
+        {
+        }
+        HRESULT STDMETHODCALLTYPE QueryInterface(REFIID riid, void** object) override
+        {
+            if (object == nullptr)
+                return E_POINTER;
+            if (riid != IID_IUnknown)
+            {
+                *object = nullptr;
+                return E_NOINTERFACE;
+            }
+            AddRef();
+            *object = this;
+            return S_OK;
+        }
+        ULONG STDMETHODCALLTYPE AddRef() override
+        {
+            return ++mReferences;
+        }
+        ULONG STDMETHODCALLTYPE Release() override
+        {
+            const ULONG references = --mReferences;
+            if (references == 0)
+            {
+                mOwner->Free(mHeap, mHandle);
+                delete this;
+            }
+            return references;
+        }
+    private:
+        std::atomic<ULONG> mReferences{ 1 };
+        std::shared_ptr<common::PlacedResourceAllocator> mOwner;
+        size_t mHeap;
+        common::TlsfAllocator::Handle mHandle;
+    };
+}
+
+common::PlacedResourceAllocator::PlacedResourceAllocator(ComPtr<ID3D12Device> device, uint64_t heapSize)
+    :mDevice(device), mHeapSize(heapSize)
+{
+    assert(mDevice != nullptr);
+    //the render target heaps are aligned to 4MB, their size has to be too
+    assert(heapSize > 0 && heapSize % D3D12_DEFAULT_MSAA_RESOURCE_PLACEMENT_ALIGNMENT == 0);
+}
+
+std::shared_ptr<common::PlacedResourceAllocator> common::PlacedResourceAllocator::Default(ComPtr<ID3D12Device> device)
+{
+    static std::mutex mutex;
+    static std::shared_ptr<PlacedResourceAllocator> allocator;
+    std::lock_guard<std::mutex> lock(mutex);
+    //the resources of the old device keep the old allocator alive
+    if (allocator == nullptr || allocator->mDevice != device)
+        allocator = std::make_shared<PlacedResourceAllocator>(device);
+    return allocator;
+}
+
+common::PlacedResourceAllocator::Kind common::PlacedResourceAllocator::KindOf(const D3D12_RESOURCE_DESC& desc)
+{
+    if (desc.Dimension == D3D12_RESOURCE_DIMENSION_BUFFER)
+        return Kind::Buffers;
+    if (desc.Flags & (D3D12_RESOURCE_FLAG_ALLOW_RENDER_TARGET | D3D12_RESOURCE_FLAG_ALLOW_DEPTH_STENCIL))
+        return Kind::RenderTargets;
+    return Kind::Textures;
+}
+
+size_t common::PlacedResourceAllocator::CreateHeap(D3D12_HEAP_TYPE heapType, Kind kind)
+{
+    //resource heap tier 1 can't mix buffers, textures and render targets in a heap
+    D3D12_HEAP_FLAGS flags = D3D12_HEAP_FLAG_ALLOW_ONLY_BUFFERS;
+    UINT64 alignment = D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT;
+    if (kind == Kind::Textures)
+        flags = D3D12_HEAP_FLAG_ALLOW_ONLY_NON_RT_DS_TEXTURES;
+    else if (kind == Kind::RenderTargets)
+    {
+        flags = D3D12_HEAP_FLAG_ALLOW_ONLY_RT_DS_TEXTURES;
+        alignment = D3D12_DEFAULT_MSAA_RESOURCE_PLACEMENT_ALIGNMENT;
+    }
+    CD3DX12_HEAP_DESC desc(mHeapSize, heapType, alignment, flags);
+    ComPtr<ID3D12Heap> heap;
+    HRESULT hr = mDevice->CreateHeap(&desc, IID_PPV_ARGS(&heap));
+    if (FAILED(hr))
+        throw std::runtime_error("could not create the resource heap");
+    heap->SetName(L"PlacedResourceAllocator heap");
+    mHeaps.push_back(std::make_unique<Heap>(Heap{ heap, TlsfAllocator(mHeapSize), heapType, kind }));
+    return mHeaps.size() - 1;
+}
+
+ComPtr<ID3D12Resource> common::PlacedResourceAllocator::CreateResource(D3D12_HEAP_TYPE heapType,
+    const D3D12_RESOURCE_DESC& desc, D3D12_RESOURCE_STATES initialState, const D3D12_CLEAR_VALUE* clearValue)
+{
+    const Kind kind = KindOf(desc);
+    D3D12_RESOURCE_DESC placedDesc = desc;
+    D3D12_RESOURCE_ALLOCATION_INFO info;
+    //small textures can be aligned to 4KB, if the device says so for this one
+    if (kind == Kind::Textures && desc.SampleDesc.Count <= 1)
+    {
+        placedDesc.Alignment = D3D12_SMALL_RESOURCE_PLACEMENT_ALIGNMENT;
+        info = mDevice->GetResourceAllocationInfo(0, 1, &placedDesc);
+        if (info.Alignment != D3D12_SMALL_RESOURCE_PLACEMENT_ALIGNMENT)
+        {
+            placedDesc.Alignment = 0;
+            info = mDevice->GetResourceAllocationInfo(0, 1, &placedDesc);
+        }
+    }
+    else
+        info = mDevice->GetResourceAllocationInfo(0, 1, &placedDesc);
+    if (info.SizeInBytes == UINT64_MAX)
+        throw std::runtime_error("invalid resource description");
+    ComPtr<ID3D12Resource> resource;
+    //it would take a heap of its own anyway
+    if (info.SizeInBytes > mHeapSize)
+    {
+        CD3DX12_HEAP_PROPERTIES heapProperties(heapType);
+        HRESULT hr = mDevice->CreateCommittedResource(&heapProperties, D3D12_HEAP_FLAG_NONE, &desc,
+            initialState, clearValue, IID_PPV_ARGS(&resource));
+        if (FAILED(hr))
+            throw std::runtime_error("could not create the committed resource");
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            mCommittedCount++;
+        }
+        PlacedRange* range = new PlacedRange(shared_from_this(), 0, TlsfAllocator::INVALID_HANDLE);
+        resource->SetPrivateDataInterface(PLACED_RANGE_GUID, range);
+        range->Release();
+        return resource;
+    }
+    size_t heapIndex = mHeaps.size();
+    TlsfAllocator::Handle handle = TlsfAllocator::INVALID_HANDLE;
+    ID3D12Heap* heap = nullptr;
+    uint64_t offset = 0;
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        for (size_t i = 0; i < mHeaps.size() && handle == TlsfAllocator::INVALID_HANDLE; i++)
+        {
+            if (mHeaps[i]->type != heapType || mHeaps[i]->kind != kind)
+                continue;
+            handle = mHeaps[i]->allocator.Allocate(info.SizeInBytes, info.Alignment);
+            heapIndex = i;
+        }
+        if (handle == TlsfAllocator::INVALID_HANDLE)
+        {
+            heapIndex = CreateHeap(heapType, kind);
+            handle = mHeaps[heapIndex]->allocator.Allocate(info.SizeInBytes, info.Alignment);
+            assert(handle != TlsfAllocator::INVALID_HANDLE);
+        }
+        heap = mHeaps[heapIndex]->heap.Get();
+        offset = mHeaps[heapIndex]->allocator.Offset(handle);
+        mResourceCount++;
+    }
+    HRESULT hr = mDevice->CreatePlacedResource(heap, offset, &placedDesc, initialState, clearValue,
+        IID_PPV_ARGS(&resource));
+    if (FAILED(hr))
+    {
+        Free(heapIndex, handle);
+        throw std::runtime_error("could not create the placed resource");
+    }
+    PlacedRange* range = new PlacedRange(shared_from_this(), heapIndex, handle);
+    resource->SetPrivateDataInterface(PLACED_RANGE_GUID, range);
+    range->Release();
+    return resource;
+}
+
+ComPtr<ID3D12Resource> common::PlacedResourceAllocator::CreateBuffer(D3D12_HEAP_TYPE heapType, uint64_t size,
+    D3D12_RESOURCE_STATES initialState, D3D12_RESOURCE_FLAGS flags)
+{
+    CD3DX12_RESOURCE_DESC desc = CD3DX12_RESOURCE_DESC::Buffer(size, flags);
+    return CreateResource(heapType, desc, initialState);
+}
+
+void common::PlacedResourceAllocator::Free(size_t heap, TlsfAllocator::Handle handle)
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    if (handle == TlsfAllocator::INVALID_HANDLE)
+    {
+        assert(mCommittedCount > 0);
+        mCommittedCount--;
+        return;
+    }
+    assert(heap < mHeaps.size());
+    mHeaps[heap]->allocator.Free(handle);
+    mResourceCount--;
+}
+
+common::PlacedResourceAllocator::Stats common::PlacedResourceAllocator::GetStats()const
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    Stats stats;
+    uint64_t largestRanges = 0;
+    for (const auto& heap : mHeaps)
+    {
+        const uint64_t largest = heap->allocator.LargestFreeRange();
+        stats.heapCount++;
+        stats.reservedSize += heap->allocator.Capacity();
+        stats.usedSize += heap->allocator.UsedSize();
+        stats.largestFreeRange = (std::max)(stats.largestFreeRange, largest);
+        largestRanges += largest;
+    }
+    stats.resourceCount = mResourceCount;
+    stats.committedCount = mCommittedCount;
+    const uint64_t freeSize = stats.reservedSize - stats.usedSize;
+    if (freeSize > 0)
+        stats.fragmentation = 1.0 - static_cast<double>(largestRanges) / static_cast<double>(freeSize);
+    return stats;
+}
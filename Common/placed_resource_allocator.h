@@ -0,0 +1,84 @@
+#pragma once
+#include "pch.h"
+#include "tlsf_allocator.h"
+#include <mutex>
+namespace common
+{
+	/// <summary>
+	/// Creates the resources as placed resources in big ID3D12Heaps, instead of one committed
+	/// resource (and one heap) each. There's a list of heaps for each heap type and kind of resource
+	/// (buffers, textures, render target/depth textures, because of resource heap tier 1), and a
+	/// TlsfAllocator for each heap. The offsets follow the alignment that the device asks for: 64KB
+	/// for buffers and most textures, 4KB for small textures, 4MB for msaa.
+	/// The returned resources are plain ComPtrs, their range goes back to the heap when the last
+	/// reference is released, so release them only when the gpu is done, like committed ones.
+	/// Placed render targets and depth buffers have to be cleared or discarded before the first use.
+	/// Thread safe.
+	/// </summary>
+	class PlacedResourceAllocator : public std::enable_shared_from_this<PlacedResourceAllocator>
+	{
+	public:
+		struct Stats
+		{
+			size_t heapCount = 0;
+			//bytes of the heaps
+			uint64_t reservedSize = 0;
+			//bytes the resources use, with their alignment
+			uint64_t usedSize = 0;
+			uint64_t largestFreeRange = 0;
+			size_t resourceCount = 0;
+			//live resources bigger than a heap, created as committed resources
+			size_t committedCount = 0;
+			/// <summary>
+			/// Of the heaps together: 1 - sum of the largest free ranges / free size.
+			/// </summary>
+			double fragmentation = 0.0;
+		};
+		/// <summary>
+		/// Make it with std::make_shared, the resources keep it alive.
+		/// </summary>
+		PlacedResourceAllocator(Microsoft::WRL::ComPtr<ID3D12Device> device, uint64_t heapSize = 64 << 20);
+		PlacedResourceAllocator(const PlacedResourceAllocator&) = delete;
+		PlacedResourceAllocator& operator=(const PlacedResourceAllocator&) = delete;
+		/// <summary>
+		/// The one that Common uses. It's made again if the device changes.
+		/// </summary>
+		static std::shared_ptr<PlacedResourceAllocator> Default(Microsoft::WRL::ComPtr<ID3D12Device> device);
+		/// <summary>
+		/// Like ID3D12Device::CreateCommittedResource, throws if there's no memory.
+		/// </summary>
+		Microsoft::WRL::ComPtr<ID3D12Resource> CreateResource(D3D12_HEAP_TYPE heapType,
+			const D3D12_RESOURCE_DESC& desc, D3D12_RESOURCE_STATES initialState,
+			const D3D12_CLEAR_VALUE* clearValue = nullptr);
+		Microsoft::WRL::ComPtr<ID3D12Resource> CreateBuffer(D3D12_HEAP_TYPE heapType, uint64_t size,
+			D3D12_RESOURCE_STATES initialState, D3D12_RESOURCE_FLAGS flags = D3D12_RESOURCE_FLAG_NONE);
+		Stats GetStats()const;
+		uint64_t HeapSize()const { return mHeapSize; }
+		/// <summary>
+		/// Gives a range back, the resources call it when they are destroyed. The committed ones
+		/// pass INVALID_HANDLE.
+		/// </summary>
+		void Free(size_t heap, TlsfAllocator::Handle handle);
+	private:
+		enum class Kind { Buffers, Textures, RenderTargets, Count };
+		/// <summary>
+		/// One ID3D12Heap and the ranges taken from it.
+		/// </summary>
+		struct Heap
+		{
+			Microsoft::WRL::ComPtr<ID3D12Heap> heap;
+			TlsfAllocator allocator;
+			D3D12_HEAP_TYPE type;
+			Kind kind;
+		};
+		static Kind KindOf(const D3D12_RESOURCE_DESC& desc);
+		size_t CreateHeap(D3D12_HEAP_TYPE heapType, Kind kind);
+		Microsoft::WRL::ComPtr<ID3D12Device> mDevice;
+		const uint64_t mHeapSize;
+		mutable std::mutex mMutex;
+		//never shrinks, the resources know their heap by index
+		std::vector<std::unique_ptr<Heap>> mHeaps;
+		size_t mResourceCount = 0;
+		size_t mCommittedCount = 0;
+	};
+}
@@ -0,0 +1,155 @@
+#pragma once
+#include <cstdint>
+#include <cassert>
+#include <vector>
+#include <algorithm>
+namespace common
+{
+	/// <summary>
+	/// What a queue that uses resources (the direct one) owes to the queue that wrote them (the copy
+	/// one): a gpu wait for the copy fence and the transitions to the states that the copy queue can't
+	/// use. Only bookkeeping, the fence values and the resources come from the caller, so it can be
+	/// tested with stand-ins.
+	/// Take the transitions when the consumer begins recording and the wait before it executes: the
+	/// wait is for everything submitted up to then, so it covers the transitions.
+	/// It also goes the other way: after taking them the consumer holds the resources in those states,
+	/// and before the producer writes one again the consumer has to put it back in COMMON and the
+	/// producer has to wait for that. The consumer runs in order, so a signal after the transitions
+	/// comes after the last use of the resource too.
+	/// </summary>
+	template<typename Resource, typename State>
+	class QueueHandoff
+	{
+	public:
+		struct Transition
+		{
+			Resource resource;
+			State state;
+		};
+		/// <summary>
+		/// The producer signaled fenceValue after writing the resources, they have to be in the given
+		/// states before the consumer uses them. The fence values must grow.
+		/// </summary>
+		void Submitted(uint64_t fenceValue, const std::vector<Transition>& transitions)
+		{
+			assert(fenceValue > mLastSubmitted);
+			mLastSubmitted = fenceValue;
+			//a resource written again only needs the last state
+			for (const Transition& t : transitions)
+			{
+				auto it = Find(mTransitions, t.resource);
+				if (it != mTransitions.end())
+					it->state = t.state;
+				else
+					mTransitions.push_back(t);
+			}
+		}
+		/// <summary>
+		/// The transitions that the consumer has to record, once each.
+		/// </summary>
+		std::vector<Transition> TakeTransitions()
+		{
+			std::vector<Transition> result;
+			result.swap(mTransitions);
+			//the consumer keeps them in those states until they are released
+			for (const Transition& t : result)
+			{
+				auto it = Find(mHeld, t.resource);
+				if (it != mHeld.end())
+					it->state = t.state;
+				else
+					mHeld.push_back(t);
+			}
+			return result;
+		}
+		/// <summary>
+		/// The fence value the consumer queue has to wait for, 0 if it alredy waited for everything.
+		/// </summary>
+		uint64_t TakeWait()
+		{
+			if (mLastSubmitted <= mLastWaited)
+				return 0;
+			mLastWaited = mLastSubmitted;
+			return mLastWaited;
+		}
+		/// <summary>
+		/// The producer is going to use resource. If the consumer holds it, returns true and the state
+		/// it has there: the consumer has to go back to COMMON (TakeReleases) and the producer wait for
+		/// it (TakeReleaseWait) before the producer's work executes.
+		/// A resource whose transitions weren't taken yet is still in COMMON, nothing to release.
+		/// </summary>
+		bool Release(const Resource& resource, State& heldState)
+		{
+			auto it = Find(mHeld, resource);
+			if (it == mHeld.end())
+				return false;
+			heldState = it->state;
+			mReleases.push_back(*it);
+			mHeld.erase(it);
+			return true;
+		}
+		/// <summary>
+		/// The transitions from these states to COMMON that the consumer has to record and submit,
+		/// then give the fence value it signals after them to ReleasesSubmitted.
+		/// </summary>
+		std::vector<Transition> TakeReleases()
+		{
+			std::vector<Transition> result;
+			result.swap(mReleases);
+			return result;
+		}
+		/// <summary>
+		/// The consumer signaled fenceValue after the releases. The fence values must grow.
+		/// </summary>
+		void ReleasesSubmitted(uint64_t fenceValue)
+		{
+			assert(fenceValue > mLastReleased);
+			mLastReleased = fenceValue;
+		}
+		/// <summary>
+		/// The consumer fence value the producer queue has to wait for, 0 if it alredy waited for everything.
+		/// </summary>
+		uint64_t TakeReleaseWait()
+		{
+			if (mLastReleased <= mLastReleaseWaited)
+				return 0;
+			mLastReleaseWaited = mLastReleased;
+			return mLastReleaseWaited;
+		}
+		/// <summary>
+		/// The resource is going away: the consumer won't get it or hold it anymore, and its address
+		/// can be reused. A release alredy asked for still happens, the producer relies on it.
+		/// </summary>
+		void Forget(const Resource& resource)
+		{
+			for (std::vector<Transition>* list : { &mTransitions, &mHeld })
+			{
+				auto it = Find(*list, resource);
+				if (it != list->end())
+					list->erase(it);
+			}
+		}
+		bool IsHeld(const Resource& resource)const
+		{
+			return std::any_of(mHeld.begin(), mHeld.end(),
+				[&resource](const Transition& held) { return held.resource == resource; });
+		}
+		uint64_t LastSubmitted()const { return mLastSubmitted; }
+		uint64_t LastWaited()const { return mLastWaited; }
+	private:
+		static typename std::vector<Transition>::iterator Find(std::vector<Transition>& list, const Resource& resource)
+		{
+			return std::find_if(list.begin(), list.end(),
+				[&resource](const Transition& t) { return t.resource == resource; });
+		}
+		uint64_t mLastSubmitted = 0;
+		uint64_t mLastWaited = 0;
+		uint64_t mLastReleased = 0;
+		uint64_t mLastReleaseWaited = 0;
+		std::vector<Transition> mTransitions;
+		//what the consumer holds in a state that isn't COMMON
+		std::vector<Transition> mHeld;
+		//what the consumer has to put back in COMMON
+		std::vector<Transition> mReleases;
+	};
+}
@@ -0,0 +1,90 @@
+#include "pch.h"
+#include "ring_allocator.h"
+
+namespace
+{
+    uint64_t AlignUp(uint64_t value, uint64_t alignment)
+    {
+        return (value + alignment - 1) & ~(alignment - 1);
+    }
+}
+
+common::RingAllocator::RingAllocator(uint64_t capacity)
+    :mCapacity(capacity)
+{
+}
+
+uint64_t common::RingAllocator::Allocate(uint64_t size, uint64_t alignment)
+{
+    assert(size > 0);
+    assert(alignment > 0 && (alignment & (alignment - 1)) == 0);
+    //nothing in use, start again from 0 so that the whole ring is one piece
+    if (mUsedSize == 0)
+        mHead = mTail = 0;
+    const uint64_t offset = FindOffset(size, alignment, mHead, mTail, mUsedSize);
+    if (offset == INVALID_OFFSET)
+        return INVALID_OFFSET;
+    //skip the end, the bytes go with the batch
+    if (offset < mTail)
+    {
+        const uint64_t skipped = mCapacity - mTail;
+        mUsedSize += skipped;
+        mCurrentBatchSize += skipped;
+        mTail = 0;
+    }
+    //the alignment padding is used too, it goes back with the batch
+    const uint64_t bytes = offset + size - mTail;
+    mUsedSize += bytes;
+    mCurrentBatchSize += bytes;
+    mTail = offset + size;
+    return offset;
+}
+
+bool common::RingAllocator::FitsAfterRetire(uint64_t size, uint64_t alignment)const
+{
+    assert(size > 0);
+    assert(alignment > 0 && (alignment & (alignment - 1)) == 0);
+    //all the finished batches given back: only the open one is left, it starts where the last one ends
+    const uint64_t head = mBatches.empty() ? mHead : mBatches.back().end;
+    if (mCurrentBatchSize == 0)
+        return FindOffset(size, alignment, 0, 0, 0) != INVALID_OFFSET;
+    return FindOffset(size, alignment, head, mTail, mCurrentBatchSize) != INVALID_OFFSET;
+}
+
+uint64_t common::RingAllocator::FindOffset(uint64_t size, uint64_t alignment, uint64_t head, uint64_t tail,
+    uint64_t usedSize)const
+{
+    if (size > mCapacity || usedSize == mCapacity)
+        return INVALID_OFFSET;
+    const uint64_t aligned = AlignUp(tail, alignment);
+    if (tail >= head)
+    {
+        //free: [tail, capacity) and [0, head)
+        if (aligned + size <= mCapacity)
+            return aligned;
+        //0 is aligned to anything
+        return size <= head ? 0 : INVALID_OFFSET;
+    }
+    //free: [tail, head)
+    return aligned + size <= head ? aligned : INVALID_OFFSET;
+}
+
+void common::RingAllocator::FinishBatch(uint64_t fenceValue)
+{
+    assert(mBatches.empty() || fenceValue > mBatches.back().fenceValue);
+    //nothing to give back
+    if (mCurrentBatchSize == 0)
+        return;
+    mBatches.push_back({ fenceValue, mTail, mCurrentBatchSize });
+    mCurrentBatchSize = 0;
+}
+
+void common::RingAllocator::Retire(uint64_t completedFenceValue)
+{
+    while (!mBatches.empty() && mBatches.front().fenceValue <= completedFenceValue)
+    {
+        mHead = mBatches.front().end;
+        mUsedSize -= mBatches.front().size;
+        mBatches.pop_front();
+    }
+}
@@ -0,0 +1,74 @@
+#pragma once
+#include <cstdint>
+#include <cassert>
+#include <deque>
+namespace common
+{
+	/// <summary>
+	/// Hands out ranges of [0, Capacity()) in order, wrapping around at the end, and gets them back
+	/// when the gpu is done with them. The allocations between two FinishBatch are a batch, tagged
+	/// with the fence value that the queue signals after using them; Retire frees the batches whose
+	/// fence value was reached. Only bookkeeping, the fence values come from the caller, so it can be
+	/// tested without a gpu.
+	/// </summary>
+	class RingAllocator
+	{
+	public:
+		static constexpr uint64_t INVALID_OFFSET = UINT64_MAX;
+		explicit RingAllocator(uint64_t capacity);
+		/// <summary>
+		/// INVALID_OFFSET if there's no room until some batch is retired. alignment must be a power of 2.
+		/// An allocation never crosses the end, the bytes skipped to go back to 0 belong to the current batch.
+		/// </summary>
+		uint64_t Allocate(uint64_t size, uint64_t alignment = 1);
+		/// <summary>
+		/// Closes the current batch, it is released when Retire sees fenceValue. The fence values
+		/// must grow.
+		/// </summary>
+		void FinishBatch(uint64_t fenceValue);
+		/// <summary>
+		/// If Allocate would find room once every finished batch is retired. False means that only
+		/// finishing the current batch can make room.
+		/// </summary>
+		bool FitsAfterRetire(uint64_t size, uint64_t alignment = 1)const;
+		/// <summary>
+		/// Releases the batches with fence value up to completedFenceValue.
+		/// </summary>
+		void Retire(uint64_t completedFenceValue);
+		/// <summary>
+		/// The fence value to wait for to release something, 0 if no batch is waiting.
+		/// </summary>
+		uint64_t OldestPendingFence()const { return mBatches.empty() ? 0 : mBatches.front().fenceValue; }
+		size_t PendingBatchCount()const { return mBatches.size(); }
+		uint64_t Capacity()const { return mCapacity; }
+		/// <summary>
+		/// Bytes that can't be allocated until a retire, including the padding and the skipped ends.
+		/// </summary>
+		uint64_t UsedSize()const { return mUsedSize; }
+		/// <summary>
+		/// Bytes of the batch that is still open.
+		/// </summary>
+		uint64_t CurrentBatchSize()const { return mCurrentBatchSize; }
+	private:
+		struct Batch
+		{
+			uint64_t fenceValue;
+			//where the next batch begins
+			uint64_t end;
+			uint64_t size;
+		};
+		/// <summary>
+		/// Where Allocate would put size bytes with this part of the ring in use, INVALID_OFFSET if
+		/// they don't fit. An offset before tail means that the end is skipped.
+		/// </summary>
+		uint64_t FindOffset(uint64_t size, uint64_t alignment, uint64_t head, uint64_t tail, uint64_t usedSize)const;
+		const uint64_t mCapacity;
+		//oldest byte in use
+		uint64_t mHead = 0;
+		//where the next allocation goes
+		uint64_t mTail = 0;
+		uint64_t mUsedSize = 0;
+		uint64_t mCurrentBatchSize = 0;
+		std::deque<Batch> mBatches;
+	};
+}
@@ -0,0 +1,105 @@
+#pragma once
+#include <cstdint>
+#include <cassert>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <array>
+namespace common
+{
+	/// <summary>
+	/// Hands snapshots from a producer thread (the simulation) to a consumer thread (the render)
+	/// with three buffers: the producer fills the back one, the consumer reads the front one and the
+	/// middle one is the last published. Publish and Acquire only swap an index with an atomic
+	/// exchange, so neither side waits for the other to copy or read, and the buffers are reused
+	/// without allocating (clear the vectors instead of making new ones).
+	/// The waits are optional and only sleep: the producer can wait for its snapshot to be taken so
+	/// it doesn't run ahead, the consumer for a snapshot it didn't see.
+	/// One producer thread and one consumer thread.
+	/// </summary>
+	template<typename T>
+	class SnapshotExchange
+	{
+	public:
+		/// <summary>
+		/// The producer's buffer, with whatever it had the last time it was the back one.
+		/// </summary>
+		T& Back() { return mBuffers[mBack]; }
+		/// <summary>
+		/// The back buffer becomes the newest snapshot. If the consumer didn't take the one before,
+		/// that one is dropped and becomes the back buffer.
+		/// </summary>
+		void Publish()
+		{
+			const uint32_t previous = mMiddle.exchange(mBack | NEW, std::memory_order_acq_rel);
+			mBack = previous & INDEX;
+			Notify();
+		}
+		/// <summary>
+		/// Takes the newest snapshot if there's one the consumer didn't see, then it's in Front.
+		/// </summary>
+		bool TryAcquire()
+		{
+			if ((mMiddle.load(std::memory_order_relaxed) & NEW) == 0)
+				return false;
+			const uint32_t previous = mMiddle.exchange(mFront, std::memory_order_acq_rel);
+			mFront = previous & INDEX;
+			Notify();
+			return true;
+		}
+		/// <summary>
+		/// The consumer's snapshot, it doesn't change until the next acquire.
+		/// </summary>
+		const T& Front()const { return mBuffers[mFront]; }
+		/// <summary>
+		/// Consumer: sleeps until there's a new snapshot and takes it. False if it was stopped.
+		/// </summary>
+		bool WaitAndAcquire()
+		{
+			std::unique_lock<std::mutex> lock(mWaitMutex);
+			mWaitCondition.wait(lock, [this]() {
+				return mStopped.load() || (mMiddle.load(std::memory_order_relaxed) & NEW) != 0;
+			});
+			lock.unlock();
+			return !mStopped.load() && TryAcquire();
+		}
+		/// <summary>
+		/// Producer: sleeps until the consumer took the last published snapshot. False if it was stopped.
+		/// </summary>
+		bool WaitUntilTaken()
+		{
+			std::unique_lock<std::mutex> lock(mWaitMutex);
+			mWaitCondition.wait(lock, [this]() {
+				return mStopped.load() || (mMiddle.load(std::memory_order_relaxed) & NEW) == 0;
+			});
+			return !mStopped.load();
+		}
+		/// <summary>
+		/// Wakes both sides up, the waits return false from now on.
+		/// </summary>
+		void Stop()
+		{
+			mStopped = true;
+			Notify();
+		}
+		bool IsStopped()const { return mStopped.load(); }
+	private:
+		static constexpr uint32_t INDEX = 3;
+		static constexpr uint32_t NEW = 4;
+		void Notify()
+		{
+			//the lock only orders the notify with a waiter that is checking, nothing waits for it long
+			{
+				std::lock_guard<std::mutex> lock(mWaitMutex);
+			}
+			mWaitCondition.notify_all();
+		}
+		std::array<T, 3> mBuffers;
+		uint32_t mBack = 0;
+		std::atomic<uint32_t> mMiddle{ 1 };
+		uint32_t mFront = 2;
+		std::atomic<bool> mStopped{ false };
+		std::mutex mWaitMutex;
+		std::condition_variable mWaitCondition;
+	};
+}
@@ -0,0 +1,56 @@
+#include "pch.h"
+#include "thread_pool.h"
+
+size_t common::ThreadPool::DefaultThreadCount()
+{
+    //hardware_concurrency can be 0 if it can't be known
+    const size_t cores = std::thread::hardware_concurrency();
+    return cores > 1 ? cores - 1 : 1;
+}
+
+common::ThreadPool::ThreadPool(size_t threadCount)
+{
+    assert(threadCount > 0);
+    mThreads.reserve(threadCount);
+    for (size_t i = 0; i < threadCount; i++)
+        mThreads.emplace_back([this]() { WorkerLoop(); });
+}
+
+common::ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mStopping = true;
+    }
+    mTaskAvailable.notify_all();
+    for (std::thread& t : mThreads)
+        t.join();
+}
+
+void common::ThreadPool::Enqueue(std::function<void()> task)
+{
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        assert(!mStopping);
+        mTasks.push_back(std::move(task));
+    }
+    mTaskAvailable.notify_one();
+}
+
+void common::ThreadPool::WorkerLoop()
+{
+    while (true)
+    {
+        std::function<void()> task;
+        {
+            std::unique_lock<std::mutex> lock(mMutex);
+            mTaskAvailable.wait(lock, [this]() { return mStopping || !mTasks.empty(); });
+            //only leave when there's nothing left, so no future is left without a value
+            if (mTasks.empty())
+                return;
+            task = std::move(mTasks.front());
+            mTasks.pop_front();
+        }
+        task();
+    }
+}
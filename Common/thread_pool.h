@@ -0,0 +1,51 @@
+#pragma once
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <vector>
+#include <condition_variable>
+#include <deque>
+#include <future>
+#include <mutex>
+#include <thread>
+namespace common
+{
+	/// <summary>
+	/// A fixed set of worker threads that run the tasks in the order they were submitted.
+	/// The destructor finishes the pending tasks before joining the workers.
+	/// </summary>
+	class ThreadPool
+	{
+	public:
+		/// <summary>
+		/// One worker per core, minus the main thread.
+		/// </summary>
+		static size_t DefaultThreadCount();
+		explicit ThreadPool(size_t threadCount = DefaultThreadCount());
+		~ThreadPool();
+		ThreadPool(const ThreadPool&) = delete;
+		ThreadPool& operator=(const ThreadPool&) = delete;
+		size_t ThreadCount()const { return mThreads.size(); }
+		/// <summary>
+		/// Queues the task. The future gets the return value, or the exception if the task throws.
+		/// </summary>
+		template<typename F>
+		std::future<std::invoke_result_t<std::decay_t<F>>> Submit(F&& task)
+		{
+			using Result = std::invoke_result_t<std::decay_t<F>>;
+			//std::function must be copyable and packaged_task is not, so it goes in a shared_ptr
+			auto packaged = std::make_shared<std::packaged_task<Result()>>(std::forward<F>(task));
+			std::future<Result> future = packaged->get_future();
+			Enqueue([packaged]() { (*packaged)(); });
+			return future;
+		}
+	private:
+		void Enqueue(std::function<void()> task);
+		void WorkerLoop();
+		std::vector<std::thread> mThreads;
+		std::deque<std::function<void()>> mTasks;
+		std::mutex mMutex;
+		std::condition_variable mTaskAvailable;
+		bool mStopping = false;
+	};
+}
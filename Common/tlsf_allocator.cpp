@@ -0,0 +1,256 @@
+#include "pch.h"
+#include "tlsf_allocator.h"
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+namespace
+{
+    uint64_t AlignUp(uint64_t value, uint64_t alignment)
+    {
+        return (value + alignment - 1) & ~(alignment - 1);
+    }
+    //index of the highest set bit, value can't be 0
+    uint32_t HighestBit(uint64_t value)
+    {
+#if defined(_MSC_VER)
+        unsigned long index;
+        _BitScanReverse64(&index, value);
+        return index;
+#else
+        return 63 - __builtin_clzll(value);
+#endif
+    }
+    //index of the lowest set bit, value can't be 0
+    uint32_t LowestBit(uint64_t value)
+    {
+#if defined(_MSC_VER)
+        unsigned long index;
+        _BitScanForward64(&index, value);
+        return index;
+#else
+        return __builtin_ctzll(value);
+#endif
+    }
+}
+
+common::TlsfAllocator::TlsfAllocator(uint64_t capacity)
+    :mCapacity(capacity)
+{
+    for (auto& heads : mHeads)
+        heads.fill(NONE);
+    if (capacity > 0)
+    {
+        const uint32_t block = NewBlock();
+        mBlocks[block] = { 0, capacity, NONE, NONE, NONE, NONE, true, true };
+        InsertFree(block);
+    }
+}
+
+void common::TlsfAllocator::Mapping(uint64_t size, uint32_t& fl, uint32_t& sl)
+{
+    if (size < SL_COUNT)
+    {
+        fl = 0;
+        sl = static_cast<uint32_t>(size);
+        return;
+    }
+    const uint32_t bit = HighestBit(size);
+    fl = bit - SL_LOG2 + 1;
+    sl = static_cast<uint32_t>(size >> (bit - SL_LOG2)) - SL_COUNT;
+}
+
+uint32_t common::TlsfAllocator::FindFree(uint64_t size)const
+{
+    //round up to the next size class, so that any range in the list is big enough
+    if (size >= SL_COUNT)
+        size += (uint64_t(1) << (HighestBit(size) - SL_LOG2)) - 1;
+    uint32_t fl, sl;
+    Mapping(size, fl, sl);
+    if (fl >= FL_COUNT)
+        return NONE;
+    uint32_t slBitmap = sl < SL_COUNT ? mSlBitmaps[fl] & (~0u << sl) : 0;
+    if (slBitmap == 0)
+    {
+        const uint64_t flBitmap = fl + 1 < 64 ? mFlBitmap & (~uint64_t(0) << (fl + 1)) : 0;
+        if (flBitmap == 0)
+            return NONE;
+        fl = LowestBit(flBitmap);
+        slBitmap = mSlBitmaps[fl];
+    }
+    sl = LowestBit(slBitmap);
+    return mHeads[fl][sl];
+}
+
+void common::TlsfAllocator::InsertFree(uint32_t block)
+{
+    Block& b = mBlocks[block];
+    uint32_t fl, sl;
+    Mapping(b.size, fl, sl);
+    b.free = true;
+    b.prevFree = NONE;
+    b.nextFree = mHeads[fl][sl];
+    if (b.nextFree != NONE)
+        mBlocks[b.nextFree].prevFree = block;
+    mHeads[fl][sl] = block;
+    mFlBitmap |= uint64_t(1) << fl;
+    mSlBitmaps[fl] |= 1u << sl;
+    mFreeRangeCount++;
+}
+
+void common::TlsfAllocator::RemoveFree(uint32_t block)
+{
+    Block& b = mBlocks[block];
+    assert(b.free);
+    if (b.prevFree != NONE)
+        mBlocks[b.prevFree].nextFree = b.nextFree;
+    if (b.nextFree != NONE)
+        mBlocks[b.nextFree].prevFree = b.prevFree;
+    uint32_t fl, sl;
+    Mapping(b.size, fl, sl);
+    if (mHeads[fl][sl] == block)
+    {
+        mHeads[fl][sl] = b.nextFree;
+        if (b.nextFree == NONE)
+        {
+            mSlBitmaps[fl] &= ~(1u << sl);
+            if (mSlBitmaps[fl] == 0)
+                mFlBitmap &= ~(uint64_t(1) << fl);
+        }
+    }
+    b.free = false;
+    mFreeRangeCount--;
+}
+
+bool common::TlsfAllocator::Fits(uint32_t block, uint64_t size, uint64_t alignment)const
+{
+    const Block& b = mBlocks[block];
+    return AlignUp(b.offset, alignment) + size <= b.offset + b.size;
+}
+
+uint32_t common::TlsfAllocator::NewBlock()
+{
+    if (!mUnusedBlocks.empty())
+    {
+        const uint32_t block = mUnusedBlocks.back();
+        mUnusedBlocks.pop_back();
+        return block;
+    }
+    mBlocks.push_back({});
+    return static_cast<uint32_t>(mBlocks.size() - 1);
+}
+
+void common::TlsfAllocator::SplitTail(uint32_t block, uint64_t size)
+{
+    const uint32_t tail = NewBlock();
+    Block& b = mBlocks[block];
+    mBlocks[tail] = { b.offset + size, b.size - size, block, b.nextPhysical, NONE, NONE, false, true };
+    if (b.nextPhysical != NONE)
+        mBlocks[b.nextPhysical].prevPhysical = tail;
+    b.nextPhysical = tail;
+    b.size = size;
+    InsertFree(tail);
+}
+
+void common::TlsfAllocator::Merge(uint32_t block, uint32_t next)
+{
+    Block& b = mBlocks[block];
+    Block& n = mBlocks[next];
+    assert(b.nextPhysical == next);
+    b.size += n.size;
+    b.nextPhysical = n.nextPhysical;
+    if (n.nextPhysical != NONE)
+        mBlocks[n.nextPhysical].prevPhysical = block;
+    n.alive = false;
+    mUnusedBlocks.push_back(next);
+}
+
+common::TlsfAllocator::Handle common::TlsfAllocator::Allocate(uint64_t size, uint64_t alignment)
+{
+    assert(size > 0);
+    assert(alignment > 0 && (alignment & (alignment - 1)) == 0);
+    uint32_t block = FindFree(size);
+    //the first range of the class may not have room for the padding, then we look for one that
+    //fits even with the worst padding
+    if (block != NONE && !Fits(block, size, alignment))
+        block = FindFree(size + alignment - 1);
+    //the classes above are empty, but a range in the class of size itself can still be big enough
+    if (block == NONE)
+    {
+        uint32_t fl, sl;
+        Mapping(size, fl, sl);
+        for (block = mHeads[fl][sl]; block != NONE && !Fits(block, size, alignment); block = mBlocks[block].nextFree);
+    }
+    if (block == NONE)
+        return INVALID_HANDLE;
+    RemoveFree(block);
+    const uint64_t padding = AlignUp(mBlocks[block].offset, alignment) - mBlocks[block].offset;
+    if (padding > 0)
+    {
+        //the padding stays free, the allocation is the block after it
+        SplitTail(block, padding);
+        const uint32_t padded = block;
+        block = mBlocks[padded].nextPhysical;
+        RemoveFree(block);
+        InsertFree(padded);
+    }
+    if (mBlocks[block].size > size)
+        SplitTail(block, size);
+    mUsedSize += size;
+    mAllocationCount++;
+    return block;
+}
+
+void common::TlsfAllocator::Free(Handle handle)
+{
+    assert(handle < mBlocks.size() && mBlocks[handle].alive && !mBlocks[handle].free);
+    uint32_t block = handle;
+    mUsedSize -= mBlocks[block].size;
+    mAllocationCount--;
+    const uint32_t next = mBlocks[block].nextPhysical;
+    if (next != NONE && mBlocks[next].free)
+    {
+        RemoveFree(next);
+        Merge(block, next);
+    }
+    const uint32_t prev = mBlocks[block].prevPhysical;
+    if (prev != NONE && mBlocks[prev].free)
+    {
+        RemoveFree(prev);
+        Merge(prev, block);
+        block = prev;
+    }
+    InsertFree(block);
+}
+
+uint64_t common::TlsfAllocator::Offset(Handle handle)const
+{
+    assert(handle < mBlocks.size() && mBlocks[handle].alive && !mBlocks[handle].free);
+    return mBlocks[handle].offset;
+}
+
+uint64_t common::TlsfAllocator::Size(Handle handle)const
+{
+    assert(handle < mBlocks.size() && mBlocks[handle].alive && !mBlocks[handle].free);
+    return mBlocks[handle].size;
+}
+
+uint64_t common::TlsfAllocator::LargestFreeRange()const
+{
+    if (mFlBitmap == 0)
+        return 0;
+    const uint32_t fl = HighestBit(mFlBitmap);
+    const uint32_t sl = HighestBit(mSlBitmaps[fl]);
+    uint64_t largest = 0;
+    for (uint32_t block = mHeads[fl][sl]; block != NONE; block = mBlocks[block].nextFree)
+        largest = (std::max)(largest, mBlocks[block].size);
+    return largest;
+}
+
+double common::TlsfAllocator::Fragmentation()const
+{
+    const uint64_t freeSize = FreeSize();
+    if (freeSize == 0)
+        return 0.0;
+    return 1.0 - static_cast<double>(LargestFreeRange()) / static_cast<double>(freeSize);
+}
@@ -0,0 +1,89 @@
+#pragma once
+#include <cstdint>
+#include <array>
+#include <vector>
+namespace common
+{
+	/// <summary>
+	/// Two level segregated fit: the free ranges are kept in lists by size class (a power of 2 split
+	/// in 16 steps), with bitmaps to find a non empty list, so Allocate and Free take constant time
+	/// no matter how many ranges there are. Free neighbours are merged.
+	/// Like OffsetAllocator it only does the bookkeeping for [0, Capacity()), it never touches memory,
+	/// so it can be tested and benchmarked without a gpu. PlacedResourceAllocator uses one per heap.
+	/// </summary>
+	class TlsfAllocator
+	{
+	public:
+		using Handle = uint32_t;
+		static constexpr Handle INVALID_HANDLE = UINT32_MAX;
+		explicit TlsfAllocator(uint64_t capacity);
+		/// <summary>
+		/// INVALID_HANDLE if there's no free range big enough. alignment must be a power of 2.
+		/// </summary>
+		Handle Allocate(uint64_t size, uint64_t alignment = 1);
+		void Free(Handle handle);
+		uint64_t Offset(Handle handle)const;
+		uint64_t Size(Handle handle)const;
+		uint64_t Capacity()const { return mCapacity; }
+		uint64_t UsedSize()const { return mUsedSize; }
+		uint64_t FreeSize()const { return mCapacity - mUsedSize; }
+		/// <summary>
+		/// Looks only at the biggest size class that has free ranges.
+		/// </summary>
+		uint64_t LargestFreeRange()const;
+		size_t FreeRangeCount()const { return mFreeRangeCount; }
+		size_t AllocationCount()const { return mAllocationCount; }
+		/// <summary>
+		/// 0 when the free space is one range, close to 1 when it's scattered in small ranges:
+		/// 1 - largest free range / free size.
+		/// </summary>
+		double Fragmentation()const;
+	private:
+		static constexpr uint32_t SL_LOG2 = 4;
+		static constexpr uint32_t SL_COUNT = 1 << SL_LOG2;
+		//sizes below SL_COUNT go to the first level 0, each bit above that is a level
+		static constexpr uint32_t FL_COUNT = 64 - SL_LOG2 + 1;
+		static constexpr uint32_t NONE = UINT32_MAX;
+		/// <summary>
+		/// A range, free or allocated. The physical links are the neighbours in the address space, the
+		/// free links are the other ranges of the same size class.
+		/// </summary>
+		struct Block
+		{
+			uint64_t offset;
+			uint64_t size;
+			uint32_t prevPhysical;
+			uint32_t nextPhysical;
+			uint32_t prevFree;
+			uint32_t nextFree;
+			bool free;
+			bool alive;
+		};
+		static void Mapping(uint64_t size, uint32_t& fl, uint32_t& sl);
+		/// <summary>
+		/// A non empty list where every range is at least size, NONE if there's none.
+		/// </summary>
+		uint32_t FindFree(uint64_t size)const;
+		bool Fits(uint32_t block, uint64_t size, uint64_t alignment)const;
+		void InsertFree(uint32_t block);
+		void RemoveFree(uint32_t block);
+		/// <summary>
+		/// Cuts [offset + size, end) of block into a new free block.
+		/// </summary>
+		void SplitTail(uint32_t block, uint64_t size);
+		/// <summary>
+		/// block absorbs next, that is recycled.
+		/// </summary>
+		void Merge(uint32_t block, uint32_t next);
+		uint32_t NewBlock();
+		uint64_t mCapacity;
+		uint64_t mUsedSize = 0;
+		size_t mFreeRangeCount = 0;
+		size_t mAllocationCount = 0;
+		uint64_t mFlBitmap = 0;
+		std::array<uint32_t, FL_COUNT> mSlBitmaps{};
+		std::array<std::array<uint32_t, SL_COUNT>, FL_COUNT> mHeads;
+		std::vector<Block> mBlocks;
+		std::vector<uint32_t> mUnusedBlocks;
+	};
+}
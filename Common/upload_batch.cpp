@@ -0,0 +1,305 @@
+#include "pch.h"
+#include "upload_batch.h"
+using Microsoft::WRL::ComPtr;
+
+common::UploadBatch::UploadBatch(ComPtr<ID3D12Device> device, ComPtr<ID3D12CommandQueue> commandQueue,
+    std::shared_ptr<UploadRing> uploadRing, ComPtr<ID3D12CommandQueue> consumerQueue)
+    :mDevice(device), mCommandQueue(commandQueue), mType(commandQueue->GetDesc().Type), mUploadRing(uploadRing),
+    mConsumerQueue(consumerQueue)
+{
+    assert(mUploadRing != nullptr);
+    assert(mType == D3D12_COMMAND_LIST_TYPE_DIRECT || mType == D3D12_COMMAND_LIST_TYPE_COPY);
+    assert(mType == D3D12_COMMAND_LIST_TYPE_DIRECT || mConsumerQueue != nullptr);
+    HRESULT hr = mDevice->CreateFence(0, D3D12_FENCE_FLAG_NONE, IID_PPV_ARGS(&mFence));
+    if (FAILED(hr))
+        throw std::runtime_error("could not create the upload batch fence");
+    if (mType == D3D12_COMMAND_LIST_TYPE_COPY)
+    {
+        hr = mDevice->CreateFence(0, D3D12_FENCE_FLAG_NONE, IID_PPV_ARGS(&mReleaseFence));
+        if (FAILED(hr))
+            throw std::runtime_error("could not create the upload batch release fence");
+    }
+    mFenceEvent = CreateEventW(nullptr, FALSE, FALSE, nullptr);
+    assert(mFenceEvent != nullptr);
+}
+
+common::UploadBatch::~UploadBatch()
+{
+    Flush();
+    CloseHandle(mFenceEvent);
+}
+
+bool common::UploadBatch::IsComplete(uint64_t fenceValue)const
+{
+    return mFence->GetCompletedValue() >= fenceValue;
+}
+
+void common::UploadBatch::Wait(uint64_t fenceValue)
+{
+    if (IsComplete(fenceValue))
+        return;
+    mFence->SetEventOnCompletion(fenceValue, mFenceEvent);
+    WaitForSingleObject(mFenceEvent, INFINITE);
+    Retire();
+}
+
+void common::UploadBatch::Retire()
+{
+    while (!mKeptAlive.empty() && IsComplete(mKeptAlive.front().first))
+        mKeptAlive.pop_front();
+}
+
+void common::UploadBatch::Begin()
+{
+    if (mRecording)
+        return;
+    Retire();
+    //the oldest allocator is free if its batch is done, otherwise we need another one
+    if (!mSubmittedAllocators.empty() && IsComplete(mSubmittedAllocators.front().first))
+    {
+        mCommandAllocator = mSubmittedAllocators.front().second;
+        mSubmittedAllocators.pop_front();
+        HRESULT hr = mCommandAllocator->Reset();
+        assert(SUCCEEDED(hr));
+    }
+    else
+    {
+        HRESULT hr = mDevice->CreateCommandAllocator(mType, IID_PPV_ARGS(&mCommandAllocator));
+        if (FAILED(hr))
+            throw std::runtime_error("could not create the upload batch command allocator");
+    }
+    if (mCommandList == nullptr)
+    {
+        //a new list is alredy open
+        HRESULT hr = mDevice->CreateCommandList(0, mType, mCommandAllocator.Get(),
+            nullptr, IID_PPV_ARGS(&mCommandList));
+        if (FAILED(hr))
+            throw std::runtime_error("could not create the upload batch command list");
+        mCommandList->SetName(L"UploadBatch");
+    }
+    else
+    {
+        HRESULT hr = mCommandList->Reset(mCommandAllocator.Get(), nullptr);
+        assert(SUCCEEDED(hr));
+    }
+    mRecording = true;
+}
+
+D3D12_RESOURCE_STATES common::UploadBatch::Acquire(ID3D12Resource* resource)
+{
+    auto it = mStates.find(resource);
+    if (it != mStates.end())
+        return it->second.final;
+    //the direct queue puts it in COMMON before the copies run, it gets its state back after
+    D3D12_RESOURCE_STATES held = D3D12_RESOURCE_STATE_COMMON;
+    if (mType == D3D12_COMMAND_LIST_TYPE_COPY)
+        mHandoff.Release(resource, held);
+    return held;
+}
+
+void common::UploadBatch::Use(ID3D12Resource* resource, D3D12_RESOURCE_STATES state, D3D12_RESOURCE_STATES finalState)
+{
+    Begin();
+    Acquire(resource);
+    auto it = mStates.find(resource);
+    const D3D12_RESOURCE_STATES current = it == mStates.end() ? D3D12_RESOURCE_STATE_COMMON : it->second.current;
+    if (current != state)
+    {
+        CD3DX12_RESOURCE_BARRIER barrier = CD3DX12_RESOURCE_BARRIER::Transition(resource, current, state);
+        mCommandList->ResourceBarrier(1, &barrier);
+    }
+    mStates[resource] = { state, finalState };
+}
+
+void common::UploadBatch::Transition(ID3D12Resource* resource, D3D12_RESOURCE_STATES state)
+{
+    Begin();
+    Acquire(resource);
+    auto it = mStates.find(resource);
+    if (it == mStates.end())
+        mStates[resource] = { D3D12_RESOURCE_STATE_COMMON, state };
+    else
+        it->second.final = state;
+}
+
+void common::UploadBatch::Reserve(uint64_t size)
+{
+    if (size == 0)
+        return;
+    //what this batch staged is filling the ring: send it, so that the ring can wait for it to be
+    //done instead of making buffers for the uploads that don't fit. Not in Copy, the memory it
+    //returned before may not be written yet
+    const RingAllocator& ring = mUploadRing->Allocator();
+    if (mRecording && size <= ring.Capacity() && ring.CurrentBatchSize() > 0 &&
+        !ring.FitsAfterRetire(size, UploadRing::DEFAULT_ALIGNMENT))
+        Submit();
+    mReserved = mUploadRing->Allocate(size);
+    mReservedUsed = 0;
+}
+
+common::UploadRing::Allocation common::UploadBatch::Stage(uint64_t size)
+{
+    const uint64_t aligned = (size + UploadRing::DEFAULT_ALIGNMENT - 1) & ~(UploadRing::DEFAULT_ALIGNMENT - 1);
+    if (mReserved.buffer == nullptr || mReservedUsed + aligned > mReserved.size)
+        return mUploadRing->Allocate(size);
+    UploadRing::Allocation staging = mReserved;
+    staging.offset += mReservedUsed;
+    staging.cpuAddress = static_cast<uint8_t*>(staging.cpuAddress) + mReservedUsed;
+    staging.gpuAddress += mReservedUsed;
+    staging.size = size;
+    mReservedUsed += aligned;
+    return staging;
+}
+
+void* common::UploadBatch::Copy(ID3D12Resource* dst, uint64_t dstOffset, uint64_t size, D3D12_RESOURCE_STATES finalState)
+{
+    assert(dst != nullptr && size > 0);
+    UploadRing::Allocation staging = Stage(size);
+    Use(dst, D3D12_RESOURCE_STATE_COPY_DEST, finalState);
+    //the ring is an upload heap, always in D3D12_RESOURCE_STATE_GENERIC_READ
+    mCommandList->CopyBufferRegion(dst, dstOffset, staging.buffer, staging.offset, size);
+    return staging.cpuAddress;
+}
+
+void common::UploadBatch::Copy(ID3D12Resource* dst, uint64_t dstOffset, const void* data, uint64_t size,
+    D3D12_RESOURCE_STATES finalState)
+{
+    memcpy(Copy(dst, dstOffset, size, finalState), data, size);
+}
+
+void common::UploadBatch::CopyBuffer(ID3D12Resource* dst, uint64_t dstOffset, ID3D12Resource* src, uint64_t srcOffset,
+    uint64_t size, D3D12_RESOURCE_STATES dstFinalState)
+{
+    assert(dst != nullptr && src != nullptr && dst != src);
+    //the source goes back to where it was when the batch ends
+    const D3D12_RESOURCE_STATES srcFinalState = Acquire(src);
+    Use(src, D3D12_RESOURCE_STATE_COPY_SOURCE, srcFinalState);
+    Use(dst, D3D12_RESOURCE_STATE_COPY_DEST, dstFinalState);
+    mCommandList->CopyBufferRegion(dst, dstOffset, src, srcOffset, size);
+}
+
+void common::UploadBatch::KeepAlive(ComPtr<ID3D12Resource> resource)
+{
+    mKeptAlive.push_back({ mFenceValue + 1, resource });
+}
+
+ID3D12GraphicsCommandList* common::UploadBatch::CommandList()
+{
+    Begin();
+    return mCommandList.Get();
+}
+
+uint64_t common::UploadBatch::Submit()
+{
+    if (!mRecording)
+        return mFenceValue;
+    std::vector<CD3DX12_RESOURCE_BARRIER> barriers;
+    std::vector<QueueHandoff<ID3D12Resource*, D3D12_RESOURCE_STATES>::Transition> handoff;
+    for (const auto& [resource, state] : mStates)
+    {
+        if (mType == D3D12_COMMAND_LIST_TYPE_COPY)
+        {
+            //everything decays to COMMON after a copy queue, the direct queue takes it from there
+            if (state.final != D3D12_RESOURCE_STATE_COMMON)
+                handoff.push_back({ resource, state.final });
+        }
+        else if (state.current != state.final)
+            barriers.push_back(CD3DX12_RESOURCE_BARRIER::Transition(resource, state.current, state.final));
+    }
+    if (!barriers.empty())
+        mCommandList->ResourceBarrier(static_cast<UINT>(barriers.size()), barriers.data());
+    mStates.clear();
+    HRESULT hr = mCommandList->Close();
+    assert(SUCCEEDED(hr));
+    if (mType == D3D12_COMMAND_LIST_TYPE_COPY)
+        SubmitReleases();
+    ID3D12CommandList* lists[] = { mCommandList.Get() };
+    mCommandQueue->ExecuteCommandLists(1, lists);
+    mFenceValue++;
+    mCommandQueue->Signal(mFence.Get(), mFenceValue);
+    if (mType == D3D12_COMMAND_LIST_TYPE_COPY)
+        mHandoff.Submitted(mFenceValue, handoff);
+    //the staging memory is free again after the copies
+    mUploadRing->Submit(mCommandQueue.Get());
+    mReserved = {};
+    mSubmittedAllocators.push_back({ mFenceValue, mCommandAllocator });
+    mCommandAllocator = nullptr;
+    mRecording = false;
+    mSubmitCount++;
+    return mFenceValue;
+}
+
+void common::UploadBatch::RecordPendingTransitions(ID3D12GraphicsCommandList* commandList)
+{
+    std::vector<CD3DX12_RESOURCE_BARRIER> barriers;
+    for (const auto& transition : mHandoff.TakeTransitions())
+        barriers.push_back(CD3DX12_RESOURCE_BARRIER::Transition(transition.resource,
+            D3D12_RESOURCE_STATE_COMMON, transition.state));
+    if (!barriers.empty())
+        commandList->ResourceBarrier(static_cast<UINT>(barriers.size()), barriers.data());
+}
+
+void common::UploadBatch::QueueWait(ID3D12CommandQueue* queue)
+{
+    const uint64_t fenceValue = mHandoff.TakeWait();
+    if (fenceValue > 0)
+        queue->Wait(mFence.Get(), fenceValue);
+}
+
+void common::UploadBatch::SubmitReleases()
+{
+    std::vector<CD3DX12_RESOURCE_BARRIER> barriers;
+    for (const auto& release : mHandoff.TakeReleases())
+        barriers.push_back(CD3DX12_RESOURCE_BARRIER::Transition(release.resource,
+            release.state, D3D12_RESOURCE_STATE_COMMON));
+    if (!barriers.empty())
+    {
+        //a list of its own, the frame's lists aren't open when the batch is submitted
+        ComPtr<ID3D12CommandAllocator> allocator;
+        if (!mReleaseAllocators.empty() && mReleaseFence->GetCompletedValue() >= mReleaseAllocators.front().first)
+        {
+            allocator = mReleaseAllocators.front().second;
+            mReleaseAllocators.pop_front();
+            HRESULT hr = allocator->Reset();
+            assert(SUCCEEDED(hr));
+        }
+        else
+        {
+            HRESULT hr = mDevice->CreateCommandAllocator(D3D12_COMMAND_LIST_TYPE_DIRECT, IID_PPV_ARGS(&allocator));
+            if (FAILED(hr))
+                throw std::runtime_error("could not create the upload batch release allocator");
+        }
+        if (mReleaseList == nullptr)
+        {
+            HRESULT hr = mDevice->CreateCommandList(0, D3D12_COMMAND_LIST_TYPE_DIRECT, allocator.Get(),
+                nullptr, IID_PPV_ARGS(&mReleaseList));
+            if (FAILED(hr))
+                throw std::runtime_error("could not create the upload batch release list");
+            mReleaseList->SetName(L"UploadBatch releases");
+        }
+        else
+        {
+            HRESULT hr = mReleaseList->Reset(allocator.Get(), nullptr);
+            assert(SUCCEEDED(hr));
+        }
+        mReleaseList->ResourceBarrier(static_cast<UINT>(barriers.size()), barriers.data());
+        HRESULT hr = mReleaseList->Close();
+        assert(SUCCEEDED(hr));
+        ID3D12CommandList* lists[] = { mReleaseList.Get() };
+        mConsumerQueue->ExecuteCommandLists(1, lists);
+        //after every list that used them before, the direct queue runs in order
+        mReleaseFenceValue++;
+        mConsumerQueue->Signal(mReleaseFence.Get(), mReleaseFenceValue);
+        mHandoff.ReleasesSubmitted(mReleaseFenceValue);
+        mReleaseAllocators.push_back({ mReleaseFenceValue, allocator });
+    }
+    const uint64_t fenceValue = mHandoff.TakeReleaseWait();
+    if (fenceValue > 0)
+        mCommandQueue->Wait(mReleaseFence.Get(), fenceValue);
+}
+
+void common::UploadBatch::Forget(ID3D12Resource* resource)
+{
+    mHandoff.Forget(resource);
+    mStates.erase(resource);
+}
@@ -0,0 +1,160 @@
+#pragma once
+#include "pch.h"
+#include "upload_ring.h"
+#include "queue_handoff.h"
+#include <deque>
+#include <unordered_map>
+namespace common
+{
+	/// <summary>
+	/// Records many copies and transitions in one command list and submits them together, without
+	/// waiting: Submit returns a fence value to wait for, if the cpu needs to. Work submitted later on
+	/// the same queue runs after it, so the frames don't have to wait at all.
+	/// The resources are assumed to be in D3D12_RESOURCE_STATE_COMMON when a batch first uses them:
+	/// buffers decay to it after each submit and textures are in it when created. Each one goes to
+	/// the final state given by the last call that used it when the batch is submitted.
+	/// On a copy queue the copies run while the direct queue renders. The copy queue can only leave
+	/// the resources in COMMON, so the direct queue does the rest: RecordPendingTransitions in its
+	/// command list and QueueWait before executing it. From then on the direct queue holds them in
+	/// their states; a batch that uses one of them again first executes a list on the direct queue
+	/// that puts it back in COMMON, and the copy queue waits on the gpu for it before the copies.
+	/// Not thread safe. Submit it outside of the frame recording: it also closes what the frame took
+	/// from the upload ring, and the lists recorded before it must not use what it gives back to the
+	/// copy queue.
+	/// </summary>
+	class UploadBatch
+	{
+	public:
+		/// <summary>
+		/// consumerQueue is the direct queue that uses the uploads, needed when commandQueue is a copy queue.
+		/// </summary>
+		UploadBatch(Microsoft::WRL::ComPtr<ID3D12Device> device,
+			Microsoft::WRL::ComPtr<ID3D12CommandQueue> commandQueue,
+			std::shared_ptr<UploadRing> uploadRing,
+			Microsoft::WRL::ComPtr<ID3D12CommandQueue> consumerQueue = nullptr);
+		/// <summary>
+		/// Submits what's left and waits for the gpu.
+		/// </summary>
+		~UploadBatch();
+		UploadBatch(const UploadBatch&) = delete;
+		UploadBatch& operator=(const UploadBatch&) = delete;
+		/// <summary>
+		/// Takes the staging memory of the next copies in one piece, size bytes in all with each copy
+		/// rounded up to UploadRing::DEFAULT_ALIGNMENT, so that they all fit once the first one is
+		/// staged. If only the batch's own staging memory is in the way, the batch is submitted first:
+		/// call it before a run of Copy whose memory is written after the last one, with everything
+		/// staged before alredy written. Copy never submits on its own.
+		/// </summary>
+		void Reserve(uint64_t size);
+		/// <summary>
+		/// Copies size bytes to dst at dstOffset. Returns the staging memory, write to it before Submit.
+		/// </summary>
+		void* Copy(ID3D12Resource* dst, uint64_t dstOffset, uint64_t size, D3D12_RESOURCE_STATES finalState);
+		void Copy(ID3D12Resource* dst, uint64_t dstOffset, const void* data, uint64_t size, D3D12_RESOURCE_STATES finalState);
+		/// <summary>
+		/// Gpu to gpu, between two different resources. src ends in the state it had in the batch.
+		/// </summary>
+		void CopyBuffer(ID3D12Resource* dst, uint64_t dstOffset, ID3D12Resource* src, uint64_t srcOffset, uint64_t size,
+			D3D12_RESOURCE_STATES dstFinalState);
+		/// <summary>
+		/// Leaves the resource in state when the batch is submitted.
+		/// </summary>
+		void Transition(ID3D12Resource* resource, D3D12_RESOURCE_STATES state);
+		/// <summary>
+		/// Keeps a resource alive until the gpu is done with this batch, for buffers that are replaced
+		/// after being copied from.
+		/// </summary>
+		void KeepAlive(Microsoft::WRL::ComPtr<ID3D12Resource> resource);
+		/// <summary>
+		/// The open command list, for what the other functions don't cover. Use Transition for the
+		/// resources that the batch also copies to.
+		/// </summary>
+		ID3D12GraphicsCommandList* CommandList();
+		bool IsEmpty()const { return !mRecording; }
+		/// <summary>
+		/// Executes what was recorded. Returns the fence value that says it's done, or the last one
+		/// if there was nothing to submit.
+		/// </summary>
+		uint64_t Submit();
+		bool IsComplete(uint64_t fenceValue)const;
+		void Wait(uint64_t fenceValue);
+		/// <summary>
+		/// Submit and wait, for the loads that need the data before going on.
+		/// </summary>
+		void Flush() { Wait(Submit()); }
+		/// <summary>
+		/// How many times Submit executed a command list.
+		/// </summary>
+		size_t SubmitCount()const { return mSubmitCount; }
+		const std::shared_ptr<UploadRing>& Ring()const { return mUploadRing; }
+		/// <summary>
+		/// Transitions from COMMON to the final states of what a copy queue submitted since the last
+		/// call. Record them at the beginning of the direct queue's command list. Nothing to do on a
+		/// direct queue.
+		/// </summary>
+		void RecordPendingTransitions(ID3D12GraphicsCommandList* commandList);
+		/// <summary>
+		/// Makes queue wait on the gpu for what a copy queue submitted, call it before executing the
+		/// lists that use the uploads. The cpu doesn't wait.
+		/// </summary>
+		void QueueWait(ID3D12CommandQueue* queue);
+		/// <summary>
+		/// Stops tracking a resource that goes away, so that another one at the same address doesn't
+		/// get its transitions. Only needed for the ones a copy queue wrote. The copies alredy
+		/// recorded for it are still submitted.
+		/// </summary>
+		void Forget(ID3D12Resource* resource);
+		D3D12_COMMAND_LIST_TYPE Type()const { return mType; }
+	private:
+		void Begin();
+		void Retire();
+		/// <summary>
+		/// Moves the resource to state inside the command list.
+		/// </summary>
+		void Use(ID3D12Resource* resource, D3D12_RESOURCE_STATES state, D3D12_RESOURCE_STATES finalState);
+		/// <summary>
+		/// The state the resource goes back to when the batch ends, if nothing else is asked. On a copy
+		/// queue it takes the resource back from the direct queue the first time the batch uses it.
+		/// </summary>
+		D3D12_RESOURCE_STATES Acquire(ID3D12Resource* resource);
+		/// <summary>
+		/// Executes the transitions to COMMON of what was taken back on the direct queue and makes the
+		/// copy queue wait for them.
+		/// </summary>
+		void SubmitReleases();
+		/// <summary>
+		/// The staging memory of a copy, from what Reserve took while it lasts.
+		/// </summary>
+		UploadRing::Allocation Stage(uint64_t size);
+		struct TrackedState
+		{
+			D3D12_RESOURCE_STATES current;
+			D3D12_RESOURCE_STATES final;
+		};
+		Microsoft::WRL::ComPtr<ID3D12Device> mDevice;
+		Microsoft::WRL::ComPtr<ID3D12CommandQueue> mCommandQueue;
+		D3D12_COMMAND_LIST_TYPE mType;
+		std::shared_ptr<UploadRing> mUploadRing;
+		Microsoft::WRL::ComPtr<ID3D12GraphicsCommandList> mCommandList;
+		Microsoft::WRL::ComPtr<ID3D12CommandAllocator> mCommandAllocator;
+		//allocators of the submitted batches, reused when their fence value is reached
+		std::deque<std::pair<uint64_t, Microsoft::WRL::ComPtr<ID3D12CommandAllocator>>> mSubmittedAllocators;
+		std::deque<std::pair<uint64_t, Microsoft::WRL::ComPtr<ID3D12Resource>>> mKeptAlive;
+		std::unordered_map<ID3D12Resource*, TrackedState> mStates;
+		//what the direct queue owes to the copies and the other way around, only used on a copy queue
+		QueueHandoff<ID3D12Resource*, D3D12_RESOURCE_STATES> mHandoff;
+		Microsoft::WRL::ComPtr<ID3D12CommandQueue> mConsumerQueue;
+		Microsoft::WRL::ComPtr<ID3D12GraphicsCommandList> mReleaseList;
+		std::deque<std::pair<uint64_t, Microsoft::WRL::ComPtr<ID3D12CommandAllocator>>> mReleaseAllocators;
+		Microsoft::WRL::ComPtr<ID3D12Fence> mReleaseFence;
+		uint64_t mReleaseFenceValue = 0;
+		Microsoft::WRL::ComPtr<ID3D12Fence> mFence;
+		uint64_t mFenceValue = 0;
+		HANDLE mFenceEvent = nullptr;
+		bool mRecording = false;
+		size_t mSubmitCount = 0;
+		//what Reserve took and how much of it the copies used, it goes with the batch
+		UploadRing::Allocation mReserved = {};
+		uint64_t mReservedUsed = 0;
+	};
+}
@@ -0,0 +1,111 @@
+#include "pch.h"
+#include "upload_ring.h"
+using Microsoft::WRL::ComPtr;
+
+namespace
+{
+    ComPtr<ID3D12Resource> CreateUploadBuffer(ID3D12Device* device, uint64_t size, const wchar_t* name)
+    {
+        ComPtr<ID3D12Resource> buffer;
+        CD3DX12_HEAP_PROPERTIES heapProperties(D3D12_HEAP_TYPE_UPLOAD);
+        CD3DX12_RESOURCE_DESC desc = CD3DX12_RESOURCE_DESC::Buffer(size);
+        HRESULT hr = device->CreateCommittedResource(&heapProperties, D3D12_HEAP_FLAG_NONE, &desc,
+            D3D12_RESOURCE_STATE_GENERIC_READ, nullptr, IID_PPV_ARGS(&buffer));
+        if (FAILED(hr))
+            throw std::runtime_error("could not create the upload buffer");
+        buffer->SetName(name);
+        return buffer;
+    }
+}
+
+common::UploadRing::UploadRing(ComPtr<ID3D12Device> device, uint64_t capacity, const std::wstring& name)
+    :mDevice(device), mAllocator(capacity)
+{
+    mBuffer = CreateUploadBuffer(mDevice.Get(), capacity, name.c_str());
+    //upload heaps can stay mapped, we never read from it
+    CD3DX12_RANGE readRange(0, 0);
+    HRESULT hr = mBuffer->Map(0, &readRange, reinterpret_cast<void**>(&mMapped));
+    assert(SUCCEEDED(hr));
+    mFenceEvent = CreateEventW(nullptr, FALSE, FALSE, nullptr);
+    assert(mFenceEvent != nullptr);
+}
+
+common::UploadRing::~UploadRing()
+{
+    WaitForSubmission(mSubmissionIndex);
+    CloseHandle(mFenceEvent);
+}
+
+void common::UploadRing::WaitForSubmission(uint64_t index)
+{
+    //each queue has its own fence, so wait for every submit up to index, not only the last one
+    for (const Submission& submission : mSubmissions)
+    {
+        if (submission.index > index)
+            break;
+        if (submission.fence->GetCompletedValue() >= submission.fenceValue)
+            continue;
+        submission.fence->SetEventOnCompletion(submission.fenceValue, mFenceEvent);
+        WaitForSingleObject(mFenceEvent, INFINITE);
+    }
+}
+
+void common::UploadRing::Retire()
+{
+    //in submit order: a later submit on a faster queue waits for the older ones
+    while (!mSubmissions.empty() &&
+        mSubmissions.front().fence->GetCompletedValue() >= mSubmissions.front().fenceValue)
+    {
+        mRetiredIndex = mSubmissions.front().index;
+        mSubmissions.pop_front();
+    }
+    mAllocator.Retire(mRetiredIndex);
+    while (!mDedicated.empty() && mDedicated.front().first <= mRetiredIndex)
+        mDedicated.pop_front();
+}
+
+common::UploadRing::Allocation common::UploadRing::Allocate(uint64_t size, uint64_t alignment)
+{
+    Retire();
+    uint64_t offset = mAllocator.Allocate(size, alignment);
+    //full, wait for the gpu to give back the oldest uploads
+    while (offset == RingAllocator::INVALID_OFFSET && mAllocator.PendingBatchCount() > 0)
+    {
+        WaitForSubmission(mAllocator.OldestPendingFence());
+        Retire();
+        offset = mAllocator.Allocate(size, alignment);
+    }
+    if (offset == RingAllocator::INVALID_OFFSET)
+        return AllocateDedicated(size);
+    return { mBuffer.Get(), offset, mMapped + offset, mBuffer->GetGPUVirtualAddress() + offset, size };
+}
+
+common::UploadRing::Allocation common::UploadRing::AllocateDedicated(uint64_t size)
+{
+    ComPtr<ID3D12Resource> buffer = CreateUploadBuffer(mDevice.Get(), size, L"UploadRing dedicated");
+    void* mapped = nullptr;
+    CD3DX12_RANGE readRange(0, 0);
+    HRESULT hr = buffer->Map(0, &readRange, &mapped);
+    assert(SUCCEEDED(hr));
+    //released with the allocations of the next Submit
+    mDedicated.push_back({ mSubmissionIndex + 1, buffer });
+    mDedicatedCount++;
+    return { buffer.Get(), 0, mapped, buffer->GetGPUVirtualAddress(), size };
+}
+
+void common::UploadRing::Submit(ID3D12CommandQueue* queue)
+{
+    assert(queue != nullptr);
+    QueueFence& queueFence = mFences[queue];
+    if (queueFence.fence == nullptr)
+    {
+        HRESULT hr = mDevice->CreateFence(0, D3D12_FENCE_FLAG_NONE, IID_PPV_ARGS(&queueFence.fence));
+        if (FAILED(hr))
+            throw std::runtime_error("could not create the upload ring fence");
+    }
+    queueFence.value++;
+    queue->Signal(queueFence.fence.Get(), queueFence.value);
+    mSubmissionIndex++;
+    mSubmissions.push_back({ mSubmissionIndex, queueFence.fence.Get(), queueFence.value });
+    mAllocator.FinishBatch(mSubmissionIndex);
+}
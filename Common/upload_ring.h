@@ -0,0 +1,95 @@
+#pragma once
+#include "pch.h"
+#include "ring_allocator.h"
+#include <unordered_map>
+namespace common
+{
+	/// <summary>
+	/// One upload heap, mapped for its whole life, that all the cpu->gpu copies take their staging
+	/// memory from. Allocate, write to cpuAddress, record the copy from buffer/offset, execute it and
+	/// then Submit on the same queue: the memory is reused when the gpu passes that point.
+	/// It can be shared by queues that run at the same time, each one gets a fence of its own.
+	/// Not thread safe, use it from the thread that records the copies.
+	/// </summary>
+	class UploadRing
+	{
+	public:
+		/// <summary>
+		/// Staging memory for one upload.
+		/// </summary>
+		struct Allocation
+		{
+			ID3D12Resource* buffer;
+			uint64_t offset;
+			void* cpuAddress;
+			D3D12_GPU_VIRTUAL_ADDRESS gpuAddress;
+			uint64_t size;
+		};
+		static constexpr uint64_t DEFAULT_ALIGNMENT = 16;
+		UploadRing(Microsoft::WRL::ComPtr<ID3D12Device> device, uint64_t capacity = 32 << 20,
+			const std::wstring& name = L"UploadRing");
+		/// <summary>
+		/// Waits for the gpu to be done with everything that was submitted.
+		/// </summary>
+		~UploadRing();
+		UploadRing(const UploadRing&) = delete;
+		UploadRing& operator=(const UploadRing&) = delete;
+		/// <summary>
+		/// If the ring is full it waits for the oldest submitted uploads. Uploads bigger than the
+		/// ring, or that don't fit with what was allocated since the last Submit, get an upload
+		/// buffer of their own that lives until the next Submit is done.
+		/// </summary>
+		Allocation Allocate(uint64_t size, uint64_t alignment = DEFAULT_ALIGNMENT);
+		/// <summary>
+		/// Signals the queue after the commands that read what was allocated since the last Submit.
+		/// The memory is free again when that submit and all the ones before it are done.
+		/// </summary>
+		void Submit(ID3D12CommandQueue* queue);
+		/// <summary>
+		/// Gives back the memory of the submits that the gpu finished. Allocate calls it.
+		/// </summary>
+		void Retire();
+		const RingAllocator& Allocator()const { return mAllocator; }
+		/// <summary>
+		/// How many uploads needed a buffer of their own, if it grows the ring is too small.
+		/// </summary>
+		size_t DedicatedCount()const { return mDedicatedCount; }
+	private:
+		/// <summary>
+		/// The fence of a queue and the last value it was signaled with.
+		/// </summary>
+		struct QueueFence
+		{
+			Microsoft::WRL::ComPtr<ID3D12Fence> fence;
+			uint64_t value = 0;
+		};
+		/// <summary>
+		/// A Submit: the ring allocator only sees the index, that grows even with many queues.
+		/// </summary>
+		struct Submission
+		{
+			uint64_t index;
+			ID3D12Fence* fence;
+			uint64_t fenceValue;
+		};
+		/// <summary>
+		/// Waits until the submits up to index are done.
+		/// </summary>
+		void WaitForSubmission(uint64_t index);
+		Allocation AllocateDedicated(uint64_t size);
+		Microsoft::WRL::ComPtr<ID3D12Device> mDevice;
+		Microsoft::WRL::ComPtr<ID3D12Resource> mBuffer;
+		uint8_t* mMapped = nullptr;
+		RingAllocator mAllocator;
+		std::unordered_map<ID3D12CommandQueue*, QueueFence> mFences;
+		//the submits the gpu may not have finished, in order
+		std::deque<Submission> mSubmissions;
+		uint64_t mSubmissionIndex = 0;
+		//submits up to this one are done
+		uint64_t mRetiredIndex = 0;
+		HANDLE mFenceEvent = nullptr;
+		//the buffers of the oversized uploads and the submit index that releases them
+		std::deque<std::pair<uint64_t, Microsoft::WRL::ComPtr<ID3D12Resource>>> mDedicated;
+		size_t mDedicatedCount = 0;
+	};
+}
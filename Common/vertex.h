@@ -1,5 +1,6 @@
 #pragma once
-#include "pch.h"
+#include <cstdint>
+#include <DirectXMath.h>
 namespace common //TODO refactor: change namespace to commons
 {
 	/// <summary>
@@ -13,4 +14,15 @@ namespace common //TODO refactor: change namespace to commons
 		DirectX::XMFLOAT3 normal;
 		DirectX::XMFLOAT2 uv;
 	};
-}
\ No newline at end of file
+	/// <summary>
+	/// Compressed vertex, 16 bytes instead of 32. Positions are 16 bit unorms relative to the
+	/// bounds of the mesh, normals are octahedral encoded in 2 snorms and uvs are half floats.
+	/// See vertex_packing.h.
+	/// </summary>
+	struct PackedVertex {
+		uint16_t pos[4]; //w is padding, the input layout reads the 4 components
+		int16_t normal[2];
+		uint16_t uv[2];
+	};
+	static_assert(sizeof(PackedVertex) == 16, "PackedVertex must match input_layout_service::PackedInstanceIdTransform");
+}
@@ -0,0 +1,139 @@
+#include "pch.h"
+#include "vertex_packing.h"
+#include <DirectXPackedVector.h>
+#include <algorithm>
+#include <cmath>
+using namespace DirectX;
+
+namespace
+{
+    float SignNotZero(float v)
+    {
+        return v >= 0.0f ? 1.0f : -1.0f;
+    }
+    int16_t ToSnorm16(float v)
+    {
+        return static_cast<int16_t>(std::round(std::clamp(v, -1.0f, 1.0f) * 32767.0f));
+    }
+    float FromSnorm16(int16_t v)
+    {
+        //-32768 and -32767 are both -1
+        return (std::max)(v / 32767.0f, -1.0f);
+    }
+    uint16_t ToUnorm16(float v)
+    {
+        return static_cast<uint16_t>(std::round(std::clamp(v, 0.0f, 1.0f) * 65535.0f));
+    }
+    float FromUnorm16(uint16_t v)
+    {
+        return v / 65535.0f;
+    }
+    uint16_t Quantize(float v, float min, float extent)
+    {
+        //flat meshes have 0 extent in some axis
+        return extent > 0.0f ? ToUnorm16((v - min) / extent) : 0;
+    }
+}
+
+XMFLOAT2 common::OctEncode(const XMFLOAT3& normal)
+{
+    const float l1 = fabsf(normal.x) + fabsf(normal.y) + fabsf(normal.z);
+    if (l1 == 0.0f)
+        return { 0.0f, 0.0f };
+    float x = normal.x / l1;
+    float y = normal.y / l1;
+    if (normal.z < 0.0f)
+    {
+        const float foldedX = (1.0f - fabsf(y)) * SignNotZero(x);
+        const float foldedY = (1.0f - fabsf(x)) * SignNotZero(y);
+        x = foldedX;
+        y = foldedY;
+    }
+    return { x, y };
+}
+
+XMFLOAT3 common::OctDecode(const XMFLOAT2& encoded)
+{
+    //same as OctDecode in instanced_transform_packed_vertex_shader.hlsl
+    XMFLOAT3 n(encoded.x, encoded.y, 1.0f - fabsf(encoded.x) - fabsf(encoded.y));
+    const float t = (std::max)(-n.z, 0.0f);
+    n.x += n.x >= 0.0f ? -t : t;
+    n.y += n.y >= 0.0f ? -t : t;
+    XMStoreFloat3(&n, XMVector3Normalize(XMLoadFloat3(&n)));
+    return n;
+}
+
+common::QuantizationBounds common::ComputeQuantizationBounds(const Vertex* vertices, size_t count)
+{
+    QuantizationBounds bounds;
+    if (count == 0)
+        return bounds;
+    XMVECTOR min = XMLoadFloat3(&vertices[0].pos);
+    XMVECTOR max = min;
+    for (size_t i = 1; i < count; i++)
+    {
+        XMVECTOR p = XMLoadFloat3(&vertices[i].pos);
+        min = XMVectorMin(min, p);
+        max = XMVectorMax(max, p);
+    }
+    XMStoreFloat4(&bounds.min, min);
+    XMStoreFloat4(&bounds.extent, max - min);
+    bounds.min.w = 0;
+    bounds.extent.w = 0;
+    return bounds;
+}
+
+common::PackedVertex common::PackVertex(const Vertex& vertex, const QuantizationBounds& bounds)
+{
+    PackedVertex packed;
+    packed.pos[0] = Quantize(vertex.pos.x, bounds.min.x, bounds.extent.x);
+    packed.pos[1] = Quantize(vertex.pos.y, bounds.min.y, bounds.extent.y);
+    packed.pos[2] = Quantize(vertex.pos.z, bounds.min.z, bounds.extent.z);
+    packed.pos[3] = 0;
+    const XMFLOAT2 octahedral = OctEncode(vertex.normal);
+    packed.normal[0] = ToSnorm16(octahedral.x);
+    packed.normal[1] = ToSnorm16(octahedral.y);
+    packed.uv[0] = PackedVector::XMConvertFloatToHalf(vertex.uv.x);
+    packed.uv[1] = PackedVector::XMConvertFloatToHalf(vertex.uv.y);
+    return packed;
+}
+
+common::Vertex common::UnpackVertex(const PackedVertex& vertex, const QuantizationBounds& bounds)
+{
+    Vertex unpacked;
+    unpacked.pos.x = bounds.min.x + FromUnorm16(vertex.pos[0]) * bounds.extent.x;
+    unpacked.pos.y = bounds.min.y + FromUnorm16(vertex.pos[1]) * bounds.extent.y;
+    unpacked.pos.z = bounds.min.z + FromUnorm16(vertex.pos[2]) * bounds.extent.z;
+    unpacked.normal = OctDecode({ FromSnorm16(vertex.normal[0]), FromSnorm16(vertex.normal[1]) });
+    unpacked.uv.x = PackedVector::XMConvertHalfToFloat(vertex.uv[0]);
+    unpacked.uv.y = PackedVector::XMConvertHalfToFloat(vertex.uv[1]);
+    return unpacked;
+}
+
+common::QuantizationBounds common::PackVertices(const Vertex* vertices, size_t count, PackedVertex* dst)
+{
+    QuantizationBounds bounds = ComputeQuantizationBounds(vertices, count);
+    for (size_t i = 0; i < count; i++)
+        dst[i] = PackVertex(vertices[i], bounds);
+    return bounds;
+}
+
+common::VertexPackingError common::MeasurePackingError(const Vertex* vertices, size_t count)
+{
+    VertexPackingError error;
+    std::vector<PackedVertex> packed(count);
+    QuantizationBounds bounds = PackVertices(vertices, count, packed.data());
+    for (size_t i = 0; i < count; i++)
+    {
+        const Vertex& original = vertices[i];
+        const Vertex decoded = UnpackVertex(packed[i], bounds);
+        XMVECTOR positionDelta = XMLoadFloat3(&original.pos) - XMLoadFloat3(&decoded.pos);
+        error.position = (std::max)(error.position, XMVectorGetX(XMVector3Length(positionDelta)));
+        //the imported normals are not always unit length
+        XMVECTOR n = XMVector3Normalize(XMLoadFloat3(&original.normal));
+        const float cosAngle = std::clamp(XMVectorGetX(XMVector3Dot(n, XMLoadFloat3(&decoded.normal))), -1.0f, 1.0f);
+        error.normalDegrees = (std::max)(error.normalDegrees, XMConvertToDegrees(acosf(cosAngle)));
+        error.uv = (std::max)(error.uv, (std::max)(fabsf(original.uv.x - decoded.uv.x), fabsf(original.uv.y - decoded.uv.y)));
+    }
+    return error;
+}
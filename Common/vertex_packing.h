@@ -0,0 +1,45 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include <DirectXMath.h>
+#include "vertex.h"
+namespace common
+{
+	/// <summary>
+	/// Bounding box used to quantize the positions of a mesh. Has 4 components to match
+	/// the layout of the root constants that the packed vertex shader reads.
+	/// position = min + unorm * extent
+	/// </summary>
+	struct QuantizationBounds
+	{
+		DirectX::XMFLOAT4 min = { 0, 0, 0, 0 };
+		DirectX::XMFLOAT4 extent = { 0, 0, 0, 0 };
+	};
+	/// <summary>
+	/// Biggest difference between the original vertices and the packed-then-unpacked ones.
+	/// </summary>
+	struct VertexPackingError
+	{
+		float position = 0;
+		//angle between the original and decoded normals
+		float normalDegrees = 0;
+		float uv = 0;
+	};
+	/// <summary>
+	/// Maps a unit vector to the [-1,1] square, folding the lower hemisphere over the upper one.
+	/// </summary>
+	DirectX::XMFLOAT2 OctEncode(const DirectX::XMFLOAT3& normal);
+	DirectX::XMFLOAT3 OctDecode(const DirectX::XMFLOAT2& encoded);
+
+	QuantizationBounds ComputeQuantizationBounds(const Vertex* vertices, size_t count);
+	PackedVertex PackVertex(const Vertex& vertex, const QuantizationBounds& bounds);
+	Vertex UnpackVertex(const PackedVertex& vertex, const QuantizationBounds& bounds);
+	/// <summary>
+	/// Packs count vertices into dst, returns the bounds needed to decode them.
+	/// </summary>
+	QuantizationBounds PackVertices(const Vertex* vertices, size_t count, PackedVertex* dst);
+	/// <summary>
+	/// Packs and unpacks the vertices to measure how much precision we lose.
+	/// </summary>
+	VertexPackingError MeasurePackingError(const Vertex* vertices, size_t count);
+}
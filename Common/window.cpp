@@ -5,6 +5,12 @@ common::Window* _window = nullptr;
 
 LRESULT CALLBACK __WindowProc(HWND hwnd, UINT uMsg, WPARAM wParam, LPARAM lParam) {
 	assert(_window);
+	if (_window->mOnInput.has_value() &&
+		((uMsg >= WM_KEYFIRST && uMsg <= WM_KEYLAST) || (uMsg >= WM_MOUSEFIRST && uMsg <= WM_MOUSELAST)))
+	{
+		auto fn = _window->mOnInput;
+		(*fn)();
+	}
 	switch (uMsg)
 	{	
 		case WM_CREATE:
@@ -126,6 +132,16 @@ namespace common
 	{
 		MSG msg;
 		ZeroMemory(&msg, sizeof(MSG));
+		//without an idle handler there's nothing to do between messages, so it sleeps until one comes
+		if (!mOnIdle)
+		{
+			while (GetMessage(&msg, NULL, 0, 0) > 0)
+			{
+				TranslateMessage(&msg);
+				DispatchMessage(&msg);
+			}
+			return;
+		}
 		while (true)
 		{
 			if (PeekMessage(&msg, NULL, 0, 0, PM_REMOVE))
@@ -27,6 +27,10 @@ namespace common
 		std::optional<std::function<void()>> mOnIdle;
 		std::optional<std::function<void(int w, int h)>> mOnResize;
 		std::optional<std::function<void()>> mOnCreate;
+		/// <summary>
+		/// Called for each keyboard and mouse message, before it's handled.
+		/// </summary>
+		std::optional<std::function<void()>> mOnInput;
 		friend LRESULT CALLBACK __WindowProc(HWND hwnd, UINT uMsg, WPARAM wParam, LPARAM lParam);
 	private:
 		HWND mHWND;
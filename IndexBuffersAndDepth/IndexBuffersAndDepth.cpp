@@ -1,7 +1,6 @@
 #include "pch.h"
 #include "../Common/window.h"
 #include "../Common/mesh.h"
-#include "../Common/mesh_load.h"
 #include "direct3d_context.h"
 #include "Pipeline.h"
 #include "view_projection.h"
@@ -33,9 +32,7 @@ int main()
 		L"HelloWorldPipeline"
 	);
 	//load data from the file
-	auto sphereMeshData = common::LoadMeshes("assets/monkey.glb")[0];
-	std::shared_ptr<common::Mesh> mesh = std::make_shared<common::Mesh>(sphereMeshData,
-		ctx->GetDevice(), ctx->GetCommandQueue());
+	std::shared_ptr<common::Mesh> mesh = common::io::ImportMesh(ctx->GetDevice(), ctx->GetCommandQueue(), "monkey.glb")[0];
 	// Fill out the Viewport
 	myPipeline->viewport.TopLeftX = 0;
 	myPipeline->viewport.TopLeftY = 0;
@@ -10,40 +10,136 @@
 #include "transforms_pipeline.h"
 #include "camera.h"
 #include "../Common/mesh.h"
+#include "../Common/mesh_cache.h"
+#include "../Common/mesh_async_load.h"
+#include "../Common/culling.h"
 #include "model_matrix.h"
 #include "presentation_pipeline.h"
 #include "../Common/game_timer.h"
+#include "../Common/frame_pacer.h"
 #include "../Common/concatenate.h"
 #include "../Common/mathutils.h"
 #include "instanced_transform_pipeline.h"
-#include "instance_index.h"
+#include "render_snapshot.h"
+#include "../Common/snapshot_exchange.h"
+#include <thread>
 using Microsoft::WRL::ComPtr;
 
 constexpr int W = 1024;
 constexpr int H = 768;
 std::vector<std::shared_ptr<common::Mesh>> gMeshes;
+//all of gMeshes live in the same vertex and index buffers
+std::shared_ptr<common::GeometryPool> gGeometryPool;
+
+float DistanceTo(const DirectX::XMFLOAT3& a, const DirectX::XMFLOAT3& b)
+{
+	using namespace DirectX;
+	return XMVectorGetX(XMVector3Length(XMLoadFloat3(&a) - XMLoadFloat3(&b)));
+}
 
 entt::registry gRegistry;
 common::GameTimer gTimer;
-void LoadAssets(rtt::DxContext& context)
+/// <summary>
+/// The files are parsed in the pool while the window and the device are created, here we only
+/// wait for them and send them to the gpu.
+/// </summary>
+void LoadAssets(rtt::DxContext& context, std::vector<std::future<common::io::LoadedMeshFile>>& files)
 {
-	auto cube = common::io::LoadMesh(context.Device(),
-		context.CommandQueue(), "cube.glb");
-	auto monkey = common::io::LoadMesh(context.Device(),
-		context.CommandQueue(), "monkey.glb");
-	auto sphere = common::io::LoadMesh(context.Device(),
-		context.CommandQueue(), "sphere.glb");
+	std::vector<common::io::LoadedMeshFile> loaded;
+	for (auto& f : files)
+		loaded.push_back(f.get());
+	//as big as what was loaded, the pool grows if more meshes come later
+	const common::io::PoolCapacity capacity = common::io::PoolCapacityFor(loaded);
+	gGeometryPool = std::make_shared<common::GeometryPool>(context.Device(), context.UploadBatch(), meshVertexFormat,
+		capacity.vertices, capacity.indices16, capacity.indices32);
+	//the frames in flight can still draw a mesh that goes away
+	gGeometryPool->SetFrameFence(context.FrameFence(), [&context]() { return context.FrameFenceValue(); });
+	for (common::io::LoadedMeshFile& file : loaded)
+	{
+		for (auto x : common::io::UploadMeshes(file, context.Device(), context.CommandQueue(), meshVertexFormat, gGeometryPool))
+			gMeshes.push_back(x);
+	}
+}
 
-	for (auto x : cube)
-		gMeshes.push_back(x);
-	for (auto x : monkey)
-		gMeshes.push_back(x);
-	for (auto x : sphere)
-		gMeshes.push_back(x);
+/// <summary>
+/// One step of the simulation: moves the world by the timer's delta and writes in snapshot what
+/// the render needs, with the levels of detail alredy picked. Only the simulation thread touches
+/// the registry and the timer.
+/// </summary>
+void Simulate(const rtt::Camera& camera, rtt::RenderSnapshot& snapshot)
+{
+	gTimer.Tick();
+	auto gameUpdateView = gRegistry.view<
+		const rtt::entities::DeltaTransform,
+		rtt::entities::Transform>();
+	gameUpdateView.each([](
+		const rtt::entities::DeltaTransform deltaTransform, 
+		rtt::entities::Transform& transform
+		) {
+		using namespace DirectX;
+		//position
+		XMVECTOR pos = XMLoadFloat3(&transform.position);
+		XMVECTOR posVelocity = XMLoadFloat3(&deltaTransform.dPosition);
+		XMVECTOR dPos = XMVectorScale(posVelocity, gTimer.DeltaTime());
+		pos = XMVectorAdd(pos, dPos);
+		DirectX::XMStoreFloat3(&transform.position, pos);
+		//scale
+		XMVECTOR scale = XMLoadFloat3(&transform.scale);
+		XMVECTOR scaleVelocity = XMLoadFloat3(&deltaTransform.dScale);
+		XMVECTOR dScale = XMVectorScale(scaleVelocity, gTimer.DeltaTime());
+		scale = XMVectorAdd(scale, dScale);
+		DirectX::XMStoreFloat3(&transform.scale, scale);
+		//rotation
+		float rotationSpeed = XMConvertToRadians(deltaTransform.rotationSpeed); 
+		float scaledAngle = rotationSpeed * gTimer.DeltaTime();
+		XMVECTOR rotationVariation = XMQuaternionRotationAxis(deltaTransform.rotationAxis ,
+			scaledAngle);
+		XMVECTOR currentQuaternion = transform.rotation;
+		currentQuaternion = XMQuaternionMultiply(currentQuaternion, rotationVariation);
+		currentQuaternion = XMQuaternionNormalize(currentQuaternion);
+		transform.rotation = currentQuaternion;
+	});
+	snapshot.camera = camera;
+	//each cube picks its level of detail from how big its error is on the screen
+	const float projectionScale = camera.ProjectionScale(static_cast<float>(H));
+	const DirectX::XMFLOAT3 eye = camera.Position();
+	const std::vector<common::LodLevel>& cubeLods = gMeshes[0]->Lods();
+	snapshot.cubesPerLod.resize(cubeLods.size());
+	for (std::vector<rtt::entities::Transform>& cubes : snapshot.cubesPerLod)
+		cubes.clear();
+	auto cubeDrawDataView = gRegistry.view<const rtt::entities::Transform, const rtt::entities::Cube>();
+	cubeDrawDataView.each([&snapshot, &cubeLods, &eye, projectionScale](const rtt::entities::Transform t, const rtt::entities::Cube)
+	{
+		uint32_t lod = common::SelectLod(cubeLods, (std::max)({ t.scale.x, t.scale.y, t.scale.z }),
+			DistanceTo(eye, t.position), projectionScale);
+		snapshot.cubesPerLod[lod].push_back(t);
+	});
+	const std::vector<common::LodLevel>& monkeyLods = gMeshes[1]->Lods();
+	snapshot.monkeys.clear();
+	snapshot.monkeyLod = 0;
+	auto monkeyDrawDataView = gRegistry.view<const rtt::entities::Transform, const rtt::entities::Monkey>();
+	monkeyDrawDataView.each([&snapshot, &monkeyLods, &eye, projectionScale](const rtt::entities::Transform t, const rtt::entities::Monkey m) {
+		snapshot.monkeys.push_back(t);
+		snapshot.monkeyLod = common::SelectLod(monkeyLods, (std::max)({ t.scale.x, t.scale.y, t.scale.z }),
+			DistanceTo(eye, t.position), projectionScale);
+	});
 }
 
 int main()
 {
+	//before the loading starts, it cooks the same files
+	if (BENCHMARK_MESH_LOAD)
+	{
+		common::io::BenchmarkMeshLoad({ "assets/cube.glb", "assets/monkey.glb",
+			"assets/sphere.glb", "assets/plane.glb" });
+	}
+	//start parsing the assets right away, the window and the device don't need them
+	common::ThreadPool loadingPool;
+	std::vector<std::future<common::io::LoadedMeshFile>> assetFiles = common::io::LoadMeshesAsync(loadingPool,
+		{ "cube.glb", "monkey.glb", "sphere.glb" });
+	std::future<common::io::LoadedMeshFile> planeFile = loadingPool.Submit([]() {
+		return common::io::LoadMeshFile("plane.glb");
+	});
 	//////Create the window//////
 	HINSTANCE hInstance = GetModuleHandle(NULL);
 	common::Window window(hInstance, L"colored_triangle_t", L"Colored Triangle", W, H);
@@ -59,7 +155,7 @@ int main()
 	std::shared_ptr<rtt::Swapchain> swapchain = std::make_shared<rtt::Swapchain>(
 		window.Hwnd(), W, H, *context);
 	//asset load - we need a command queue to load the assets because the meshes are sent to the vertex buffers in the gpu.
-	LoadAssets(*context);
+	LoadAssets(*context, assetFiles);
 	//create the offscreen render pass
 	std::shared_ptr<rtt::OffscreenRenderPass> offscreenRP = std::make_shared<rtt::OffscreenRenderPass>();
 	std::shared_ptr<rtt::PresentationRenderPass> presentationRP = std::make_shared<rtt::PresentationRenderPass>();
@@ -119,35 +215,65 @@ int main()
 		context->Device(),
 		context->SampleCount(),
 		context->QualityLevels());
+	//the presentation shaders read the full vertex format
+	common::io::LoadedMeshFile planeData = planeFile.get();
+	std::shared_ptr<common::Mesh> plane = common::io::UploadMeshes(planeData,
+		context->Device(), context->CommandQueue(), common::VertexFormat::Full, nullptr, context->UploadBatch())[0];
 	std::shared_ptr<rtt::PresentationPipeline> presentationPipeline = std::make_shared<rtt::PresentationPipeline>(
-		context->Device(), context->CommandQueue(), presentationRootSignature, 
+		context->Device(), plane, presentationRootSignature, 
 		context->SampleCount(),
 		context->QualityLevels());
 	std::shared_ptr<rtt::InstancedTransformPipeline> instancedPipeline = std::make_shared<rtt::InstancedTransformPipeline>(
-		L"instanced_transform_vertex_shader.cso",
+		PACKED_VERTICES ? L"instanced_transform_packed_vertex_shader.cso" : L"instanced_transform_vertex_shader.cso",
 		L"instanced_transform_pixel_shader.cso",
 		context->Device(),
 		context->SampleCount(),
-		context->QualityLevels()
+		context->QualityLevels(),
+		meshVertexFormat
 	);
 	//create camera
-	rtt::Camera camera(*context);
+	rtt::Camera camera;
 	camera.SetPerspective(60.0f, ((float)W / (float)H), 0.01f, 100.f);
 	camera.LookAt({ 6.0f, 10.0f, 14.0f }, { 0.0f, 0.0f, 0.0f }, { 0.0f, 1.0f, 0.0f });
 
 	//create the model view buffer
 	std::shared_ptr<rtt::ModelMatrix> modelMatrixForMonkeys = std::make_shared<rtt::ModelMatrix>(*context);
-	std::shared_ptr<rtt::InstanceData<int, 4096>> monkeyInstanceIndexes = std::make_shared<rtt::InstanceData<int, 4096>>(context->Device(), context->CommandQueue());
-	//instance index buffer for the cubes
-	std::shared_ptr<rtt::InstanceData<int, 4096>> cubeInstanceIndexes = std::make_shared<rtt::InstanceData<int, 4096>>(context->Device(), context->CommandQueue());
 	std::shared_ptr<rtt::ModelMatrix>  modelMatrixForCubes = std::make_shared<rtt::ModelMatrix>(*context);
+	//everything that was loaded goes to the gpu in one submit, the frames run after it in the queue
+	context->UploadBatch()->Submit();
+	//the frames wait for the gpu and for their time here, instead of spinning in the main loop
+	common::FramePacer::Settings pacing;
+	pacing.maxQueuedFrames = MAX_QUEUED_FRAMES;
+	pacing.targetFps = TARGET_FPS;
+	common::FramePacer framePacer(pacing, {
+		[&context]() { return context->FrameFence()->GetCompletedValue(); },
+		[&context](uint64_t value) { context->FenceWaiter()->Wait(context->FrameFence(), value); }
+	});
+	window.mOnInput = [&framePacer]() { framePacer.InputReceived(); };
+	//the simulation runs on its own thread and hands a snapshot of the world to each frame. It
+	//stays at most one snapshot ahead, so the frame takes about the longest of the two, not the sum
+	common::SnapshotExchange<rtt::RenderSnapshot> snapshots;
+	std::thread simulationThread([&snapshots, &camera]() {
+		while (!snapshots.IsStopped())
+		{
+			Simulate(camera, snapshots.Back());
+			snapshots.Publish();
+			if (!snapshots.WaitUntilTaken())
+				break;
+		}
+	});
 	//////Main loop//////
 	static float r = 0;
 	window.mOnIdle = [&context, &swapchain,&offscreenRTV, &offscreenRP, 
-		&presentationRP, &modelMatrixForMonkeys,&monkeyInstanceIndexes, &camera, &transformsRootSignature,
+		&presentationRP, &modelMatrixForMonkeys, &transformsRootSignature,
 		&transformsPipeline, &presentationRootSignature, &presentationPipeline, &instancedPipeline,
-		&modelMatrixForCubes, &cubeInstanceIndexes]()
+		&modelMatrixForCubes, &framePacer, &snapshots]()
 	{
+		framePacer.BeginFrame();
+		//the newest state of the world, the simulation is alredy working on the next one
+		if (!snapshots.WaitAndAcquire())
+			return;
+		const rtt::RenderSnapshot& snapshot = snapshots.Front();
 		// Fill out the Viewport
 		D3D12_VIEWPORT viewport;
 		viewport.TopLeftX = 0;
@@ -163,38 +289,6 @@ int main()
 		scissorRect.right = static_cast<float>(W);
 		scissorRect.bottom = static_cast<float>(H);
 			
-		/////// Update Logic ///////
-		gTimer.Tick();
-		auto gameUpdateView = gRegistry.view<
-			const rtt::entities::DeltaTransform,
-			rtt::entities::Transform>();
-		gameUpdateView.each([](
-			const rtt::entities::DeltaTransform deltaTransform, 
-			rtt::entities::Transform& transform
-			) {
-			using namespace DirectX;
-			//position
-			XMVECTOR pos = XMLoadFloat3(&transform.position);
-			XMVECTOR posVelocity = XMLoadFloat3(&deltaTransform.dPosition);
-			XMVECTOR dPos = XMVectorScale(posVelocity, gTimer.DeltaTime());
-			pos = XMVectorAdd(pos, dPos);
-			DirectX::XMStoreFloat3(&transform.position, pos);
-			//scale
-			XMVECTOR scale = XMLoadFloat3(&transform.scale);
-			XMVECTOR scaleVelocity = XMLoadFloat3(&deltaTransform.dScale);
-			XMVECTOR dScale = XMVectorScale(scaleVelocity, gTimer.DeltaTime());
-			scale = XMVectorAdd(scale, dScale);
-			DirectX::XMStoreFloat3(&transform.scale, scale);
-			//rotation
-			float rotationSpeed = XMConvertToRadians(deltaTransform.rotationSpeed); 
-			float scaledAngle = rotationSpeed * gTimer.DeltaTime();
-			XMVECTOR rotationVariation = XMQuaternionRotationAxis(deltaTransform.rotationAxis ,
-				scaledAngle);
-			XMVECTOR currentQuaternion = transform.rotation;
-			currentQuaternion = XMQuaternionMultiply(currentQuaternion, rotationVariation);
-			currentQuaternion = XMQuaternionNormalize(currentQuaternion);
-			transform.rotation = currentQuaternion;
-		});
 		/////// Draw Scene ///////
 		context->WaitPreviousFrame();
 		context->ResetCommandList();
@@ -206,77 +300,109 @@ int main()
 			offscreenRTV->DepthStencilView(),
 			{0,0,0,1}
 		);
-		//set viewport and scissors
-		context->CommandList()->RSSetViewports(1, &viewport);
-		context->CommandList()->RSSetScissorRects(1, &scissorRect);
-
-		//Send cube data to GPU, we need to send the matrices and the indices.
-		auto cubeDrawDataView = gRegistry.view<const rtt::entities::Transform, const rtt::entities::Cube>();
+		//Send cube data to GPU, the shader finds the matrix from the instance id.
+		const std::vector<common::LodLevel>& cubeLods = gMeshes[0]->Lods();
+		//the matrices are grouped by lod, each lod is drawn starting at its group
 		modelMatrixForCubes->BeginStore();
-		cubeInstanceIndexes->BeginStore(context->CommandList());
-		int cubeIdx = 0;
-		cubeDrawDataView.each([&modelMatrixForCubes, &cubeInstanceIndexes, &cubeIdx](const rtt::entities::Transform t, const rtt::entities::Cube) 
+		for (const std::vector<rtt::entities::Transform>& cubes : snapshot.cubesPerLod)
+			for (const rtt::entities::Transform& t : cubes)
+				modelMatrixForCubes->Store(t);
+		modelMatrixForCubes->EndStore(context->CommandList());
+		//the state the lists of the cubes start with, they don't inherit it from the list before
+		const D3D12_GPU_VIRTUAL_ADDRESS cameraAddress = snapshot.camera.StoreInBuffer(*context->FrameAllocator());
+		const D3D12_CPU_DESCRIPTOR_HANDLE rtv = offscreenRTV->RenderTargetView();
+		const D3D12_CPU_DESCRIPTOR_HANDLE dsv = offscreenRTV->DepthStencilView();
+		auto cubeState = [&](const ComPtr<ID3D12GraphicsCommandList>& commandList)
 		{
-			modelMatrixForCubes->Store(t);
-			cubeInstanceIndexes->Store(cubeIdx);
-			cubeIdx++;
+			commandList->OMSetRenderTargets(1, &rtv, FALSE, &dsv);
+			//set viewport and scissors
+			commandList->RSSetViewports(1, &viewport);
+			commandList->RSSetScissorRects(1, &scissorRect);
+			//bind root signature
+			commandList->SetGraphicsRootSignature(instancedPipeline->RootSignature().Get());
+			////root param 1 = view projection buffer - all objects will use the same camera
+			commandList->SetGraphicsRootConstantBufferView(1, cameraAddress);
+			//bind the pipeline 
+			commandList->SetPipelineState(instancedPipeline->Pipeline().Get());
+			commandList->IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+			//bind the cube buffers
+			////root param 0 = model matrix buffer - it's different between object classes (cube, monkey, etc)
+			std::array<ID3D12DescriptorHeap*, 1> cubeDescriptorHeaps = { modelMatrixForCubes->DescriptorHeap().Get() };
+			commandList->SetDescriptorHeaps(cubeDescriptorHeaps.size(), cubeDescriptorHeaps.data());
+			commandList->SetGraphicsRootDescriptorTable(0,
+				modelMatrixForCubes->DescriptorHeap()->GetGPUDescriptorHandleForHeapStart());
+			////vertex input 0 = vertex buffer, the same for all the meshes of the pool
+			auto cubeVBV = gGeometryPool->VertexBufferView();
+			commandList->IASetVertexBuffers(0, 1, &cubeVBV);
+			////index list
+			auto cubeIBV = gMeshes[0]->IndexBufferView();
+			commandList->IASetIndexBuffer(&cubeIBV);
+			////root param 2 = quantization bounds, only if the mesh is packed
+			rtt::InstancedTransformPipeline::BindQuantization(commandList, *gMeshes[0]);
+		};
+		//the cube instances, one draw per lod that has cubes, with the first matrix of its group
+		static std::vector<std::pair<size_t, UINT>> cubeDraws;
+		cubeDraws.clear();
+		UINT startInstance = 0;
+		for (size_t lod = 0; lod < cubeLods.size(); lod++)
+		{
+			if (snapshot.cubesPerLod[lod].empty())
+				continue;
+			cubeDraws.push_back({ lod, startInstance });
+			startInstance += static_cast<UINT>(snapshot.cubesPerLod[lod].size());
+		}
+		//the draws are split among the recording threads if there are enough of them, a draw per lod stays in one list
+		context->RecordParallel(cubeDraws.size(), cubeState,
+			[&snapshot, &cubeLods](const ComPtr<ID3D12GraphicsCommandList>& commandList, size_t i)
+		{
+			const size_t lod = cubeDraws[i].first;
+			UINT instanceCount = static_cast<UINT>(snapshot.cubesPerLod[lod].size());
+			////root param 3 = the first matrix of the lod's group
+			rtt::InstancedTransformPipeline::BindInstanceBase(commandList, cubeDraws[i].second);
+			commandList->DrawIndexedInstanced(cubeLods[lod].indexCount, instanceCount,
+				gMeshes[0]->FirstIndex() + cubeLods[lod].firstIndex, gMeshes[0]->BaseVertex(), 0);
 		});
-		modelMatrixForCubes->EndStore(context->CommandList());
-		cubeInstanceIndexes->EndStore(context->CommandList());
-		//bind root signature
-		context->CommandList()->SetGraphicsRootSignature(instancedPipeline->RootSignature().Get());
-		////root param 1 = view projection buffer - all objects will use the same camera
-		camera.StoreInBuffer();
-		context->CommandList()->SetGraphicsRootConstantBufferView(1,
-			camera.GetConstantBuffer()->GetGPUVirtualAddress());
-		//bind the pipeline 
-		context->CommandList()->SetPipelineState(instancedPipeline->Pipeline().Get());
-		context->CommandList()->IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
-		//bind the cube buffers
-		////root param 0 = model matrix buffer - it's different between object classes (cube, monkey, etc)
-		std::vector<ID3D12DescriptorHeap*> cubeDescriptorHeaps = {modelMatrixForCubes->DescriptorHeap().Get() };
-		context->CommandList()->SetDescriptorHeaps(cubeDescriptorHeaps.size(), cubeDescriptorHeaps.data());
-		context->CommandList()->SetGraphicsRootDescriptorTable(0,
-			modelMatrixForCubes->DescriptorHeap()->GetGPUDescriptorHandleForHeapStart());
-		////vertex input 0 = vertex buffer
-		auto cubeVBV = gMeshes[0]->VertexBufferView();
-		context->CommandList()->IASetVertexBuffers(0, 1, &cubeVBV);
-		////vertex input 1 = instance buffer
-		auto instanceBV = cubeInstanceIndexes->InstanceBufferView();
-		context->CommandList()->IASetVertexBuffers(1, 1, &instanceBV);
-		////index list
-		auto cubeIBV = gMeshes[0]->IndexBufferView();
-		context->CommandList()->IASetIndexBuffer(&cubeIBV);
-		//draw the cube instances
-		context->CommandList()->DrawIndexedInstanced(gMeshes[0]->NumberOfIndices(), cubeIdx, 0, 0, 0);
-		//TODO: Send monkey data to GPU, we need to send the matrices and the indices.
-		auto monkeyDrawDataView = gRegistry.view<const rtt::entities::Transform, const rtt::entities::Monkey>();
+		//TODO: Send monkey data to GPU, the shader finds the matrix from the instance id.
 		modelMatrixForMonkeys->BeginStore();
-		monkeyInstanceIndexes->BeginStore(context->CommandList());
-		int monkeyIndex = 0;
-		monkeyDrawDataView.each([&modelMatrixForMonkeys, &monkeyInstanceIndexes, &monkeyIndex](const rtt::entities::Transform t, const rtt::entities::Monkey m) {
+		for (const rtt::entities::Transform& t : snapshot.monkeys)
 			modelMatrixForMonkeys->Store(t);
-			monkeyInstanceIndexes->Store(monkeyIndex);
-			monkeyIndex++;
-		});
+		const int monkeyIndex = static_cast<int>(snapshot.monkeys.size());
+		const std::vector<common::LodLevel>& monkeyLods = gMeshes[1]->Lods();
+		const uint32_t monkeyLod = snapshot.monkeyLod;
 		modelMatrixForMonkeys->EndStore(context->CommandList());
-		monkeyInstanceIndexes->EndStore(context->CommandList());
 		//TODO: write monkey data
 		////root param 0 
 		std::vector<ID3D12DescriptorHeap*> monkeyDescriptorHeaps = { modelMatrixForMonkeys->DescriptorHeap().Get() };
 		context->CommandList()->SetDescriptorHeaps(monkeyDescriptorHeaps.size(), monkeyDescriptorHeaps.data());
 		context->CommandList()->SetGraphicsRootDescriptorTable(0,modelMatrixForMonkeys->DescriptorHeap()->GetGPUDescriptorHandleForHeapStart());
-		////vertex input 0 = vertex buffer
-		auto monkeyCubeVBV = gMeshes[1]->VertexBufferView();
-		context->CommandList()->IASetVertexBuffers(0, 1, &monkeyCubeVBV);
-		////vertex input 1 = instance buffer
-		auto monkeyInstanceBV = monkeyInstanceIndexes->InstanceBufferView();
-		context->CommandList()->IASetVertexBuffers(1, 1, &monkeyInstanceBV);
+		////vertex input 0 = vertex buffer, the pool's one is alredy bound
 		////index list
 		auto monkeyIBV = gMeshes[1]->IndexBufferView();
 		context->CommandList()->IASetIndexBuffer(&monkeyIBV);
+		rtt::InstancedTransformPipeline::BindQuantization(context->CommandList(), *gMeshes[1]);
+		////root param 3 = the monkeys' matrices start at 0
+		rtt::InstancedTransformPipeline::BindInstanceBase(context->CommandList(), 0);
 		//TODO: draw monkey
-		context->CommandList()->DrawIndexedInstanced(gMeshes[1]->NumberOfIndices(), cubeIdx, 0, 0, 0);
+		if (MESHLET_CULLING && monkeyIndex == 1 && monkeyLod == 0 && !gMeshes[1]->Meshlets().empty())
+		{
+			//there's only one monkey, so we can throw away the meshlets that it won't see using its transform
+			const rtt::entities::Transform& t = snapshot.monkeys[0];
+			const DirectX::XMMATRIX monkeyWorld = DirectX::XMMatrixScaling(t.scale.x, t.scale.y, t.scale.z) *
+				DirectX::XMMatrixRotationQuaternion(t.rotation) *
+				DirectX::XMMatrixTranslation(t.position.x, t.position.y, t.position.z);
+			static std::vector<common::IndexRange> visibleRanges;
+			common::CullMeshlets(gMeshes[1]->Meshlets(), gMeshes[1]->MeshletsBounds(), monkeyWorld,
+				common::FrustumFromMatrix(snapshot.camera.ViewProjection()), snapshot.camera.Position(), visibleRanges);
+			for (const common::IndexRange& range : visibleRanges)
+				context->CommandList()->DrawIndexedInstanced(range.indexCount, 1,
+					gMeshes[1]->FirstIndex() + range.firstIndex, gMeshes[1]->BaseVertex(), 0);
+		}
+		else
+		{
+			//the meshlets are only for level 0, the other levels are drawn whole
+			context->CommandList()->DrawIndexedInstanced(monkeyLods[monkeyLod].indexCount, monkeyIndex,
+				gMeshes[1]->FirstIndex() + monkeyLods[monkeyLod].firstIndex, gMeshes[1]->BaseVertex(), 0);
+		}
 		
 		//end the offscreen render pass
 		offscreenRP->End(context->CommandList(),
@@ -295,6 +421,7 @@ int main()
 		presentationPipeline->Draw(context->CommandList());
 		presentationRP->End(context->CommandList(), *swapchain);
 		context->Present(swapchain->SwapChain());
+		framePacer.Presented(context->FrameFenceValue());
 	};
 	//////On Resize handle//////
 	window.mOnResize = [](int newW, int newH) {};
@@ -305,6 +432,11 @@ int main()
 	};
 	//////Fire main loop///////
 	window.MainLoop();
+	snapshots.Stop();
+	simulationThread.join();
+	//the frames and the uploads in flight still use the meshes and the pool
+	context->WaitIdle();
 	gMeshes.clear();
+	gGeometryPool.reset();
 	return 0;
 }
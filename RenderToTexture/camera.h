@@ -1,32 +1,32 @@
 #pragma once
 #include "pch.h"
+#include "../Common/frame_allocator.h"
 
 namespace rtt
 {
-	class DxContext;
 	class Camera
 	{
 	public:
-		Camera(DxContext& ctx);
 		void SetPerspective(float fovInDegrees, float aspectRatio, float nearZ, float farZ);
 		void LookAt(
 			DirectX::FXMVECTOR EyePosition,
 			DirectX::FXMVECTOR FocusPosition,
 			DirectX::FXMVECTOR UpDirection);
-		void StoreInBuffer();
-		Microsoft::WRL::ComPtr<ID3D12DescriptorHeap> GetDescriptorHeap()const {
-			return descriptorHeap;
-		}
-		Microsoft::WRL::ComPtr<ID3D12Resource> GetConstantBuffer()const {
-			return constantBuffer;
-		}
+		/// <summary>
+		/// Writes the view projection in the frame's constant memory and returns its address, for the
+		/// root constant buffer view. Each frame gets its own copy, the gpu may still read the last one.
+		/// </summary>
+		D3D12_GPU_VIRTUAL_ADDRESS StoreInBuffer(common::FrameAllocator& frameAllocator)const;
+		DirectX::XMMATRIX ViewProjection()const { return viewProjectionMatrix; }
+		DirectX::XMFLOAT3 Position()const { return eyePosition; }
+		/// <summary>
+		/// How many pixels a world unit at distance 1 covers, for screen space error metrics.
+		/// </summary>
+		float ProjectionScale(float viewportHeight)const { return viewportHeight / (2.0f * tanf(fov * 0.5f)); }
 	private:
-		Microsoft::WRL::ComPtr<ID3D12Device> device;
-		Microsoft::WRL::ComPtr<ID3D12Resource> constantBuffer;
 		float fov, aspectRatio, nearZ, farZ;
 		DirectX::XMMATRIX viewProjectionMatrix;
-		Microsoft::WRL::ComPtr<ID3D12DescriptorHeap> descriptorHeap;
-		D3D12_CONSTANT_BUFFER_VIEW_DESC cbvDesc = {};
+		DirectX::XMFLOAT3 eyePosition;
 	};
 }
 
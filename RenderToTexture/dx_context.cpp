@@ -3,8 +3,10 @@
 #include "camera.h"
 using Microsoft::WRL::ComPtr;
 using namespace common;
-rtt::DxContext::DxContext()
+rtt::DxContext::DxContext(uint32_t framesInFlight)
+    :frames(framesInFlight)
 {
+    assert(framesInFlight > 0);
     HRESULT hr;
     //the factory is used to create DXGI objects.
     dxgiFactory = common::CreateDXGIFactory();
@@ -37,57 +39,76 @@ rtt::DxContext::DxContext()
     qualityLevels = msQualityLevels.NumQualityLevels;
     //create the fence
     device->CreateFence(FENCE_INITIAL_VALUE, D3D12_FENCE_FLAG_NONE, IID_PPV_ARGS(&fence));
+    fenceWaiter = std::make_shared<common::FenceWaiter>();
     //create command queue and list
     D3D12_COMMAND_QUEUE_DESC queueDesc = {};
     queueDesc.Type = D3D12_COMMAND_LIST_TYPE_DIRECT;
     queueDesc.Flags = D3D12_COMMAND_QUEUE_FLAG_NONE;
     device->CreateCommandQueue(&queueDesc, IID_PPV_ARGS(&commandQueue));
-    device->CreateCommandAllocator(D3D12_COMMAND_LIST_TYPE_DIRECT, IID_PPV_ARGS(&directCmdAllocList));
-    device->CreateCommandList(0, 
-        D3D12_COMMAND_LIST_TYPE_DIRECT, 
-        directCmdAllocList.Get(),
-        nullptr, IID_PPV_ARGS(&commandList));
-    commandList->Close();
-    directCmdAllocList->Reset();
-
+    //each frame in flight records in its own lists and allocators, the recorder keeps a pool per frame
+    recordingPool = std::make_shared<common::ThreadPool>();
+    recorder = std::make_shared<common::CommandRecorder>(common::D3D12Recording{ device, commandQueue },
+        framesInFlight, recordingPool, MIN_DRAWS_PER_COMMAND_LIST);
+    copyQueue = common::CreateCopyCommandQueue(device, L"Copy Queue");
+    uploadRing = std::make_shared<common::UploadRing>(device);
+    uploadBatch = std::make_shared<common::UploadBatch>(device, copyQueue, uploadRing, commandQueue);
+    frameAllocator = std::make_shared<common::FrameAllocator>(device, framesInFlight);
 }
 
 void rtt::DxContext::WaitPreviousFrame()
 {
-    HRESULT hr;
-    if (fence->GetCompletedValue() < fenceValue)
-    {
-        HANDLE fenceEvent;
-        fenceEvent = CreateEvent(nullptr, FALSE, FALSE, nullptr);
-        hr = fence->SetEventOnCompletion(fenceValue, fenceEvent);
-        WaitForSingleObject(fenceEvent, INFINITE);
-    }
-    fenceValue++;
+    //only the frame that had this index has to be done, its allocator and memory are reused
+    fenceWaiter->Wait(fence.Get(), frames.BeginFrame());
+    frameAllocator->BeginFrame(frames.Index());
+}
+
+void rtt::DxContext::WaitIdle()
+{
+    //what the loading still has in the batch and what the copy queue is running
+    uploadBatch->Flush();
+    //the frame being recorded may not be submitted, its lists don't run and it can be signaled now.
+    //Its value is the highest the DeferRelease callbacks wait for
+    const uint64_t value = frames.FenceValue();
+    commandQueue->Signal(fence.Get(), value);
+    fenceWaiter->Wait(fence.Get(), value);
+    //the callbacks that get ready together run in the order they were added, this one goes last
+    std::promise<void> released;
+    fenceWaiter->OnCompletion(fence.Get(), value, [&released]() { released.set_value(); });
+    released.get_future().wait();
+}
+
+void rtt::DxContext::DeferRelease(Microsoft::WRL::ComPtr<IUnknown> object)
+{
+    //Present signals the frame's value after it, the callback drops the last reference
+    fenceWaiter->OnCompletion(fence.Get(), frames.FenceValue(), [object]() {});
 }
 
 void rtt::DxContext::ResetCommandList()
 {
 
-    HRESULT hr = directCmdAllocList->Reset();
-    assert(hr == S_OK);
-    hr = commandList->Reset(directCmdAllocList.Get(), NULL);
-    assert(hr == S_OK);
+    //WaitPreviousFrame made sure the gpu is done with what the frame's allocators have
+    recorder->BeginFrame(frames.Index());
+    //the copy queue leaves what it uploaded in COMMON
+    uploadBatch->RecordPendingTransitions(recorder->Current().Get());
 }
 
 void rtt::DxContext::Present(Microsoft::WRL::ComPtr<IDXGISwapChain3> swapchain)
 {
-    commandList->Close();
-    std::array<ID3D12CommandList*, 1> ppCommandLists{ commandList.Get() };
-    commandQueue->ExecuteCommandLists(ppCommandLists.size(),
-        ppCommandLists.data());
-    commandQueue->Signal(fence.Get(), fenceValue);
+    //the gpu waits for the uploads that the frame uses, the cpu goes on
+    uploadBatch->QueueWait(commandQueue.Get());
+    //all the frame's lists in one call, in the order they were recorded
+    recorder->Submit();
+    commandQueue->Signal(fence.Get(), frames.EndFrame());
+    //what the frame copied from the ring can be reused when the gpu gets here
+    uploadRing->Submit(commandQueue.Get());
     swapchain->Present(0, 0);
 }
 
 void rtt::DxContext::BindRootSignatureForTransforms(Microsoft::WRL::ComPtr<ID3D12RootSignature> rs, 
     rtt::ModelMatrix& modelMatrixData, 
-    rtt::Camera& camera)
+    const rtt::Camera& camera)
 {
+    ID3D12GraphicsCommandList* commandList = recorder->Current().Get();
     commandList->SetGraphicsRootSignature(rs.Get());
     //bind the descriptor table (SRV for the structured buffer that holds the model matrices)
     ID3D12DescriptorHeap* h = modelMatrixData.DescriptorHeap().Get();
@@ -98,7 +119,7 @@ void rtt::DxContext::BindRootSignatureForTransforms(Microsoft::WRL::ComPtr<ID3D1
     // the root constants are in param #1
     // the constant buffer for view/proj data is in #2
     commandList->SetGraphicsRootConstantBufferView(2,
-        camera.GetConstantBuffer()->GetGPUVirtualAddress());
+        camera.StoreInBuffer(*frameAllocator));
 }
 
 void rtt::DxContext::BindRootSignatureForPresentation(
@@ -106,6 +127,7 @@ void rtt::DxContext::BindRootSignatureForPresentation(
     Microsoft::WRL::ComPtr<ID3D12DescriptorHeap> samplerHeap,
     Microsoft::WRL::ComPtr<ID3D12DescriptorHeap> srvHeap)
 {
+    ID3D12GraphicsCommandList* commandList = recorder->Current().Get();
     commandList->SetGraphicsRootSignature(rs.Get());
     //bind the heaps
     std::array< ID3D12DescriptorHeap*, 2> descriptorHeaps = { 
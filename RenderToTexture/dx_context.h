@@ -1,11 +1,26 @@
 #pragma once
 #include "pch.h"
 #include "../Common/d3d_utils.h"
+#include "../Common/upload_batch.h"
+#include "../Common/frame_allocator.h"
+#include "../Common/fence_waiter.h"
+#include "../Common/command_recorder.h"
+#include "../Common/frame_ring.h"
 namespace rtt
 {
 	class ModelMatrix;
 	class Camera;
 	constexpr unsigned long FENCE_INITIAL_VALUE = 0l;
+	//how many frames the cpu can record while the gpu hasn't finished them, by default
+	constexpr uint32_t FRAMES_IN_FLIGHT = 2;
+	/// <summary>
+	/// The device, the queues and the frames. There are N frames in flight: each one has its
+	/// command lists and allocators in the recorder, the fence value that says the gpu is done with
+	/// it and a part of the frame allocator, so the cpu only waits when it gets N frames ahead of
+	/// the gpu.
+	/// The default heap buffers (model matrices, instance data) don't need a copy per frame: the
+	/// frames run in order in the queue, only the staging memory they copy from is per frame.
+	/// </summary>
 	class DxContext
 	{
 	private:
@@ -16,32 +31,89 @@ namespace rtt
 		Microsoft::WRL::ComPtr<ID3D12Device> device = nullptr;
 		Microsoft::WRL::ComPtr<ID3D12Fence> fence;
 		Microsoft::WRL::ComPtr<ID3D12CommandQueue> commandQueue;
-		Microsoft::WRL::ComPtr<ID3D12CommandAllocator> directCmdAllocList;
-		Microsoft::WRL::ComPtr<ID3D12GraphicsCommandList> commandList;
+		//the uploads run here, at the same time as the frames
+		Microsoft::WRL::ComPtr<ID3D12CommandQueue> copyQueue;
+		//the slot of the frame being recorded and the fence values of the frames in flight
+		common::FrameRing frames;
+		//the threads that record the draws with the calling thread
+		std::shared_ptr<common::ThreadPool> recordingPool;
+		//the frame's command lists, CommandList() is the one the calling thread records in
+		std::shared_ptr<common::CommandRecorder> recorder;
 		Microsoft::WRL::ComPtr<IDXGIFactory4> dxgiFactory;
 		UINT rtvDescriptorSize;
 		UINT dsvDescriptorSize;
 		UINT cbvSrvUavDescriptorSize;
 		UINT sampleCount;
 		UINT qualityLevels;
-		uint64_t fenceValue = 0;
+		//the constants of each frame, a part for each frame in flight
+		std::shared_ptr<common::FrameAllocator> frameAllocator;
+		//waits for the frames and releases what DeferRelease got when the gpu is done with it
+		std::shared_ptr<common::FenceWaiter> fenceWaiter;
+		//staging memory for all the uploads, the frames give it back in Present
+		std::shared_ptr<common::UploadRing> uploadRing;
+		//where the loading records its copies, on the copy queue. The frames wait for what it submitted
+		//and do the transitions that the copy queue can't
+		std::shared_ptr<common::UploadBatch> uploadBatch;
 	public:
-		DxContext();
+		DxContext(uint32_t framesInFlight = FRAMES_IN_FLIGHT);
 		UINT RtvDescriptorSize()const { return rtvDescriptorSize; }
 		UINT DsvDescriptorSize()const { return dsvDescriptorSize; }
 		UINT CbvSrvUavDescriptorSize()const { return cbvSrvUavDescriptorSize; }
 		UINT SampleCount()const { return 1;/*return sampleCount;*/ } //FIXME:The multisample quality value is not supported. Support for each sample count value and format must be verified when creating the swap chain
 		UINT QualityLevels()const { return 0;/*return qualityLevels;*/ } //FIXME:The multisample quality value is not supported. Support for each sample count value and format must be verified when creating the swap chain
 		Microsoft::WRL::ComPtr<ID3D12CommandQueue> CommandQueue()const { return commandQueue; }
+		Microsoft::WRL::ComPtr<ID3D12CommandQueue> CopyQueue()const { return copyQueue; }
 		Microsoft::WRL::ComPtr<ID3D12Device> Device()const { return device; }
 		Microsoft::WRL::ComPtr<IDXGIFactory4> DxgiFactory()const { return dxgiFactory; }
+		std::shared_ptr<common::UploadRing> UploadRing()const { return uploadRing; }
+		std::shared_ptr<common::UploadBatch> UploadBatch()const { return uploadBatch; }
+		std::shared_ptr<common::FrameAllocator> FrameAllocator()const { return frameAllocator; }
+		uint32_t FrameIndex()const { return frames.Index(); }
+		uint32_t FramesInFlight()const { return frames.Count(); }
+		/// <summary>
+		/// To wait for the frames or run something when the gpu gets to one, see FrameFence.
+		/// </summary>
+		std::shared_ptr<common::FenceWaiter> FenceWaiter()const { return fenceWaiter; }
+		/// <summary>
+		/// Present signals it with the frame's value, FrameFenceValue() for the frame being recorded.
+		/// </summary>
+		ID3D12Fence* FrameFence()const { return fence.Get(); }
+		uint64_t FrameFenceValue()const { return frames.FenceValue(); }
+		/// <summary>
+		/// Starts the next frame. Waits only for the gpu to be done with the frame that had the same
+		/// index, FramesInFlight() frames ago, the ones after it may still be running.
+		/// </summary>
 		void WaitPreviousFrame();
+		/// <summary>
+		/// Waits for the gpu to be done with everything: the uploads, every frame submitted and the
+		/// one being recorded, and the DeferRelease callbacks. Call it before destroying what the
+		/// frames use.
+		/// </summary>
+		void WaitIdle();
+		/// <summary>
+		/// Keeps object alive until the gpu is done with the frame being recorded, for the buffers
+		/// and heaps that are replaced when they grow. The fence waiter's thread releases it.
+		/// </summary>
+		void DeferRelease(Microsoft::WRL::ComPtr<IUnknown> object);
 		void ResetCommandList();
-		Microsoft::WRL::ComPtr<ID3D12GraphicsCommandList> CommandList()const { return commandList; }
+		/// <summary>
+		/// Where the render thread records. It's another list after RecordParallel, so don't keep it.
+		/// </summary>
+		Microsoft::WRL::ComPtr<ID3D12GraphicsCommandList> CommandList()const { return recorder->Current(); }
+		/// <summary>
+		/// Records the draw batches in lists of their own on the recording threads, after what
+		/// CommandList() has. See common::CommandRecorder::RecordParallel.
+		/// </summary>
+		void RecordParallel(size_t batchCount, const common::CommandRecorder::Setup& setup,
+			const common::CommandRecorder::Record& record)
+		{
+			recorder->RecordParallel(batchCount, setup, record);
+		}
+		std::shared_ptr<common::CommandRecorder> Recorder()const { return recorder; }
 		void Present(Microsoft::WRL::ComPtr<IDXGISwapChain3> swapchain);
 		void BindRootSignatureForTransforms(Microsoft::WRL::ComPtr<ID3D12RootSignature> rs,
 			rtt::ModelMatrix& modelMatrixData,
-			rtt::Camera& camera);
+			const rtt::Camera& camera);
 		void BindRootSignatureForPresentation(Microsoft::WRL::ComPtr<ID3D12RootSignature> rs,
 			Microsoft::WRL::ComPtr<ID3D12DescriptorHeap> samplerDescriptorHeap,
 			Microsoft::WRL::ComPtr<ID3D12DescriptorHeap> texture);
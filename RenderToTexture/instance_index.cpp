@@ -1,3 +0,0 @@
-#include "instance_index.h"
-
-
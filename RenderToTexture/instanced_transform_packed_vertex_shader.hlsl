@@ -0,0 +1,62 @@
+//inputs, see common::PackedVertex
+struct VS_INPUT
+{
+    float4 pos : POSITION; //unorm, relative to the mesh bounds
+    float2 normal : NORMAL; //octahedral encoded
+    float2 uv : UV; //half floats, the input assembler converts them
+    uint instanceID : SV_InstanceID; // doesn't include the StartInstanceLocation of the draw
+};
+//outputs
+struct VS_OUTPUT
+{
+    float4 pos : SV_POSITION;
+    float4 color : COLOR;
+    float3 normal : NORMAL;
+};
+//describes the model matrix
+struct ModelMatrixStruct
+{
+    float4x4 mat;
+};
+//where i store the model matrices
+StructuredBuffer<ModelMatrixStruct> ModelMatrices : register(t0);
+
+//holds the view projection matrix
+cbuffer ConstantBuffer : register(b0)
+{
+    float4x4 viewProjectionMatrix;
+};
+//root constants with the bounds used to quantize the positions, see common::QuantizationBounds
+cbuffer Quantization : register(b1)
+{
+    float4 boundsMin;
+    float4 boundsExtent;
+};
+
+float3 OctDecode(float2 e)
+{
+    float3 n = float3(e.x, e.y, 1.0f - abs(e.x) - abs(e.y));
+    //the lower hemisphere was folded over the upper one
+    float t = saturate(-n.z);
+    n.x += n.x >= 0.0f ? -t : t;
+    n.y += n.y >= 0.0f ? -t : t;
+    return normalize(n);
+}
+
+//root constant with the index of the first matrix of the draw
+cbuffer InstanceBase : register(b2)
+{
+    uint firstInstance;
+};
+
+VS_OUTPUT main(VS_INPUT input)
+{
+    VS_OUTPUT output;
+    float3 position = boundsMin.xyz + input.pos.xyz * boundsExtent.xyz;
+    float4x4 modelMatrix = ModelMatrices[firstInstance + input.instanceID].mat;
+    float4x4 mvpMatrix = mul(modelMatrix, viewProjectionMatrix);
+    output.pos = mul(float4(position, 1.0f), mvpMatrix);
+    output.color = float4(input.uv, 1.0f, 1.0f);
+    output.normal = mul(float4(OctDecode(input.normal), 0.0f), modelMatrix).xyz;
+    return output;
+}
@@ -1,5 +1,6 @@
 #include "instanced_transform_pipeline.h"
 #include "../Common/input_layout_service.h"
+#include "../Common/mesh.h"
 using Microsoft::WRL::ComPtr;
 using namespace common;
 using namespace rtt;
@@ -8,7 +9,8 @@ rtt::InstancedTransformPipeline::InstancedTransformPipeline(
     const std::wstring& vsFilename, 
     const std::wstring& psFilename, 
     Microsoft::WRL::ComPtr<ID3D12Device> device, 
-    UINT sampleCount, UINT quality)
+    UINT sampleCount, UINT quality,
+    common::VertexFormat vertexFormat)
 {
     HRESULT hr;
     CreateRootSignatureIfNotCreatedYet(device);
@@ -27,7 +29,9 @@ rtt::InstancedTransformPipeline::InstancedTransformPipeline(
     pixelShaderBytecode.BytecodeLength = pixelShader->GetBufferSize();
     pixelShaderBytecode.pShaderBytecode = pixelShader->GetBufferPointer();
     //create input layout
-    std::vector< D3D12_INPUT_ELEMENT_DESC> inputLayout = common::input_layout_service::InstancedTransform();
+    std::vector< D3D12_INPUT_ELEMENT_DESC> inputLayout = vertexFormat == common::VertexFormat::Packed ?
+        common::input_layout_service::PackedInstanceIdTransform() :
+        common::input_layout_service::InstanceIdTransform();
     D3D12_INPUT_LAYOUT_DESC inputLayoutDesc = {};
     inputLayoutDesc.NumElements = inputLayout.size();
     inputLayoutDesc.pInputElementDescs = inputLayout.data();
@@ -78,7 +82,7 @@ void rtt::InstancedTransformPipeline::CreateRootSignatureIfNotCreatedYet(Microso
     if (rootSignature == nullptr)
     {
         //the table of root signature parameters
-        std::array<CD3DX12_ROOT_PARAMETER, 2> rootParams;
+        std::array<CD3DX12_ROOT_PARAMETER, 4> rootParams;
         //1) ModelMatrices 
         CD3DX12_DESCRIPTOR_RANGE srvRange(
             D3D12_DESCRIPTOR_RANGE_TYPE_SRV, //it's a shader resource view 
@@ -87,6 +91,11 @@ void rtt::InstancedTransformPipeline::CreateRootSignatureIfNotCreatedYet(Microso
         rootParams[0].InitAsDescriptorTable(1, &srvRange);
         //ConstantBuffer (view/projection data)
         rootParams[1].InitAsConstantBufferView(0); //at register b0
+        //RootConstants with the quantization bounds of packed meshes, the full vertex shader ignores them
+        rootParams[2].InitAsConstants(sizeof(common::QuantizationBounds) / sizeof(uint32_t), //8 dwords
+            1, 0, D3D12_SHADER_VISIBILITY_VERTEX); //at register b1
+        //RootConstant with the first matrix of the draw, SV_InstanceID starts at 0 in every draw
+        rootParams[3].InitAsConstants(1, 2, 0, D3D12_SHADER_VISIBILITY_VERTEX); //at register b2
 
         //create root signature
         CD3DX12_ROOT_SIGNATURE_DESC rootSignatureDesc;
@@ -109,3 +118,19 @@ void rtt::InstancedTransformPipeline::CreateRootSignatureIfNotCreatedYet(Microso
             IID_PPV_ARGS(&rootSignature));
     }
 }
+
+void rtt::InstancedTransformPipeline::BindQuantization(Microsoft::WRL::ComPtr<ID3D12GraphicsCommandList> commandList,
+    const common::Mesh& mesh)
+{
+    if (mesh.GetVertexFormat() != common::VertexFormat::Packed)
+        return;
+    commandList->SetGraphicsRoot32BitConstants(2,
+        sizeof(common::QuantizationBounds) / sizeof(uint32_t),
+        &mesh.Quantization(), 0);
+}
+
+void rtt::InstancedTransformPipeline::BindInstanceBase(Microsoft::WRL::ComPtr<ID3D12GraphicsCommandList> commandList,
+    UINT firstInstance)
+{
+    commandList->SetGraphicsRoot32BitConstant(3, firstInstance, 0);
+}
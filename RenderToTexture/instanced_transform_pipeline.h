@@ -1,5 +1,9 @@
 #pragma once
 #include "pch.h"
+namespace common
+{
+	class Mesh;
+}
 namespace rtt
 {
 	class InstancedTransformPipeline
@@ -10,7 +14,8 @@ namespace rtt
 			const std::wstring& psFilename,
 			Microsoft::WRL::ComPtr<ID3D12Device> device,
 			UINT sampleCount,
-			UINT quality
+			UINT quality,
+			common::VertexFormat vertexFormat = common::VertexFormat::Full
 		);
 		Microsoft::WRL::ComPtr<ID3D12RootSignature> RootSignature() {
 			assert(rootSignature != nullptr);
@@ -19,6 +24,18 @@ namespace rtt
 		Microsoft::WRL::ComPtr<ID3D12PipelineState> Pipeline() {
 			return mPipeline;
 		}
+		/// <summary>
+		/// Root param 2, the bounds that the packed vertex shader uses to decode the positions.
+		/// Does nothing for meshes that are not packed.
+		/// </summary>
+		static void BindQuantization(Microsoft::WRL::ComPtr<ID3D12GraphicsCommandList> commandList,
+			const common::Mesh& mesh);
+		/// <summary>
+		/// Root param 3, the index in the model matrices of the draw's first instance. The
+		/// shader reads the matrix firstInstance + SV_InstanceID, so there's no instance buffer.
+		/// </summary>
+		static void BindInstanceBase(Microsoft::WRL::ComPtr<ID3D12GraphicsCommandList> commandList,
+			UINT firstInstance);
 		//void Bind(Microsoft::WRL::ComPtr<ID3D12GraphicsCommandList> commandList,
 		//	D3D12_VIEWPORT viewport, D3D12_RECT scissorRect);
 		//void DrawInstanced();
@@ -4,7 +4,7 @@ struct VS_INPUT
     float3 pos : POSITION;
     float3 normal : NORMAL;
     float2 uv : UV;
-    int instanceID : OBJECT_ID; // Instance ID semantic
+    uint instanceID : SV_InstanceID; // doesn't include the StartInstanceLocation of the draw
 };
 //outputs
 struct VS_OUTPUT
@@ -26,10 +26,16 @@ cbuffer ConstantBuffer : register(b0)
     float4x4 viewProjectionMatrix;
 };
 
+//root constant with the index of the first matrix of the draw
+cbuffer InstanceBase : register(b2)
+{
+    uint firstInstance;
+};
+
 VS_OUTPUT main(VS_INPUT input)
 {
     VS_OUTPUT output;
-    float4x4 modelMatrix = ModelMatrices[input.instanceID].mat;
+    float4x4 modelMatrix = ModelMatrices[firstInstance + input.instanceID].mat;
     float4x4 mvpMatrix = mul(modelMatrix, viewProjectionMatrix);
     output.pos = mul(float4(input.pos, 1.0f), mvpMatrix);
     output.color = float4(input.uv, 1.0f, 1.0f);
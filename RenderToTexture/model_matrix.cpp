@@ -1,5 +1,6 @@
 #include "model_matrix.h"
 #include "dx_context.h"
+#include "../Common/placed_resource_allocator.h"
 using namespace DirectX;
 using namespace Microsoft::WRL;
 /// <summary>
@@ -8,26 +9,47 @@ using namespace Microsoft::WRL;
 struct ModelMatrixStruct {
     DirectX::XMFLOAT4X4 matrix;
 };
-constexpr UINT numMatrices = 4096;
 constexpr UINT matrixSize = sizeof(ModelMatrixStruct);
-constexpr UINT bufferSize = (numMatrices * matrixSize + 255) & ~255;
 
-rtt::ModelMatrix::ModelMatrix(DxContext& ctx)
+namespace
 {
+    //a matrix the gpu buffer can't have, for the slots it has garbage in
+    XMFLOAT4X4 UnknownMatrix()
+    {
+        XMFLOAT4X4 unknown;
+        memset(&unknown, 0xFF, sizeof(unknown));
+        return unknown;
+    }
+}
+
+rtt::ModelMatrix::ModelMatrix(DxContext& ctx, UINT initialCapacity)
+    :ctx(ctx)
+{
+    assert(initialCapacity > 0);
+    //no staging buffer of our own, the copies take their memory from the ring
+    uploadRing = ctx.UploadRing();
+    matrices.resize(initialCapacity, UnknownMatrix());
+    CreateBuffer(initialCapacity);
+}
+
+void rtt::ModelMatrix::CreateBuffer(UINT newCapacity)
+{
+    //the frames in flight may still read the old ones
+    if (structuredBuffer != nullptr)
+    {
+        ctx.DeferRelease(structuredBuffer);
+        ctx.DeferRelease(srvHeap);
+    }
+    capacity = newCapacity;
+    const UINT64 bufferSize = (UINT64(capacity) * matrixSize + 255) & ~UINT64(255);
     ///////////////// CREATE THE GPU BUFFER /////////////////
-    CD3DX12_HEAP_PROPERTIES heapProperties(D3D12_HEAP_TYPE_DEFAULT);
-    CD3DX12_RESOURCE_DESC bufferDesc = CD3DX12_RESOURCE_DESC::Buffer(
-        bufferSize, D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS);
-    HRESULT r = ctx.Device()->CreateCommittedResource(
-        &heapProperties,
-        D3D12_HEAP_FLAG_NONE,
-        &bufferDesc,
+    structuredBuffer = common::PlacedResourceAllocator::Default(ctx.Device())->CreateBuffer(
+        D3D12_HEAP_TYPE_DEFAULT,
+        bufferSize,
         D3D12_RESOURCE_STATE_COMMON, // Initial state
-        nullptr,
-        IID_PPV_ARGS(&structuredBuffer));
-    assert(r == S_OK);
+        D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS);
     structuredBuffer->SetName(L"ModelMatrixBuffer");
-    //the heap to hold the view.
+    //the heap to hold the view. A new one, the old one may be bound in a frame in flight
     D3D12_DESCRIPTOR_HEAP_DESC srvHeapDesc = {};
     srvHeapDesc.NumDescriptors = 1; // Just one SRV for now
     srvHeapDesc.Type = D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV;
@@ -40,72 +62,78 @@ rtt::ModelMatrix::ModelMatrix(DxContext& ctx)
     srvDesc.ViewDimension = D3D12_SRV_DIMENSION_BUFFER;
     srvDesc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
     srvDesc.Buffer.FirstElement = 0;
-    srvDesc.Buffer.NumElements = numMatrices; // Number of matrices
+    srvDesc.Buffer.NumElements = capacity; // Number of matrices
     srvDesc.Buffer.StructureByteStride = matrixSize;
     srvDesc.Buffer.Flags = D3D12_BUFFER_SRV_FLAG_NONE;
     srvDesc.Format = DXGI_FORMAT_UNKNOWN;
     ctx.Device()->CreateShaderResourceView(structuredBuffer.Get(), &srvDesc,
         srvHeap->GetCPUDescriptorHandleForHeapStart());
-    ///////////////// CREATE THE STAGING BUFFER /////////////////
-    CD3DX12_HEAP_PROPERTIES uploadHeapProps(D3D12_HEAP_TYPE_UPLOAD);
-    CD3DX12_RESOURCE_DESC uploadBufferDesc = CD3DX12_RESOURCE_DESC::Buffer(bufferSize);
-    ctx.Device()->CreateCommittedResource(
-        &uploadHeapProps,
-        D3D12_HEAP_FLAG_NONE,
-        &uploadBufferDesc,
-        D3D12_RESOURCE_STATE_GENERIC_READ,
-        nullptr,
-        IID_PPV_ARGS(&uploadBuffer));
-    uploadBuffer->SetName(L"ModelMatrixStagingBuffer");
-    uploadBuffer->Map(0, nullptr, &mappedData);
-    
+    //the new buffer starts with garbage, everything that was stored goes again
+    dirty.Mark(0, used);
 }
 
 void rtt::ModelMatrix::BeginStore()
 {
-    void* baseAddress = mappedData;
-    ModelMatrixStruct* structs = reinterpret_cast<ModelMatrixStruct*>(baseAddress);
-    ZeroMemory(structs, bufferSize);
+    //no clear, the matrices that don't change are not copied again
     cursor = 0;
 }
 
+void rtt::ModelMatrix::Write(int idx, DirectX::FXMMATRIX modelMatrix)
+{
+    assert(idx >= 0);
+    //the cpu side grows now, the gpu buffer in EndStore
+    if (static_cast<size_t>(idx) >= matrices.size())
+        matrices.resize((std::max)(static_cast<size_t>(idx) + 1, matrices.size() * 2), UnknownMatrix());
+    used = (std::max)(used, static_cast<UINT>(idx) + 1);
+    XMFLOAT4X4 stored;
+    XMStoreFloat4x4(&stored, modelMatrix);
+    if (memcmp(&stored, &matrices[idx], matrixSize) == 0)
+        return;
+    matrices[idx] = stored;
+    dirty.Mark(static_cast<uint32_t>(idx));
+}
+
 void rtt::ModelMatrix::Store(const entities::Transform& t, int idx)
 {
-    void* baseAddress = mappedData;
-    ModelMatrixStruct* structs = reinterpret_cast<ModelMatrixStruct*>(baseAddress);
     XMMATRIX scaleMatrix = DirectX::XMMatrixScaling(t.scale.x, t.scale.y, t.scale.z);
     XMMATRIX rotationMatrix = DirectX::XMMatrixRotationQuaternion(t.rotation);
     XMMATRIX translationMatrix = DirectX::XMMatrixTranslation(t.position.x, t.position.y, t.position.z);
     XMMATRIX __modelMatrix = DirectX::XMMatrixTranspose(scaleMatrix * rotationMatrix * translationMatrix);
-    XMStoreFloat4x4(&structs[idx].matrix, __modelMatrix);
+    Write(idx, __modelMatrix);
 }
 
 void rtt::ModelMatrix::Store(const entities::Transform& t)
 {
     assert(cursor != INT_MAX);
-    void* baseAddress = mappedData;
-    ModelMatrixStruct* structs = reinterpret_cast<ModelMatrixStruct*>(baseAddress);
-    XMMATRIX scaleMatrix = DirectX::XMMatrixScaling(t.scale.x, t.scale.y, t.scale.z);
-    XMMATRIX rotationMatrix = DirectX::XMMatrixRotationQuaternion(t.rotation);
-    XMMATRIX translationMatrix = DirectX::XMMatrixTranslation(t.position.x, t.position.y, t.position.z);
-    XMMATRIX __modelMatrix = DirectX::XMMatrixTranspose(scaleMatrix * rotationMatrix * translationMatrix);
-    XMStoreFloat4x4(&structs[cursor].matrix, __modelMatrix);
+    Store(t, cursor);
     cursor++;
 }
 
 void rtt::ModelMatrix::EndStore(Microsoft::WRL::ComPtr<ID3D12GraphicsCommandList> commandList)
 {
-    void* baseAddress = mappedData;
-    ModelMatrixStruct* structs = reinterpret_cast<ModelMatrixStruct*>(baseAddress);
-    D3D12_SUBRESOURCE_DATA subresourceData = {};
-    subresourceData.pData = baseAddress;
-    subresourceData.RowPitch = sizeof(DirectX::XMFLOAT4X4) * numMatrices;
-    subresourceData.SlicePitch = subresourceData.RowPitch;
-    UpdateSubresources(commandList.Get(),
-        structuredBuffer.Get(),
-        uploadBuffer.Get(),
-        0, 0, 1, &subresourceData);
     cursor = INT_MAX;
+    if (matrices.size() > capacity)
+        CreateBuffer(static_cast<UINT>(matrices.size()));
+    std::vector<common::DirtyRanges::Range> ranges = dirty.Take();
+    if (ranges.empty())
+        return;
+    //one staging allocation for all the ranges, one copy per range
+    UINT64 stagingSize = 0;
+    for (const common::DirtyRanges::Range& range : ranges)
+        stagingSize += UINT64(range.count) * matrixSize;
+    common::UploadRing::Allocation staging = uploadRing->Allocate(stagingSize);
+    UINT64 stagingOffset = 0;
+    for (const common::DirtyRanges::Range& range : ranges)
+    {
+        const UINT64 size = UINT64(range.count) * matrixSize;
+        memcpy(static_cast<uint8_t*>(staging.cpuAddress) + stagingOffset, &matrices[range.first], size);
+        //the buffer is promoted from common to copy dest by the first copy
+        commandList->CopyBufferRegion(structuredBuffer.Get(), UINT64(range.first) * matrixSize,
+            staging.buffer, staging.offset + stagingOffset, size);
+        stagingOffset += size;
+    }
+    //it's read by the vertex shader after the copies
+    CD3DX12_RESOURCE_BARRIER barrier = CD3DX12_RESOURCE_BARRIER::Transition(structuredBuffer.Get(),
+        D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+    commandList->ResourceBarrier(1, &barrier);
 }
-
-
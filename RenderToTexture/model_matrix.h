@@ -1,29 +1,58 @@
 #pragma once
 #include "pch.h"
 #include "entities.h"
+#include "../Common/dirty_ranges.h"
+#include "../Common/upload_ring.h"
 namespace rtt
 {
 	class DxContext;
+	/// <summary>
+	/// The model matrices in a structured buffer. It remembers what the gpu buffer has and only the
+	/// matrices that changed are copied, so the upload grows with the entities that moved, not with
+	/// the size of the buffer. It grows when an index doesn't fit: the gpu buffer is made again,
+	/// twice as big, and the old one is released when the frames in flight are done with it.
+	/// </summary>
 	class ModelMatrix
 	{
 	public:
-		ModelMatrix(DxContext& ctx);
+		ModelMatrix(DxContext& ctx, UINT initialCapacity = 4096);
 		void BeginStore();
 		void Store(const entities::Transform& t, int idx);
 		void Store(const entities::Transform& t);
+		/// <summary>
+		/// Copies the changed ranges from the upload ring and leaves the buffer ready for the shaders.
+		/// </summary>
 		void EndStore(Microsoft::WRL::ComPtr<ID3D12GraphicsCommandList> commandList);
+		/// <summary>
+		/// Changes when the buffer grows, get it after EndStore.
+		/// </summary>
 		Microsoft::WRL::ComPtr<ID3D12DescriptorHeap> DescriptorHeap() {
 			return srvHeap;
 		}
+		UINT Capacity()const { return capacity; }
 	private:
+		/// <summary>
+		/// Keeps the matrix and marks it dirty if it's not what the gpu alredy has.
+		/// </summary>
+		void Write(int idx, DirectX::FXMMATRIX modelMatrix);
+		/// <summary>
+		/// The buffer and its view for newCapacity matrices, the old ones are released later.
+		/// </summary>
+		void CreateBuffer(UINT newCapacity);
+		DxContext& ctx;
 		int cursor = INT_MAX;
+		UINT capacity = 0;
+		//one past the highest index stored
+		UINT used = 0;
 		Microsoft::WRL::ComPtr<ID3D12Resource> structuredBuffer;
 		//Shader Resource View heap
 		Microsoft::WRL::ComPtr<ID3D12DescriptorHeap> srvHeap;
-		//staging buffer resource
-		Microsoft::WRL::ComPtr<ID3D12Resource> uploadBuffer;
-		//maps the uploadBuffer
-		void* mappedData;
+		//the staging memory comes from here
+		std::shared_ptr<common::UploadRing> uploadRing;
+		//what the gpu buffer has, after the copies of the last EndStore
+		std::vector<DirectX::XMFLOAT4X4> matrices;
+		//a few clean matrices between two changes are copied too, it saves a copy
+		common::DirtyRanges dirty{ 4 };
 
 	};
 }
@@ -10,13 +10,8 @@ rtt::OffscreenRTV::OffscreenRTV(int w, int h, DxContext& context)
 		context.SampleCount(), context.QualityLevels(), context.Device(),
 		{1.0f,0,0,1}
 	);
-	common::RunCommands(context.Device().Get(), context.CommandQueue().Get(), [this](ComPtr<ID3D12GraphicsCommandList> commandList) {
-		CD3DX12_RESOURCE_BARRIER x = CD3DX12_RESOURCE_BARRIER::Transition(
-			renderTargetTexture.Get(),
-			D3D12_RESOURCE_STATE_COMMON,  // Previous state
-			D3D12_RESOURCE_STATE_RENDER_TARGET);
-		commandList->ResourceBarrier(1, &x);
-		});
+	//it's used as render target from the first frame on, textures don't decay to common
+	context.UploadBatch()->Transition(renderTargetTexture.Get(), D3D12_RESOURCE_STATE_RENDER_TARGET);
 	//Define the RTV heap description for the offscreen rendering image
 	D3D12_DESCRIPTOR_HEAP_DESC rtvHeapDesc = {};
 	rtvHeapDesc.NumDescriptors = 1;
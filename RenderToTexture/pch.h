@@ -22,10 +22,24 @@
 #include <map>
 #include <unordered_map>
 #include <filesystem>
+#include <algorithm>
 #include <entt/entt.hpp>
 
 #include "../Common/vertex.h"
 constexpr int FRAMEBUFFER_COUNT = 2;
 constexpr bool FULLSCREEN = false;
+//prints cold (assimp) vs warm (cooked) mesh load times at startup
+constexpr bool BENCHMARK_MESH_LOAD = false;
+//uploads the meshes as common::PackedVertex (16 bytes) instead of common::Vertex (32 bytes)
+constexpr bool PACKED_VERTICES = false;
+//culls the meshlets of single instance meshes against the camera on the cpu before drawing them
+constexpr bool MESHLET_CULLING = true;
+//frames presented but not finished by the gpu, fewer is less input latency
+constexpr uint32_t MAX_QUEUED_FRAMES = 2;
+//caps the frame rate, sleeping between the frames. 0 doesn't cap it
+constexpr double TARGET_FPS = 0.0;
+//the draws are recorded in many command lists at once only if each list gets at least this many
+constexpr size_t MIN_DRAWS_PER_COMMAND_LIST = 64;
+constexpr common::VertexFormat meshVertexFormat = PACKED_VERTICES ? common::VertexFormat::Packed : common::VertexFormat::Full;
 
 constexpr DXGI_FORMAT offscreenImageFormat = DXGI_FORMAT_R8G8B8A8_UNORM;
@@ -1,7 +1,6 @@
 #include "presentation_pipeline.h"
 #include "../Common/d3d_utils.h"
 #include "../Common/mesh.h"
-#include "../Common/mesh_load.h"
 #include "../Common/input_layout_service.h"
 using Microsoft::WRL::ComPtr;
 
@@ -13,18 +12,13 @@ struct QuadVertex {
 
 
 rtt::PresentationPipeline::PresentationPipeline(Microsoft::WRL::ComPtr<ID3D12Device> device,
-    Microsoft::WRL::ComPtr<ID3D12CommandQueue> commandQueue,
+    std::shared_ptr<common::Mesh> plane,
     Microsoft::WRL::ComPtr<ID3D12RootSignature> rootSignature,
     UINT sampleCount,
     UINT quality)
+    :plane(plane)
 {
-    std::string assetFolder = "assets/";
-    std::stringstream ss;
-    ss << assetFolder << "plane.glb";
-    std::string path = ss.str();
-    common::MeshData planeMeshData = common::LoadMeshes(path.c_str())[0];
-    plane = std::make_unique<common::Mesh>(planeMeshData,
-        device, commandQueue);
+    assert(this->plane != nullptr && this->plane->GetVertexFormat() == common::VertexFormat::Full);
     CreatePipeline(rootSignature, device, sampleCount, quality);
     CreateSampler(device);
 }
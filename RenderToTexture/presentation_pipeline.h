@@ -6,9 +6,13 @@ namespace rtt
 	class PresentationPipeline
 	{
 	public:
+		/// <summary>
+		/// plane is the quad where the offscreen image goes, it must use VertexFormat::Full.
+		/// It's loaded by the caller so that it can be parsed together with the other assets.
+		/// </summary>
 		PresentationPipeline(
 			Microsoft::WRL::ComPtr<ID3D12Device> device,
-			Microsoft::WRL::ComPtr<ID3D12CommandQueue> commandQueue,
+			std::shared_ptr<common::Mesh> plane,
 			Microsoft::WRL::ComPtr<ID3D12RootSignature> rootSignature,
 			UINT sampleCount,
 			UINT quality);
@@ -21,7 +25,7 @@ namespace rtt
 		void Draw(Microsoft::WRL::ComPtr<ID3D12GraphicsCommandList> commandList);
 	private:
 
-		std::unique_ptr<common::Mesh> plane;
+		std::shared_ptr<common::Mesh> plane;
 		void CreatePipeline(Microsoft::WRL::ComPtr<ID3D12RootSignature> rootSignature,
 			Microsoft::WRL::ComPtr<ID3D12Device> device,
 			UINT sampleCount,
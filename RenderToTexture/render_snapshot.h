@@ -0,0 +1,21 @@
+#pragma once
+#include "pch.h"
+#include "entities.h"
+#include "camera.h"
+namespace rtt
+{
+	/// <summary>
+	/// What the render needs from the simulation to draw a frame, the simulation thread writes it
+	/// and the render thread reads it. The vectors are cleared and filled again, not remade, so
+	/// after the first frames they don't allocate.
+	/// </summary>
+	struct RenderSnapshot
+	{
+		Camera camera;
+		//the cubes' transforms, grouped by the lod they're drawn with
+		std::vector<std::vector<entities::Transform>> cubesPerLod;
+		std::vector<entities::Transform> monkeys;
+		//all the monkeys use the lod of the last one
+		uint32_t monkeyLod = 0;
+	};
+}
@@ -0,0 +1,109 @@
+#include "pch.h"
+#include "bounds.h"
+#include "check.h"
+#include <cmath>
+#include <random>
+
+using namespace DirectX;
+
+namespace
+{
+    float Distance(const XMFLOAT3& a, const XMFLOAT3& b)
+    {
+        const float x = a.x - b.x, y = a.y - b.y, z = a.z - b.z;
+        return std::sqrt(x * x + y * y + z * z);
+    }
+    /// <summary>
+    /// Every point in the box and in the sphere, and the box touches the points on every side.
+    /// </summary>
+    void CheckContains(const common::MeshBounds& b, const std::vector<XMFLOAT3>& points)
+    {
+        XMFLOAT3 min = points[0], max = points[0];
+        for (const XMFLOAT3& p : points)
+        {
+            CHECK(p.x >= b.aabbMin.x && p.y >= b.aabbMin.y && p.z >= b.aabbMin.z);
+            CHECK(p.x <= b.aabbMax.x && p.y <= b.aabbMax.y && p.z <= b.aabbMax.z);
+            //a relative epsilon for the float error of the sphere growth
+            CHECK(Distance(p, b.sphereCenter) <= b.sphereRadius * 1.0001f);
+            min = { (std::min)(min.x, p.x), (std::min)(min.y, p.y), (std::min)(min.z, p.z) };
+            max = { (std::max)(max.x, p.x), (std::max)(max.y, p.y), (std::max)(max.z, p.z) };
+        }
+        CHECK(b.aabbMin.x == min.x && b.aabbMin.y == min.y && b.aabbMin.z == min.z);
+        CHECK(b.aabbMax.x == max.x && b.aabbMax.y == max.y && b.aabbMax.z == max.z);
+    }
+
+    void PointsOnASphere()
+    {
+        //radius 2 around (5, 0, 0): the minimal sphere is known
+        std::mt19937 random(1);
+        std::normal_distribution<float> gaussian;
+        std::vector<XMFLOAT3> points;
+        for (size_t i = 0; i < 20000; i++)
+        {
+            const float x = gaussian(random), y = gaussian(random), z = gaussian(random);
+            const float length = std::sqrt(x * x + y * y + z * z);
+            points.push_back({ 5 + x / length * 2, y / length * 2, z / length * 2 });
+        }
+        const common::MeshBounds b = common::ComputeMeshBounds(points);
+        CheckContains(b, points);
+        //Ritter's is within a few percent of the minimal sphere
+        CHECK(b.sphereRadius <= 2 * 1.05f);
+        CHECK(Distance(b.sphereCenter, { 5, 0, 0 }) < 0.1f);
+    }
+
+    void LongBoxesGetATightSphere()
+    {
+        //a 20 x 2 x 2 box: the sphere around the box center has radius sqrt(102) = 10.1, the
+        //minimal one is about the same, what matters is that it isn't much bigger
+        std::mt19937 random(2);
+        std::uniform_real_distribution<float> unit(-1, 1);
+        std::vector<XMFLOAT3> points;
+        for (size_t i = 0; i < 20000; i++)
+            points.push_back({ unit(random) * 10, unit(random), unit(random) });
+        const common::MeshBounds b = common::ComputeMeshBounds(points);
+        CheckContains(b, points);
+        CHECK(b.sphereRadius <= std::sqrt(102.0f) * 1.01f);
+    }
+
+    void ClusteredPointsUseTheAabbSphereIfSmaller()
+    {
+        //the corners of a cube: the sphere of the box is the minimal one
+        std::vector<XMFLOAT3> points;
+        for (int i = 0; i < 8; i++)
+            points.push_back({ i & 1 ? 1.0f : -1.0f, i & 2 ? 1.0f : -1.0f, i & 4 ? 1.0f : -1.0f });
+        const common::MeshBounds b = common::ComputeMeshBounds(points);
+        CheckContains(b, points);
+        CHECK(std::fabs(b.sphereRadius - std::sqrt(3.0f)) < 1e-4f);
+        CHECK(Distance(b.sphereCenter, { 0, 0, 0 }) < 1e-4f);
+    }
+
+    void DegenerateInputs()
+    {
+        //empty: everything at the origin
+        const common::MeshBounds empty = common::ComputeMeshBounds(nullptr, 0);
+        CHECK(empty.sphereRadius == 0);
+        CHECK(empty.aabbMin.x == 0 && empty.aabbMax.x == 0 && empty.sphereCenter.x == 0);
+        //one point
+        const std::vector<XMFLOAT3> one = { { 3, -4, 5 } };
+        const common::MeshBounds single = common::ComputeMeshBounds(one);
+        CheckContains(single, one);
+        CHECK(single.sphereRadius == 0);
+        //counts that are not a multiple of the 4 wide loop
+        for (size_t count = 1; count < 10; count++)
+        {
+            std::vector<XMFLOAT3> points;
+            for (size_t i = 0; i < count; i++)
+                points.push_back({ float(i), -float(i) * 2, float(i % 3) });
+            CheckContains(common::ComputeMeshBounds(points), points);
+        }
+    }
+}
+
+int main()
+{
+    PointsOnASphere();
+    LongBoxesGetATightSphere();
+    ClusteredPointsUseTheAabbSphereIfSmaller();
+    DegenerateInputs();
+    return 0;
+}
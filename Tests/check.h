@@ -0,0 +1,16 @@
+#pragma once
+#include <cstdio>
+#include <cstdlib>
+/// <summary>
+/// Stops the test at the first condition that doesn't hold, with its file and line. The tests
+/// are plain executables, ctest takes a non zero exit code as a failure.
+/// </summary>
+#define CHECK(condition) \
+	do \
+	{ \
+		if (!(condition)) \
+		{ \
+			std::fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #condition); \
+			std::exit(1); \
+		} \
+	} while (false)
@@ -0,0 +1,210 @@
+#include "pch.h"
+#include "basic_command_recorder.h"
+#include "check.h"
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+
+using common::ThreadPool;
+
+namespace
+{
+    /// <summary>
+    /// A command list that keeps what was recorded in it. An allocator can't be used by two threads
+    /// at once, the list remembers the threads that recorded in it to check it.
+    /// </summary>
+    struct StandInList
+    {
+        std::vector<std::string> commands;
+        bool open = false;
+        int allocator = -1;
+        std::vector<std::thread::id> threads;
+        void Add(std::string command)
+        {
+            CHECK(open);
+            if (threads.empty() || threads.back() != std::this_thread::get_id())
+                threads.push_back(std::this_thread::get_id());
+            commands.push_back(std::move(command));
+        }
+    };
+    struct StandInRecording
+    {
+        using Allocator = std::shared_ptr<int>;
+        using List = std::shared_ptr<StandInList>;
+        std::shared_ptr<int> allocators = std::make_shared<int>(0);
+        //what the queue executed, in order
+        std::shared_ptr<std::vector<std::string>> executed = std::make_shared<std::vector<std::string>>();
+        std::shared_ptr<int> executeCalls = std::make_shared<int>(0);
+
+        Allocator CreateAllocator() { return std::make_shared<int>((*allocators)++); }
+        List CreateList(const Allocator&) { return std::make_shared<StandInList>(); }
+        void Reset(const Allocator& allocator, const List& list)
+        {
+            CHECK(!list->open);
+            list->commands.clear();
+            list->threads.clear();
+            list->open = true;
+            list->allocator = *allocator;
+        }
+        void Close(const List& list)
+        {
+            CHECK(list->open);
+            list->open = false;
+        }
+        void Execute(const std::vector<List>& lists)
+        {
+            (*executeCalls)++;
+            for (const List& list : lists)
+            {
+                CHECK(!list->open);
+                //one thread at a time recorded in it
+                CHECK(list->threads.size() <= 1);
+                executed->insert(executed->end(), list->commands.begin(), list->commands.end());
+            }
+        }
+    };
+    using Recorder = common::BasicCommandRecorder<StandInRecording>;
+
+    void Setup(const StandInRecording::List& list) { list->Add("setup"); }
+    void Draw(const StandInRecording::List& list, size_t i) { list->Add(std::to_string(i)); }
+
+    /// <summary>
+    /// The draws of the frame have to execute in order, each list of RecordParallel after its setup.
+    /// </summary>
+    void CheckFrame(const std::vector<std::string>& executed, size_t draws)
+    {
+        CHECK(executed.front() == "begin" && executed.back() == "end");
+        size_t next = 0;
+        bool setUp = false;
+        for (size_t i = 1; i + 1 < executed.size(); i++)
+        {
+            if (executed[i] == "setup")
+            {
+                setUp = true;
+                continue;
+            }
+            CHECK(setUp);
+            CHECK(std::stoul(executed[i]) == next);
+            next++;
+        }
+        CHECK(next == draws);
+    }
+
+    void ParallelRecordingKeepsTheOrder()
+    {
+        StandInRecording backend;
+        auto pool = std::make_shared<ThreadPool>(3);
+        Recorder recorder(backend, 2, pool, 10);
+        for (uint32_t frame = 0; frame < 6; frame++)
+        {
+            backend.executed->clear();
+            recorder.BeginFrame(frame % 2);
+            recorder.Current()->Add("begin");
+            const size_t draws = 1000 + frame;
+            recorder.RecordParallel(draws, Setup, Draw);
+            recorder.Current()->Add("end");
+            recorder.Submit();
+            CheckFrame(*backend.executed, draws);
+            //the list before, one per thread and the calling thread's, and the one after
+            CHECK(recorder.LastListCount() == 1 + 4 + 1);
+            CHECK(*backend.executeCalls == int(frame + 1));
+        }
+        //the pools of the two frames grew once, then they were reused
+        CHECK(recorder.ListCount() == 2 * 6);
+        CHECK(*backend.allocators == 2 * 6);
+    }
+
+    void SmallRunsStayInTheCurrentList()
+    {
+        StandInRecording backend;
+        auto pool = std::make_shared<ThreadPool>(3);
+        Recorder recorder(backend, 1, pool, 64);
+        CHECK(recorder.ListsFor(0) == 1 && recorder.ListsFor(64) == 1);
+        CHECK(recorder.ListsFor(65) == 2 && recorder.ListsFor(64 * 3) == 3);
+        //never more lists than the threads that record them
+        CHECK(recorder.ListsFor(64 * 100) == 4);
+        recorder.BeginFrame(0);
+        recorder.Current()->Add("begin");
+        recorder.RecordParallel(5, Setup, Draw);
+        recorder.Current()->Add("end");
+        recorder.Submit();
+        CheckFrame(*backend.executed, 5);
+        CHECK(recorder.LastListCount() == 1);
+        //without a pool everything is on the calling thread
+        Recorder serial(StandInRecording{}, 1, nullptr, 1);
+        CHECK(serial.ListsFor(1000) == 1);
+    }
+
+    void ListsAreResetWhenTheFrameComesBack()
+    {
+        StandInRecording backend;
+        auto pool = std::make_shared<ThreadPool>(2);
+        Recorder recorder(backend, 2, pool, 1);
+        std::vector<StandInRecording::List> frameZero;
+        recorder.BeginFrame(0);
+        frameZero.push_back(recorder.Current());
+        recorder.RecordParallel(3, Setup, Draw);
+        frameZero.push_back(recorder.Current());
+        recorder.Submit();
+        //frame 1 has its own lists, frame 0's are still the gpu's
+        recorder.BeginFrame(1);
+        for (const StandInRecording::List& list : frameZero)
+            CHECK(list != recorder.Current());
+        recorder.Submit();
+        CHECK(frameZero[1]->commands == std::vector<std::string>{ "setup" });
+        //back to frame 0: its lists again, in the same order, reset before they are recorded
+        recorder.BeginFrame(0);
+        CHECK(recorder.Current() == frameZero[0]);
+        recorder.RecordParallel(3, [](const StandInRecording::List&) {}, Draw);
+        CHECK(recorder.Current() == frameZero[1]);
+        CHECK(recorder.Current()->commands.empty());
+        recorder.Submit();
+        //frame 0: the first list, the three ranges and the one after; frame 1 only recorded in one
+        CHECK(recorder.ListCount() == 5 + 1);
+    }
+
+    void AThrowingRangeIsThrownByRecordParallel()
+    {
+        StandInRecording backend;
+        auto pool = std::make_shared<ThreadPool>(3);
+        Recorder recorder(backend, 1, pool, 10);
+        recorder.BeginFrame(0);
+        bool threw = false;
+        try
+        {
+            recorder.RecordParallel(100, Setup, [](const StandInRecording::List& list, size_t i) {
+                if (i == 77)
+                    throw std::runtime_error("draw 77");
+                Draw(list, i);
+            });
+        }
+        catch (const std::runtime_error& e)
+        {
+            threw = std::string(e.what()) == "draw 77";
+        }
+        CHECK(threw);
+        //the ranges are dropped, the recorder goes on with what was before and after them
+        recorder.Current()->Add("end");
+        recorder.Submit();
+        CHECK((*backend.executed == std::vector<std::string>{ "setup", "end" }));
+        CHECK(recorder.LastListCount() == 2);
+        //and the lists of the ranges were closed, they can be reset the next time
+        recorder.BeginFrame(0);
+        recorder.Current()->Add("begin");
+        backend.executed->clear();
+        recorder.RecordParallel(100, Setup, Draw);
+        recorder.Current()->Add("end");
+        recorder.Submit();
+        CheckFrame(*backend.executed, 100);
+    }
+}
+
+int main()
+{
+    ParallelRecordingKeepsTheOrder();
+    SmallRunsStayInTheCurrentList();
+    ListsAreResetWhenTheFrameComesBack();
+    AThrowingRangeIsThrownByRecordParallel();
+    return 0;
+}
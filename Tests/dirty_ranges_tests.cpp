@@ -0,0 +1,117 @@
+#include "pch.h"
+#include "dirty_ranges.h"
+#include "check.h"
+#include <algorithm>
+#include <random>
+
+using common::DirtyRanges;
+
+namespace common
+{
+    //for the comparisons of the vectors, where std::equal looks for it
+    bool operator==(const DirtyRanges::Range& a, const DirtyRanges::Range& b)
+    {
+        return a.first == b.first && a.count == b.count;
+    }
+}
+
+namespace
+{
+    void InOrderMarksGrowOneRange()
+    {
+        DirtyRanges dirty;
+        CHECK(dirty.IsEmpty() && dirty.Take().empty());
+        for (uint32_t i = 10; i < 20; i++)
+            dirty.Mark(i);
+        dirty.Mark(20, 5);
+        //nothing marked
+        dirty.Mark(100, 0);
+        CHECK((dirty.Take() == std::vector<DirtyRanges::Range>{ { 10, 15 } }));
+        CHECK(dirty.IsEmpty());
+    }
+
+    void RangesAreSortedAndJoined()
+    {
+        DirtyRanges dirty;
+        dirty.Mark(50, 10);
+        dirty.Mark(0, 5);
+        //overlaps the first one
+        dirty.Mark(55, 10);
+        //touches the end of the second one
+        dirty.Mark(5);
+        dirty.Mark(30);
+        CHECK((dirty.Take() == std::vector<DirtyRanges::Range>{ { 0, 6 }, { 30, 1 }, { 50, 15 } }));
+        //inside another range
+        dirty.Mark(0, 100);
+        dirty.Mark(10, 5);
+        CHECK((dirty.Take() == std::vector<DirtyRanges::Range>{ { 0, 100 } }));
+        dirty.Mark(1);
+        dirty.Clear();
+        CHECK(dirty.Take().empty());
+    }
+
+    void SmallGapsAreMerged()
+    {
+        DirtyRanges dirty(3);
+        dirty.Mark(0);
+        dirty.Mark(4);
+        //4 clean elements before it
+        dirty.Mark(9);
+        CHECK((dirty.Take() == std::vector<DirtyRanges::Range>{ { 0, 5 }, { 9, 1 } }));
+        //the last elements of the buffer don't overflow
+        dirty.Mark(UINT32_MAX - 1);
+        dirty.Mark(UINT32_MAX - 5, 2);
+        CHECK((dirty.Take() == std::vector<DirtyRanges::Range>{ { UINT32_MAX - 5, 5 } }));
+    }
+
+    /// <summary>
+    /// Random marks against a vector of flags: the ranges cover every marked element, are sorted
+    /// and apart by more than the gap, and don't cover more than the gaps they joined.
+    /// </summary>
+    void RandomMarksAreCovered()
+    {
+        std::mt19937 random(3);
+        for (uint32_t gap = 0; gap < 4; gap++)
+        {
+            for (int round = 0; round < 200; round++)
+            {
+                const uint32_t size = 1 + random() % 500;
+                std::vector<bool> marked(size, false);
+                DirtyRanges dirty(gap);
+                for (int i = 0, n = random() % 50; i < n; i++)
+                {
+                    const uint32_t first = random() % size;
+                    const uint32_t count = (std::min)(uint32_t(random() % 8), size - first);
+                    dirty.Mark(first, count);
+                    for (uint32_t j = first; j < first + count; j++)
+                        marked[j] = true;
+                }
+                std::vector<bool> covered(size, false);
+                uint64_t previousEnd = 0;
+                bool first = true;
+                for (const DirtyRanges::Range& r : dirty.Take())
+                {
+                    CHECK(r.count > 0 && r.first + r.count <= size);
+                    CHECK(first || r.first > previousEnd + gap);
+                    //the ranges start and end on marked elements
+                    CHECK(marked[r.first] && marked[r.first + r.count - 1]);
+                    for (uint32_t j = r.first; j < r.first + r.count; j++)
+                        covered[j] = true;
+                    previousEnd = r.first + r.count;
+                    first = false;
+                }
+                for (uint32_t j = 0; j < size; j++)
+                    CHECK(!marked[j] || covered[j]);
+            }
+        }
+    }
+}
+
+int main()
+{
+    InOrderMarksGrowOneRange();
+    RangesAreSortedAndJoined();
+    SmallGapsAreMerged();
+    RandomMarksAreCovered();
+    return 0;
+}
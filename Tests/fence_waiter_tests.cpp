@@ -0,0 +1,269 @@
+#include "pch.h"
+#include "basic_fence_waiter.h"
+#include "check.h"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+
+namespace
+{
+    /// <summary>
+    /// Auto reset events on a condition variable, all of them on one so that WaitAny can wait.
+    /// </summary>
+    struct FakeEvent
+    {
+        bool set = false;
+    };
+    std::atomic<int> gLiveEvents{ 0 };
+    std::mutex gEventMutex;
+    std::condition_variable gEventChanged;
+    struct FakeEvents
+    {
+        using Event = FakeEvent*;
+        static Event Create()
+        {
+            gLiveEvents++;
+            return new FakeEvent;
+        }
+        static void Destroy(Event e)
+        {
+            gLiveEvents--;
+            delete e;
+        }
+        static void Set(Event e)
+        {
+            {
+                std::lock_guard<std::mutex> lock(gEventMutex);
+                e->set = true;
+            }
+            gEventChanged.notify_all();
+        }
+        static void Wait(Event e)
+        {
+            std::unique_lock<std::mutex> lock(gEventMutex);
+            gEventChanged.wait(lock, [e]() { return e->set; });
+            e->set = false;
+        }
+        static size_t WaitAny(const Event* events, size_t count)
+        {
+            std::unique_lock<std::mutex> lock(gEventMutex);
+            size_t signaled = count;
+            gEventChanged.wait(lock, [&]() {
+                for (size_t i = 0; i < count && signaled == count; i++)
+                    if (events[i]->set)
+                        signaled = i;
+                return signaled < count;
+            });
+            events[signaled]->set = false;
+            return signaled;
+        }
+    };
+    /// <summary>
+    /// Like ID3D12Fence: an event registered for a value is set when Signal gets there, once.
+    /// </summary>
+    struct FakeFence
+    {
+        std::mutex mutex;
+        uint64_t value = 0;
+        std::vector<std::pair<uint64_t, FakeEvent*>> registered;
+        uint64_t GetCompletedValue()
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            return value;
+        }
+        void SetEventOnCompletion(uint64_t target, FakeEvent* e)
+        {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                if (value < target)
+                {
+                    registered.push_back({ target, e });
+                    return;
+                }
+            }
+            FakeEvents::Set(e);
+        }
+        void Signal(uint64_t target)
+        {
+            std::vector<FakeEvent*> reached;
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                value = target;
+                for (auto it = registered.begin(); it != registered.end(); )
+                {
+                    if (it->first <= target)
+                    {
+                        reached.push_back(it->second);
+                        it = registered.erase(it);
+                    }
+                    else
+                        ++it;
+                }
+            }
+            for (FakeEvent* e : reached)
+                FakeEvents::Set(e);
+        }
+        size_t RegisteredCount()
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            return registered.size();
+        }
+        /// <summary>
+        /// Signals from another thread once someone waits for it, so the wait really blocks.
+        /// </summary>
+        std::thread SignalWhenWaited(uint64_t target)
+        {
+            return std::thread([this, target]() {
+                while (RegisteredCount() == 0)
+                    std::this_thread::yield();
+                Signal(target);
+            });
+        }
+    };
+    using Waiter = common::BasicFenceWaiter<FakeFence, FakeEvents>;
+
+    /// <summary>
+    /// Waits for condition for a few seconds, for the callbacks that run on the waiter's thread.
+    /// </summary>
+    template<typename Condition>
+    bool Eventually(Condition condition)
+    {
+        for (int i = 0; i < 5000 && !condition(); i++)
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        return condition();
+    }
+
+    void CompletedFencesNeedNoEvent()
+    {
+        Waiter waiter;
+        FakeFence a, b;
+        a.Signal(5);
+        b.Signal(5);
+        waiter.Wait(&a, 5);
+        waiter.WaitAll({ { &a, 3 }, { &b, 5 } });
+        CHECK(waiter.WaitAny({ { &a, 9 }, { &b, 4 } }) == 1);
+        CHECK(waiter.EventCount() == 0);
+    }
+
+    void WaitsReuseTheEvents()
+    {
+        Waiter waiter;
+        FakeFence fence;
+        for (uint64_t value = 1; value <= 20; value++)
+        {
+            std::thread signaler = fence.SignalWhenWaited(value);
+            waiter.Wait(&fence, value);
+            CHECK(fence.GetCompletedValue() >= value);
+            signaler.join();
+        }
+        //one wait at a time, one event for all of them
+        CHECK(waiter.EventCount() == 1);
+    }
+
+    void WaitAllWaitsForEveryFence()
+    {
+        Waiter waiter;
+        FakeFence a, b;
+        //b gets there first, a later: returning on the first one would be wrong
+        std::thread signaler([&a, &b]() {
+            while (a.RegisteredCount() == 0 || b.RegisteredCount() == 0)
+                std::this_thread::yield();
+            b.Signal(2);
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+            a.Signal(1);
+        });
+        waiter.WaitAll({ { &a, 1 }, { &b, 2 } });
+        CHECK(a.GetCompletedValue() >= 1 && b.GetCompletedValue() >= 2);
+        signaler.join();
+        CHECK(waiter.EventCount() == 2);
+    }
+
+    void WaitAnyAndStaleEvents()
+    {
+        Waiter waiter;
+        FakeFence a, b, c, d;
+        std::thread signaler = a.SignalWhenWaited(3);
+        //b doesn't get there, its registration stays in b with an event that goes back to the pool
+        CHECK(waiter.WaitAny({ { &b, 100 }, { &a, 3 } }) == 1);
+        signaler.join();
+        CHECK(waiter.EventCount() == 2);
+        //now the old registration fires, and sets an event that is free in the pool
+        b.Signal(100);
+        //a wait that takes both events wakes up early on that one, it has to check the fence again
+        signaler = std::thread([&c, &d]() {
+            while (c.RegisteredCount() == 0 || d.RegisteredCount() == 0)
+                std::this_thread::yield();
+            c.Signal(1);
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+            d.Signal(1);
+        });
+        waiter.WaitAll({ { &c, 1 }, { &d, 1 } });
+        CHECK(c.GetCompletedValue() == 1 && d.GetCompletedValue() == 1);
+        signaler.join();
+        CHECK(waiter.EventCount() == 2);
+    }
+
+    void CallbacksRunInOrder()
+    {
+        Waiter waiter;
+        FakeFence fence;
+        std::mutex mutex;
+        std::vector<int> order;
+        auto record = [&mutex, &order](int id) {
+            return [&mutex, &order, id]() {
+                std::lock_guard<std::mutex> lock(mutex);
+                order.push_back(id);
+            };
+        };
+        auto count = [&mutex, &order]() {
+            std::lock_guard<std::mutex> lock(mutex);
+            return order.size();
+        };
+        //ready together: in the order they were added, whatever the values
+        waiter.OnCompletion(&fence, 3, record(0));
+        waiter.OnCompletion(&fence, 1, record(1));
+        waiter.OnCompletion(&fence, 2, record(2));
+        waiter.OnCompletion(&fence, 1, record(3));
+        CHECK(waiter.PendingCallbacks() == 4);
+        fence.Signal(3);
+        CHECK(Eventually([&]() { return count() == 4; }));
+        CHECK((order == std::vector<int>{ 0, 1, 2, 3 }));
+        //ready one after the other: in the order the fence gets there
+        waiter.OnCompletion(&fence, 5, record(4));
+        waiter.OnCompletion(&fence, 4, record(5));
+        fence.Signal(4);
+        CHECK(Eventually([&]() { return count() == 5; }));
+        fence.Signal(5);
+        CHECK(Eventually([&]() { return count() == 6; }));
+        CHECK(order[4] == 5 && order[5] == 4);
+        //alredy there: runs anyway
+        waiter.OnCompletion(&fence, 1, record(6));
+        CHECK(Eventually([&]() { return count() == 7; }));
+        CHECK(waiter.PendingCallbacks() == 0);
+    }
+
+    void DestroyingDropsThePendingCallbacks()
+    {
+        bool ran = false;
+        FakeFence fence;
+        {
+            Waiter waiter;
+            waiter.OnCompletion(&fence, 1, [&ran]() { ran = true; });
+            CHECK(waiter.PendingCallbacks() == 1);
+        }
+        CHECK(!ran);
+    }
+}
+
+int main()
+{
+    CompletedFencesNeedNoEvent();
+    WaitsReuseTheEvents();
+    WaitAllWaitsForEveryFence();
+    WaitAnyAndStaleEvents();
+    CallbacksRunInOrder();
+    DestroyingDropsThePendingCallbacks();
+    //every event made by a waiter was destroyed with it
+    CHECK(gLiveEvents == 0);
+    return 0;
+}
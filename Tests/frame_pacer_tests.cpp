@@ -0,0 +1,297 @@
+#include "pch.h"
+#include "frame_pacer.h"
+#include "check.h"
+#include <algorithm>
+#include <cmath>
+
+using common::FramePacer;
+
+namespace
+{
+    /// <summary>
+    /// Time only moves when the pacer sleeps or spins, or when the test says so: a wait that
+    /// doesn't go through the clock never ends.
+    /// </summary>
+    class SimulatedClock final : public FramePacer::Clock
+    {
+    public:
+        explicit SimulatedClock(double oversleep)
+            :mOversleep(oversleep)
+        {
+        }
+        double Now() override { return time; }
+        void Sleep(double seconds) override
+        {
+            sleeps++;
+            time += seconds + mOversleep;
+        }
+        void Spin() override
+        {
+            spins++;
+            time += SPIN_STEP;
+        }
+        static constexpr double SPIN_STEP = 1e-5;
+        double time = 0.0;
+        size_t sleeps = 0;
+        size_t spins = 0;
+    private:
+        //the sleeps end a bit late, like the os ones
+        const double mOversleep;
+    };
+    /// <summary>
+    /// Runs the presented frames one after the other, each for frameTime after it was presented
+    /// and the one before it finished.
+    /// </summary>
+    struct SimulatedGpu
+    {
+        SimulatedGpu(SimulatedClock& clock, double frameTime)
+            :clock(clock), frameTime(frameTime)
+        {
+        }
+        SimulatedClock& clock;
+        double frameTime;
+        //fence value and when it's done
+        std::deque<std::pair<uint64_t, double>> frames;
+        uint64_t completed = 0;
+        double lastFinish = 0.0;
+
+        uint64_t Completed()
+        {
+            while (!frames.empty() && frames.front().second <= clock.time)
+            {
+                completed = frames.front().first;
+                frames.pop_front();
+            }
+            return completed;
+        }
+        void WaitFor(uint64_t value)
+        {
+            while (completed < value)
+            {
+                clock.time = (std::max)(clock.time, frames.front().second);
+                completed = frames.front().first;
+                frames.pop_front();
+            }
+        }
+        void Submit(uint64_t value)
+        {
+            lastFinish = (std::max)(clock.time, lastFinish) + frameTime;
+            frames.push_back({ value, lastFinish });
+        }
+        /// <summary>
+        /// Frames presented and not finished at the current time.
+        /// </summary>
+        size_t InFlight()const
+        {
+            return std::count_if(frames.begin(), frames.end(),
+                [this](const std::pair<uint64_t, double>& f) { return f.second > clock.time; });
+        }
+        FramePacer::Queue Queue()
+        {
+            return { [this]() { return Completed(); }, [this](uint64_t value) { WaitFor(value); } };
+        }
+    };
+
+    /// <summary>
+    /// A frame: the pacer's wait, cpuTime of work, the present.
+    /// </summary>
+    void Frame(FramePacer& pacer, SimulatedClock& clock, SimulatedGpu& gpu, uint64_t fenceValue, double cpuTime)
+    {
+        pacer.BeginFrame();
+        clock.time += cpuTime;
+        gpu.Submit(fenceValue);
+        pacer.Presented(fenceValue);
+    }
+
+    void QueuedFramesAreLimited()
+    {
+        for (uint32_t limit = 1; limit <= 3; limit++)
+        {
+            auto clock = std::make_shared<SimulatedClock>(0.0);
+            SimulatedGpu gpu{ *clock, 0.020 };
+            FramePacer::Settings settings;
+            settings.maxQueuedFrames = limit;
+            FramePacer pacer(settings, gpu.Queue(), clock);
+            for (uint64_t f = 1; f <= 100; f++)
+            {
+                pacer.BeginFrame();
+                //room for this frame: the gpu has fewer than the limit
+                CHECK(gpu.InFlight() < limit);
+                clock->time += 0.001;
+                gpu.Submit(f);
+                pacer.Presented(f);
+                CHECK(pacer.QueuedFrames() <= limit);
+            }
+            const FramePacer::Stats& stats = pacer.GetStats();
+            if (limit == 1)
+            {
+                //nothing overlaps: the cpu waits for each frame
+                CHECK(std::fabs(stats.frameTime - 0.021) < 1e-9);
+            }
+            else
+            {
+                //the gpu is the limit, the cpu waits the rest of the time
+                CHECK(std::fabs(stats.frameTime - 0.020) < 1e-9);
+                CHECK(std::fabs(stats.queueWait - 0.019) < 1e-9);
+            }
+            CHECK(stats.rateWait == 0.0);
+        }
+    }
+
+    void NoLimitNeverWaitsForTheGpu()
+    {
+        auto clock = std::make_shared<SimulatedClock>(0.0);
+        SimulatedGpu gpu{ *clock, 0.020 };
+        FramePacer::Settings settings;
+        settings.maxQueuedFrames = 0;
+        FramePacer pacer(settings, gpu.Queue(), clock);
+        for (uint64_t f = 1; f <= 50; f++)
+            Frame(pacer, *clock, gpu, f, 0.001);
+        CHECK(pacer.GetStats().queueWait == 0.0);
+        CHECK(gpu.InFlight() > 40);
+    }
+
+    void FrameRateIsCapped()
+    {
+        //sleeps that end 0.5ms late, less than the spin time: the spin makes up for them
+        auto clock = std::make_shared<SimulatedClock>(0.0005);
+        SimulatedGpu gpu{ *clock, 0.005 };
+        FramePacer::Settings settings;
+        settings.targetFps = 60.0;
+        settings.spinTime = 0.002;
+        FramePacer pacer(settings, gpu.Queue(), clock);
+        const double interval = 1.0 / 60.0;
+        pacer.BeginFrame();
+        const double first = clock->time;
+        for (uint64_t f = 1; f <= 600; f++)
+        {
+            clock->time += 0.001;
+            gpu.Submit(f);
+            pacer.Presented(f);
+            pacer.BeginFrame();
+            const FramePacer::Stats& stats = pacer.GetStats();
+            //never early, late only by the spin step that crossed the deadline
+            CHECK(stats.frameTime >= interval - 1e-12);
+            CHECK(clock->time - (first + f * interval) < SimulatedClock::SPIN_STEP + 1e-9);
+            CHECK(stats.rateWait > 0.0);
+        }
+        //600 frames in 10 seconds, the spins don't add up
+        CHECK(std::fabs((clock->time - first) - 10.0) < 1e-3);
+        CHECK(clock->sleeps == 600);
+        CHECK(clock->spins > 0);
+    }
+
+    void LateFramesDontBuildADebt()
+    {
+        auto clock = std::make_shared<SimulatedClock>(0.0);
+        SimulatedGpu gpu{ *clock, 0.001 };
+        FramePacer::Settings settings;
+        settings.targetFps = 100.0;
+        FramePacer pacer(settings, gpu.Queue(), clock);
+        for (uint64_t f = 1; f <= 10; f++)
+            Frame(pacer, *clock, gpu, f, 0.002);
+        //a 50ms hitch
+        Frame(pacer, *clock, gpu, 11, 0.050);
+        pacer.BeginFrame();
+        CHECK(pacer.GetStats().rateWait == 0.0);
+        CHECK(pacer.GetStats().frameTime > 0.050);
+        //the frames after it keep the rate, they don't run faster to catch up
+        clock->time += 0.002;
+        gpu.Submit(12);
+        pacer.Presented(12);
+        for (uint64_t f = 13; f <= 20; f++)
+        {
+            Frame(pacer, *clock, gpu, f, 0.002);
+            CHECK(pacer.GetStats().frameTime >= 0.010 - 1e-12);
+        }
+    }
+
+    void AClockThatOnlyMovesWhenSpunDoesntHang()
+    {
+        //no sleeps at all: everything has to go through Spin
+        auto clock = std::make_shared<SimulatedClock>(0.0);
+        SimulatedGpu gpu{ *clock, 0.001 };
+        FramePacer::Settings settings;
+        settings.targetFps = 1000.0;
+        //more than the frame time, the whole wait spins
+        settings.spinTime = 0.01;
+        FramePacer pacer(settings, gpu.Queue(), clock);
+        for (uint64_t f = 1; f <= 10; f++)
+            Frame(pacer, *clock, gpu, f, 0.0);
+        CHECK(clock->sleeps == 0);
+        CHECK(clock->spins >= 9 * 100);
+    }
+
+    void InputLatencyIsFromTheFirstInputToThePresent()
+    {
+        auto clock = std::make_shared<SimulatedClock>(0.0);
+        SimulatedGpu gpu{ *clock, 0.001 };
+        FramePacer pacer(FramePacer::Settings{}, gpu.Queue(), clock);
+        Frame(pacer, *clock, gpu, 1, 0.004);
+        CHECK(pacer.GetStats().framesWithInput == 0);
+        //input 3ms after the present, another one after it doesn't count
+        clock->time += 0.003;
+        pacer.InputReceived();
+        clock->time += 0.001;
+        pacer.InputReceived();
+        Frame(pacer, *clock, gpu, 2, 0.004);
+        //1ms after the second input, 4ms of frame
+        CHECK(std::fabs(pacer.GetStats().inputLatency - 0.005) < 1e-12);
+        CHECK(pacer.GetStats().framesWithInput == 1);
+        //a frame without input leaves the numbers alone
+        Frame(pacer, *clock, gpu, 3, 0.004);
+        CHECK(pacer.GetStats().framesWithInput == 1);
+        //input in the middle of a long frame: it counts for that frame
+        pacer.BeginFrame();
+        clock->time += 0.010;
+        pacer.InputReceived();
+        clock->time += 0.020;
+        gpu.Submit(4);
+        pacer.Presented(4);
+        CHECK(std::fabs(pacer.GetStats().inputLatency - 0.020) < 1e-12);
+        CHECK(std::fabs(pacer.GetStats().maxInputLatency - 0.020) < 1e-12);
+        CHECK(pacer.GetStats().framesWithInput == 2);
+    }
+
+    void QueueLimitAddsLatency()
+    {
+        //gpu bound: each queued frame is a frame of input latency more
+        double latencies[3] = {};
+        for (uint32_t limit = 1; limit <= 3; limit++)
+        {
+            auto clock = std::make_shared<SimulatedClock>(0.0);
+            SimulatedGpu gpu{ *clock, 0.010 };
+            FramePacer::Settings settings;
+            settings.maxQueuedFrames = limit;
+            FramePacer pacer(settings, gpu.Queue(), clock);
+            double worst = 0;
+            for (uint64_t f = 1; f <= 50; f++)
+            {
+                pacer.BeginFrame();
+                //input read at the beginning of the frame, seen on screen when the gpu is done
+                const double input = clock->time;
+                clock->time += 0.001;
+                gpu.Submit(f);
+                pacer.Presented(f);
+                if (f > 10)
+                    worst = (std::max)(worst, gpu.lastFinish - input);
+            }
+            latencies[limit - 1] = worst;
+        }
+        CHECK(std::fabs(latencies[0] - 0.011) < 1e-9);
+        CHECK(latencies[1] > latencies[0] && latencies[2] > latencies[1]);
+        CHECK(std::fabs(latencies[2] - latencies[1] - 0.010) < 1e-9);
+    }
+}
+
+int main()
+{
+    QueuedFramesAreLimited();
+    NoLimitNeverWaitsForTheGpu();
+    FrameRateIsCapped();
+    LateFramesDontBuildADebt();
+    AClockThatOnlyMovesWhenSpunDoesntHang();
+    InputLatencyIsFromTheFirstInputToThePresent();
+    QueueLimitAddsLatency();
+    return 0;
+}
@@ -0,0 +1,123 @@
+#include "pch.h"
+#include "frame_ring.h"
+#include "check.h"
+#include <algorithm>
+#include <cmath>
+#include <random>
+
+using common::FrameRing;
+
+namespace
+{
+    void SlotsAreReusedAfterNFrames()
+    {
+        FrameRing ring(3);
+        CHECK(ring.Count() == 3 && ring.FenceValue() == 0);
+        for (uint64_t frame = 1; frame <= 10; frame++)
+        {
+            const uint64_t wait = ring.BeginFrame();
+            CHECK(ring.FenceValue() == frame);
+            CHECK(ring.Index() == frame % 3);
+            //the first time each slot is new, then it waits for the frame 3 before
+            CHECK(wait == (frame <= 3 ? 0 : frame - 3));
+            CHECK(ring.EndFrame() == frame);
+        }
+    }
+
+    /// <summary>
+    /// A queue that runs the frames in order, each for its own time, after they are submitted: the
+    /// fence gets to a frame's value when the queue finishes it.
+    /// </summary>
+    struct StandInQueue
+    {
+        //when the queue finishes each fence value, [0] is the initial value
+        std::vector<double> completion{ 0.0 };
+        void Submit(uint64_t fenceValue, double time, double duration)
+        {
+            CHECK(fenceValue == completion.size());
+            completion.push_back((std::max)(completion.back(), time) + duration);
+        }
+        /// <summary>
+        /// The time when the fence reaches value, for a cpu that gets there at time.
+        /// </summary>
+        double Wait(uint64_t value, double time)const
+        {
+            return (std::max)(time, completion[value]);
+        }
+        /// <summary>
+        /// How many frames the queue still has at time.
+        /// </summary>
+        size_t InFlight(double time)const
+        {
+            return std::count_if(completion.begin(), completion.end(), [time](double t) { return t > time; });
+        }
+    };
+
+    /// <summary>
+    /// Runs frameCount frames, cpuTime to record each one and gpuTime(frame) to execute it. Returns when
+    /// the last one is done on the gpu.
+    /// </summary>
+    template<typename GpuTime>
+    double Run(uint32_t framesInFlight, int frameCount, double cpuTime, GpuTime gpuTime)
+    {
+        FrameRing ring(framesInFlight);
+        StandInQueue queue;
+        double time = 0;
+        for (int frame = 0; frame < frameCount; frame++)
+        {
+            //DxContext::WaitPreviousFrame
+            time = queue.Wait(ring.BeginFrame(), time);
+            //the slot is free: never more frames on the gpu than slots, counting this one
+            CHECK(queue.InFlight(time) < framesInFlight);
+            time += cpuTime;
+            //DxContext::Present
+            const uint64_t value = ring.EndFrame();
+            queue.Submit(value, time, gpuTime(frame));
+        }
+        return queue.completion.back();
+    }
+
+    void CpuAndGpuOverlap()
+    {
+        const int frames = 100;
+        const double cpu = 4, gpu = 5;
+        auto constant = [gpu](int) { return gpu; };
+        //one frame in flight: the cpu waits for each frame, the times add up
+        const double serial = Run(1, frames, cpu, constant);
+        CHECK(std::fabs(serial - frames * (cpu + gpu)) < 1e-6);
+        //two: the cpu records the next frame while the gpu runs this one, the gpu is the limit
+        const double overlapped = Run(2, frames, cpu, constant);
+        CHECK(std::fabs(overlapped - (cpu + frames * gpu)) < 1e-6);
+        //more slots don't help when the gpu is always busy
+        CHECK(std::fabs(Run(3, frames, cpu, constant) - overlapped) < 1e-6);
+    }
+
+    void SpikesAreAbsorbedByTheSlots()
+    {
+        //a gpu that is usually faster than the cpu with a slow frame now and then: with more
+        //frames in flight the cpu waits less for the slow ones
+        std::mt19937 random(5);
+        std::vector<double> gpuTimes;
+        for (int i = 0; i < 500; i++)
+            gpuTimes.push_back(random() % 10 == 0 ? 12.0 : 2.0);
+        auto gpuTime = [&gpuTimes](int frame) { return gpuTimes[frame]; };
+        const double one = Run(1, 500, 4, gpuTime);
+        const double two = Run(2, 500, 4, gpuTime);
+        const double three = Run(3, 500, 4, gpuTime);
+        CHECK(two < one);
+        CHECK(three <= two);
+        //never faster than the cpu or the gpu alone
+        double gpuTotal = 0;
+        for (double t : gpuTimes)
+            gpuTotal += t;
+        CHECK(three >= (std::max)(500 * 4.0, gpuTotal));
+    }
+}
+
+int main()
+{
+    SlotsAreReusedAfterNFrames();
+    CpuAndGpuOverlap();
+    SpikesAreAbsorbedByTheSlots();
+    return 0;
+}
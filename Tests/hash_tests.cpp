@@ -0,0 +1,72 @@
+#include "pch.h"
+#include "hash.h"
+#include "check.h"
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+namespace
+{
+    uint64_t Hash(const char* text, uint64_t seed = 0)
+    {
+        return common::XXH64(text, strlen(text), seed);
+    }
+
+    void SameAsTheReference()
+    {
+        //the values of the reference implementation
+        CHECK(Hash("") == 0xEF46DB3751D8E999ull);
+        CHECK(Hash("a") == 0xD24EC4F1A98C6E5Bull);
+        CHECK(Hash("abc") == 0x44BC2CF5AD770999ull);
+        //more than a stripe, and a tail with 4 bytes and single ones
+        CHECK(Hash("Nobody inspects the spammish repetition") == 0xFBCEA83C8A378BF1ull);
+        CHECK(Hash("abc", 1) != Hash("abc"));
+    }
+
+    void PiecesGiveTheSameHash()
+    {
+        std::vector<uint8_t> data(1000);
+        for (size_t i = 0; i < data.size(); i++)
+            data[i] = uint8_t(i * 31 + 7);
+        //around the stripe size and the tail sizes, in pieces that cross the stripes every way
+        for (size_t size : { 0, 1, 3, 4, 7, 8, 31, 32, 33, 63, 64, 100, 999, 1000 })
+        {
+            for (size_t piece : { 1, 3, 5, 16, 31, 32, 33, 100 })
+            {
+                common::XXH64State state(42);
+                for (size_t offset = 0; offset < size; offset += piece)
+                    state.Update(data.data() + offset, (std::min)(piece, size - offset));
+                CHECK(state.Digest() == common::XXH64(data.data(), size, 42));
+            }
+        }
+        //Digest doesn't change the state
+        common::XXH64State state;
+        state.Update("abc", 3);
+        CHECK(state.Digest() == Hash("abc"));
+        state.Update("def", 3);
+        CHECK(state.Digest() == Hash("abcdef"));
+    }
+
+    void OneBitChangesTheHash()
+    {
+        std::vector<uint8_t> data(256, 0);
+        const uint64_t original = common::XXH64(data.data(), data.size());
+        std::vector<uint64_t> hashes{ original };
+        for (size_t bit = 0; bit < data.size() * 8; bit += 7)
+        {
+            data[bit / 8] ^= uint8_t(1 << (bit % 8));
+            hashes.push_back(common::XXH64(data.data(), data.size()));
+            data[bit / 8] ^= uint8_t(1 << (bit % 8));
+        }
+        std::sort(hashes.begin(), hashes.end());
+        CHECK(std::adjacent_find(hashes.begin(), hashes.end()) == hashes.end());
+    }
+}
+
+int main()
+{
+    SameAsTheReference();
+    PiecesGiveTheSameHash();
+    OneBitChangesTheHash();
+    return 0;
+}
@@ -0,0 +1,140 @@
+#include "pch.h"
+#include "mesh_load.h"
+#include "check.h"
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+namespace
+{
+    std::atomic<size_t> gAllocations{ 0 };
+}
+//counts every allocation of the program, the tests look at the difference around a call
+void* operator new(size_t size)
+{
+    gAllocations++;
+    if (void* p = std::malloc(size == 0 ? 1 : size))
+        return p;
+    throw std::bad_alloc();
+}
+void operator delete(void* p) noexcept
+{
+    std::free(p);
+}
+void operator delete(void* p, size_t) noexcept
+{
+    std::free(p);
+}
+
+namespace
+{
+    /// <summary>
+    /// Laid out like aiVector3D and aiFace, what the writers read from assimp.
+    /// </summary>
+    struct SourceVector
+    {
+        float x, y, z;
+    };
+    struct SourceFace
+    {
+        unsigned int mNumIndices;
+        unsigned int* mIndices;
+    };
+    /// <summary>
+    /// A grid of size x size quads as assimp gives it after aiProcess_Triangulate, with a line
+    /// and a point that the writers must skip.
+    /// </summary>
+    struct SourceMesh
+    {
+        std::vector<SourceVector> positions, normals, uvs;
+        std::vector<unsigned int> indexStorage;
+        std::vector<SourceFace> faces;
+        explicit SourceMesh(uint32_t size)
+        {
+            for (uint32_t y = 0; y <= size; y++)
+            {
+                for (uint32_t x = 0; x <= size; x++)
+                {
+                    positions.push_back({ float(x), float(y), 0.5f });
+                    normals.push_back({ 0, 0, -1 });
+                    uvs.push_back({ float(x) / size, float(y) / size, 0 });
+                }
+            }
+            for (uint32_t y = 0; y < size; y++)
+            {
+                for (uint32_t x = 0; x < size; x++)
+                {
+                    const unsigned int a = y * (size + 1) + x, c = a + size + 1;
+                    indexStorage.insert(indexStorage.end(), { a, c, a + 1, a + 1, c, c + 1 });
+                }
+            }
+            indexStorage.insert(indexStorage.end(), { 0, 1, 2 });
+            for (size_t i = 0; i + 3 < indexStorage.size(); i += 3)
+                faces.push_back({ 3, &indexStorage[i] });
+            faces.insert(faces.begin() + 5, { 2, &indexStorage[indexStorage.size() - 3] });
+            faces.push_back({ 1, &indexStorage[indexStorage.size() - 1] });
+        }
+        uint32_t TriangleIndexCount()const { return static_cast<uint32_t>(indexStorage.size() - 3); }
+    };
+
+    void WritingIntoTheCallerBufferDoesNotAllocate()
+    {
+        const SourceMesh source(64);
+        const uint32_t indexCount = common::CountTriangleIndices(source.faces.data(), source.faces.size());
+        CHECK(indexCount == source.TriangleIndexCount());
+        const size_t vertexCount = source.positions.size();
+        const DXGI_FORMAT format = common::IndexFormatFor(vertexCount);
+        CHECK(format == DXGI_FORMAT_R16_UINT);
+        //the destination is made before counting, like a mapped upload heap
+        std::vector<uint8_t> destination(vertexCount * sizeof(common::Vertex) + indexCount * common::IndexSize(format));
+        common::Vertex* vertices = reinterpret_cast<common::Vertex*>(destination.data());
+        uint8_t* indices = destination.data() + vertexCount * sizeof(common::Vertex);
+
+        const size_t before = gAllocations;
+        common::InterleaveVertices(source.positions.data(), source.normals.data(), source.uvs.data(), vertexCount, vertices);
+        common::WriteTriangleIndices(source.faces.data(), source.faces.size(), format, indices);
+        const size_t allocations = gAllocations - before;
+        CHECK(allocations == 0);
+
+        for (size_t i = 0; i < vertexCount; i++)
+        {
+            CHECK(vertices[i].pos.x == source.positions[i].x && vertices[i].pos.y == source.positions[i].y &&
+                vertices[i].pos.z == source.positions[i].z);
+            CHECK(vertices[i].normal.z == -1);
+            CHECK(vertices[i].uv.x == source.uvs[i].x && vertices[i].uv.y == source.uvs[i].y);
+        }
+        const uint16_t* written = reinterpret_cast<const uint16_t*>(indices);
+        for (uint32_t i = 0; i < indexCount; i++)
+            CHECK(written[i] == source.indexStorage[i]);
+    }
+
+    void ThirtyTwoBitIndicesDoNotAllocate()
+    {
+        const SourceMesh source(8);
+        const uint32_t indexCount = common::CountTriangleIndices(source.faces.data(), source.faces.size());
+        std::vector<uint32_t> written(indexCount + 1, 0xDEADBEEF);
+        const size_t before = gAllocations;
+        common::WriteTriangleIndices(source.faces.data(), source.faces.size(), DXGI_FORMAT_R32_UINT, written.data());
+        CHECK(gAllocations - before == 0);
+        for (uint32_t i = 0; i < indexCount; i++)
+            CHECK(written[i] == source.indexStorage[i]);
+        //the points and lines wrote nothing past the triangles
+        CHECK(written[indexCount] == 0xDEADBEEF);
+    }
+
+    void TheHookCounts()
+    {
+        //so that the zeros of the other tests mean no allocations and not a hook that is not there
+        const size_t before = gAllocations;
+        std::vector<common::Vertex> copy(16);
+        CHECK(gAllocations - before == 1);
+    }
+}
+
+int main()
+{
+    TheHookCounts();
+    WritingIntoTheCallerBufferDoesNotAllocate();
+    ThirtyTwoBitIndicesDoNotAllocate();
+    return 0;
+}
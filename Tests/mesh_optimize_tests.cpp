@@ -0,0 +1,153 @@
+#include "pch.h"
+#include "mesh_optimize.h"
+#include "check.h"
+#include <algorithm>
+#include <cstdio>
+#include <random>
+
+namespace
+{
+    /// <summary>
+    /// A flat grid of size x size quads, two triangles each, with the triangles shuffled so
+    /// that the order has no locality at all.
+    /// </summary>
+    common::MeshData ShuffledGrid(uint32_t size)
+    {
+        common::MeshData mesh;
+        for (uint32_t y = 0; y <= size; y++)
+        {
+            for (uint32_t x = 0; x <= size; x++)
+            {
+                mesh.vertices.push_back({ static_cast<float>(x), static_cast<float>(y), 0 });
+                mesh.normals.push_back({ 0, 0, 1 });
+                mesh.uv.push_back({ static_cast<float>(x) / size, static_cast<float>(y) / size });
+            }
+        }
+        std::vector<std::array<uint32_t, 3>> triangles;
+        for (uint32_t y = 0; y < size; y++)
+        {
+            for (uint32_t x = 0; x < size; x++)
+            {
+                const uint32_t a = y * (size + 1) + x;
+                const uint32_t c = a + size + 1;
+                triangles.push_back({ a, c, a + 1 });
+                triangles.push_back({ a + 1, c, c + 1 });
+            }
+        }
+        std::mt19937 random(1);
+        std::shuffle(triangles.begin(), triangles.end(), random);
+        for (const std::array<uint32_t, 3>& t : triangles)
+            mesh.indices.insert(mesh.indices.end(), t.begin(), t.end());
+        return mesh;
+    }
+    /// <summary>
+    /// The triangles as positions, rotated so that each one starts with its smallest corner and
+    /// sorted, to compare meshes whose vertices and triangles were reordered.
+    /// </summary>
+    std::vector<std::array<float, 9>> Triangles(const common::MeshData& mesh)
+    {
+        std::vector<std::array<float, 9>> result;
+        for (size_t i = 0; i < mesh.indices.size(); i += 3)
+        {
+            std::array<DirectX::XMFLOAT3, 3> corners;
+            for (size_t c = 0; c < 3; c++)
+                corners[c] = mesh.vertices[mesh.indices[i + c]];
+            auto less = [](const DirectX::XMFLOAT3& a, const DirectX::XMFLOAT3& b) {
+                return std::tie(a.x, a.y, a.z) < std::tie(b.x, b.y, b.z);
+            };
+            const size_t first = std::min_element(corners.begin(), corners.end(), less) - corners.begin();
+            std::array<float, 9> t;
+            for (size_t c = 0; c < 3; c++)
+            {
+                const DirectX::XMFLOAT3& p = corners[(first + c) % 3];
+                t[c * 3] = p.x;
+                t[c * 3 + 1] = p.y;
+                t[c * 3 + 2] = p.z;
+            }
+            result.push_back(t);
+        }
+        std::sort(result.begin(), result.end());
+        return result;
+    }
+
+    void AnalyzeCountsEveryMiss()
+    {
+        //a lone triangle misses its 3 vertices
+        common::VertexCacheStats one = common::AnalyzeVertexCache({ 0, 1, 2 }, 3);
+        CHECK(one.acmr == 3.0f);
+        CHECK(one.atvr == 1.0f);
+        //the second triangle of a quad only misses the new vertex
+        common::VertexCacheStats quad = common::AnalyzeVertexCache({ 0, 1, 2, 2, 1, 3 }, 4);
+        CHECK(quad.acmr == 2.0f);
+        CHECK(quad.atvr == 1.0f);
+        //with a cache of 3, going back to the first vertex after 3 others is a miss again
+        common::VertexCacheStats evicted = common::AnalyzeVertexCache({ 0, 1, 2, 3, 4, 5, 0, 1, 2 }, 6, 3);
+        CHECK(evicted.acmr == 3.0f);
+        CHECK(evicted.atvr == 1.5f);
+    }
+
+    void OptimizeMeshImprovesAcmr()
+    {
+        common::MeshData mesh = ShuffledGrid(100);
+        const std::vector<std::array<float, 9>> before = Triangles(mesh);
+        const size_t vertexCount = mesh.vertices.size();
+        common::MeshOptimizationReport report = common::OptimizeMesh(mesh);
+        std::printf("acmr %.3f -> %.3f, atvr %.3f -> %.3f\n", report.before.acmr, report.after.acmr,
+            report.before.atvr, report.after.atvr);
+        //shuffled, almost every vertex of every triangle is a miss
+        CHECK(report.before.acmr > 2.5f);
+        //a 16 entry cache can't get to the 0.5 of an infinite one, but it gets close to 1
+        CHECK(report.after.acmr < 0.8f);
+        CHECK(report.after.atvr < 1.4f);
+        //what the report says is what the indices have
+        common::VertexCacheStats after = common::AnalyzeVertexCache(mesh.indices, mesh.vertices.size());
+        CHECK(after.acmr == report.after.acmr);
+        //the same triangles and vertices, only in another order
+        CHECK(mesh.vertices.size() == vertexCount);
+        CHECK(mesh.normals.size() == vertexCount);
+        CHECK(mesh.uv.size() == vertexCount);
+        CHECK(Triangles(mesh) == before);
+    }
+
+    void VertexFetchFollowsTheIndices()
+    {
+        common::MeshData mesh = ShuffledGrid(8);
+        //a vertex that no triangle uses
+        mesh.vertices.push_back({ -1, -1, -1 });
+        mesh.normals.push_back({ 0, 0, 1 });
+        mesh.uv.push_back({ 0, 0 });
+        const std::vector<std::array<float, 9>> before = Triangles(mesh);
+        common::OptimizeVertexFetch(mesh);
+        CHECK(mesh.vertices.size() == 81);
+        CHECK(mesh.uv.size() == 81);
+        uint32_t next = 0;
+        for (uint32_t index : mesh.indices)
+        {
+            //each index is one that was seen or the next new one
+            CHECK(index <= next);
+            if (index == next)
+                next++;
+        }
+        CHECK(Triangles(mesh) == before);
+    }
+
+    void OverdrawKeepsTheCacheWithinThreshold()
+    {
+        common::MeshData mesh = ShuffledGrid(32);
+        common::OptimizeVertexCache(mesh.indices, mesh.vertices.size());
+        const float cacheOrder = common::AnalyzeVertexCache(mesh.indices, mesh.vertices.size()).acmr;
+        const std::vector<std::array<float, 9>> before = Triangles(mesh);
+        common::OptimizeOverdraw(mesh.indices, mesh.vertices, 1.05f);
+        CHECK(common::AnalyzeVertexCache(mesh.indices, mesh.vertices.size()).acmr <= cacheOrder * 1.05f);
+        CHECK(Triangles(mesh) == before);
+    }
+}
+
+int main()
+{
+    AnalyzeCountsEveryMiss();
+    OptimizeMeshImprovesAcmr();
+    VertexFetchFollowsTheIndices();
+    OverdrawKeepsTheCacheWithinThreshold();
+    return 0;
+}
@@ -0,0 +1,200 @@
+#include "pch.h"
+#include "mesh_simplify.h"
+#include "mesh_load.h"
+#include "check.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <set>
+
+namespace
+{
+    /// <summary>
+    /// A height field of size x size quads, flat when amplitude is 0.
+    /// </summary>
+    common::MeshData Terrain(uint32_t size, float amplitude)
+    {
+        common::MeshData mesh;
+        for (uint32_t y = 0; y <= size; y++)
+        {
+            for (uint32_t x = 0; x <= size; x++)
+            {
+                const float z = amplitude * std::sin(x * 0.2f) * std::cos(y * 0.15f);
+                mesh.vertices.push_back({ static_cast<float>(x), static_cast<float>(y), z });
+                mesh.normals.push_back({ 0, 0, 1 });
+                mesh.uv.push_back({ 0, 0 });
+            }
+        }
+        for (uint32_t y = 0; y < size; y++)
+        {
+            for (uint32_t x = 0; x < size; x++)
+            {
+                const uint32_t a = y * (size + 1) + x;
+                const uint32_t c = a + size + 1;
+                mesh.indices.insert(mesh.indices.end(), { a, c, a + 1, a + 1, c, c + 1 });
+            }
+        }
+        return mesh;
+    }
+    /// <summary>
+    /// Area of the triangles projected on z = 0, with sign: a flipped triangle subtracts.
+    /// </summary>
+    double ProjectedArea(const std::vector<uint32_t>& indices, const std::vector<DirectX::XMFLOAT3>& positions)
+    {
+        double area = 0;
+        for (size_t i = 0; i < indices.size(); i += 3)
+        {
+            const DirectX::XMFLOAT3& a = positions[indices[i]];
+            const DirectX::XMFLOAT3& b = positions[indices[i + 1]];
+            const DirectX::XMFLOAT3& c = positions[indices[i + 2]];
+            //the grid triangles are clockwise seen from +z
+            area -= 0.5 * ((double(b.x) - a.x) * (double(c.y) - a.y) - (double(c.x) - a.x) * (double(b.y) - a.y));
+        }
+        return area;
+    }
+    /// <summary>
+    /// The height of the simplified surface under (x, y), or NAN if no triangle covers it.
+    /// </summary>
+    float HeightAt(const std::vector<uint32_t>& indices, const std::vector<DirectX::XMFLOAT3>& positions, float x, float y)
+    {
+        for (size_t i = 0; i < indices.size(); i += 3)
+        {
+            const DirectX::XMFLOAT3& a = positions[indices[i]];
+            const DirectX::XMFLOAT3& b = positions[indices[i + 1]];
+            const DirectX::XMFLOAT3& c = positions[indices[i + 2]];
+            const float d = (b.y - c.y) * (a.x - c.x) + (c.x - b.x) * (a.y - c.y);
+            if (d == 0)
+                continue;
+            const float wa = ((b.y - c.y) * (x - c.x) + (c.x - b.x) * (y - c.y)) / d;
+            const float wb = ((c.y - a.y) * (x - c.x) + (a.x - c.x) * (y - c.y)) / d;
+            const float wc = 1 - wa - wb;
+            if (wa >= -1e-5f && wb >= -1e-5f && wc >= -1e-5f)
+                return wa * a.z + wb * b.z + wc * c.z;
+        }
+        return NAN;
+    }
+
+    void FlatGridCollapsesWithoutError()
+    {
+        common::MeshData mesh = Terrain(32, 0);
+        float error = -1;
+        const std::vector<uint32_t> simplified = common::SimplifyMesh(mesh.indices, mesh.vertices,
+            mesh.indices.size() / 4, 0.01f, &error);
+        CHECK(simplified.size() <= mesh.indices.size() / 4);
+        CHECK(simplified.size() % 3 == 0);
+        CHECK(error < 1e-4f);
+        //no holes and no flips: the same area, and the border is where it was
+        CHECK(std::fabs(ProjectedArea(simplified, mesh.vertices) - 32.0 * 32.0) < 1e-3);
+        std::set<uint32_t> used(simplified.begin(), simplified.end());
+        for (uint32_t i = 0; i <= 32; i++)
+        {
+            CHECK(used.count(i) == 1);
+            CHECK(used.count(32 * 33 + i) == 1);
+            CHECK(used.count(i * 33) == 1);
+            CHECK(used.count(i * 33 + 32) == 1);
+        }
+        for (size_t i = 0; i < simplified.size(); i += 3)
+        {
+            CHECK(simplified[i] != simplified[i + 1] && simplified[i + 1] != simplified[i + 2] &&
+                simplified[i] != simplified[i + 2]);
+        }
+    }
+
+    void ErrorStopsTheSimplification()
+    {
+        common::MeshData mesh = Terrain(64, 2);
+        float loose = 0, tight = 0;
+        //no error allowed on a curved surface: hardly anything can go
+        const std::vector<uint32_t> kept = common::SimplifyMesh(mesh.indices, mesh.vertices, 0, 0.0f, &tight);
+        CHECK(kept.size() > mesh.indices.size() * 3 / 4);
+        CHECK(tight == 0);
+        const std::vector<uint32_t> simplified = common::SimplifyMesh(mesh.indices, mesh.vertices, 0, 0.01f, &loose);
+        CHECK(simplified.size() < kept.size());
+        const float meshSize = std::sqrt(64.0f * 64.0f * 2 + 4.0f * 4.0f);
+        CHECK(loose > 0 && loose <= 0.01f * meshSize);
+    }
+
+    void GeneratedLodsAreWithinTheirTargets()
+    {
+        common::MeshData mesh = Terrain(100, 3);
+        const std::vector<uint32_t> base = mesh.indices;
+        const std::vector<common::LodTarget> targets = common::DefaultLodTargets();
+        common::GenerateLods(mesh, targets);
+        std::printf("%zu levels:", mesh.lods.size());
+        for (const common::LodLevel& lod : mesh.lods)
+            std::printf(" %u indices error %f,", lod.indexCount, lod.error);
+        std::printf("\n");
+        CHECK(mesh.lods.size() >= 2);
+        CHECK(mesh.lods[0].firstIndex == 0 && mesh.lods[0].indexCount == base.size() && mesh.lods[0].error == 0);
+        CHECK(std::equal(base.begin(), base.end(), mesh.indices.begin()));
+        const float meshSize = std::sqrt(100.0f * 100.0f * 2 + 6.0f * 6.0f);
+        for (size_t i = 1; i < mesh.lods.size(); i++)
+        {
+            const common::LodLevel& lod = mesh.lods[i];
+            const common::LodLevel& previous = mesh.lods[i - 1];
+            //one after the other in the index buffer, each one smaller and less precise
+            CHECK(lod.firstIndex == previous.firstIndex + previous.indexCount);
+            CHECK(lod.indexCount % 3 == 0);
+            CHECK(lod.indexCount <= previous.indexCount * 0.9f);
+            CHECK(lod.indexCount >= base.size() * targets[i - 1].triangleRatio - 3);
+            CHECK(lod.error >= previous.error);
+            CHECK(lod.error <= targets[i - 1].maxError * meshSize);
+            //the surface moved less than the error says
+            const std::vector<uint32_t> indices(mesh.indices.begin() + lod.firstIndex,
+                mesh.indices.begin() + lod.firstIndex + lod.indexCount);
+            float worst = 0;
+            for (const DirectX::XMFLOAT3& p : mesh.vertices)
+            {
+                const float height = HeightAt(indices, mesh.vertices, p.x, p.y);
+                CHECK(!std::isnan(height));
+                worst = (std::max)(worst, std::fabs(height - p.z));
+            }
+            CHECK(worst <= lod.error);
+        }
+        CHECK(mesh.lods.back().firstIndex + mesh.lods.back().indexCount == mesh.indices.size());
+        //again starts from level 0 instead of simplifying the last level
+        const std::vector<common::LodLevel> first = mesh.lods;
+        common::GenerateLods(mesh, targets);
+        CHECK(mesh.lods.size() == first.size());
+        for (size_t i = 0; i < first.size(); i++)
+            CHECK(mesh.lods[i].indexCount == first[i].indexCount && mesh.lods[i].error == first[i].error);
+    }
+
+    void SelectLodFollowsTheScreenError()
+    {
+        const std::vector<common::LodLevel> lods = {
+            { 0, 600, 0.0f, 0 }, { 600, 300, 0.01f, 0 }, { 900, 150, 0.05f, 0 }, { 1050, 75, 0.2f, 0 } };
+        //1000 pixels per unit at distance 1: the error in pixels is error * 1000 / distance
+        const float projection = 1000;
+        CHECK(common::SelectLod(lods, 1, 5, projection) == 0);
+        CHECK(common::SelectLod(lods, 1, 20, projection) == 1);
+        CHECK(common::SelectLod(lods, 1, 100, projection) == 2);
+        CHECK(common::SelectLod(lods, 1, 1000, projection) == 3);
+        //twice as big is the same as twice as close
+        CHECK(common::SelectLod(lods, 2, 50, projection) == common::SelectLod(lods, 1, 25, projection));
+        CHECK(common::SelectLod(lods, 2, 50, projection) == 1);
+        //allowing more pixels of error gets there sooner
+        CHECK(common::SelectLod(lods, 1, 20, projection, 5) == 2);
+        //inside the object or only one level
+        CHECK(common::SelectLod(lods, 1, 0, projection) == 0);
+        CHECK(common::SelectLod({ lods[0] }, 1, 1000, projection) == 0);
+        //never goes back to more detail when going away
+        uint32_t last = 0;
+        for (float distance = 1; distance < 5000; distance *= 1.1f)
+        {
+            const uint32_t lod = common::SelectLod(lods, 1, distance, projection);
+            CHECK(lod >= last);
+            last = lod;
+        }
+        CHECK(last == 3);
+    }
+}
+
+int main()
+{
+    FlatGridCollapsesWithoutError();
+    ErrorStopsTheSimplification();
+    GeneratedLodsAreWithinTheirTargets();
+    SelectLodFollowsTheScreenError();
+    return 0;
+}
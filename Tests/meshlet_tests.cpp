@@ -0,0 +1,276 @@
+#include "pch.h"
+#include "meshlet.h"
+#include "culling.h"
+#include "check.h"
+#include <cmath>
+
+using namespace DirectX;
+
+namespace
+{
+    struct TestMesh
+    {
+        std::vector<XMFLOAT3> positions;
+        std::vector<uint32_t> indices;
+    };
+    /// <summary>
+    /// size x size quads in the z = 0 plane, the triangles face -z.
+    /// </summary>
+    TestMesh Grid(uint32_t size)
+    {
+        TestMesh mesh;
+        for (uint32_t y = 0; y <= size; y++)
+            for (uint32_t x = 0; x <= size; x++)
+                mesh.positions.push_back({ static_cast<float>(x), static_cast<float>(y), 0 });
+        for (uint32_t y = 0; y < size; y++)
+        {
+            for (uint32_t x = 0; x < size; x++)
+            {
+                const uint32_t a = y * (size + 1) + x;
+                const uint32_t c = a + size + 1;
+                mesh.indices.insert(mesh.indices.end(), { a, c, a + 1, a + 1, c, c + 1 });
+            }
+        }
+        return mesh;
+    }
+    /// <summary>
+    /// A unit cube centered in the origin, each face a grid of size x size quads facing out.
+    /// The faces go one after the other in the index buffer: +x, -x, +y, -y, +z, -z.
+    /// </summary>
+    TestMesh Cube(uint32_t size)
+    {
+        //u x v = the face normal
+        const XMFLOAT3 faces[6][3] = {
+            { { 1, 0, 0 }, { 0, 1, 0 }, { 0, 0, 1 } },
+            { { -1, 0, 0 }, { 0, 0, 1 }, { 0, 1, 0 } },
+            { { 0, 1, 0 }, { 0, 0, 1 }, { 1, 0, 0 } },
+            { { 0, -1, 0 }, { 1, 0, 0 }, { 0, 0, 1 } },
+            { { 0, 0, 1 }, { 1, 0, 0 }, { 0, 1, 0 } },
+            { { 0, 0, -1 }, { 0, 1, 0 }, { 1, 0, 0 } },
+        };
+        TestMesh mesh;
+        for (const auto& face : faces)
+        {
+            const XMVECTOR n = XMLoadFloat3(&face[0]);
+            const XMVECTOR u = XMLoadFloat3(&face[1]);
+            const XMVECTOR v = XMLoadFloat3(&face[2]);
+            const uint32_t first = static_cast<uint32_t>(mesh.positions.size());
+            for (uint32_t y = 0; y <= size; y++)
+            {
+                for (uint32_t x = 0; x <= size; x++)
+                {
+                    XMFLOAT3 p;
+                    XMStoreFloat3(&p, n * 0.5f + u * (static_cast<float>(x) / size - 0.5f) +
+                        v * (static_cast<float>(y) / size - 0.5f));
+                    mesh.positions.push_back(p);
+                }
+            }
+            for (uint32_t y = 0; y < size; y++)
+            {
+                for (uint32_t x = 0; x < size; x++)
+                {
+                    const uint32_t a = first + y * (size + 1) + x;
+                    const uint32_t c = a + size + 1;
+                    mesh.indices.insert(mesh.indices.end(), { a, a + 1, c, a + 1, c + 1, c });
+                }
+            }
+        }
+        return mesh;
+    }
+    XMVECTOR TriangleNormal(const TestMesh& mesh, size_t triangle)
+    {
+        const XMVECTOR a = XMLoadFloat3(&mesh.positions[mesh.indices[triangle * 3]]);
+        const XMVECTOR b = XMLoadFloat3(&mesh.positions[mesh.indices[triangle * 3 + 1]]);
+        const XMVECTOR c = XMLoadFloat3(&mesh.positions[mesh.indices[triangle * 3 + 2]]);
+        return XMVector3Cross(b - a, c - a);
+    }
+    /// <summary>
+    /// The meshlets are contiguous, within the limits and give back the same triangles.
+    /// </summary>
+    void CheckMeshlets(const TestMesh& mesh, const common::MeshletData& data, uint32_t maxVertices,
+        uint32_t maxTriangles)
+    {
+        CHECK(data.meshlets.size() == data.bounds.size());
+        uint32_t triangles = 0;
+        uint32_t vertices = 0;
+        for (size_t i = 0; i < data.meshlets.size(); i++)
+        {
+            const common::Meshlet& m = data.meshlets[i];
+            CHECK(m.vertexCount <= maxVertices);
+            CHECK(m.triangleCount > 0 && m.triangleCount <= maxTriangles);
+            CHECK(m.triangleOffset == triangles);
+            CHECK(m.vertexOffset == vertices);
+            for (uint32_t k = 0; k < m.triangleCount * 3; k++)
+            {
+                const uint8_t local = data.triangles[m.triangleOffset * 3 + k];
+                CHECK(local < m.vertexCount);
+                CHECK(data.vertices[m.vertexOffset + local] == mesh.indices[m.triangleOffset * 3 + k]);
+            }
+            //the sphere has all the vertices
+            const common::MeshletBounds& b = data.bounds[i];
+            for (uint32_t v = 0; v < m.vertexCount; v++)
+            {
+                const XMVECTOR p = XMLoadFloat3(&mesh.positions[data.vertices[m.vertexOffset + v]]);
+                CHECK(XMVectorGetX(XMVector3Length(p - XMLoadFloat3(&b.center))) <= b.radius * 1.0001f);
+            }
+            triangles += m.triangleCount;
+            vertices += m.vertexCount;
+        }
+        CHECK(triangles * 3 == mesh.indices.size());
+        CHECK(data.vertices.size() == vertices);
+        CHECK(data.triangles.size() == mesh.indices.size());
+    }
+
+    void GridMeshletsKeepTheLimits()
+    {
+        const TestMesh grid = Grid(50);
+        CheckMeshlets(grid, common::BuildMeshlets(grid.indices, grid.positions),
+            common::MESHLET_MAX_VERTICES, common::MESHLET_MAX_TRIANGLES);
+        //a grid row is 51 vertices, so the meshlets are at least as full as two rows allow
+        const common::MeshletData data = common::BuildMeshlets(grid.indices, grid.positions);
+        CHECK(data.meshlets.size() <= 5000 / 30);
+        //a limit that cuts by triangles and one that cuts by vertices
+        CheckMeshlets(grid, common::BuildMeshlets(grid.indices, grid.positions, 64, 8), 64, 8);
+        CheckMeshlets(grid, common::BuildMeshlets(grid.indices, grid.positions, 16, 124), 16, 124);
+        //the smallest limits, one triangle each
+        const common::MeshletData single = common::BuildMeshlets(grid.indices, grid.positions, 3, 1);
+        CheckMeshlets(grid, single, 3, 1);
+        CHECK(single.meshlets.size() == grid.indices.size() / 3);
+    }
+
+    void FlatClustersHaveATightCone()
+    {
+        const TestMesh grid = Grid(16);
+        const common::MeshletData data = common::BuildMeshlets(grid.indices, grid.positions);
+        for (const common::MeshletBounds& b : data.bounds)
+        {
+            CHECK(std::fabs(b.coneAxis.z + 1.0f) < 1e-5f);
+            CHECK(b.coneCutoff < 1e-3f);
+            //from the side the triangles face it's visible, from behind it's not
+            CHECK(!common::IsClusterBackfacing(b, { b.center.x, b.center.y, -100 }));
+            CHECK(common::IsClusterBackfacing(b, { b.center.x, b.center.y, 100 }));
+            //edge on, the sphere still reaches the camera's side
+            CHECK(!common::IsClusterBackfacing(b, { b.center.x + 100, b.center.y, 0 }));
+        }
+    }
+
+    void SpreadClustersAreNeverCulled()
+    {
+        //the same triangle twice, once for each side
+        const std::vector<XMFLOAT3> positions = { { 0, 0, 0 }, { 1, 0, 0 }, { 0, 1, 0 } };
+        const common::MeshletData data = common::BuildMeshlets({ 0, 1, 2, 0, 2, 1 }, positions);
+        CHECK(data.meshlets.size() == 1);
+        CHECK(data.bounds[0].coneCutoff == 1.0f);
+        CHECK(!common::IsClusterBackfacing(data.bounds[0], { 0, 0, 100 }));
+        CHECK(!common::IsClusterBackfacing(data.bounds[0], { 0, 0, -100 }));
+    }
+
+    void CubeBackFacesAreCulled()
+    {
+        //7x7 quads are 64 vertices and 98 triangles, one meshlet per face
+        const TestMesh cube = Cube(7);
+        const common::MeshletData data = common::BuildMeshlets(cube.indices, cube.positions);
+        CheckMeshlets(cube, data, common::MESHLET_MAX_VERTICES, common::MESHLET_MAX_TRIANGLES);
+        CHECK(data.meshlets.size() == 6);
+        const XMFLOAT3 cameras[] = { { 10, 0, 0 }, { -10, 0, 0 }, { 0, 10, 0 }, { 0, -10, 0 }, { 0, 0, 10 }, { 0, 0, -10 },
+            { 3, 4, 5 }, { -6, 1, -2 } };
+        for (size_t c = 0; c < std::size(cameras); c++)
+        {
+            const XMVECTOR camera = XMLoadFloat3(&cameras[c]);
+            size_t culled = 0;
+            for (size_t i = 0; i < data.meshlets.size(); i++)
+            {
+                const common::Meshlet& m = data.meshlets[i];
+                if (!common::IsClusterBackfacing(data.bounds[i], cameras[c]))
+                    continue;
+                culled++;
+                //conservative: no culled triangle faces the camera
+                for (uint32_t t = m.triangleOffset; t < m.triangleOffset + m.triangleCount; t++)
+                {
+                    const XMVECTOR p = XMLoadFloat3(&cube.positions[cube.indices[t * 3]]);
+                    CHECK(XMVectorGetX(XMVector3Dot(p - camera, TriangleNormal(cube, t))) >= 0.0f);
+                }
+            }
+            CHECK(culled > 0);
+            if (c >= 6)
+                continue;
+            //from an axis the face on the other side is culled and the one in front is not. The
+            //sides are almost edge on, the bounding sphere keeps them
+            CHECK(common::IsClusterBackfacing(data.bounds[c ^ 1], cameras[c]));
+            CHECK(!common::IsClusterBackfacing(data.bounds[c], cameras[c]));
+        }
+    }
+
+    void CullMeshletsMergesTheVisibleRanges()
+    {
+        const TestMesh cube = Cube(7);
+        const common::MeshletData data = common::BuildMeshlets(cube.indices, cube.positions);
+        //a box from -100 to 100 in every axis, so only the cone culls
+        common::Frustum frustum;
+        const XMFLOAT4 planes[6] = { { 1, 0, 0, 100 }, { -1, 0, 0, 100 }, { 0, 1, 0, 100 }, { 0, -1, 0, 100 },
+            { 0, 0, 1, 100 }, { 0, 0, -1, 100 } };
+        std::copy(std::begin(planes), std::end(planes), frustum.planes.begin());
+        std::vector<common::IndexRange> ranges;
+        common::CullMeshlets(data.meshlets, data.bounds, XMMatrixIdentity(), frustum, { 10, 0, 0 }, ranges);
+        //the +x face is first in the index buffer and visible, so it's one range from 0
+        CHECK(!ranges.empty());
+        CHECK(ranges[0].firstIndex == 0);
+        CHECK(ranges[0].indexCount >= cube.indices.size() / 6);
+        for (size_t i = 1; i < ranges.size(); i++)
+            CHECK(ranges[i].firstIndex > ranges[i - 1].firstIndex + ranges[i - 1].indexCount);
+        //moving the mesh and the camera together culls the same
+        std::vector<common::IndexRange> moved;
+        common::CullMeshlets(data.meshlets, data.bounds, XMMatrixTranslation(5, 6, 7), frustum, { 15, 6, 7 }, moved);
+        CHECK(moved.size() == ranges.size());
+        for (size_t i = 0; i < moved.size(); i++)
+            CHECK(moved[i].firstIndex == ranges[i].firstIndex && moved[i].indexCount == ranges[i].indexCount);
+        //out of the frustum nothing is left
+        common::CullMeshlets(data.meshlets, data.bounds, XMMatrixTranslation(500, 0, 0), frustum, { 10, 0, 0 }, moved);
+        CHECK(moved.empty());
+    }
+
+    void ValidateMeshletsFindsBrokenRanges()
+    {
+        const TestMesh grid = Grid(16);
+        const common::MeshletData built = common::BuildMeshlets(grid.indices, grid.positions);
+        auto validate = [&grid](const common::MeshletData& d, size_t indexCount)
+        {
+            return common::ValidateMeshlets(d.meshlets.data(), d.meshlets.size(), d.vertices.data(), d.vertices.size(),
+                d.triangles.data(), d.triangles.size() / 3, grid.positions.size(), indexCount);
+        };
+        CHECK(validate(built, grid.indices.size()));
+        //past the end of the meshlet vertices
+        common::MeshletData broken = built;
+        broken.meshlets.back().vertexCount++;
+        CHECK(!validate(broken, grid.indices.size()));
+        //past the end of the triangles
+        broken = built;
+        broken.meshlets.back().triangleOffset++;
+        CHECK(!validate(broken, grid.indices.size()));
+        //past the end of the index buffer
+        CHECK(!validate(built, grid.indices.size() - 3));
+        //a local index out of its meshlet
+        broken = built;
+        broken.triangles[built.meshlets[0].triangleOffset * 3] = static_cast<uint8_t>(built.meshlets[0].vertexCount);
+        CHECK(!validate(broken, grid.indices.size()));
+        //a vertex that the mesh doesn't have
+        broken = built;
+        broken.vertices[0] = static_cast<uint32_t>(grid.positions.size());
+        CHECK(!validate(broken, grid.indices.size()));
+        //an offset that overflows 32 bits
+        broken = built;
+        broken.meshlets[0].vertexOffset = UINT32_MAX;
+        CHECK(!validate(broken, grid.indices.size()));
+    }
+}
+
+int main()
+{
+    GridMeshletsKeepTheLimits();
+    FlatClustersHaveATightCone();
+    SpreadClustersAreNeverCulled();
+    CubeBackFacesAreCulled();
+    CullMeshletsMergesTheVisibleRanges();
+    ValidateMeshletsFindsBrokenRanges();
+    return 0;
+}
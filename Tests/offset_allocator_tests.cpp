@@ -0,0 +1,194 @@
+#include "pch.h"
+#include "offset_allocator.h"
+#include "check.h"
+#include <algorithm>
+#include <random>
+
+using common::OffsetAllocator;
+
+namespace
+{
+    struct Live
+    {
+        OffsetAllocator::Handle handle;
+        uint64_t alignment;
+    };
+    /// <summary>
+    /// The live allocations don't overlap, are aligned and inside the capacity, the counters
+    /// agree with them and the free space is merged: as many free ranges as gaps.
+    /// </summary>
+    void CheckConsistent(const OffsetAllocator& a, const std::vector<Live>& live)
+    {
+        std::vector<bool> used(a.Capacity(), false);
+        uint64_t usedSize = 0;
+        for (const Live& l : live)
+        {
+            const uint64_t offset = a.Offset(l.handle), size = a.Size(l.handle);
+            CHECK(offset % l.alignment == 0);
+            CHECK(offset + size <= a.Capacity());
+            for (uint64_t i = offset; i < offset + size; i++)
+            {
+                CHECK(!used[i]);
+                used[i] = true;
+            }
+            usedSize += size;
+        }
+        CHECK(a.UsedSize() == usedSize);
+        CHECK(a.FreeSize() == a.Capacity() - usedSize);
+        CHECK(a.AllocationCount() == live.size());
+        size_t gaps = 0;
+        uint64_t largest = 0, run = 0;
+        for (size_t i = 0; i < used.size(); i++)
+        {
+            if (used[i])
+            {
+                run = 0;
+                continue;
+            }
+            if (run == 0)
+                gaps++;
+            run++;
+            largest = (std::max)(largest, run);
+        }
+        CHECK(a.FreeRangeCount() == gaps);
+        CHECK(a.LargestFreeRange() == largest);
+    }
+
+    void BestFitAndMerging()
+    {
+        OffsetAllocator a(100);
+        const OffsetAllocator::Handle x = a.Allocate(10);
+        const OffsetAllocator::Handle y = a.Allocate(20);
+        const OffsetAllocator::Handle z = a.Allocate(5);
+        CHECK(a.Offset(x) == 0 && a.Offset(y) == 10 && a.Offset(z) == 30);
+        //a 20 hole and a 65 one: 15 goes in the 20 one
+        a.Free(y);
+        const OffsetAllocator::Handle w = a.Allocate(15);
+        CHECK(a.Offset(w) == 10);
+        //freeing the neighbours merges them back in one range
+        a.Free(w);
+        a.Free(x);
+        a.Free(z);
+        CHECK(a.FreeRangeCount() == 1);
+        CHECK(a.LargestFreeRange() == 100);
+        //too big
+        CHECK(a.Allocate(101) == OffsetAllocator::INVALID_HANDLE);
+        CHECK(a.Allocate(100) != OffsetAllocator::INVALID_HANDLE);
+    }
+
+    void AlignmentPadsAndKeepsThePadding()
+    {
+        OffsetAllocator a(64);
+        const OffsetAllocator::Handle one = a.Allocate(1);
+        const OffsetAllocator::Handle aligned = a.Allocate(8, 16);
+        CHECK(a.Offset(aligned) == 16);
+        //the padding before it is still free
+        const OffsetAllocator::Handle small = a.Allocate(15);
+        CHECK(a.Offset(small) == 1);
+        CheckConsistent(a, { { one, 1 }, { aligned, 16 }, { small, 1 } });
+    }
+
+    void GrowKeepsTheAllocations()
+    {
+        OffsetAllocator a(0);
+        CHECK(a.Allocate(1) == OffsetAllocator::INVALID_HANDLE);
+        a.Grow(10);
+        const OffsetAllocator::Handle x = a.Allocate(6);
+        CHECK(a.Allocate(6) == OffsetAllocator::INVALID_HANDLE);
+        a.Grow(20);
+        const OffsetAllocator::Handle y = a.Allocate(6);
+        CHECK(a.Offset(x) == 0);
+        CHECK(a.Offset(y) == 6);
+        //the free space at the old end and the new one are one range
+        CHECK(a.FreeRangeCount() == 1 && a.LargestFreeRange() == 8);
+    }
+
+    void DefragmentPacksInOrder()
+    {
+        OffsetAllocator a(100);
+        std::vector<OffsetAllocator::Handle> handles;
+        for (int i = 0; i < 10; i++)
+            handles.push_back(a.Allocate(10));
+        for (int i = 0; i < 10; i += 2)
+            a.Free(handles[i]);
+        CHECK(!a.IsCompact());
+        const std::vector<OffsetAllocator::Move> moves = a.Defragment();
+        CHECK(moves.size() == 5);
+        uint64_t expected = 0;
+        for (const OffsetAllocator::Move& m : moves)
+        {
+            //in offset order, only down, and the handle keeps working
+            CHECK(m.to == expected && m.to <= m.from && m.size == 10);
+            CHECK(a.Offset(m.handle) == m.to);
+            expected += m.size;
+        }
+        CHECK(a.IsCompact());
+        CHECK(a.FreeRangeCount() == 1 && a.LargestFreeRange() == 50);
+        //nothing to do the second time
+        for (const OffsetAllocator::Move& m : a.Defragment())
+            CHECK(m.from == m.to);
+    }
+
+    void RandomOperationsStayConsistent()
+    {
+        std::mt19937 random(3);
+        OffsetAllocator a(10000);
+        std::vector<Live> live;
+        for (int step = 0; step < 20000; step++)
+        {
+            const uint32_t op = random() % 10;
+            if (op < 6)
+            {
+                const uint64_t size = 1 + random() % 200, alignment = uint64_t(1) << (random() % 4);
+                const OffsetAllocator::Handle h = a.Allocate(size, alignment);
+                if (h != OffsetAllocator::INVALID_HANDLE)
+                    live.push_back({ h, alignment });
+                else
+                    //the best fit only fails if no range can hold it with its padding
+                    CHECK(a.LargestFreeRange() < size + alignment - 1);
+            }
+            else if (op < 9 && !live.empty())
+            {
+                const size_t i = random() % live.size();
+                a.Free(live[i].handle);
+                live.erase(live.begin() + i);
+            }
+            else if (step % 100 == 0)
+            {
+                for (const OffsetAllocator::Move& m : a.Defragment())
+                    CHECK(m.to <= m.from);
+                //packed: the only holes left are the alignment padding
+                std::vector<Live> sorted = live;
+                std::sort(sorted.begin(), sorted.end(), [&a](const Live& l, const Live& r) {
+                    return a.Offset(l.handle) < a.Offset(r.handle);
+                });
+                uint64_t cursor = 0;
+                for (const Live& l : sorted)
+                {
+                    CHECK(a.Offset(l.handle) == (cursor + l.alignment - 1) / l.alignment * l.alignment);
+                    cursor = a.Offset(l.handle) + a.Size(l.handle);
+                }
+            }
+            else if (step % 1000 == 0)
+            {
+                a.Grow(a.Capacity() + 500);
+            }
+            if (step % 50 == 0)
+                CheckConsistent(a, live);
+        }
+        CheckConsistent(a, live);
+        for (const Live& l : live)
+            a.Free(l.handle);
+        CHECK(a.UsedSize() == 0 && a.FreeRangeCount() == 1 && a.LargestFreeRange() == a.Capacity());
+    }
+}
+
+int main()
+{
+    BestFitAndMerging();
+    AlignmentPadsAndKeepsThePadding();
+    GrowKeepsTheAllocations();
+    DefragmentPacksInOrder();
+    RandomOperationsStayConsistent();
+    return 0;
+}
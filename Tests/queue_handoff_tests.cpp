@@ -0,0 +1,224 @@
+#include "pch.h"
+#include "queue_handoff.h"
+#include "check.h"
+#include <deque>
+#include <map>
+#include <random>
+
+namespace
+{
+    enum class State
+    {
+        Common,
+        CopyDest,
+        VertexBuffer,
+        IndexBuffer
+    };
+    using Handoff = common::QueueHandoff<int, State>;
+
+    void TransitionsAndWaitsAreTakenOnce()
+    {
+        Handoff handoff;
+        CHECK(handoff.TakeWait() == 0);
+        handoff.Submitted(1, { { 1, State::VertexBuffer }, { 2, State::IndexBuffer } });
+        //written again before the consumer took it: only the last state
+        handoff.Submitted(2, { { 1, State::IndexBuffer } });
+        const std::vector<Handoff::Transition> transitions = handoff.TakeTransitions();
+        CHECK(transitions.size() == 2);
+        CHECK(transitions[0].resource == 1 && transitions[0].state == State::IndexBuffer);
+        CHECK(transitions[1].resource == 2 && transitions[1].state == State::IndexBuffer);
+        CHECK(handoff.TakeTransitions().empty());
+        CHECK(handoff.TakeWait() == 2);
+        CHECK(handoff.TakeWait() == 0);
+        //a submit with nothing to transition still has to be waited for
+        handoff.Submitted(3, {});
+        CHECK(handoff.TakeWait() == 3);
+    }
+
+    void HeldResourcesAreReleasedBeforeTheProducerUsesThem()
+    {
+        Handoff handoff;
+        State held = State::Common;
+        //not handed over yet: still in COMMON, nothing to release
+        handoff.Submitted(1, { { 7, State::VertexBuffer } });
+        CHECK(!handoff.Release(7, held));
+        handoff.TakeTransitions();
+        CHECK(handoff.IsHeld(7));
+        //the producer writes it again
+        CHECK(handoff.Release(7, held));
+        CHECK(held == State::VertexBuffer);
+        CHECK(!handoff.IsHeld(7));
+        CHECK(!handoff.Release(7, held));
+        const std::vector<Handoff::Transition> releases = handoff.TakeReleases();
+        CHECK(releases.size() == 1 && releases[0].resource == 7 && releases[0].state == State::VertexBuffer);
+        CHECK(handoff.TakeReleases().empty());
+        CHECK(handoff.TakeReleaseWait() == 0);
+        handoff.ReleasesSubmitted(4);
+        CHECK(handoff.TakeReleaseWait() == 4);
+        CHECK(handoff.TakeReleaseWait() == 0);
+        //and it goes back to the consumer with the next submit
+        handoff.Submitted(2, { { 7, State::VertexBuffer } });
+        handoff.TakeTransitions();
+        CHECK(handoff.IsHeld(7));
+    }
+
+    void ForgottenResourcesAreNotTransitioned()
+    {
+        Handoff handoff;
+        State held;
+        handoff.Submitted(1, { { 1, State::VertexBuffer }, { 2, State::VertexBuffer } });
+        handoff.TakeTransitions();
+        handoff.Submitted(2, { { 3, State::IndexBuffer } });
+        CHECK(handoff.Release(2, held));
+        handoff.Forget(1);
+        handoff.Forget(2);
+        handoff.Forget(3);
+        CHECK(!handoff.IsHeld(1));
+        CHECK(handoff.TakeTransitions().empty());
+        //the producer alredy counts on this one
+        CHECK(handoff.TakeReleases().size() == 1);
+    }
+
+    /// <summary>
+    /// A gpu queue that runs its commands in order and stops at a wait until the fence gets there.
+    /// The resources have one real state, every command checks it.
+    /// </summary>
+    struct Command
+    {
+        enum Type { Barrier, Write, Read, Signal, Wait } type;
+        int resource;
+        State before, after;
+        uint64_t value;
+    };
+    struct Gpu
+    {
+        std::map<int, State> states;
+        uint64_t copyFence = 0, releaseFence = 0;
+        std::deque<Command> copy, direct;
+        /// <summary>
+        /// Runs the next command of the queue, false if it waits.
+        /// </summary>
+        bool Step(std::deque<Command>& queue)
+        {
+            if (queue.empty())
+                return false;
+            const Command c = queue.front();
+            switch (c.type)
+            {
+            case Command::Wait:
+                //the direct queue waits on the copy fence, the copy queue on the release one
+                if ((&queue == &copy ? releaseFence : copyFence) < c.value)
+                    return false;
+                break;
+            case Command::Signal:
+                (&queue == &copy ? copyFence : releaseFence) = c.value;
+                break;
+            case Command::Barrier:
+                CHECK(states[c.resource] == c.before);
+                states[c.resource] = c.after;
+                break;
+            case Command::Write:
+                //the copy queue can only use resources in COMMON or the states it set itself
+                CHECK(&queue == &copy);
+                CHECK(states[c.resource] == State::CopyDest);
+                break;
+            case Command::Read:
+                CHECK(&queue == &direct);
+                CHECK(states[c.resource] == c.after);
+                break;
+            }
+            queue.pop_front();
+            return true;
+        }
+    };
+
+    /// <summary>
+    /// Uploads on the copy queue and frames on the direct queue, recorded like UploadBatch and DxContext
+    /// do it, executed with the two queues going at random speeds. A missing wait or release makes a
+    /// command find the resource in another state.
+    /// </summary>
+    void RandomUploadsAndFramesAgree()
+    {
+        std::mt19937 random(11);
+        const State readStates[] = { State::VertexBuffer, State::IndexBuffer };
+        for (int trial = 0; trial < 100; trial++)
+        {
+            Gpu gpu;
+            Handoff handoff;
+            std::map<int, State> finalStates;
+            uint64_t copyValue = 0, releaseValue = 0;
+            for (int step = 0; step < 400; step++)
+            {
+                if (random() % 3 == 0)
+                {
+                    //a batch writes a few resources: UploadBatch::Use, Acquire and Submit
+                    std::map<int, State> batch;
+                    for (int i = 0, n = 1 + random() % 3; i < n; i++)
+                    {
+                        const int resource = random() % 6;
+                        if (batch.count(resource))
+                            continue;
+                        State held;
+                        handoff.Release(resource, held);
+                        batch[resource] = readStates[random() % 2];
+                    }
+                    const std::vector<Handoff::Transition> releases = handoff.TakeReleases();
+                    if (!releases.empty())
+                    {
+                        for (const Handoff::Transition& r : releases)
+                            gpu.direct.push_back({ Command::Barrier, r.resource, r.state, State::Common, 0 });
+                        gpu.direct.push_back({ Command::Signal, 0, State::Common, State::Common, ++releaseValue });
+                        handoff.ReleasesSubmitted(releaseValue);
+                    }
+                    if (const uint64_t wait = handoff.TakeReleaseWait())
+                        gpu.copy.push_back({ Command::Wait, 0, State::Common, State::Common, wait });
+                    std::vector<Handoff::Transition> handed;
+                    for (const auto& [resource, state] : batch)
+                    {
+                        gpu.copy.push_back({ Command::Barrier, resource, State::Common, State::CopyDest, 0 });
+                        gpu.copy.push_back({ Command::Write, resource, State::Common, State::Common, 0 });
+                        //decays to COMMON at the end of the copy queue's list
+                        gpu.copy.push_back({ Command::Barrier, resource, State::CopyDest, State::Common, 0 });
+                        handed.push_back({ resource, state });
+                    }
+                    gpu.copy.push_back({ Command::Signal, 0, State::Common, State::Common, ++copyValue });
+                    handoff.Submitted(copyValue, handed);
+                }
+                else
+                {
+                    //a frame: RecordPendingTransitions, the draws, QueueWait before executing
+                    std::vector<Command> frame;
+                    for (const Handoff::Transition& t : handoff.TakeTransitions())
+                    {
+                        frame.push_back({ Command::Barrier, t.resource, State::Common, t.state, 0 });
+                        finalStates[t.resource] = t.state;
+                    }
+                    for (const auto& [resource, state] : finalStates)
+                        if (handoff.IsHeld(resource))
+                            frame.push_back({ Command::Read, resource, state, state, 0 });
+                    if (const uint64_t wait = handoff.TakeWait())
+                        gpu.direct.push_back({ Command::Wait, 0, State::Common, State::Common, wait });
+                    gpu.direct.insert(gpu.direct.end(), frame.begin(), frame.end());
+                }
+                //the gpu runs a random part of what was submitted, a queue at a time
+                for (int i = 0, n = random() % 8; i < n; i++)
+                    gpu.Step(random() % 2 ? gpu.copy : gpu.direct);
+            }
+            //everything runs in the end, nothing waits forever
+            while (gpu.Step(gpu.copy) || gpu.Step(gpu.direct))
+            {
+            }
+            CHECK(gpu.copy.empty() && gpu.direct.empty());
+            CHECK(gpu.copyFence == copyValue && gpu.releaseFence == releaseValue);
+        }
+    }
+}
+
+int main()
+{
+    TransitionsAndWaitsAreTakenOnce();
+    HeldResourcesAreReleasedBeforeTheProducerUsesThem();
+    ForgottenResourcesAreNotTransitioned();
+    RandomUploadsAndFramesAgree();
+    return 0;
+}
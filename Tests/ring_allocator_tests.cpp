@@ -0,0 +1,293 @@
+#include "pch.h"
+#include "ring_allocator.h"
+#include "check.h"
+#include <algorithm>
+#include <deque>
+#include <random>
+
+using common::RingAllocator;
+
+namespace
+{
+    void WrapsAroundAfterRetire()
+    {
+        RingAllocator ring(100);
+        CHECK(ring.Allocate(40) == 0);
+        CHECK(ring.Allocate(40) == 40);
+        ring.FinishBatch(1);
+        CHECK(ring.Allocate(30) == RingAllocator::INVALID_OFFSET);
+        //one batch per frame, the first one done
+        CHECK(ring.Allocate(10) == 80);
+        ring.FinishBatch(2);
+        CHECK(ring.OldestPendingFence() == 1);
+        ring.Retire(1);
+        CHECK(ring.PendingBatchCount() == 1 && ring.UsedSize() == 10);
+        //doesn't fit in the 10 at the end, goes to 0 and the end is skipped
+        CHECK(ring.Allocate(20) == 0);
+        CHECK(ring.UsedSize() == 40 && ring.CurrentBatchSize() == 30);
+        //the second batch still holds [80, 90)
+        CHECK(ring.Allocate(80) == RingAllocator::INVALID_OFFSET);
+        ring.FinishBatch(3);
+        ring.Retire(3);
+        CHECK(ring.UsedSize() == 0 && ring.PendingBatchCount() == 0 && ring.OldestPendingFence() == 0);
+        //empty starts again from 0, the whole capacity in one piece
+        CHECK(ring.Allocate(100) == 0);
+    }
+
+    void AlignmentPaddingGoesWithTheBatch()
+    {
+        RingAllocator ring(256);
+        CHECK(ring.Allocate(3) == 0);
+        CHECK(ring.Allocate(16, 64) == 64);
+        CHECK(ring.UsedSize() == 80 && ring.CurrentBatchSize() == 80);
+        ring.FinishBatch(5);
+        //an empty batch doesn't keep anything
+        ring.FinishBatch(6);
+        CHECK(ring.PendingBatchCount() == 1);
+        ring.Retire(4);
+        CHECK(ring.UsedSize() == 80);
+        ring.Retire(6);
+        CHECK(ring.UsedSize() == 0);
+    }
+
+    void TooBigOrFull()
+    {
+        RingAllocator ring(64);
+        CHECK(ring.Allocate(65) == RingAllocator::INVALID_OFFSET);
+        CHECK(ring.Allocate(64) == 0);
+        CHECK(ring.Allocate(1) == RingAllocator::INVALID_OFFSET);
+        ring.FinishBatch(1);
+        ring.Retire(0);
+        CHECK(ring.Allocate(1) == RingAllocator::INVALID_OFFSET);
+        ring.Retire(1);
+        CHECK(ring.Allocate(1) == 0);
+    }
+
+    void FitsAfterRetireOnlyCountsTheOpenBatch()
+    {
+        RingAllocator ring(100);
+        CHECK(ring.FitsAfterRetire(100));
+        CHECK(ring.Allocate(40) == 0);
+        ring.FinishBatch(1);
+        CHECK(ring.Allocate(40) == 40);
+        //[0, 40) comes back with the gpu, [40, 80) is the open batch
+        CHECK(ring.Allocate(30) == RingAllocator::INVALID_OFFSET);
+        CHECK(ring.FitsAfterRetire(30));
+        CHECK(ring.FitsAfterRetire(40));
+        //60 are free then, but not in one piece
+        CHECK(!ring.FitsAfterRetire(41));
+        CHECK(!ring.FitsAfterRetire(101));
+        //finishing the open batch makes room for anything
+        ring.FinishBatch(2);
+        CHECK(ring.FitsAfterRetire(100));
+        CHECK(ring.FitsAfterRetire(60, 64) && ring.FitsAfterRetire(64, 64));
+    }
+
+    /// <summary>
+    /// Staging memory like UploadBatch on an UploadRing: Reserve before a pair of copies, the two
+    /// copies carved from what it took, and only then the writes. The gpu checks each copy's bytes
+    /// when it runs the batch, and runs the oldest one when Allocate waits for room, like the ring.
+    /// </summary>
+    struct StandInUploads
+    {
+        static constexpr uint64_t ALIGNMENT = 16;
+        struct Copy
+        {
+            uint64_t offset, size;
+            int id;
+        };
+        RingAllocator ring;
+        //the id that wrote each byte, -1 if nobody did
+        std::vector<int> staging;
+        std::vector<Copy> open;
+        std::deque<std::pair<uint64_t, std::vector<Copy>>> submitted;
+        uint64_t fenceValue = 0;
+        size_t dedicated = 0;
+        uint64_t reserved = RingAllocator::INVALID_OFFSET;
+        uint64_t reservedSize = 0, reservedUsed = 0;
+
+        explicit StandInUploads(uint64_t capacity)
+            :ring(capacity), staging(capacity, -1)
+        {
+        }
+        static uint64_t AlignUp(uint64_t size) { return (size + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT; }
+        /// <summary>
+        /// UploadRing::Allocate, INVALID_OFFSET for a dedicated buffer.
+        /// </summary>
+        uint64_t Allocate(uint64_t size)
+        {
+            uint64_t offset = ring.Allocate(size, ALIGNMENT);
+            while (offset == RingAllocator::INVALID_OFFSET && !submitted.empty())
+            {
+                RunOldest();
+                offset = ring.Allocate(size, ALIGNMENT);
+            }
+            if (offset == RingAllocator::INVALID_OFFSET)
+                dedicated++;
+            return offset;
+        }
+        //UploadBatch::Reserve
+        void Reserve(uint64_t size)
+        {
+            if (size <= ring.Capacity() && ring.CurrentBatchSize() > 0 && !ring.FitsAfterRetire(size, ALIGNMENT))
+                Submit();
+            reserved = Allocate(size);
+            reservedSize = size;
+            reservedUsed = 0;
+        }
+        //UploadBatch::Copy, INVALID_OFFSET for a dedicated buffer
+        uint64_t Stage(uint64_t size, int id)
+        {
+            uint64_t offset;
+            if (reserved != RingAllocator::INVALID_OFFSET && reservedUsed + AlignUp(size) <= reservedSize)
+            {
+                offset = reserved + reservedUsed;
+                reservedUsed += AlignUp(size);
+            }
+            else
+                offset = Allocate(size);
+            if (offset == RingAllocator::INVALID_OFFSET)
+                return offset;
+            std::fill(staging.begin() + offset, staging.begin() + offset + size, -1);
+            open.push_back({ offset, size, id });
+            return offset;
+        }
+        void Write(uint64_t offset, uint64_t size, int id)
+        {
+            if (offset != RingAllocator::INVALID_OFFSET)
+                std::fill(staging.begin() + offset, staging.begin() + offset + size, id);
+        }
+        void Submit()
+        {
+            fenceValue++;
+            ring.FinishBatch(fenceValue);
+            submitted.push_back({ fenceValue, open });
+            open.clear();
+            reserved = RingAllocator::INVALID_OFFSET;
+        }
+        void RunOldest()
+        {
+            for (const Copy& c : submitted.front().second)
+                for (uint64_t i = c.offset; i < c.offset + c.size; i++)
+                    CHECK(staging[i] == c.id);
+            ring.Retire(submitted.front().first);
+            submitted.pop_front();
+        }
+    };
+
+    void AFullRingNeverSubmitsUnwrittenCopies()
+    {
+        std::mt19937 random(13);
+        for (int trial = 0; trial < 100; trial++)
+        {
+            const uint64_t capacity = 1024 + random() % 8192;
+            StandInUploads uploads(capacity);
+            for (int mesh = 0; mesh < 500; mesh++)
+            {
+                //meshes up to nearly the whole ring, like the big ones that get 32 bit indices
+                const uint64_t total = 2 + random() % (capacity - 32);
+                const uint64_t vertices = 1 + random() % (total - 1), indices = total - vertices;
+                uploads.Reserve(StandInUploads::AlignUp(vertices) + StandInUploads::AlignUp(indices));
+                //Copy can't submit: the memory of the first one isn't written until after the second
+                const uint64_t submits = uploads.fenceValue;
+                const uint64_t v = uploads.Stage(vertices, mesh);
+                const uint64_t i = uploads.Stage(indices, mesh);
+                CHECK(uploads.fenceValue == submits);
+                //the fill
+                uploads.Write(v, vertices, mesh);
+                uploads.Write(i, indices, mesh);
+                //the gpu gets some of the work done meanwhile, sometimes the batch is submitted
+                if (random() % 4 == 0)
+                    uploads.Submit();
+                for (int run = 0, n = random() % 3; run < n && !uploads.submitted.empty(); run++)
+                    uploads.RunOldest();
+            }
+            uploads.Submit();
+            while (!uploads.submitted.empty())
+                uploads.RunOldest();
+            //what fits in the ring always got room in it
+            CHECK(uploads.dedicated == 0);
+        }
+    }
+
+    struct Range
+    {
+        uint64_t offset, size, fenceValue;
+    };
+    /// <summary>
+    /// Random frames with a gpu that lags a random number of them behind: the ranges handed out
+    /// never overlap a range whose fence value wasn't reached, and everything comes back.
+    /// </summary>
+    void RandomFramesNeverOverlap()
+    {
+        std::mt19937 random(7);
+        for (int trial = 0; trial < 200; trial++)
+        {
+            const uint64_t capacity = 64 + random() % 4096;
+            RingAllocator ring(capacity);
+            std::vector<Range> pending, current;
+            uint64_t fenceValue = 0, completed = 0;
+            for (int step = 0; step < 5000; step++)
+            {
+                const uint32_t op = random() % 10;
+                if (op < 6)
+                {
+                    const uint64_t size = 1 + random() % (capacity / 3 + 1), alignment = uint64_t(1) << (random() % 6);
+                    //the same as allocating after the gpu finished everything that was submitted
+                    RingAllocator retired(ring);
+                    retired.Retire(fenceValue);
+                    CHECK(ring.FitsAfterRetire(size, alignment) ==
+                        (retired.Allocate(size, alignment) != RingAllocator::INVALID_OFFSET));
+                    const uint64_t offset = ring.Allocate(size, alignment);
+                    if (offset == RingAllocator::INVALID_OFFSET)
+                        continue;
+                    CHECK(offset % alignment == 0 && offset + size <= capacity);
+                    for (const Range& r : pending)
+                        CHECK(offset >= r.offset + r.size || r.offset >= offset + size);
+                    for (const Range& r : current)
+                        CHECK(offset >= r.offset + r.size || r.offset >= offset + size);
+                    current.push_back({ offset, size, 0 });
+                }
+                else if (op < 8)
+                {
+                    fenceValue++;
+                    ring.FinishBatch(fenceValue);
+                    for (Range& r : current)
+                    {
+                        r.fenceValue = fenceValue;
+                        pending.push_back(r);
+                    }
+                    current.clear();
+                }
+                else
+                {
+                    if (completed < fenceValue)
+                        completed += 1 + random() % (fenceValue - completed);
+                    ring.Retire(completed);
+                    std::vector<Range> kept;
+                    for (const Range& r : pending)
+                        if (r.fenceValue > completed)
+                            kept.push_back(r);
+                    pending = kept;
+                }
+                CHECK(ring.UsedSize() <= capacity);
+            }
+            fenceValue++;
+            ring.FinishBatch(fenceValue);
+            ring.Retire(fenceValue);
+            CHECK(ring.UsedSize() == 0 && ring.PendingBatchCount() == 0);
+            CHECK(ring.Allocate(capacity) == 0);
+        }
+    }
+}
+
+int main()
+{
+    WrapsAroundAfterRetire();
+    AlignmentPaddingGoesWithTheBatch();
+    TooBigOrFull();
+    FitsAfterRetireOnlyCountsTheOpenBatch();
+    AFullRingNeverSubmitsUnwrittenCopies();
+    RandomFramesNeverOverlap();
+    return 0;
+}
@@ -0,0 +1,124 @@
+#include "pch.h"
+#include "snapshot_exchange.h"
+#include "check.h"
+#include <map>
+#include <thread>
+
+using common::SnapshotExchange;
+
+namespace
+{
+    struct Snapshot
+    {
+        int id = 0;
+        std::vector<int> values;
+    };
+
+    void NewestSnapshotIsTakenOnce()
+    {
+        SnapshotExchange<Snapshot> exchange;
+        CHECK(!exchange.TryAcquire());
+        exchange.Back().id = 1;
+        exchange.Publish();
+        CHECK(exchange.TryAcquire());
+        CHECK(exchange.Front().id == 1);
+        //nothing new: the front stays
+        CHECK(!exchange.TryAcquire());
+        CHECK(exchange.Front().id == 1);
+        //two publishes before an acquire: the first one is dropped
+        exchange.Back().id = 2;
+        exchange.Publish();
+        exchange.Back().id = 3;
+        exchange.Publish();
+        CHECK(exchange.TryAcquire());
+        CHECK(exchange.Front().id == 3);
+        CHECK(!exchange.TryAcquire());
+    }
+
+    void BuffersAreReused()
+    {
+        SnapshotExchange<Snapshot> exchange;
+        //each buffer the producer gets is marked the first time, the mark has to be there every time after
+        std::map<const Snapshot*, int> marks;
+        for (int i = 0; i < 30; i++)
+        {
+            Snapshot& back = exchange.Back();
+            //the producer never gets the consumer's buffer
+            CHECK(&back != &exchange.Front());
+            auto mark = marks.find(&back);
+            if (mark == marks.end())
+                back.values.assign(1, marks.emplace(&back, int(marks.size())).first->second);
+            else
+                CHECK(back.values.size() == 1 && back.values[0] == mark->second);
+            exchange.Publish();
+            if (i % 3)
+                exchange.TryAcquire();
+        }
+        CHECK(marks.size() == 3);
+    }
+
+    void StopWakesBothSides()
+    {
+        {
+            //nothing published: the consumer waits until the stop
+            SnapshotExchange<Snapshot> exchange;
+            std::thread consumer([&exchange]() { CHECK(!exchange.WaitAndAcquire()); });
+            exchange.Stop();
+            consumer.join();
+        }
+        {
+            //never taken: the producer waits until the stop
+            SnapshotExchange<Snapshot> exchange;
+            exchange.Publish();
+            std::thread producer([&exchange]() { CHECK(!exchange.WaitUntilTaken()); });
+            exchange.Stop();
+            producer.join();
+            //stopped: a snapshot that is there isn't taken by the wait
+            CHECK(!exchange.WaitAndAcquire());
+        }
+    }
+
+    /// <summary>
+    /// A producer that fills each snapshot with its id and a consumer that checks them: a snapshot
+    /// the producer is still writing would have mixed values, and the ids only go up.
+    /// </summary>
+    void ThreadsNeverShareABuffer(bool producerWaits)
+    {
+        SnapshotExchange<Snapshot> exchange;
+        std::thread producer([&exchange, producerWaits]() {
+            for (int id = 1; !exchange.IsStopped(); id++)
+            {
+                Snapshot& back = exchange.Back();
+                back.id = id;
+                back.values.assign(256, id);
+                exchange.Publish();
+                if (producerWaits && !exchange.WaitUntilTaken())
+                    break;
+            }
+        });
+        int last = 0;
+        for (int taken = 0; taken < 20000; taken++)
+        {
+            CHECK(exchange.WaitAndAcquire());
+            const Snapshot& front = exchange.Front();
+            CHECK(front.id > last);
+            //a producer that waits is never more than one snapshot ahead
+            CHECK(!producerWaits || front.id == last + 1);
+            for (int value : front.values)
+                CHECK(value == front.id);
+            last = front.id;
+        }
+        exchange.Stop();
+        producer.join();
+    }
+}
+
+int main()
+{
+    NewestSnapshotIsTakenOnce();
+    BuffersAreReused();
+    StopWakesBothSides();
+    ThreadsNeverShareABuffer(true);
+    ThreadsNeverShareABuffer(false);
+    return 0;
+}
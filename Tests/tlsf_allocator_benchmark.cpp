@@ -0,0 +1,64 @@
+#include "pch.h"
+#include "tlsf_allocator.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+
+using common::TlsfAllocator;
+
+/// <summary>
+/// Times TlsfAllocator on what PlacedResourceAllocator gives it: 64KB aligned buffers from 64KB to
+/// 4MB in a 256MB heap, allocated and freed in a random mix that keeps it about half full. The
+/// sizes and the order are made before the clock starts, only the allocator is timed.
+/// Not a test, run it by hand: tlsf_allocator_benchmark [operations, 1M by default]
+/// </summary>
+int main(int argc, char** argv)
+{
+    const size_t operations = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 1000000;
+    constexpr uint64_t ALIGNMENT = 64 << 10;
+    constexpr uint64_t CAPACITY = 256ull << 20;
+    struct Operation
+    {
+        uint64_t size;
+        //which live allocation a free takes, modulo how many there are
+        uint32_t pick;
+        bool allocate;
+    };
+    std::mt19937 random(15);
+    std::vector<Operation> plan(operations);
+    for (Operation& op : plan)
+        op = { ALIGNMENT * (1 + random() % 64), static_cast<uint32_t>(random()), random() % 2 == 0 };
+
+    TlsfAllocator allocator(CAPACITY);
+    std::vector<TlsfAllocator::Handle> live;
+    live.reserve(CAPACITY / ALIGNMENT);
+    size_t failed = 0;
+    const auto start = std::chrono::steady_clock::now();
+    for (const Operation& op : plan)
+    {
+        //above half full the frees win, so the heap doesn't just fill up
+        const bool allocate = live.empty() || (op.allocate && allocator.UsedSize() < CAPACITY / 2) ||
+            allocator.UsedSize() < CAPACITY / 4;
+        if (allocate)
+        {
+            const TlsfAllocator::Handle h = allocator.Allocate(op.size, ALIGNMENT);
+            if (h == TlsfAllocator::INVALID_HANDLE)
+                failed++;
+            else
+                live.push_back(h);
+        }
+        else
+        {
+            const size_t i = op.pick % live.size();
+            allocator.Free(live[i]);
+            live[i] = live.back();
+            live.pop_back();
+        }
+    }
+    const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::printf("%zu operations in %.1fms, %.1fns each\n", operations, seconds * 1e3, seconds * 1e9 / operations);
+    std::printf("%zu live, %zu free ranges, fragmentation %.3f, %zu allocations didn't fit\n",
+        live.size(), allocator.FreeRangeCount(), allocator.Fragmentation(), failed);
+    return 0;
+}
@@ -0,0 +1,137 @@
+#include "pch.h"
+#include "tlsf_allocator.h"
+#include "check.h"
+#include <iterator>
+#include <map>
+#include <random>
+
+using common::TlsfAllocator;
+
+namespace
+{
+    void FreeNeighboursMerge()
+    {
+        TlsfAllocator a(1000);
+        const TlsfAllocator::Handle x = a.Allocate(100);
+        const TlsfAllocator::Handle y = a.Allocate(200);
+        const TlsfAllocator::Handle z = a.Allocate(300);
+        CHECK(a.Offset(x) == 0 && a.Offset(y) == 100 && a.Offset(z) == 300);
+        CHECK(a.UsedSize() == 600 && a.AllocationCount() == 3 && a.FreeRangeCount() == 1);
+        a.Free(y);
+        CHECK(a.FreeRangeCount() == 2);
+        CHECK(a.Fragmentation() > 0);
+        //merges with the hole before and the free end after
+        a.Free(z);
+        CHECK(a.FreeRangeCount() == 1 && a.LargestFreeRange() == 900);
+        a.Free(x);
+        CHECK(a.FreeRangeCount() == 1 && a.LargestFreeRange() == 1000 && a.Fragmentation() == 0.0);
+        CHECK(a.UsedSize() == 0 && a.AllocationCount() == 0);
+    }
+
+    void HolesAreReused()
+    {
+        TlsfAllocator a(1 << 20);
+        std::vector<TlsfAllocator::Handle> handles;
+        for (int i = 0; i < 16; i++)
+            handles.push_back(a.Allocate(4096));
+        a.Free(handles[5]);
+        //the same size goes back in the hole instead of the big free end
+        const TlsfAllocator::Handle again = a.Allocate(4096);
+        CHECK(a.Offset(again) == 5 * 4096);
+    }
+
+    void AlignmentPaddingStaysFree()
+    {
+        TlsfAllocator a(1 << 20);
+        const TlsfAllocator::Handle small = a.Allocate(100);
+        const TlsfAllocator::Handle aligned = a.Allocate(65536, 65536);
+        CHECK(a.Offset(aligned) == 65536);
+        CHECK(a.Size(aligned) == 65536);
+        //the used size doesn't count the padding, it can still be allocated
+        CHECK(a.UsedSize() == 100 + 65536);
+        const TlsfAllocator::Handle inPadding = a.Allocate(1000);
+        CHECK(a.Offset(inPadding) < 65536);
+        a.Free(small);
+        a.Free(aligned);
+        a.Free(inPadding);
+        CHECK(a.FreeRangeCount() == 1 && a.LargestFreeRange() == a.Capacity());
+    }
+
+    void FullAndEmpty()
+    {
+        TlsfAllocator empty(0);
+        CHECK(empty.Allocate(1) == TlsfAllocator::INVALID_HANDLE);
+        CHECK(empty.LargestFreeRange() == 0);
+        TlsfAllocator a(4096);
+        CHECK(a.Allocate(4097) == TlsfAllocator::INVALID_HANDLE);
+        const TlsfAllocator::Handle all = a.Allocate(4096);
+        CHECK(all != TlsfAllocator::INVALID_HANDLE && a.FreeRangeCount() == 0);
+        CHECK(a.Allocate(1) == TlsfAllocator::INVALID_HANDLE);
+        a.Free(all);
+        //a size that isn't a size class start still fits exactly
+        CHECK(a.Allocate(4095) != TlsfAllocator::INVALID_HANDLE);
+    }
+
+    /// <summary>
+    /// Random sizes from bytes to 64KB, alignments up to 64KB and frees in random order, checked
+    /// against a map of what is alive: no overlaps, right counters, and all one range at the end.
+    /// </summary>
+    void RandomOperationsStayConsistent()
+    {
+        std::mt19937_64 random(1);
+        for (int round = 0; round < 200; round++)
+        {
+            const uint64_t capacity = 1 + random() % (1 << 24);
+            TlsfAllocator a(capacity);
+            //offset -> size, handle
+            std::map<uint64_t, std::pair<uint64_t, TlsfAllocator::Handle>> live;
+            uint64_t used = 0;
+            for (int i = 0; i < 3000; i++)
+            {
+                if (live.empty() || random() % 3)
+                {
+                    const uint64_t size = 1 + random() % (random() % 2 ? 64 : 1 << 16);
+                    const uint64_t alignment = uint64_t(1) << (random() % 17);
+                    const TlsfAllocator::Handle h = a.Allocate(size, alignment);
+                    if (h == TlsfAllocator::INVALID_HANDLE)
+                        continue;
+                    const uint64_t offset = a.Offset(h);
+                    CHECK(offset % alignment == 0 && offset + size <= capacity && a.Size(h) == size);
+                    auto next = live.lower_bound(offset);
+                    CHECK(next == live.end() || next->first >= offset + size);
+                    if (next != live.begin())
+                    {
+                        auto previous = std::prev(next);
+                        CHECK(previous->first + previous->second.first <= offset);
+                    }
+                    live[offset] = { size, h };
+                    used += size;
+                }
+                else
+                {
+                    auto it = live.begin();
+                    std::advance(it, random() % live.size());
+                    a.Free(it->second.second);
+                    used -= it->second.first;
+                    live.erase(it);
+                }
+                CHECK(a.UsedSize() == used && a.AllocationCount() == live.size());
+                CHECK(a.LargestFreeRange() <= a.FreeSize());
+            }
+            for (const auto& [offset, allocation] : live)
+                a.Free(allocation.second);
+            CHECK(a.FreeRangeCount() == 1 && a.LargestFreeRange() == capacity && a.Fragmentation() == 0.0);
+            CHECK(a.Allocate(capacity) != TlsfAllocator::INVALID_HANDLE);
+        }
+    }
+}
+
+int main()
+{
+    FreeNeighboursMerge();
+    HolesAreReused();
+    AlignmentPaddingStaysFree();
+    FullAndEmpty();
+    RandomOperationsStayConsistent();
+    return 0;
+}
@@ -0,0 +1,121 @@
+#include "pch.h"
+#include "vertex_packing.h"
+#include "check.h"
+#include <cmath>
+#include <random>
+
+namespace
+{
+    //a 16 bit unorm step, relative to the extent of the axis
+    constexpr float POSITION_STEP = 1.0f / 65535.0f;
+    //16 bit octahedral codes are around 0.003 degrees apart, but MeasurePackingError gets the
+    //angle from the acos of a float dot product, that can't resolve less than ~0.02 degrees
+    constexpr float MAX_NORMAL_DEGREES = 0.05f;
+    //half floats in [0,1] have at least 11 bits of mantissa
+    constexpr float MAX_UV_ERROR = 1.0f / 4096.0f;
+
+    std::vector<common::Vertex> RandomVertices(size_t count, float sx, float sy, float sz)
+    {
+        std::mt19937 random(2);
+        std::uniform_real_distribution<float> signedUnit(-1, 1), unit(0, 1);
+        std::vector<common::Vertex> vertices;
+        while (vertices.size() < count)
+        {
+            const float x = signedUnit(random), y = signedUnit(random), z = signedUnit(random);
+            const float length = std::sqrt(x * x + y * y + z * z);
+            if (length < 0.001f)
+                continue;
+            vertices.emplace_back(signedUnit(random) * sx, signedUnit(random) * sy, signedUnit(random) * sz,
+                x / length, y / length, z / length, unit(random), unit(random));
+        }
+        return vertices;
+    }
+    /// <summary>
+    /// Bound of the position error: half a quantization step in each axis.
+    /// </summary>
+    float MaxPositionError(const common::QuantizationBounds& bounds)
+    {
+        const float x = bounds.extent.x * POSITION_STEP * 0.5f;
+        const float y = bounds.extent.y * POSITION_STEP * 0.5f;
+        const float z = bounds.extent.z * POSITION_STEP * 0.5f;
+        //plus float rounding of min + unorm * extent
+        return std::sqrt(x * x + y * y + z * z) * 1.01f;
+    }
+
+    void RandomVerticesStayWithinBounds()
+    {
+        const std::vector<common::Vertex> vertices = RandomVertices(100000, 5, 3, 1);
+        const common::QuantizationBounds bounds = common::ComputeQuantizationBounds(vertices.data(), vertices.size());
+        const common::VertexPackingError error = common::MeasurePackingError(vertices.data(), vertices.size());
+        CHECK(error.position <= MaxPositionError(bounds));
+        CHECK(error.normalDegrees <= MAX_NORMAL_DEGREES);
+        CHECK(error.uv <= MAX_UV_ERROR);
+        //and each vertex on its own, not only the max that MeasurePackingError gives
+        for (const common::Vertex& v : vertices)
+        {
+            const common::Vertex decoded = common::UnpackVertex(common::PackVertex(v, bounds), bounds);
+            CHECK(std::fabs(decoded.pos.x - v.pos.x) <= bounds.extent.x * POSITION_STEP * 0.51f);
+            CHECK(std::fabs(decoded.pos.y - v.pos.y) <= bounds.extent.y * POSITION_STEP * 0.51f);
+            CHECK(std::fabs(decoded.pos.z - v.pos.z) <= bounds.extent.z * POSITION_STEP * 0.51f);
+            CHECK(std::fabs(decoded.uv.x - v.uv.x) <= MAX_UV_ERROR);
+            CHECK(std::fabs(decoded.uv.y - v.uv.y) <= MAX_UV_ERROR);
+            const float length = std::sqrt(decoded.normal.x * decoded.normal.x +
+                decoded.normal.y * decoded.normal.y + decoded.normal.z * decoded.normal.z);
+            CHECK(std::fabs(length - 1.0f) < 1e-5f);
+        }
+    }
+
+    void BoundsAreTheCorners()
+    {
+        std::vector<common::Vertex> vertices = {
+            { -1, 2, -3, 0, 0, 1, 0, 0 },
+            { 4, -5, 6, 0, 0, 1, 1, 1 },
+            { 0, 0, 0, 0, 0, 1, 0.5f, 0.5f },
+        };
+        common::PackedVertex packed[3];
+        const common::QuantizationBounds bounds = common::PackVertices(vertices.data(), vertices.size(), packed);
+        CHECK(bounds.min.x == -1 && bounds.min.y == -5 && bounds.min.z == -3);
+        CHECK(bounds.extent.x == 5 && bounds.extent.y == 7 && bounds.extent.z == 9);
+        //the corners of the box are the ends of the unorm range
+        CHECK(packed[0].pos[0] == 0 && packed[0].pos[1] == 65535 && packed[0].pos[2] == 0);
+        CHECK(packed[1].pos[0] == 65535 && packed[1].pos[1] == 0 && packed[1].pos[2] == 65535);
+        CHECK(packed[0].pos[3] == 0);
+    }
+
+    void FlatMeshesKeepTheFlatAxis()
+    {
+        std::vector<common::Vertex> vertices = RandomVertices(1000, 2, 2, 0);
+        for (common::Vertex& v : vertices)
+            v.pos.z = 7.5f;
+        const common::QuantizationBounds bounds = common::ComputeQuantizationBounds(vertices.data(), vertices.size());
+        CHECK(bounds.extent.z == 0);
+        for (const common::Vertex& v : vertices)
+            CHECK(common::UnpackVertex(common::PackVertex(v, bounds), bounds).pos.z == 7.5f);
+        CHECK(common::MeasurePackingError(vertices.data(), vertices.size()).position <= MaxPositionError(bounds));
+    }
+
+    void AxisNormalsAreExact()
+    {
+        const DirectX::XMFLOAT3 axes[] = { { 1, 0, 0 }, { -1, 0, 0 }, { 0, 1, 0 }, { 0, -1, 0 }, { 0, 0, 1 }, { 0, 0, -1 } };
+        for (const DirectX::XMFLOAT3& axis : axes)
+        {
+            const DirectX::XMFLOAT3 decoded = common::OctDecode(common::OctEncode(axis));
+            CHECK(std::fabs(decoded.x - axis.x) < 1e-6f);
+            CHECK(std::fabs(decoded.y - axis.y) < 1e-6f);
+            CHECK(std::fabs(decoded.z - axis.z) < 1e-6f);
+        }
+        //the encoding is in the [-1,1] square
+        const DirectX::XMFLOAT2 folded = common::OctEncode({ 0.6f, -0.64f, -0.48f });
+        CHECK(std::fabs(folded.x) + std::fabs(folded.y) >= 1.0f - 1e-6f);
+        CHECK(std::fabs(folded.x) <= 1 && std::fabs(folded.y) <= 1);
+    }
+}
+
+int main()
+{
+    RandomVerticesStayWithinBounds();
+    BoundsAreTheCorners();
+    FlatMeshesKeepTheFlatAxis();
+    AxisNormalsAreExact();
+    return 0;
+}
@@ -1,7 +1,7 @@
 #include "pch.h"
 #include "../Common/window.h"
 #include "../Common/mesh.h"
-#include "../Common/mesh_load.h"
+#include "../Common/mesh_async_load.h"
 #include "direct3d_context.h"
 #include "Pipeline.h"
 #include "view_projection.h"
@@ -159,22 +159,16 @@ int main()
 }
 
 void LoadMeshes(transforms::Context& ctx) {
-	auto monkeyMeshData = common::LoadMeshes("assets/monkey.glb")[0];
-	std::shared_ptr<common::Mesh> monkeyMesh = std::make_shared<common::Mesh>(
-		monkeyMeshData,
-		ctx.GetDevice(), ctx.GetCommandQueue());
-	gMeshTable.insert({ 0, monkeyMesh });
-
-	auto cubeMeshData = common::LoadMeshes("assets/cube.glb")[0];
-	std::shared_ptr<common::Mesh> cubeMesh = std::make_shared<common::Mesh>(
-		cubeMeshData,
-		ctx.GetDevice(), 
-		ctx.GetCommandQueue());
-	gMeshTable.insert({ 1, cubeMesh });
-
-	auto sphereMeshData = common::LoadMeshes("assets/sphere.glb")[0];
-	std::shared_ptr<common::Mesh> sphereMesh = std::make_shared<common::Mesh>(sphereMeshData,
-		ctx.GetDevice(), ctx.GetCommandQueue());
-	gMeshTable.insert({ 2, sphereMesh });
-
+	//the files are parsed at the same time in the pool, only the upload is one after the other
+	common::ThreadPool pool;
+	auto files = common::io::LoadMeshesAsync(pool, { "monkey.glb", "cube.glb", "sphere.glb" });
+	//and all of them go to the gpu in one submit
+	auto uploadBatch = std::make_shared<common::UploadBatch>(ctx.GetDevice(), ctx.GetCommandQueue(),
+		std::make_shared<common::UploadRing>(ctx.GetDevice()));
+	for (int id = 0; id < files.size(); id++) {
+		common::io::LoadedMeshFile file = files[id].get();
+		gMeshTable.insert({ id, common::io::UploadMeshes(file, ctx.GetDevice(), ctx.GetCommandQueue(),
+			common::VertexFormat::Full, nullptr, uploadBatch)[0] });
+	}
+	uploadBatch->Flush();
 }
@@ -64,29 +64,18 @@ namespace transforms
                 CD3DX12_RESOURCE_BARRIER secondVertexBufferResourceBarrier = CD3DX12_RESOURCE_BARRIER::Transition(_vertexBuffer.Get(),
                     D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_VERTEX_AND_CONSTANT_BUFFER);
                 lst->ResourceBarrier(1, &secondVertexBufferResourceBarrier);
-            });
+            },
+            &fenceWaiter);
         _vertexBufferView.BufferLocation = _vertexBuffer->GetGPUVirtualAddress();
         _vertexBufferView.StrideInBytes = sizeof(Vertex);
         _vertexBufferView.SizeInBytes = vBufferSize;
     }
     void Context::WaitForPreviousFrame()
     {
-        HRESULT hr;
         // if the current fence value is still less than "fenceValue", then we know the GPU has not finished executing
-        // the command queue since it has not reached the "commandQueue->Signal(fence, fenceValue)" command
-        if (fence[frameIndex]->GetCompletedValue() < fenceValue[frameIndex])
-        {
-            // a handle to an event when our fence is unlocked by the gpu
-            HANDLE fenceEvent;
-            fenceEvent = CreateEvent(nullptr, FALSE, FALSE, nullptr);
-            assert(fenceEvent != nullptr);
-            // we have the fence create an event which is signaled once the fence's current value is "fenceValue"
-            hr = fence[frameIndex]->SetEventOnCompletion(fenceValue[frameIndex], fenceEvent);
-            assert(hr == S_OK);
-            // We will wait until the fence has triggered the event that it's current value has reached "fenceValue". once it's value
-            // has reached "fenceValue", we know the command queue has finished executing
-            WaitForSingleObject(fenceEvent, INFINITE);
-        }
+        // the command queue since it has not reached the "commandQueue->Signal(fence, fenceValue)" command.
+        // We wait until the fence's current value has reached "fenceValue", it returns right away if it alredy did
+        fenceWaiter.Wait(fence[frameIndex].Get(), fenceValue[frameIndex]);
         // increment fenceValue for next frame
         fenceValue[frameIndex]++;
         // swap the current rtv buffer index so we draw on the correct buffer
@@ -260,17 +249,15 @@ namespace transforms
 
     void Context::WaitAllFrames()
     {
-        std::vector<HANDLE> fenceEvents(FRAMEBUFFER_COUNT);
+        std::vector<common::FenceWaiter::Point> points;
         for (UINT i = 0; i < FRAMEBUFFER_COUNT; ++i) {
             const UINT64 currentFenceValue = fenceValue[i];
             commandQueue->Signal(fence[i].Get(), currentFenceValue);
             fenceValue[i]++;
-
-            if (fence[i]->GetCompletedValue() < currentFenceValue) {
-                fence[i]->SetEventOnCompletion(currentFenceValue, fenceEvents[i]);
-                WaitForSingleObject(fenceEvents[i], INFINITE);
-            }
+            points.push_back({ fence[i].Get(), currentFenceValue });
         }
+        //all the fences at once
+        fenceWaiter.WaitAll(points);
     }
 
     Context::Context(int w, int h, HWND hwnd)
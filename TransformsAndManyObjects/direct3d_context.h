@@ -1,6 +1,7 @@
 #pragma once
 #include "pch.h"
 #include "../Common/d3d_utils.h"
+#include "../Common/fence_waiter.h"
 //using Microsoft::WRL::ComPtr;
 namespace transforms
 {
@@ -35,6 +36,8 @@ namespace transforms
         std::vector<Microsoft::WRL::ComPtr<ID3D12Fence>> fence; //TODO refactor
         // this value is incremented each frame. each fence will have its own value
         std::vector<uint64_t> fenceValue;
+        // waits on the fences with the same few events, instead of making one each frame
+        common::FenceWaiter fenceWaiter;
         // This is the memory for our depth buffer. it will also be used for a stencil buffer in a later tutorial
         std::vector<Microsoft::WRL::ComPtr<ID3D12Resource>> depthStencilBuffer; 
         // This is a heap for our depth/stencil buffer descriptor
@@ -10,81 +10,97 @@ struct ModelMatrixStruct {
     DirectX::XMFLOAT4X4 matrix;
 };
 
-constexpr UINT numMatrices = 1024; 
+constexpr UINT initialCapacity = 1024;
 constexpr UINT matrixSize = sizeof(ModelMatrixStruct);
-constexpr UINT bufferSize = (numMatrices * matrixSize + 255) & ~255; 
 
 transforms::ModelMatrix::ModelMatrix(Context& ctx)
+    :device(ctx.GetDevice())
 {
+    structuredBuffer.resize(FRAMEBUFFER_COUNT);
+    srvHeap.resize(FRAMEBUFFER_COUNT);
+    uploadBuffer.resize(FRAMEBUFFER_COUNT);
+    mappedData.resize(FRAMEBUFFER_COUNT);
+    matrices.resize(FRAMEBUFFER_COUNT);
+    capacity.resize(FRAMEBUFFER_COUNT);
+    dirty.resize(FRAMEBUFFER_COUNT, common::DirtyRanges(4));
+    for (auto i = 0; i < FRAMEBUFFER_COUNT; i++)
+        CreateBuffers(i, initialCapacity);
+}
+
+void transforms::ModelMatrix::CreateBuffers(int frameId, UINT newCapacity)
+{
+    //the frame alredy waited for its fence, nothing on the gpu uses the old ones
+    capacity[frameId] = newCapacity;
+    const UINT64 bufferSize = (UINT64(newCapacity) * matrixSize + 255) & ~UINT64(255);
     //creates the gpu buffer that'll hold the data
     CD3DX12_HEAP_PROPERTIES heapProperties(D3D12_HEAP_TYPE_DEFAULT);
     CD3DX12_RESOURCE_DESC bufferDesc = CD3DX12_RESOURCE_DESC::Buffer(
         bufferSize, D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS);
-    structuredBuffer.resize(FRAMEBUFFER_COUNT);
-    srvHeap.resize(FRAMEBUFFER_COUNT);
-    for (auto i = 0; i < FRAMEBUFFER_COUNT; i++)
-    {
-        HRESULT r = ctx.GetDevice()->CreateCommittedResource(
-            &heapProperties,
-            D3D12_HEAP_FLAG_NONE,
-            &bufferDesc,
-            D3D12_RESOURCE_STATE_COMMON, // Initial state
-            nullptr,
-            IID_PPV_ARGS(&structuredBuffer[i]));
-        assert(r == S_OK);
-        auto n0 = Concatenate(L"ModelMatrixBuffer", i);
-        structuredBuffer[i]->SetName(n0.c_str());
-        //the heap to hold the views that we'll need.
-        D3D12_DESCRIPTOR_HEAP_DESC srvHeapDesc = {};
-        srvHeapDesc.NumDescriptors = 1; // Just one SRV for now
-        srvHeapDesc.Type = D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV;
-        srvHeapDesc.Flags = D3D12_DESCRIPTOR_HEAP_FLAG_SHADER_VISIBLE;
-        ctx.GetDevice()->CreateDescriptorHeap(&srvHeapDesc, IID_PPV_ARGS(&srvHeap[i]));
-        auto n1 = Concatenate(L"ModelMatrixSRVHeap", i);
-        srvHeap[i]->SetName(n1.c_str());
+    HRESULT r = device->CreateCommittedResource(
+        &heapProperties,
+        D3D12_HEAP_FLAG_NONE,
+        &bufferDesc,
+        D3D12_RESOURCE_STATE_COMMON, // Initial state
+        nullptr,
+        IID_PPV_ARGS(&structuredBuffer[frameId]));
+    assert(r == S_OK);
+    auto n0 = Concatenate(L"ModelMatrixBuffer", frameId);
+    structuredBuffer[frameId]->SetName(n0.c_str());
+    //the heap to hold the views that we'll need.
+    D3D12_DESCRIPTOR_HEAP_DESC srvHeapDesc = {};
+    srvHeapDesc.NumDescriptors = 1; // Just one SRV for now
+    srvHeapDesc.Type = D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV;
+    srvHeapDesc.Flags = D3D12_DESCRIPTOR_HEAP_FLAG_SHADER_VISIBLE;
+    device->CreateDescriptorHeap(&srvHeapDesc, IID_PPV_ARGS(&srvHeap[frameId]));
+    auto n1 = Concatenate(L"ModelMatrixSRVHeap", frameId);
+    srvHeap[frameId]->SetName(n1.c_str());
 
-        //now that i have the heap to hold the view and the resource i create the Shader Resource View
-        //that connects the resource to the view
-        D3D12_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
-        srvDesc.ViewDimension = D3D12_SRV_DIMENSION_BUFFER;
-        srvDesc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
-        srvDesc.Buffer.FirstElement = 0;
-        srvDesc.Buffer.NumElements = numMatrices; // Number of matrices
-        srvDesc.Buffer.StructureByteStride = matrixSize;
-        srvDesc.Buffer.Flags = D3D12_BUFFER_SRV_FLAG_NONE;
-        srvDesc.Format = DXGI_FORMAT_UNKNOWN;
+    //now that i have the heap to hold the view and the resource i create the Shader Resource View
+    //that connects the resource to the view
+    D3D12_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
+    srvDesc.ViewDimension = D3D12_SRV_DIMENSION_BUFFER;
+    srvDesc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
+    srvDesc.Buffer.FirstElement = 0;
+    srvDesc.Buffer.NumElements = newCapacity; // Number of matrices
+    srvDesc.Buffer.StructureByteStride = matrixSize;
+    srvDesc.Buffer.Flags = D3D12_BUFFER_SRV_FLAG_NONE;
+    srvDesc.Format = DXGI_FORMAT_UNKNOWN;
 
-        ctx.GetDevice()->CreateShaderResourceView(structuredBuffer[i].Get(), &srvDesc,
-            srvHeap[i]->GetCPUDescriptorHandleForHeapStart());
-    }
+    device->CreateShaderResourceView(structuredBuffer[frameId].Get(), &srvDesc,
+        srvHeap[frameId]->GetCPUDescriptorHandleForHeapStart());
 
-    //create the staging buffers
+    //create the staging buffer
     CD3DX12_HEAP_PROPERTIES uploadHeapProps(D3D12_HEAP_TYPE_UPLOAD);
     CD3DX12_RESOURCE_DESC uploadBufferDesc = CD3DX12_RESOURCE_DESC::Buffer(bufferSize);
-    uploadBuffer.resize(FRAMEBUFFER_COUNT);
-    mappedData.resize(FRAMEBUFFER_COUNT);
-    for (auto i = 0; i < FRAMEBUFFER_COUNT; i++)
-    {
-        ctx.GetDevice()->CreateCommittedResource(
-            &uploadHeapProps,
-            D3D12_HEAP_FLAG_NONE,
-            &uploadBufferDesc,
-            D3D12_RESOURCE_STATE_GENERIC_READ,
-            nullptr,
-            IID_PPV_ARGS(&uploadBuffer[i]));
-        auto n0 = Concatenate(L"ModelMatrixStagingBuffer", i);
-        uploadBuffer[i]->SetName(n0.c_str());
-        uploadBuffer[i]->Map(0, nullptr, &mappedData[i]);
-    }
+    device->CreateCommittedResource(
+        &uploadHeapProps,
+        D3D12_HEAP_FLAG_NONE,
+        &uploadBufferDesc,
+        D3D12_RESOURCE_STATE_GENERIC_READ,
+        nullptr,
+        IID_PPV_ARGS(&uploadBuffer[frameId]));
+    auto n2 = Concatenate(L"ModelMatrixStagingBuffer", frameId);
+    uploadBuffer[frameId]->SetName(n2.c_str());
+    uploadBuffer[frameId]->Map(0, nullptr, &mappedData[frameId]);
+    //nothing was uploaded to the new buffers, so no matrix matches what they have
+    matrices[frameId].resize(newCapacity);
+    memset(matrices[frameId].data(), 0xFF, matrices[frameId].size() * matrixSize);
+    dirty[frameId].Clear();
 }
 
 void transforms::ModelMatrix::UploadData(std::vector<Transform*>& transforms,
     int frameId,  Microsoft::WRL::ComPtr<ID3D12GraphicsCommandList> commandList)
 {
-    //fill the staging buffer
+    //grows this frame's buffers if an id doesn't fit, twice as big at least
+    int highestId = -1;
+    for (const Transform* t : transforms)
+        highestId = (std::max)(highestId, t->id);
+    if (highestId >= static_cast<int>(capacity[frameId]))
+        CreateBuffers(frameId, (std::max)(static_cast<UINT>(highestId) + 1, capacity[frameId] * 2));
+    //fill the staging buffer, only where the matrix changed
     void* baseAddress = mappedData[frameId];
     ModelMatrixStruct* structs = reinterpret_cast<ModelMatrixStruct*>(baseAddress);
-    ZeroMemory(structs, bufferSize);
+    std::vector<DirectX::XMFLOAT4X4>& frameMatrices = matrices[frameId];
     for (int i = 0; i < transforms.size(); i++)
     {
         using namespace DirectX;
@@ -93,17 +109,19 @@ void transforms::ModelMatrix::UploadData(std::vector<Transform*>& transforms,
         XMMATRIX rotationMatrix = XMMatrixRotationQuaternion(t->rotation);
         XMMATRIX translationMatrix = XMMatrixTranslation(t->position.x, t->position.y, t->position.z);
         XMMATRIX __modelMatrix = DirectX::XMMatrixTranspose(scaleMatrix * rotationMatrix * translationMatrix);
-        XMStoreFloat4x4(&structs[t->id].matrix, __modelMatrix);
+        XMFLOAT4X4 stored;
+        XMStoreFloat4x4(&stored, __modelMatrix);
+        if (memcmp(&stored, &frameMatrices[t->id], matrixSize) == 0)
+            continue;
+        frameMatrices[t->id] = stored;
+        structs[t->id].matrix = stored;
+        dirty[frameId].Mark(static_cast<uint32_t>(t->id));
+    }
+    //copy the changed ranges, the staging buffer has the same layout as the gpu one
+    for (const common::DirtyRanges::Range& range : dirty[frameId].Take())
+    {
+        const UINT64 offset = UINT64(range.first) * matrixSize;
+        commandList->CopyBufferRegion(structuredBuffer[frameId].Get(), offset,
+            uploadBuffer[frameId].Get(), offset, UINT64(range.count) * matrixSize);
     }
-    //copy the staging buffer
-    D3D12_SUBRESOURCE_DATA subresourceData = {};
-    subresourceData.pData = baseAddress;
-    subresourceData.RowPitch = sizeof(DirectX::XMFLOAT4X4) * numMatrices;
-    subresourceData.SlicePitch = subresourceData.RowPitch;
-    UpdateSubresources(commandList.Get(), 
-        structuredBuffer[frameId].Get(),
-        uploadBuffer[frameId].Get(), 
-        0, 0, 1, &subresourceData);
-
-
 }
@@ -1,6 +1,7 @@
 #pragma once
 #include "pch.h"
 #include "transform.h"
+#include "../Common/dirty_ranges.h"
 namespace transforms
 {
 	class Context;
@@ -10,6 +11,8 @@ namespace transforms
 		ModelMatrix(Context& ctx);
 		/// <summary>
 		/// Remember that the transforms MUST BE on the same ordering here and where the draw call is done.
+		/// Only the matrices that changed since this frame's buffer was last uploaded are copied.
+		/// The buffers of the frame grow if an id doesn't fit, get the DescriptorHeap after this.
 		/// </summary>
 		/// <param name="transforms"></param>
 		/// <param name="frameId"></param>
@@ -19,6 +22,13 @@ namespace transforms
 			return srvHeap[frameId];
 		}
 	private:
+		/// <summary>
+		/// The gpu buffer, its view and the staging buffer of a frame, for newCapacity matrices.
+		/// </summary>
+		void CreateBuffers(int frameId, UINT newCapacity);
+		Microsoft::WRL::ComPtr<ID3D12Device> device;
+		//how many matrices each frame's buffers have room for
+		std::vector<UINT> capacity;
 		std::vector<Microsoft::WRL::ComPtr<ID3D12Resource>> structuredBuffer;
 		//Shader Resource View heap
 		std::vector<Microsoft::WRL::ComPtr<ID3D12DescriptorHeap>> srvHeap;
@@ -26,6 +36,9 @@ namespace transforms
 		std::vector<Microsoft::WRL::ComPtr<ID3D12Resource>> uploadBuffer;
 		//maps the uploadBuffer
 		std::vector<void*> mappedData;
+		//what each frame's gpu buffer has, upload heaps are too slow to read back from
+		std::vector<std::vector<DirectX::XMFLOAT4X4>> matrices;
+		std::vector<common::DirtyRanges> dirty;
 
 	};
 }